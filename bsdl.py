@@ -0,0 +1,403 @@
+"""
+@file bsdl.py
+
+@brief BSDL parser of the host, and the library of compact boundary scan
+        pin maps built from it, keyed by IDCODE.
+        A BSDL file is parsed for its INSTRUCTION_LENGTH, INSTRUCTION_OPCODE,
+        IDCODE_REGISTER, BOUNDARY_LENGTH and BOUNDARY_REGISTER, and compiled
+        into a binary pin map that the Jtagger driver (src/bscan/bscan_map.h)
+        and the host tools load as is, without parsing text.
+
+        Pin map layout (little endian):
+            header       : magic "BM", version u8, IR length u8, IDCODE u32,
+                           IDCODE mask u32, EXTEST u32, SAMPLE u32,
+                           boundary length u16, names length u16, instructions u16
+            names        : NUL terminated strings, the entity name first
+            cells        : per cell -> port u16 (offset in names, 0xFFFF for none),
+                           function | safe << 4 | disable << 6 u8,
+                           control cell u16 (0xFFFF for none)
+            instructions : per opcode -> name u16 (offset in names), opcode u32
+
+        Library layout (little endian):
+            header  : magic "JBSL", version u16, number of maps u16
+            index   : per map -> idcode u32, idcode mask u32, map offset u32, map length u32
+            maps    : the pin maps, in index order
+
+        Usage:
+            python3 bsdl.py build <BSDL files or directories> [-o library]
+            python3 bsdl.py show <idcode> [-l library]
+            python3 bsdl.py compile <BSDL file> -o <pin map>
+
+        When the driver asks for the pin map of a device with
+        "@bsdl 0x<idcode> <bytes per chunk>", the map is sent in chunks as
+        frames (see dump.py), a chunk for every 'R' byte the driver sends,
+        then an empty frame. A device without a map gets the empty frame only.
+
+@author Michael Vigdorchik
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import time
+
+from program import send_frame
+
+MAGIC = b"JBSL"
+VERSION = 1
+
+MAP_MAGIC = b"BM"
+MAP_VERSION = 1
+
+BSDL_HEADER = "@bsdl"
+
+# read attempts (of the serial timeout) while waiting for the driver to ask for a chunk
+READY_RETRIES = 10
+
+HEADER = struct.Struct("<4sHH")
+INDEX_ENTRY = struct.Struct("<IIII")
+MAP_HEADER = struct.Struct("<2sBBIIIIHHH")
+MAP_CELL = struct.Struct("<HBH")
+MAP_INSTRUCTION = struct.Struct("<HI")
+
+NONE = 0xFFFF
+
+# cell functions, as in src/bscan/bscan.h
+FUNCTIONS = {
+    "INPUT": 0,
+    "OUTPUT2": 1,
+    "OUTPUT3": 2,
+    "CONTROL": 3,
+    "CONTROLR": 4,
+    "INTERNAL": 5,
+    "BIDIR": 6,
+    "CLOCK": 7,
+    "OBSERVE_ONLY": 8,
+}
+SAFE_X = 2
+
+BSDL_EXTENSIONS = (".bsd", ".bsdl", ".bsm")
+
+# compiled once: a vendor library is hundreds of files
+COMMENT = re.compile(r"--[^\n]*")
+ENTITY = re.compile(r"\bentity\s+(\w+)\s+is\b", re.IGNORECASE)
+ATTRIBUTE = re.compile(r"\battribute\s+(\w+)\s+of\s+\w+\s*:\s*entity\s+is\s+((?:\"[^\"]*\"|[^;\"])*);", re.IGNORECASE)
+STRING = re.compile(r"\"([^\"]*)\"")
+OPCODE = re.compile(r"(\w+)\s*\(([^)]*)\)")
+CELL = re.compile(r"(\d+)\s*\(\s*(\w+)\s*,\s*(\*|[\w.]+(?:\s*\(\s*\d+\s*\))?)\s*,\s*(\w+)\s*,\s*(\w)"
+                  r"(?:\s*,\s*(\d+)\s*,\s*(\d)\s*,\s*(\w+))?\s*\)")
+
+
+class BsdlError(Exception):
+    pass
+
+
+class BsdlModel():
+    """Boundary scan model of a device, as described by its BSDL"""
+
+    def __init__(self, name) -> None:
+        self.name = name
+        self.ir_len = 0
+        self.idcode = 0
+        self.mask = 0
+        self.instructions = {}  # name -> opcode
+        self.length = 0
+        self.cells = []         # by cell number: (port or None, function, safe, control or None, disable)
+
+    def opcode(self, *names) -> int:
+        for name in names:
+            if name in self.instructions:
+                return self.instructions[name]
+        raise BsdlError(f"{self.name} has no {' or '.join(names)} instruction")
+
+    def encode(self) -> bytes:
+        """Compile the model into a pin map"""
+        names = bytearray()
+        offsets = {}
+
+        def name_offset(name):
+            if name not in offsets:
+                offsets[name] = len(names)
+                names.extend(name.encode("ascii") + b"\0")
+            return offsets[name]
+
+        name_offset(self.name)
+        cells = b"".join(MAP_CELL.pack(NONE if port is None else name_offset(port),
+                                       function | safe << 4 | disable << 6,
+                                       NONE if control is None else control)
+                         for port, function, safe, control, disable in self.cells)
+        instructions = b"".join(MAP_INSTRUCTION.pack(name_offset(name), opcode)
+                                for name, opcode in sorted(self.instructions.items()))
+        if len(names) >= NONE:
+            raise BsdlError(f"{self.name} has too many port names")
+
+        header = MAP_HEADER.pack(MAP_MAGIC, MAP_VERSION, self.ir_len, self.idcode, self.mask,
+                                 self.opcode("EXTEST"), self.opcode("SAMPLE", "SAMPLE/PRELOAD", "PRELOAD"),
+                                 self.length, len(names), len(self.instructions))
+        return header + bytes(names) + cells + instructions
+
+
+def decode(data) -> BsdlModel:
+    """Load a pin map back into a model"""
+    magic, version, ir_len, idcode, mask, _, _, length, names_len, count = MAP_HEADER.unpack_from(data, 0)
+    if magic != MAP_MAGIC or version != MAP_VERSION:
+        raise BsdlError("not a jtagger pin map")
+
+    names = data[MAP_HEADER.size:MAP_HEADER.size + names_len]
+
+    def name_at(offset):
+        return names[offset:names.index(b"\0", offset)].decode("ascii")
+
+    model = BsdlModel(name_at(0))
+    model.ir_len, model.idcode, model.mask, model.length = ir_len, idcode, mask, length
+
+    offset = MAP_HEADER.size + names_len
+    for port, flags, control in MAP_CELL.iter_unpack(data[offset:offset + length * MAP_CELL.size]):
+        model.cells.append((None if port == NONE else name_at(port), flags & 0xf, (flags >> 4) & 3,
+                            None if control == NONE else control, (flags >> 6) & 1))
+
+    offset += length * MAP_CELL.size
+    for name, opcode in MAP_INSTRUCTION.iter_unpack(data[offset:offset + count * MAP_INSTRUCTION.size]):
+        model.instructions[name_at(name)] = opcode
+    return model
+
+
+def parse(text, path="BSDL") -> BsdlModel:
+    """Parse the attributes of a BSDL text that describe its boundary scan"""
+    text = COMMENT.sub("", text)
+
+    entity = ENTITY.search(text)
+    if not entity:
+        raise BsdlError(f"{path}: no entity")
+    model = BsdlModel(entity.group(1))
+
+    # string values are concatenated with '&', only their contents matter
+    attributes = {}
+    for match in ATTRIBUTE.finditer(text):
+        value = match.group(2)
+        strings = STRING.findall(value)
+        attributes[match.group(1).upper()] = "".join(strings) if strings else value.strip()
+
+    for required in ("INSTRUCTION_LENGTH", "INSTRUCTION_OPCODE", "BOUNDARY_LENGTH", "BOUNDARY_REGISTER"):
+        if required not in attributes:
+            raise BsdlError(f"{path}: no {required}")
+
+    try:
+        model.ir_len = int(attributes["INSTRUCTION_LENGTH"])
+        model.length = int(attributes["BOUNDARY_LENGTH"])
+    except ValueError:
+        raise BsdlError(f"{path}: bad INSTRUCTION_LENGTH or BOUNDARY_LENGTH")
+    if not 0 < model.ir_len <= 32:
+        raise BsdlError(f"{path}: IR length {model.ir_len} is not supported")
+
+    # an instruction with several opcodes takes the first one, X bits are taken as 0
+    for name, opcodes in OPCODE.findall(attributes["INSTRUCTION_OPCODE"]):
+        opcode = opcodes.split(",")[0].strip().upper().replace("X", "0")
+        if len(opcode) != model.ir_len or set(opcode) - {"0", "1"}:
+            raise BsdlError(f"{path}: bad opcode of {name}")
+        model.instructions.setdefault(name.upper(), int(opcode, 2))
+
+    # X bits (usually the version) do not identify the part
+    idcode = re.sub(r"\s", "", attributes.get("IDCODE_REGISTER", "")).upper()
+    if len(idcode) == 32 and not set(idcode) - {"0", "1", "X"}:
+        model.idcode = int(idcode.replace("X", "0"), 2)
+        model.mask = int("".join("0" if bit == "X" else "1" for bit in idcode), 2)
+
+    cells = [None] * model.length
+    for number, _, port, function, safe, control, disable, _ in CELL.findall(attributes["BOUNDARY_REGISTER"]):
+        number = int(number)
+        function = function.upper()
+        if number >= model.length or function not in FUNCTIONS:
+            raise BsdlError(f"{path}: bad boundary register cell {number}")
+
+        # a merged cell is listed again for its second function, the one with a port wins
+        if cells[number] is not None and (cells[number][0] is not None or port == "*"):
+            continue
+        cells[number] = (None if port == "*" else "".join(port.split()), FUNCTIONS[function],
+                         SAFE_X if safe.upper() == "X" else int(safe) & 1,
+                         int(control) if control else None, int(disable) if disable else 0)
+
+    missing = [number for number, cell in enumerate(cells) if cell is None]
+    if missing:
+        raise BsdlError(f"{path}: boundary register cell {missing[0]} is missing")
+    model.cells = cells
+    return model
+
+
+def parse_file(path) -> BsdlModel:
+    with open(path, "r", encoding="latin-1") as f:
+        return parse(f.read(), path)
+
+
+def find_files(paths) -> list:
+    """BSDL files of the paths, directories are searched recursively"""
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            for root, _, names in os.walk(path):
+                files += [os.path.join(root, name) for name in names if name.lower().endswith(BSDL_EXTENSIONS)]
+        else:
+            files.append(path)
+    return sorted(files)
+
+
+class BsdlLibrary():
+    def __init__(self, path) -> None:
+        self.path = path
+        self.maps = {}  # (idcode, mask) -> pin map
+        if os.path.exists(path):
+            self.load()
+
+    def load(self):
+        with open(self.path, "rb") as f:
+            data = f.read()
+
+        magic, version, count = HEADER.unpack_from(data, 0)
+        if magic != MAGIC or version != VERSION:
+            raise ValueError(f"{self.path} is not a jtagger BSDL library")
+
+        for idcode, mask, offset, length in INDEX_ENTRY.iter_unpack(data[HEADER.size:HEADER.size + count * INDEX_ENTRY.size]):
+            self.maps[(idcode, mask)] = data[offset:offset + length]
+
+    def save(self):
+        keys = sorted(self.maps)
+        index = []
+        offset = HEADER.size + INDEX_ENTRY.size * len(keys)
+        for key in keys:
+            index.append(INDEX_ENTRY.pack(*key, offset, len(self.maps[key])))
+            offset += len(self.maps[key])
+
+        # write to a temporary file first, so a crash never leaves a broken library
+        tmp = self.path + ".tmp"
+        with open(tmp, "wb") as f:
+            f.write(HEADER.pack(MAGIC, VERSION, len(keys)) + b"".join(index) + b"".join(self.maps[key] for key in keys))
+        os.replace(tmp, self.path)
+
+    def add(self, model) -> bool:
+        """@return False if a map of the same IDCODE is already in the library"""
+        key = (model.idcode & model.mask, model.mask)
+        if key in self.maps:
+            return False
+        self.maps[key] = model.encode()
+        return True
+
+    def lookup(self, idcode) -> bytes:
+        """@return the pin map of a device, the one with the most IDCODE bits if several match"""
+        found = None
+        for (part, mask), data in self.maps.items():
+            if idcode & mask == part and (found is None or bin(mask).count("1") > bin(found[0]).count("1")):
+                found = (mask, data)
+        return found[1] if found else None
+
+
+def send_map(ser, line, library):
+    """Send the pin map of the device in the "@bsdl" line as the driver asks for it."""
+    fields = line.split()
+    if len(fields) != 3 or fields[0] != BSDL_HEADER:
+        raise BsdlError(f"bad bsdl header: {line.strip()}")
+    idcode, chunk = int(fields[1], 16), int(fields[2], 10)
+
+    data = library.lookup(idcode) if library else None
+    if data is None:
+        print(f"No BSDL of IDCODE 0x{idcode:08X} in the library")
+        data = b""
+
+    sent = 0
+    retries = 0
+    ended = False
+    while not ended:
+        credit = ser.read(1)
+        if not credit:
+            retries += 1
+            if retries > READY_RETRIES:
+                raise BsdlError("driver stopped asking for the pin map")
+            continue
+        retries = 0
+
+        if credit == b"X":
+            raise BsdlError("pin map refused by the driver")
+        if credit != b"R":
+            continue
+
+        send_frame(ser, data[sent:sent + chunk])
+        ended = sent == len(data)
+        sent += len(data[sent:sent + chunk])
+
+    ser.flush()
+    if data:
+        print(f"Pin map of {decode(data).name} sent, {len(data)} bytes")
+
+
+def build(paths, path) -> BsdlLibrary:
+    library = BsdlLibrary(path)
+    start = time.time()
+    files = find_files(paths)
+    added = 0
+
+    for name in files:
+        try:
+            model = parse_file(name)
+        except (OSError, BsdlError) as error:
+            print(f"Skipped: {error}")
+            continue
+        if model.mask == 0:
+            print(f"Skipped: {name}: no IDCODE_REGISTER")
+        elif not library.add(model):
+            print(f"Skipped: {name}: IDCODE 0x{model.idcode:08X} is already in the library")
+        else:
+            added += 1
+
+    library.save()
+    print(f"{added} of {len(files)} BSDL files added in {time.time() - start:.2f} s, {len(library.maps)} pin maps in {path}")
+    return library
+
+
+def show(model):
+    print(f"{model.name}: IDCODE 0x{model.idcode:08X} mask 0x{model.mask:08X}, IR length {model.ir_len}, "
+          f"{model.length} cells")
+    for name, opcode in sorted(model.instructions.items(), key=lambda item: item[1]):
+        print(f"  {name:<16} {opcode:0{model.ir_len}b}")
+    functions = {value: name for name, value in FUNCTIONS.items()}
+    for number, (port, function, safe, control, disable) in enumerate(model.cells):
+        line = f"  {number:5} {port or '*':<16} {functions[function]:<12} {'X' if safe == SAFE_X else safe}"
+        if control is not None:
+            line += f"  control {control}, off at {disable}"
+        print(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="BSDL pin maps of the Jtagger boundary scan")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    command = commands.add_parser("build", help="add the BSDL files to the library")
+    command.add_argument("paths", nargs="+", help="BSDL files, or directories of them")
+    command.add_argument("-o", "--library", default="jtagger_bsdl.bin", help="library file (default: %(default)s)")
+
+    command = commands.add_parser("show", help="print the pin map of an IDCODE")
+    command.add_argument("idcode", type=lambda value: int(value, 16))
+    command.add_argument("-l", "--library", default="jtagger_bsdl.bin", help="library file (default: %(default)s)")
+
+    command = commands.add_parser("compile", help="compile a BSDL file into a pin map file")
+    command.add_argument("path")
+    command.add_argument("-o", "--output", required=True)
+
+    args = parser.parse_args()
+    try:
+        if args.command == "build":
+            build(args.paths, args.library)
+        elif args.command == "show":
+            data = BsdlLibrary(args.library).lookup(args.idcode)
+            if data is None:
+                sys.exit(f"No BSDL of IDCODE 0x{args.idcode:08X} in {args.library}")
+            show(decode(data))
+        else:
+            with open(args.output, "wb") as f:
+                f.write(parse_file(args.path).encode())
+    except (OSError, BsdlError) as error:
+        sys.exit(str(error))
+
+
+if __name__ == "__main__":
+    main()
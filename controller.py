@@ -7,11 +7,19 @@
 @author Michael Vigdorchik
 """
 
+import argparse
 import serial
 import sys
 import time
 from serial.tools import list_ports
 
+from bsdl import BSDL_HEADER, BsdlError, BsdlLibrary, send_map
+from dump import (DCC_EXIT_CHAR, DCC_HEADER, DUMP_HEADER, INCREMENTAL_DUMP_HEADER, DumpError, receive_dcc, receive_dump,
+                  receive_incremental_dump)
+from gdb_bridge import GDB_HEADER, GDB_PORT, BridgeError, serve as serve_gdb
+from irdb import InstructionDB
+from program import PROGRAM_HEADER, ProgramError, send_image
+
 
 def list_available_ports() -> list:
     """List all available serial ports"""
@@ -43,6 +51,9 @@ def get_user_port_selection(ports) -> str:
 # globals
 INPUT_CHAR = ">"
 
+# the driver requests the known instructions of a part with this prompt
+IRMAP_REQUEST = "@irmap?"
+
 # uart propreties
 BAUD = 115200
 TIMEOUT = 1  # sec
@@ -55,7 +66,15 @@ TIMEOUT = 1  # sec
 
 
 class Communicator():
-    def __init__(self, port) -> None:
+    def __init__(self, port, irdb=None, dump_dir=".", image=None, bitswap=False, gdb_port=GDB_PORT, bsdl=None,
+                 dcc_log=None) -> None:
+        self.irdb = irdb
+        self.dcc_log = dcc_log
+        self.bsdl = bsdl
+        self.gdb_port = gdb_port
+        self.dump_dir = dump_dir
+        self.image = image
+        self.bitswap = bitswap
         self.s = serial.Serial(
             port=port,
             baudrate=BAUD,
@@ -68,6 +87,8 @@ class Communicator():
         self.s.flushOutput()
     
     def close(self):
+        if self.irdb:
+            self.irdb.save()
         self.s.flush()
         self.s.close()
         print("\nSerial connection closed")
@@ -88,8 +109,71 @@ class Communicator():
                 sys.stdout.write(r)
                 sys.stdout.flush()
 
+                # instruction database records and requests are handled without the user
+                if self.irdb and self.irdb.handle_line(r.strip()):
+                    continue
+
+                # binary flash dump follows the header line
+                if r.startswith(DUMP_HEADER) or r.startswith(INCREMENTAL_DUMP_HEADER):
+                    try:
+                        if r.startswith(INCREMENTAL_DUMP_HEADER):
+                            receive_incremental_dump(self.s, r, self.dump_dir)
+                        else:
+                            receive_dump(self.s, r, self.dump_dir)
+                    except DumpError as error:
+                        print(f"\nDump failed: {error}")
+                        # drop the rest of the stream
+                        time.sleep(TIMEOUT)
+                        self.s.reset_input_buffer()
+                    continue
+
+                # the log of a running core, until the user stops it
+                if r.startswith(DCC_HEADER):
+                    try:
+                        receive_dcc(self.s, r, self.dcc_log)
+                    except (OSError, DumpError) as error:
+                        print(f"\nDCC log failed: {error}")
+                        self.s.write(DCC_EXIT_CHAR)
+                        time.sleep(TIMEOUT)
+                        self.s.reset_input_buffer()
+                    continue
+
+                # the driver asks for the chunks of the image to program
+                if r.startswith(PROGRAM_HEADER):
+                    path = self.image or input("Image file to program > ")
+                    try:
+                        send_image(self.s, r, path, self.bitswap)
+                    except (OSError, ProgramError) as error:
+                        print(f"\nProgramming failed: {error}")
+                    continue
+
+                # the driver serves a GDB session through the bridge
+                if r.startswith(GDB_HEADER):
+                    try:
+                        serve_gdb(self.s, r, self.gdb_port)
+                    except (OSError, BridgeError) as error:
+                        print(f"\nGDB bridge failed: {error}")
+                    continue
+
+                # the driver asks for the boundary scan pin map of a device
+                if r.startswith(BSDL_HEADER):
+                    try:
+                        send_map(self.s, r, self.bsdl)
+                    except BsdlError as error:
+                        print(f"\nPin map transfer failed: {error}")
+                    continue
+
+                if IRMAP_REQUEST in r:
+                    idcode = int(r.split()[1], 16)
+                    w = self.irdb.encode_for_device(idcode) if self.irdb else b"\n"
+                    self.s.write(w)
+                    self.s.flush()
+                    continue
+
                 # user input is required - return
                 if INPUT_CHAR in r:
+                    if self.irdb:
+                        self.irdb.save()
                     w = (input() + '\n').encode()
                     self.s.write(w)
                     self.s.flush()
@@ -104,6 +188,23 @@ class Communicator():
 
 
 def main():
+    parser = argparse.ArgumentParser(description="Jtagger host controller")
+    parser.add_argument("--irdb", default="jtagger_irdb.bin",
+                        help="instruction database file, keyed by IDCODE (default: %(default)s)")
+    parser.add_argument("--dump-dir", default="dumps",
+                        help="directory of the flash images received from the driver (default: %(default)s)")
+    parser.add_argument("--image",
+                        help="flash image to program, asked for when programming starts if not given")
+    parser.add_argument("--bitswap", action="store_true",
+                        help="reverse the bits of every byte of the image (some RPD exports)")
+    parser.add_argument("--gdb-port", type=int, default=GDB_PORT,
+                        help="local TCP port of the GDB bridge (default: %(default)s)")
+    parser.add_argument("--bsdl", default="jtagger_bsdl.bin",
+                        help="BSDL pin map library, built by bsdl.py (default: %(default)s)")
+    parser.add_argument("--dcc-log",
+                        help="file the DCC log of a running core is appended to, only printed if not given")
+    args = parser.parse_args()
+
     ports = list_available_ports()
     if not ports:
         return
@@ -113,7 +214,8 @@ def main():
     if not port:
         return
 
-    c = Communicator(port)
+    c = Communicator(port, InstructionDB(args.irdb), args.dump_dir, args.image, args.bitswap, args.gdb_port,
+                     BsdlLibrary(args.bsdl), args.dcc_log)
     while True:
         if not c.interact():
             break
@@ -0,0 +1,225 @@
+"""
+@file dump.py
+
+@brief Receiver of the binary flash dumps that the Jtagger driver streams.
+        A dump starts with a single text line that encodes the range:
+
+            "@dump 0x<start address> <number of words> <words per frame>"
+
+        followed by binary frames, every frame is:
+
+            length u16 (bytes) | payload | crc32 u32 of the payload   (little endian)
+
+        The payload holds raw 32 bit flash words (little endian), and is written
+        as is to the image file. An empty frame ends the dump.
+
+        An incremental dump ("@idump 0x<start> <number of words> <words per sector>")
+        patches the cached image of the same range. The driver asks for the
+        checksums of the cached sectors, and sends only the sectors that differ:
+
+            'C' first u32, count u32 -> host answers with count crc32 u32 values
+            'S' index u32, words     -> a changed sector
+            'T' crc32 u32            -> checksum of the whole range
+
+        The log of a running Cortex-M (DCC, "@dcc <words per frame>") comes in
+        the same frames, the payload is the text the target wrote. It ends with
+        an empty frame, after the host sent Ctrl-] (DCC_EXIT_CHAR).
+
+@author Michael Vigdorchik
+"""
+
+import os
+import struct
+import sys
+import time
+import zlib
+
+DUMP_HEADER = "@dump"
+INCREMENTAL_DUMP_HEADER = "@idump"
+DCC_HEADER = "@dcc"
+
+# ends the DCC stream of the driver (Ctrl-])
+DCC_EXIT_CHAR = b"\x1d"
+
+FRAME_LEN = struct.Struct("<H")
+FRAME_CRC = struct.Struct("<I")
+
+
+class DumpError(Exception):
+    pass
+
+
+def read_exact(ser, size) -> bytes:
+    data = b""
+    while len(data) < size:
+        chunk = ser.read(size - len(data))
+        if not chunk:
+            raise DumpError("timeout while receiving a dump frame")
+        data += chunk
+    return data
+
+
+def read_frame(ser) -> bytes:
+    """Read a single frame and check its CRC. @return The payload, empty at the end of a stream."""
+    (length,) = FRAME_LEN.unpack(read_exact(ser, FRAME_LEN.size))
+    payload = read_exact(ser, length)
+    (crc,) = FRAME_CRC.unpack(read_exact(ser, FRAME_CRC.size))
+    if zlib.crc32(payload) != crc:
+        raise DumpError("bad frame checksum")
+    return payload
+
+
+def parse_header(line, name=DUMP_HEADER) -> tuple:
+    """@return (start address, number of words, words per frame or sector) of a dump header line"""
+    fields = line.split()
+    if len(fields) != 4 or fields[0] != name:
+        raise DumpError(f"bad dump header: {line.strip()}")
+    return int(fields[1], 16), int(fields[2], 10), int(fields[3], 10)
+
+
+def image_path(out_dir, start, words) -> str:
+    """Image file of a dumped range, an incremental dump of the same range patches it"""
+    return os.path.join(out_dir, f"dump_{start:06x}_{words}.bin")
+
+
+def receive_dump(ser, line, out_dir) -> str:
+    """
+    Receive the frames of a dump that started with the given header line,
+    and write them straight to an image file in out_dir.
+    @return Path of the image file.
+    """
+    start, words, _ = parse_header(line)
+    os.makedirs(out_dir, exist_ok=True)
+    path = image_path(out_dir, start, words)
+
+    received = 0
+    began = time.time()
+    with open(path, "wb") as f:
+        while True:
+            payload = read_frame(ser)
+            if not payload:
+                break
+            f.write(payload)
+            received += len(payload)
+            sys.stdout.write(f"\rReceived {received // 4}/{words} words")
+            sys.stdout.flush()
+
+    if received != words * 4:
+        raise DumpError(f"expected {words} words, received {received // 4}")
+
+    elapsed = max(time.time() - began, 1e-3)
+    print(f"\nSaved {path} ({received} bytes, {received / elapsed:.0f} bytes/sec)")
+    return path
+
+
+def receive_incremental_dump(ser, line, out_dir) -> str:
+    """
+    Serve the checksum requests of an incremental dump that started with the
+    given header line, and patch the changed sectors into the cached image.
+    Without a cached image every sector is sent.
+    @return Path of the image file.
+    """
+    start, words, sector_words = parse_header(line, INCREMENTAL_DUMP_HEADER)
+    os.makedirs(out_dir, exist_ok=True)
+    path = image_path(out_dir, start, words)
+    sector_size = sector_words * 4
+
+    image = None
+    if os.path.exists(path) and os.path.getsize(path) == words * 4:
+        with open(path, "rb") as f:
+            image = bytearray(f.read())
+    cached = image is not None
+    if not cached:
+        image = bytearray(words * 4)
+
+    changed = 0
+    total = None
+    while True:
+        payload = read_frame(ser)
+        if not payload:
+            break
+
+        kind = payload[:1]
+        if kind == b"C":
+            first, count = struct.unpack_from("<II", payload, 1)
+            crcs = []
+            for index in range(first, first + count):
+                sector = image[index * sector_size:(index + 1) * sector_size]
+                # without a cached image ask for everything
+                crcs.append(zlib.crc32(sector) if cached else 0)
+            ser.write(struct.pack(f"<{count}I", *crcs))
+            ser.flush()
+        elif kind == b"S":
+            (index,) = struct.unpack_from("<I", payload, 1)
+            data = payload[5:]
+            image[index * sector_size:index * sector_size + len(data)] = data
+            changed += 1
+            sys.stdout.write(f"\rReceived {changed} changed sectors")
+            sys.stdout.flush()
+        elif kind == b"T":
+            (total,) = struct.unpack_from("<I", payload, 1)
+        else:
+            raise DumpError(f"unknown frame kind {kind!r}")
+
+    if total is None:
+        raise DumpError("dump aborted by the driver")
+    if zlib.crc32(image) != total:
+        raise DumpError("patched image does not match the device checksum")
+
+    tmp = path + ".tmp"
+    with open(tmp, "wb") as f:
+        f.write(image)
+    os.replace(tmp, path)
+
+    sectors = (words + sector_words - 1) // sector_words
+    print(f"\nSaved {path} ({changed} of {sectors} sectors changed)")
+    return path
+
+
+def receive_dcc(ser, line, log_path=None) -> int:
+    """
+    Print the DCC log that started with the given header line, and append it
+    to log_path if given. The target may stay silent for long, so frames are
+    waited for without a timeout. Ctrl-C sends Ctrl-] to the driver, which
+    then ends the stream.
+    @return Number of bytes received.
+    """
+    fields = line.split()
+    if len(fields) != 2 or fields[0] != DCC_HEADER:
+        raise DumpError(f"bad dcc header: {line.strip()}")
+
+    print("DCC log, Ctrl-C to stop")
+    received = 0
+    stopping = False
+    log = open(log_path, "ab") if log_path else None
+    try:
+        while True:
+            try:
+                while not ser.in_waiting:
+                    time.sleep(0.01)
+                payload = read_frame(ser)
+            except KeyboardInterrupt:
+                if stopping:
+                    raise
+                # the driver finishes the frame it is sending and ends the stream
+                stopping = True
+                ser.write(DCC_EXIT_CHAR)
+                ser.flush()
+                continue
+
+            if not payload:
+                break
+            received += len(payload)
+            # whole words are sent, the padding of a short write is dropped
+            text = payload.rstrip(b"\0")
+            sys.stdout.write(text.decode("cp1252", errors="replace"))
+            sys.stdout.flush()
+            if log:
+                log.write(text)
+                log.flush()
+    finally:
+        if log:
+            log.close()
+
+    print(f"\nDCC log ended, {received} bytes" + (f" appended to {log_path}" if log_path else ""))
+    return received
@@ -0,0 +1,527 @@
+"""
+@file gdb_bridge.py
+
+@brief GDB remote serial protocol server for a Cortex-M behind the Jtagger driver
+        (ARM DAP menu, over JTAG or SWD). GDB connects to a local TCP port:
+
+            (gdb) target extended-remote localhost:3333
+
+        and its packets are turned into the binary requests of the driver
+        (src/arm/arm_gdb.h), which starts serving them with a single text line:
+
+            "@gdb <max words per request>"
+
+        The serial link is slow next to GDB's appetite for small reads, so
+        target memory and registers are cached until the core runs again:
+          - Memory is cached in aligned blocks of CACHE_BLOCK bytes. A miss
+            reads its block and PREFETCH_BLOCKS blocks after it, and the
+            missing blocks of a read are coalesced into as few requests as
+            possible. Peripheral and system addresses are never cached or
+            read ahead.
+          - The registers are read once per stop with a single request.
+          - Writes go through to the target, and update the cache.
+        Breakpoints use the comparators of the FPB, set with memory writes.
+
+        It is started by controller.py when the driver sends the "@gdb" line,
+        or on its own: gdb_bridge.py <serial port> [--keys x,b] [--port 3333].
+
+@author Michael Vigdorchik
+"""
+
+import argparse
+import select
+import serial
+import socket
+import struct
+import sys
+import time
+
+from dump import DumpError, read_frame
+from program import send_frame
+
+GDB_HEADER = "@gdb"
+
+GDB_PORT = 3333
+
+# the driver leaves the serving after a minute without requests
+KEEPALIVE = 10  # sec
+# polls of the running core, for its halt or for GDB's interrupt
+POLL_INTERVAL = 0.05  # sec
+
+CACHE_BLOCK = 64  # bytes
+PREFETCH_BLOCKS = 3
+
+# cacheable regions of the Cortex-M memory map: code, SRAM, external RAM
+CACHEABLE = ((0x00000000, 0x40000000), (0x60000000, 0xa0000000))
+
+# status byte of the driver for a bus fault (ERR_BUS_FAULT)
+STATUS_BUS_FAULT = 20
+
+# r0-r12, sp, lr, pc, xpsr
+REGS = 17
+
+# Flash Patch and Breakpoint unit
+FP_CTRL = 0xe0002000
+FP_COMP0 = 0xe0002008
+FP_CTRL_KEY_ENABLE = 0x3
+
+TARGET_XML = """<?xml version="1.0"?>
+<!DOCTYPE target SYSTEM "gdb-target.dtd">
+<target version="1.0">
+  <architecture>arm</architecture>
+  <feature name="org.gnu.gdb.arm.m-profile">
+""" + "".join(f'    <reg name="r{i}" bitsize="32"/>\n' for i in range(13)) + """\
+    <reg name="sp" bitsize="32" type="data_ptr"/>
+    <reg name="lr" bitsize="32"/>
+    <reg name="pc" bitsize="32" type="code_ptr"/>
+    <reg name="xpsr" bitsize="32"/>
+  </feature>
+</target>
+"""
+
+
+class BridgeError(Exception):
+    def __init__(self, message, status=1):
+        super().__init__(message)
+        self.status = status
+
+
+class Link():
+    """Requests to the driver, a frame each way"""
+
+    def __init__(self, ser, max_words) -> None:
+        self.s = ser
+        self.max_words = max_words
+        self.requests = 0
+        self.words = 0
+
+    def request(self, payload) -> bytes:
+        send_frame(self.s, payload)
+        self.s.flush()
+        self.requests += 1
+        try:
+            reply = read_frame(self.s)
+        except DumpError as error:
+            raise BridgeError(f"link: {error}")
+        if not reply:
+            raise BridgeError("link: empty reply")
+        if reply[0] != 0:
+            raise BridgeError(f"driver status {reply[0]} for request {payload[:1]!r}", reply[0])
+        return reply[1:]
+
+    def read(self, addr, length) -> bytes:
+        """Read whole words, in as few requests as the driver allows"""
+        data = b""
+        while length > 0:
+            words = min(length // 4, self.max_words)
+            data += self.request(b"m" + struct.pack("<II", addr, words))
+            self.words += words
+            addr += words * 4
+            length -= words * 4
+        return data
+
+    def write(self, addr, data):
+        for pos in range(0, len(data), self.max_words * 4):
+            chunk = data[pos:pos + self.max_words * 4]
+            self.request(b"M" + struct.pack("<I", addr + pos) + chunk)
+            self.words += len(chunk) // 4
+
+    def halted(self) -> bool:
+        return self.request(b"?")[0] != 0
+
+
+class MemoryCache():
+    """Target memory, cached in aligned blocks until the core runs again"""
+
+    def __init__(self, link, prefetch=PREFETCH_BLOCKS) -> None:
+        self.link = link
+        self.prefetch = prefetch
+        self.blocks = {}
+        self.hits = 0
+        self.misses = 0
+
+    def invalidate(self):
+        self.blocks.clear()
+
+    @staticmethod
+    def cacheable(addr, length) -> bool:
+        return any(start <= addr and addr + length <= end for start, end in CACHEABLE)
+
+    def fetch(self, first, count):
+        """Read count blocks from first in a single request, or block by block if it faults"""
+        try:
+            data = self.link.read(first, count * CACHE_BLOCK)
+        except BridgeError as error:
+            # e.g. the read ahead went past the end of the RAM
+            if error.status != STATUS_BUS_FAULT or count == 1:
+                raise
+            for i in range(count):
+                try:
+                    self.fetch(first + i * CACHE_BLOCK, 1)
+                except BridgeError as block_error:
+                    if block_error.status != STATUS_BUS_FAULT:
+                        raise
+            return
+        for i in range(count):
+            self.blocks[first + i * CACHE_BLOCK] = data[i * CACHE_BLOCK:(i + 1) * CACHE_BLOCK]
+
+    def read(self, addr, length) -> bytes:
+        if not self.cacheable(addr, length):
+            # only the words asked for, a read can have side effects there
+            start = addr & ~3
+            end = (addr + length + 3) & ~3
+            data = self.link.read(start, end - start)
+            return data[addr - start:addr - start + length]
+
+        first = addr & ~(CACHE_BLOCK - 1)
+        end = addr + length
+        block = first
+        while block < end:
+            if block in self.blocks:
+                self.hits += 1
+                block += CACHE_BLOCK
+                continue
+
+            # a run of missing blocks, and the read ahead after the asked range
+            self.misses += 1
+            count = 0
+            limit = self.link.max_words * 4 // CACHE_BLOCK
+            while count < limit and block + count * CACHE_BLOCK not in self.blocks:
+                next_block = block + count * CACHE_BLOCK
+                if next_block >= end + self.prefetch * CACHE_BLOCK or not self.cacheable(next_block, CACHE_BLOCK):
+                    break
+                count += 1
+            self.fetch(block, max(count, 1))
+            block += max(count, 1) * CACHE_BLOCK
+
+        if any(b not in self.blocks for b in range(first, end, CACHE_BLOCK)):
+            raise BridgeError(f"bus fault reading 0x{addr:08x}", STATUS_BUS_FAULT)
+        data = b"".join(self.blocks[b] for b in range(first, end, CACHE_BLOCK))
+        return data[addr - first:addr - first + length]
+
+    def write(self, addr, data):
+        # whole words, the bytes around a partial word are read first
+        start = addr & ~3
+        end = (addr + len(data) + 3) & ~3
+        if (start, end) != (addr, addr + len(data)):
+            words = bytearray(self.read(start, end - start))
+        else:
+            words = bytearray(end - start)
+        words[addr - start:addr - start + len(data)] = data
+        self.link.write(start, bytes(words))
+
+        for block in range(start & ~(CACHE_BLOCK - 1), end, CACHE_BLOCK):
+            if block in self.blocks:
+                cached = bytearray(self.blocks[block])
+                lo, hi = max(block, start), min(block + CACHE_BLOCK, end)
+                cached[lo - block:hi - block] = words[lo - start:hi - start]
+                self.blocks[block] = bytes(cached)
+
+
+class Target():
+    """State of the core between the stops: registers, memory and breakpoints"""
+
+    def __init__(self, link, prefetch=PREFETCH_BLOCKS) -> None:
+        self.link = link
+        self.mem = MemoryCache(link, prefetch)
+        self.regs = None
+        self.comparators = None
+        self.fpb_rev = 0
+        self.breakpoints = {}  # address -> comparator
+
+    def invalidate(self):
+        self.mem.invalidate()
+        self.regs = None
+
+    def read_regs(self) -> list:
+        if self.regs is None:
+            self.regs = list(struct.unpack(f"<{REGS}I", self.link.request(b"g")))
+        return self.regs
+
+    def write_regs(self, regs):
+        self.link.request(b"G" + struct.pack(f"<{REGS}I", *regs))
+        self.regs = list(regs)
+
+    def halt(self):
+        self.link.request(b"h")
+        self.invalidate()
+
+    def resume(self):
+        self.invalidate()
+        self.link.request(b"c")
+
+    def step(self):
+        self.invalidate()
+        self.link.request(b"s")
+
+    def fpb_init(self):
+        if self.comparators is not None:
+            return
+        (ctrl,) = struct.unpack("<I", self.link.read(FP_CTRL, 4))
+        self.comparators = ((ctrl >> 4) & 0xf) | ((ctrl >> 8) & 0x70)
+        self.fpb_rev = ctrl >> 28
+        self.link.write(FP_CTRL, struct.pack("<I", FP_CTRL_KEY_ENABLE))
+
+    def set_breakpoint(self, addr) -> bool:
+        self.fpb_init()
+        if addr in self.breakpoints:
+            return True
+        used = set(self.breakpoints.values())
+        free = [i for i in range(self.comparators) if i not in used]
+        if not free:
+            return False
+
+        if self.fpb_rev == 0:
+            # FPB v1: code region only, the halfword of the word is selected by REPLACE
+            if addr >= 0x20000000:
+                return False
+            comp = (addr & 0x1ffffffc) | (0x80000000 if addr & 2 else 0x40000000) | 1
+        else:
+            comp = (addr & ~1) | 1
+        self.link.write(FP_COMP0 + 4 * free[0], struct.pack("<I", comp))
+        self.breakpoints[addr] = free[0]
+        return True
+
+    def clear_breakpoint(self, addr):
+        comparator = self.breakpoints.pop(addr, None)
+        if comparator is not None:
+            self.link.write(FP_COMP0 + 4 * comparator, struct.pack("<I", 0))
+
+
+def checksum(data) -> str:
+    return f"{sum(data) % 256:02x}"
+
+
+class GdbServer():
+    """A single GDB connection, served until GDB detaches"""
+
+    def __init__(self, conn, target) -> None:
+        self.conn = conn
+        self.target = target
+        self.rx = b""
+
+    def send(self, data):
+        payload = data.encode() if isinstance(data, str) else data
+        self.conn.sendall(b"$" + payload + b"#" + checksum(payload).encode())
+
+    def receive(self):
+        """@return The next packet, b"\\x03" for an interrupt, or None if GDB is gone"""
+        while True:
+            # acks are dropped, a bad checksum asks for the packet again
+            self.rx = self.rx.lstrip(b"+-")
+            if self.rx[:1] == b"\x03":
+                self.rx = self.rx[1:]
+                return b"\x03"
+            start = self.rx.find(b"$")
+            end = self.rx.find(b"#", start)
+            if start >= 0 and end >= 0 and len(self.rx) >= end + 3:
+                packet = self.rx[start + 1:end]
+                sent = self.rx[end + 1:end + 3]
+                self.rx = self.rx[end + 3:]
+                if sent.decode(errors="replace") != checksum(packet):
+                    self.conn.sendall(b"-")
+                    continue
+                self.conn.sendall(b"+")
+                return packet
+
+            ready, _, _ = select.select([self.conn], [], [], KEEPALIVE)
+            if not ready:
+                # the driver only waits that long for a request
+                self.target.link.halted()
+                continue
+            chunk = self.conn.recv(4096)
+            if not chunk:
+                return None
+            self.rx += chunk
+
+    def wait_stop(self) -> str:
+        """Poll the running core until it halts, or GDB interrupts it"""
+        while not self.target.link.halted():
+            ready, _, _ = select.select([self.conn], [], [], POLL_INTERVAL)
+            if ready:
+                chunk = self.conn.recv(4096)
+                if not chunk or b"\x03" in chunk:
+                    self.target.halt()
+                    return "S02"
+                self.rx += chunk
+        self.target.invalidate()
+        return "S05"
+
+    def handle(self, packet) -> str:
+        target = self.target
+        cmd = packet[:1]
+        args = packet[1:].decode(errors="replace")
+
+        if packet == b"\x03":
+            target.halt()
+            return "S02"
+        if cmd == b"?":
+            if not target.link.halted():
+                target.halt()
+            return "S05"
+        if cmd == b"g":
+            return b"".join(struct.pack("<I", r) for r in target.read_regs()).hex()
+        if cmd == b"G":
+            target.write_regs(struct.unpack(f"<{REGS}I", bytes.fromhex(args)[:REGS * 4]))
+            return "OK"
+        if cmd == b"p":
+            reg = int(args, 16)
+            return struct.pack("<I", target.read_regs()[reg]).hex() if reg < REGS else "xxxxxxxx"
+        if cmd == b"P":
+            reg, value = args.split("=")
+            regs = list(target.read_regs())
+            if int(reg, 16) >= REGS:
+                return "E01"
+            (regs[int(reg, 16)],) = struct.unpack("<I", bytes.fromhex(value))
+            target.write_regs(regs)
+            return "OK"
+        if cmd == b"m":
+            addr, length = (int(x, 16) for x in args.split(","))
+            return target.mem.read(addr, length).hex()
+        if cmd == b"M":
+            where, data = args.split(":")
+            addr, _ = (int(x, 16) for x in where.split(","))
+            target.mem.write(addr, bytes.fromhex(data))
+            return "OK"
+        if cmd in (b"Z", b"z"):
+            kind, addr, _ = args.split(",")
+            # software breakpoints are FPB ones as well, the flash cannot take BKPT
+            if kind not in ("0", "1"):
+                return ""
+            if cmd == b"z":
+                target.clear_breakpoint(int(addr, 16))
+                return "OK"
+            return "OK" if target.set_breakpoint(int(addr, 16)) else "E01"
+        if cmd == b"c":
+            if args:
+                regs = list(target.read_regs())
+                regs[15] = int(args, 16)
+                target.write_regs(regs)
+            target.resume()
+            return self.wait_stop()
+        if cmd == b"s":
+            target.step()
+            return "S05"
+        if cmd == b"q":
+            return self.query(args)
+        if cmd == b"H":
+            return "OK"
+        if cmd == b"T":
+            return "OK"
+        return ""
+
+    def query(self, args) -> str:
+        if args.startswith("Supported"):
+            return f"PacketSize={4 * 1024:x};qXfer:features:read+"
+        if args.startswith("Xfer:features:read:target.xml:"):
+            offset, length = (int(x, 16) for x in args.split(":")[-1].split(","))
+            chunk = TARGET_XML[offset:offset + length]
+            return ("l" if offset + length >= len(TARGET_XML) else "m") + chunk
+        if args == "Attached":
+            return "1"
+        if args == "C":
+            return "QC1"
+        if args == "fThreadInfo":
+            return "m1"
+        if args == "sThreadInfo":
+            return "l"
+        return ""
+
+    def run(self):
+        while True:
+            packet = self.receive()
+            if packet is None:
+                return
+            if packet[:1] in (b"D", b"k"):
+                if packet[:1] == b"D":
+                    self.send("OK")
+                return
+            try:
+                reply = self.handle(packet)
+            except BridgeError as error:
+                print(f"\n{error}")
+                reply = f"E{error.status & 0xff:02x}"
+            except ValueError:
+                reply = "E01"
+            self.send(reply)
+
+
+def parse_header(line) -> int:
+    """@return Most words of a memory request, from a "@gdb" header line"""
+    fields = line.split()
+    if len(fields) != 2 or fields[0] != GDB_HEADER:
+        raise BridgeError(f"bad gdb header: {line.strip()}")
+    return int(fields[1], 10)
+
+
+def serve(ser, line, port=GDB_PORT, prefetch=PREFETCH_BLOCKS):
+    """
+    Serve a single GDB session on localhost:port for the driver that sent
+    the given "@gdb" header line, then let the driver go back to its menu.
+    """
+    link = Link(ser, parse_header(line))
+    target = Target(link, prefetch)
+
+    listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind(("127.0.0.1", port))
+    listener.listen(1)
+    print(f"\nWaiting for GDB on localhost:{port}")
+
+    try:
+        while True:
+            # the driver is kept serving while nobody is connected
+            ready, _, _ = select.select([listener], [], [], KEEPALIVE)
+            if ready:
+                break
+            link.halted()
+        conn, peer = listener.accept()
+        print(f"GDB connected from {peer[0]}:{peer[1]}")
+        began = time.time()
+        with conn:
+            GdbServer(conn, target).run()
+    finally:
+        listener.close()
+        try:
+            link.request(b"q")
+        except BridgeError as error:
+            print(f"\n{error}")
+
+    elapsed = max(time.time() - began, 1e-3)
+    mem = target.mem
+    print(f"GDB detached: {link.requests} requests, {link.words} words in {elapsed:.1f} sec, "
+          f"cache {mem.hits} hits / {mem.misses} misses")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="GDB server for the Jtagger driver")
+    parser.add_argument("port", help="serial port of the driver")
+    parser.add_argument("--keys", default="x,b",
+                        help="menu commands that start the serving, comma separated (default: %(default)s)")
+    parser.add_argument("--gdb-port", type=int, default=GDB_PORT,
+                        help="local TCP port of GDB (default: %(default)s)")
+    parser.add_argument("--prefetch", type=int, default=PREFETCH_BLOCKS,
+                        help=f"blocks of {CACHE_BLOCK} bytes read ahead on a miss (default: %(default)s)")
+    args = parser.parse_args()
+
+    ser = serial.Serial(port=args.port, baudrate=115200, timeout=1)
+    for key in filter(None, args.keys.split(",")):
+        ser.write((key + "\n").encode())
+        ser.flush()
+        time.sleep(0.1)
+
+    # the menus are skipped up to the header line
+    deadline = time.time() + 5
+    while time.time() < deadline:
+        line = ser.readline().decode("cp1252")
+        if line.startswith(GDB_HEADER):
+            serve(ser, line, args.gdb_port, args.prefetch)
+            break
+    else:
+        print("The driver did not start serving GDB")
+        sys.exit(1)
+    ser.close()
+
+
+if __name__ == "__main__":
+    main()
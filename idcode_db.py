@@ -0,0 +1,173 @@
+"""
+@file idcode_db.py
+
+@brief Generator of the driver's IDCODE database (src/idcode/idcode_table.h)
+        from the list of known devices in idcodes.txt.
+
+        The parts are placed in a minimal perfect hash table (hash and displace):
+        a first hash of the IDCODE picks a bucket, and the seed of the bucket
+        makes a second hash that places every IDCODE of the bucket in a slot of
+        its own. A lookup is then two hashes and a single compare, and the
+        table is read straight from flash.
+
+            hash(key, seed) = h ^ (h >> 16), where h = (key ^ seed) * 0x9e3779b1
+
+        Run it after editing idcodes.txt:
+
+            python3 idcode_db.py [idcodes.txt] [src/idcode/idcode_table.h]
+
+@author Michael Vigdorchik
+"""
+
+import sys
+
+# the version field [31:28] of an IDCODE is not part of the part number
+IDCODE_MASK = 0x0FFFFFFF
+
+HASH_MULTIPLIER = 0x9E3779B1
+MAX_SEED = 0xFFFF
+
+
+class IdcodeDBError(Exception):
+    pass
+
+
+def idcode_hash(key, seed) -> int:
+    h = ((key ^ seed) * HASH_MULTIPLIER) & 0xFFFFFFFF
+    return h ^ (h >> 16)
+
+
+def pow2_at_least(n) -> int:
+    size = 1
+    while size < n:
+        size *= 2
+    return size
+
+
+def parse(path) -> tuple:
+    """@return ({manufacturer code: name}, {masked idcode: (ir length, part name)})"""
+    mfgs = {}
+    parts = {}
+    with open(path) as f:
+        for num, line in enumerate(f, 1):
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            fields = line.split(None, 2)
+            if len(fields) != 3:
+                raise IdcodeDBError(f"{path}:{num}: expected 3 fields")
+            if fields[0] == "mfg":
+                mfgs[int(fields[1], 16)] = fields[2]
+                continue
+            idcode = int(fields[0], 16) & IDCODE_MASK
+            if not idcode & 1:
+                raise IdcodeDBError(f"{path}:{num}: IDCODE LSB must be 1")
+            if idcode in parts:
+                raise IdcodeDBError(f"{path}:{num}: duplicate IDCODE 0x{idcode:08x}")
+            parts[idcode] = (int(fields[1], 10), fields[2])
+    return mfgs, parts
+
+
+def build(keys) -> tuple:
+    """
+    Place the keys in a perfect hash table.
+    @return (seeds per bucket, key per slot, 0 for an empty slot)
+    """
+    slots = pow2_at_least(len(keys))
+    buckets = pow2_at_least(max(len(keys) // 4, 1))
+
+    grouped = [[] for _ in range(buckets)]
+    for key in keys:
+        grouped[idcode_hash(key, 0) & (buckets - 1)].append(key)
+
+    seeds = [0] * buckets
+    table = [0] * slots
+    # the crowded buckets first, while most of the slots are free
+    for bucket in sorted(range(buckets), key=lambda b: -len(grouped[b])):
+        if not grouped[bucket]:
+            continue
+        for seed in range(1, MAX_SEED + 1):
+            placed = {idcode_hash(key, seed) & (slots - 1) for key in grouped[bucket]}
+            if len(placed) == len(grouped[bucket]) and all(table[slot] == 0 for slot in placed):
+                break
+        else:
+            raise IdcodeDBError("no seed found, try a larger table")
+        seeds[bucket] = seed
+        for key in grouped[bucket]:
+            table[idcode_hash(key, seed) & (slots - 1)] = key
+    return seeds, table
+
+
+def c_string(name) -> str:
+    return '"' + name.replace("\\", "\\\\").replace('"', '\\"') + '\\0"'
+
+
+def generate(mfgs, parts) -> str:
+    seeds, table = build(sorted(parts))
+
+    # names of the parts and the manufacturers share a single pool
+    pool = []
+    offsets = {}
+    for name in [parts[key][1] for key in sorted(parts)] + [mfgs[code] for code in sorted(mfgs)]:
+        if name not in offsets:
+            offsets[name] = sum(len(n) + 1 for n in pool)
+            pool.append(name)
+    if sum(len(n) + 1 for n in pool) > 0xFFFF:
+        raise IdcodeDBError("names do not fit a 16 bit offset")
+
+    out = []
+    out.append("/** @file idcode_table.h")
+    out.append(" *")
+    out.append(" * @brief Generated by idcode_db.py from idcodes.txt, do not edit.")
+    out.append(" * Included by idcode.cpp only.")
+    out.append(" */")
+    out.append("#ifndef __IDCODE_TABLE__H__")
+    out.append("#define __IDCODE_TABLE__H__")
+    out.append("")
+    out.append(f"#define IDCODE_PARTS   {len(parts)}")
+    out.append(f"#define IDCODE_BUCKETS {len(seeds)}")
+    out.append(f"#define IDCODE_SLOTS   {len(table)}")
+    out.append(f"#define IDCODE_MFGS    {len(mfgs)}")
+    out.append("")
+    out.append("static const uint16_t idcode_seeds[IDCODE_BUCKETS] PROGMEM = {")
+    for i in range(0, len(seeds), 8):
+        out.append("    " + " ".join(f"{seed},".rjust(6) for seed in seeds[i:i + 8]).strip())
+    out.append("};")
+    out.append("")
+    out.append("static const idcode_entry_t idcode_entries[IDCODE_SLOTS] PROGMEM = {")
+    for key in table:
+        if key:
+            ir_len, name = parts[key]
+            out.append(f"    {{ 0x{key:08x}, {offsets[name]:5}, {ir_len:2} }},  // {name}")
+        else:
+            out.append("    { 0x00000000,     0,  0 },")
+    out.append("};")
+    out.append("")
+    out.append("// sorted by code")
+    out.append("static const idcode_mfg_t idcode_mfgs[IDCODE_MFGS] PROGMEM = {")
+    for code in sorted(mfgs):
+        out.append(f"    {{ 0x{code:03x}, {offsets[mfgs[code]]:5} }},  // {mfgs[code]}")
+    out.append("};")
+    out.append("")
+    out.append("static const char idcode_names[] PROGMEM =")
+    for name in pool:
+        out.append("    " + c_string(name))
+    out.append("    ;")
+    out.append("")
+    out.append("#endif")
+    out.append("")
+    return "\n".join(out)
+
+
+def main():
+    src = sys.argv[1] if len(sys.argv) > 1 else "idcodes.txt"
+    dst = sys.argv[2] if len(sys.argv) > 2 else "src/idcode/idcode_table.h"
+
+    mfgs, parts = parse(src)
+    with open(dst, "w") as f:
+        f.write(generate(mfgs, parts))
+    print(f"{dst}: {len(parts)} parts, {len(mfgs)} manufacturers")
+
+
+if __name__ == "__main__":
+    main()
@@ -29,6 +29,33 @@
 #define TDO 10
 #define TRST 11
 
+/*
+ * SWD shares the JTAG pins: SWCLK is TCK and SWDIO is TMS, as on the
+ * ARM 10 and 20 pin debug connectors. See src/swd/swd.h.
+ */
+#define SWCLK TCK
+#define SWDIO TMS
+
+/**
+ * If 1 then the JTAG pins are not driven, and the driver talks to the simulated
+ * target attached with sim_attach() (see src/sim/sim.h). Used by the host builds
+ * of sim/ to run the driver without hardware.
+ */
+#ifndef JTAG_SIM
+#define JTAG_SIM 0
+#endif
+
+#if JTAG_SIM
+#include "../src/sim/sim.h"
+#define PIN_WRITE(pin, val) sim_pin_write(pin, val)
+#define PIN_READ(pin) sim_pin_read(pin)
+#define PIN_MODE(pin, mode) sim_pin_mode(pin, mode)
+#else
+#define PIN_WRITE(pin, val) digitalWrite(pin, val)
+#define PIN_READ(pin) digitalRead(pin)
+#define PIN_MODE(pin, mode) pinMode(pin, mode)
+#endif
+
 /**
  * Sizes of global arrays to store
  * content of IR and DR
@@ -43,12 +70,23 @@
  */
 #define MANY_ONES 100
 
+/**
+ * If 1 then the driver keeps a shadow of the last instruction shifted into
+ * the chain, and drops IR scans that would shift the very same instruction again.
+ * Put 0 for targets where the Capture-IR / Update-IR side effects matter.
+ * Can also be toggled at runtime with ir_shadow_enable().
+ */
+#define IR_SHADOW_CACHE 1
+
 /*	Choose a half-clock cycle delay	*/
 // half clock cycle
 // #define HC delay(1);
 // or
-#define DELAY_US 100 // delay in microseonds for a half-clock cycle (HC) to drive TCK.
-#define HC delayMicroseconds(DELAY_US);
+#define DELAY_US 100 // default delay in microseonds for a half-clock cycle (HC) to drive TCK.
+#define HC delayMicroseconds(tck_delay_us);
+
+// half-clock cycle delay in use, starts as DELAY_US and can be changed at runtime
+extern uint32_t tck_delay_us;
 
 // A more precise way to delay a half clock cycle:
 /*
@@ -61,7 +99,7 @@
                           " : :);  \
 }
 Notice, that you also need to override the digitalWrite and digitalRead
-functions with an appropriate assembly in order to reach the desired JTAG speeds.
+functions (PIN_WRITE and PIN_READ) with an appropriate assembly in order to reach the desired JTAG speeds.
 */
  
 
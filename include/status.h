@@ -19,6 +19,11 @@
 #define ERR_TAP_DEVICE_UNAVAILABLE    13
 #define ERR_TAP_DEVICE_ALREADY_ACTIVE 14
 #define ERR_TAP_DEVICE_REMOVE_ISSUE   15
+#define ERR_BAD_CHECKSUM              16
+#define ERR_NOT_FOUND                 17
+#define ERR_NOT_BLANK                 18
+#define ERR_TIMEOUT                   19
+#define ERR_BUS_FAULT                 20
 
 typedef int status_t;
 
@@ -9,6 +9,21 @@
 // Global Variables
 extern String digits;
 
+/**
+ * Receiver of a single binary frame from the host, in the layout of
+ * send_frame_to_host(). It is fed from the serial RX buffer without
+ * blocking, so a frame can be received between other work.
+ */
+typedef struct
+{
+    uint8_t* buf;       // payload buffer
+    uint16_t size;      // capacity of the payload buffer
+    uint16_t len;       // payload length, known after the first 2 bytes
+    uint32_t received;  // number of frame bytes received so far
+    uint32_t crc;       // CRC-32 field of the frame
+    bool complete;
+} frame_rx_t;
+
 /**
  * @brief Fill the register with zeros
  * @param reg Pointer to the register to flush.
@@ -38,6 +53,66 @@ void notify_input_and_busy_wait_for_serial_input(const char* message);
  */
 void send_data_to_host(uint8_t* buf, uint16_t chunk_size);
 
+/**
+ * @brief Sends a single binary frame to the host, without flushing:
+ * payload length (uint16, little endian), payload bytes, and the CRC-32
+ * of the payload (uint32, little endian). A frame with an empty payload
+ * ends a stream of frames.
+ * @param payload Pointer to the payload bytes.
+ * @param len Number of payload bytes.
+ */
+void send_frame_to_host(const uint8_t* payload, uint16_t len);
+
+/**
+ * @brief Pack words into bytes, little endian.
+ * @param words Words to pack.
+ * @param bytes Buffer of 4 * count bytes.
+ * @param count Number of words.
+ */
+void words_to_le_bytes(const uint32_t* words, uint8_t* bytes, uint32_t count);
+
+/**
+ * @brief Sends words as the little endian payload of a single frame, in the
+ * layout of send_frame_to_host(), without flushing.
+ * @param words Pointer to the words.
+ * @param count Number of words, at most 16383.
+ */
+void send_words_frame_to_host(const uint32_t* words, uint16_t count);
+
+/**
+ * @brief Starts a memory dump: prints "@dump <addr> <words> <frame words>",
+ * then the words follow in frames of send_words_frame_to_host().
+ */
+void send_dump_header_to_host(uint32_t addr, uint32_t words, uint16_t frame_words);
+
+/**
+ * @brief Ends a memory dump with an empty frame, and reports a failed read.
+ * @param addr Address of the first word not sent.
+ * @param rc Result of the dump.
+ */
+void send_dump_end_to_host(uint32_t addr, status_t rc);
+
+/**
+ * @brief Start receiving a new frame.
+ * @param buf Buffer for the payload.
+ * @param size Capacity of the buffer in bytes.
+ */
+void frame_rx_begin(frame_rx_t* rx, uint8_t* buf, uint16_t size);
+
+/**
+ * @brief Move the bytes waiting in the serial RX buffer into the frame, without blocking.
+ * rx->complete is set once the whole frame arrived and its CRC is correct.
+ * @return OK, -ERR_OUT_OF_BOUNDS if the payload does not fit, or -ERR_BAD_CHECKSUM.
+ */
+status_t frame_rx_poll(frame_rx_t* rx);
+
+/**
+ * @brief Block until the frame is complete.
+ * @param timeout_ms Time to wait for the rest of the frame, in milliseconds.
+ * @return OK, an error of frame_rx_poll() or -ERR_TIMEOUT.
+ */
+status_t frame_rx_wait(frame_rx_t* rx, uint32_t timeout_ms);
+
 /**
  * @brief Waits for the incoming of a special character to Serial.
  * @return The input char.
@@ -77,7 +152,7 @@ uint32_t get_tnteger(int num_bytes);
  * @brief Receive a number from the user in different formats: 0x, 0b, or decimal.
  * With an option to return the fetched number in a uint32 format.
  * @param message A message for the user.
- * @param dest Destination array. Will contain user's input value.
+ * @param dest Destination array. Will contain user's input value. May be nullptr.
  * @param size Size (in bytes) of the destination array.
  * @param out The constructed number.
  */
@@ -167,4 +242,14 @@ status_t int_to_bin_array(uint8_t* arr, uint32_t n, uint32_t len);
 */
 void print_array(uint8_t* arr, uint32_t len);
 
+/**
+ * @brief Update a CRC-32 (IEEE 802.3, same as zlib's crc32) with more data.
+ * Start with crc = 0, and pass the result back in to checksum data in parts.
+ * @param crc CRC of the data so far.
+ * @param data Pointer to the next bytes.
+ * @param len Number of bytes.
+ * @return CRC of all the data including the new bytes.
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, uint32_t len);
+
 #endif
\ No newline at end of file
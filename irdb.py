@@ -0,0 +1,102 @@
+"""
+@file irdb.py
+
+@brief Persistent instruction database of the host, keyed by IDCODE.
+        Stores for every part number the instructions that were discovered
+        by the Jtagger driver: IR value, DR length, DR capture value and
+        the time it was measured. Identical boards share the same entries,
+        so discovery runs once per part number instead of once per board.
+
+        File layout (little endian):
+            header  : magic "JIRM", version u16, number of parts u16
+            index   : per part  -> idcode u32, records offset u32, records count u32
+            records : per entry -> ir u32, dr length u32, capture u32, timestamp u32
+
+@author Michael Vigdorchik
+"""
+
+import os
+import struct
+import time
+
+MAGIC = b"JIRM"
+VERSION = 1
+
+# the version field [31:28] of an IDCODE is not part of the part number
+IDCODE_MASK = 0x0FFFFFFF
+
+HEADER = struct.Struct("<4sHH")
+INDEX_ENTRY = struct.Struct("<III")
+RECORD = struct.Struct("<IIII")
+
+
+class InstructionDB():
+    def __init__(self, path) -> None:
+        self.path = path
+        self.parts = {}  # idcode -> {ir: (dr_len, capture, timestamp)}
+        self.dirty = False
+        if os.path.exists(path):
+            self.load()
+
+    def load(self):
+        with open(self.path, "rb") as f:
+            data = f.read()
+
+        magic, version, count = HEADER.unpack_from(data, 0)
+        if magic != MAGIC or version != VERSION:
+            raise ValueError(f"{self.path} is not a jtagger instruction database")
+
+        offset = HEADER.size
+        for _ in range(count):
+            idcode, records, entries = INDEX_ENTRY.unpack_from(data, offset)
+            offset += INDEX_ENTRY.size
+            part = self.parts.setdefault(idcode, {})
+            for ir, dr_len, capture, stamp in RECORD.iter_unpack(data[records:records + entries * RECORD.size]):
+                part[ir] = (dr_len, capture, stamp)
+
+    def save(self):
+        if not self.dirty:
+            return
+
+        idcodes = sorted(self.parts)
+        index = b""
+        records = b""
+        offset = HEADER.size + INDEX_ENTRY.size * len(idcodes)
+        for idcode in idcodes:
+            part = self.parts[idcode]
+            index += INDEX_ENTRY.pack(idcode, offset + len(records), len(part))
+            for ir in sorted(part):
+                records += RECORD.pack(ir, *part[ir])
+
+        # write to a temporary file first, so a crash never leaves a broken database
+        tmp = self.path + ".tmp"
+        with open(tmp, "wb") as f:
+            f.write(HEADER.pack(MAGIC, VERSION, len(idcodes)) + index + records)
+        os.replace(tmp, self.path)
+        self.dirty = False
+
+    def get(self, idcode) -> dict:
+        """All known instructions of a part: {ir: (dr_len, capture, timestamp)}"""
+        return self.parts.get(idcode & IDCODE_MASK, {})
+
+    def put(self, idcode, ir, dr_len, capture):
+        self.parts.setdefault(idcode & IDCODE_MASK, {})[ir] = (dr_len, capture, int(time.time()))
+        self.dirty = True
+
+    def encode_for_device(self, idcode) -> bytes:
+        """Encode the known instructions of a part in the driver's irmap line format"""
+        part = self.get(idcode)
+        line = ",".join(f"{ir:x}:{dr_len:x}:{capture:x}" for ir, (dr_len, capture, _) in sorted(part.items()))
+        return (line + "\n").encode()
+
+    def handle_line(self, line) -> bool:
+        """
+        Store an "@irmap <idcode> <ir> <dr len> <capture>" record sent by the driver.
+        @return True if the line was a record.
+        """
+        fields = line.split()
+        if len(fields) != 5 or fields[0] != "@irmap":
+            return False
+
+        self.put(int(fields[1], 16), int(fields[2], 16), int(fields[3], 10), int(fields[4], 16))
+        return True
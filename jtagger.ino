@@ -16,7 +16,13 @@
 #include "include/utils.h"
 #include "src/jtag_drv/jtag_drv.h"
 #include "src/chain/chain.h"
-#include "src/max10/max10_funcs.h"
+#include "src/irmap/irmap.h"
+#include "src/persist/persist.h"
+#include "src/profile/profile.h"
+#include "src/idcode/idcode.h"
+#include "src/arm/arm_funcs.h"
+#include "src/bscan/bscan_funcs.h"
+#include "src/cjtag/cjtag.h"
 
 // DR content to input into chain's real DR
 uint8_t dr_out[MAX_DR_LEN];
@@ -28,7 +34,7 @@ uint8_t ir_in[MAX_IR_LEN];
 uint8_t ir_out[MAX_IR_LEN];
 
 // stores TAP devices in a chain
-tap_t taps[MAX_ALLOWED_TAPS];
+chain_t chain;
 
 // TODO: fix
 void print_main_menu()
@@ -38,15 +44,24 @@ void print_main_menu()
     Serial.print("\tAll numerical parameters should be passed in the format: {0x || 0b || decimal}\n\n");
     Serial.print("a - Add new TAP device to chain\n");
     Serial.print("b - Activate TAP device in chain\n");
-    Serial.print("c - Connect to chain\n");
-    Serial.print("d - Discovery\n");
-    Serial.print("i - Insert IR\n");
-    Serial.print("l - Detect DR length\n");
-    Serial.print("p - Print active TAP devices in chain\n");
-    Serial.print("r - Insert DR\n");
+    Serial.print("c - Deactivate TAP device in chain\n");
+    Serial.print("d - Remove TAP device from chain\n");
+    Serial.print("e - Connect to chain\n");
+    Serial.print("f - Discovery\n");
+    Serial.print("g - Insert IR\n");
+    Serial.print("i - Detect DR length\n");
+    Serial.print("j - Insert DR\n");
+    Serial.print("k - Toggle IR shadow cache\n");
+    Serial.print("l - Boundary scan of the selected device (BSDL from host)\n");
+    Serial.print("o - Set TCK half-clock delay\n");
+    Serial.print("p - Print TAP devices in chain\n");
     Serial.print("s - Select active TAP device to work on\n");
-    Serial.print("t - Reset TAP state machine\n");
-    Serial.print("q - Toggle TRST line\n");
+    Serial.print("r - Reset TAP state machine\n");
+    Serial.print("t - Toggle TRST line\n");
+    Serial.print("v - ARM DAP over SWD (SWCLK on TCK, SWDIO on TMS)\n");
+    Serial.print("y - Toggle cJTAG OScan1 (TCKC on TCK, TMSC on TMS)\n");
+    Serial.print("w - Save or erase the configuration in flash\n");
+    Serial.print("x - Commands of the selected device family (MAX10, ARM DAP, RISC-V ...)\n");
     Serial.print("h - Show this menu\n");
     Serial.print("z - Exit\n");
     Serial.flush();
@@ -54,7 +69,8 @@ void print_main_menu()
 
 void setup()
 {
-    // initialize mode for standard IEEE 1149.1 JTAG pins
+    // initialize mode for standard IEEE 1149.1 JTAG pins,
+    // SWD runs on TCK and TMS and turns TMS around itself
     pinMode(TCK, OUTPUT);
     pinMode(TMS, OUTPUT);
     pinMode(TDI, OUTPUT);
@@ -62,13 +78,13 @@ void setup()
     pinMode(TRST, OUTPUT);
 
     // initialize pins state
-    digitalWrite(TCK, 0);
-    digitalWrite(TMS, 1);
-    digitalWrite(TDI, 1);
-    digitalWrite(TRST, 1);
+    PIN_WRITE(TCK, 0);
+    PIN_WRITE(TMS, 1);
+    PIN_WRITE(TDI, 1);
+    PIN_WRITE(TRST, 1);
 
     // initialize possible TAPs in chain
-    chain_taps_init(taps);
+    chain_taps_init(&chain);
     clear_reg(ir_in, MAX_IR_LEN);
     clear_reg(ir_out, MAX_IR_LEN);
     clear_reg(dr_in, MAX_DR_LEN);
@@ -86,10 +102,16 @@ void loop()
     uint32_t num, dr_len = 0;
     uint32_t nbits, first_ir, final_ir, max_dr_len = 0;
     uint32_t chain_ir_len, chain_idcode = 0;
+    uint32_t found_ir_len, found_idcode = 0;
     uint32_t which_tap = 0;
 
     uint32_t tmp_idcode = 0;
     uint32_t tmp_ir_len = 0;
+    uint32_t capture = 0;
+    const irmap_entry_t* entry = nullptr;
+    const profile_t* profile = nullptr;
+    idcode_info_t id_info;
+    const char* part = nullptr;
 
     String str;
     str.reserve(32);
@@ -108,29 +130,59 @@ void loop()
 
     print_welcome();
 
-    // try to detect the existance of a chain and set a single device to the chain
-    // 0 and 2 are just initial default args that will change at detect_chain later
-    chain_tap_add(taps, which_tap, "device 0", 0, 2);
+    // reuse the saved configuration if the same devices are in chain,
+    // a single IDCODE scan instead of a full chain detection
+    if (persist_load(&chain) == OK && chain_verify_idcodes(&chain) == OK)
+    {
+        Serial.println("\nRestored the saved chain configuration");
 
-    // select cur_tap to be the above TAP we created
-    cur_tap = &taps[0];
+        // select the saved device, or the first active one
+        which_tap = chain.selected;
+        if (which_tap == CHAIN_NONE_SELECTED)
+            for (which_tap = 0; !chain.taps[which_tap].active; which_tap++) { }
 
-    // detect chain and read idcode.
-    // at the initial detection we reference the first tap device: taps[0].
-    rc = detect_chain(&cur_tap->ir_len, &cur_tap->idcode);
-    if (rc != OK) {
-        goto inf_loop;
+        chain_tap_selector(&chain, which_tap, &cur_tap);
     }
+    else
+    {
+        chain_taps_init(&chain);
 
-    // ir len cannot be too large and idcode's LSB must be 1
-    // TODO: device can be without a default IDCODE connected between TDI and TDO
-    if ((cur_tap->ir_len > MAX_IR_LEN) || !(cur_tap->idcode & 0x01)) {
-        Serial.println("\nInvalid IDCODE value or IR length");
-        goto inf_loop;
-    }
+        // detect chain and read idcode of the device closest to JTDO.
+        rc = detect_chain(&found_ir_len, &found_idcode);
+        if (rc != OK) {
+            goto inf_loop;
+        }
 
-    // successfuly found active device in chain so activate the initial tap in chain
-    chain_tap_activate(taps, which_tap);
+        // ir len cannot be too large and idcode's LSB must be 1
+        // TODO: device can be without a default IDCODE connected between TDI and TDO
+        if ((found_ir_len > MAX_IR_LEN) || !(found_idcode & 0x01)) {
+            Serial.println("\nInvalid IDCODE value or IR length");
+            goto inf_loop;
+        }
+
+        // a known part gets its name, and its IR length is checked
+        profile = profile_find(found_idcode);
+        part = profile_part_name(found_idcode);
+        if (part == nullptr && idcode_lookup(found_idcode, &id_info) == OK) {
+            part = id_info.part;
+        }
+        if (profile != nullptr) {
+            Serial.print("\nFound "); Serial.println(part);
+            if (profile->ir_len != found_ir_len) {
+                Serial.print("IR length of the family is "); Serial.print(profile->ir_len, DEC);
+                Serial.println(", there may be more devices in chain");
+            }
+        }
+
+        // successfuly found active device in chain so add, activate
+        // and select the initial tap in chain
+        chain_tap_add(&chain, which_tap, part ? part : "device 0", found_idcode, found_ir_len);
+        chain_tap_activate(&chain, which_tap);
+        chain_tap_selector(&chain, which_tap, &cur_tap);
+
+        // next boot only needs to verify it
+        persist_save(&chain);
+    }
     reset_tap();
     print_main_menu();
 
@@ -139,13 +191,22 @@ void loop()
         num = 0;
         command = get_character("\ncmd > ");
 
+        // adding, removing or deactivating devices moves or clears the selection,
+        // so the selected device is looked up again for every command
+        cur_tap = chain.selected == CHAIN_NONE_SELECTED ? nullptr : chain_get_tap(&chain, chain.selected);
+        if (cur_tap == nullptr && command != '\0' && strchr("fgijxl", command) != nullptr) {
+            Serial.println("\nNo TAP device is selected, select one first");
+            continue;
+        }
+
         switch (command)
         {
         // add new TAP device to chain
         case 'a':
-            chain_print_taps(taps);
+            chain_print_taps(&chain);
             Serial.println("\nAdding new TAP device to chain");
-            which_tap = chain_get_active_devices() + 1;
+            rc = parse_number(nullptr, 32, "\nPosition in chain (0 is closest to TDO) > ", &which_tap);
+            if (rc != OK) break;
 
             str = get_string("\nName of device (31 chars) > ");
             // TODO check str
@@ -156,16 +217,16 @@ void loop()
             rc = parse_number(nullptr, 32, "\nIR length > ", &tmp_ir_len);
             if (rc != OK) break;
 
-            rc = chain_tap_add(taps, which_tap, str.c_str(), tmp_idcode, tmp_ir_len);
+            rc = chain_tap_add(&chain, which_tap, str.c_str(), tmp_idcode, tmp_ir_len);
             if (rc != OK) break;
 
-            chain_print_taps(taps);
+            chain_print_taps(&chain);
             memset((void*)str.c_str(), '\0', 32);
             break;
 
         // activate TAP device in chain
         case 'b':
-            chain_print_taps(taps);
+            chain_print_taps(&chain);
             Serial.println("\nSelect which TAP device to activate");
             rc = parse_number(nullptr, 32, "\nIndex > ", &which_tap);
             if (rc != OK) 
@@ -174,46 +235,46 @@ void loop()
                 break;
             }
 
-            rc = chain_tap_activate(taps, which_tap);
+            rc = chain_tap_activate(&chain, which_tap);
             if (rc != OK) 
             {
                 Serial.print("\nError selecting tap device: "); Serial.print(which_tap, DEC);
                 Serial.println("TAP device is inactive or was not discovered properly");
                 break;
             }
-            chain_print_taps(taps);
+            chain_print_taps(&chain);
             break;
 
         // deactivate tap device
         case 'c':
-            chain_print_taps(taps);
+            chain_print_taps(&chain);
             Serial.println("\nSelect which TAP device to deactivate");
             rc = parse_number(nullptr, 32, "\nIndex > ", &which_tap);
             if (rc != OK) break;
 
-            rc = chain_tap_deactivate(taps, which_tap);
+            rc = chain_tap_deactivate(&chain, which_tap);
             if (rc != OK)
             {
                 Serial.println("\nCould not deactivate TAP device index");
                 break;
             }
-            chain_print_taps(taps);
+            chain_print_taps(&chain);
             break;
 
         // remove the selected tap device
         case 'd':
-            chain_print_taps(taps);
+            chain_print_taps(&chain);
             Serial.println("\nSelect which TAP device to remove from chain");
             rc = parse_number(nullptr, 32, "\nIndex > ", &which_tap);
             if (rc != OK) break;
 
-            rc = chain_tap_remove(taps, which_tap);
+            rc = chain_tap_remove(&chain, which_tap);
             if (rc != OK)
             {
                 Serial.println("\nCould not remove TAP device index");
                 break;
             }
-            chain_print_taps(taps);
+            chain_print_taps(&chain);
             break;
 
         // attempt to connect to chain and read idcode
@@ -231,13 +292,15 @@ void loop()
             if (rc != OK) break;
             rc = parse_number(nullptr, 20, "Max allowed DR length > ", &max_dr_len);
             if (rc != OK) break;
+            irmap_select(cur_tap->idcode);
             discovery(first_ir, final_ir, max_dr_len, cur_tap->ir_len, ir_in);
             break;
 
         // insert ir
         case 'g':
             // TODO: debug the following line
-            rc = parse_number(&ir_in[cur_tap->ir_in_idx], cur_tap->ir_len, "\nShift IR > ", &num);
+            // the driver pads the other devices in chain, see chain_tap_selector
+            rc = parse_number(ir_in, cur_tap->ir_len, "\nShift IR > ", &num);
             if (rc != OK) break;
 
             Serial.print("\nIR  in: ");
@@ -269,22 +332,52 @@ void loop()
 
         // detect current dr length
         case 'i':
-            dr_len = detect_dr_len(ir_in, cur_tap->ir_len, 4);
+            irmap_select(cur_tap->idcode);
+            bin_array_to_uint32(ir_in, cur_tap->ir_len, &num);
+            entry = irmap_get(num);
+            if (entry != nullptr) {
+                Serial.print("\nDR length: "); Serial.print(entry->dr_len);
+                Serial.print(" (known)");
+                break;
+            }
+
+            dr_len = detect_dr_len(ir_in, cur_tap->ir_len, 4, MAX_DR_LEN, &capture);
             if (dr_len == 0) {
-                Serial.println("\nDidn't find the current DR length, TDO is stuck");
+                Serial.println("\nDidn't find the current DR length, TDO is stuck or DR is too long");
             }
             else {
                 Serial.print("\nDR length: ");
                 Serial.print(dr_len);
+                if (irmap_put(num, dr_len, capture) == OK)
+                    irmap_report(irmap_get(num));
             }
             break;
 
         // insert dr
         case 'j':
-            rc = parse_number(nullptr, 32, "Enter amount of bits to shift > ", &nbits);
-            if (nbits == 0 || rc != OK)
+            rc = parse_number(nullptr, 32, "Enter amount of bits to shift (0 for the known DR length) > ", &nbits);
+            if (rc != OK)
                 break;
 
+            // size the scan from the instruction map of the current IR
+            if (nbits == 0)
+            {
+                irmap_select(cur_tap->idcode);
+                bin_array_to_uint32(ir_in, cur_tap->ir_len, &num);
+                entry = irmap_get(num);
+                if (entry == nullptr) {
+                    Serial.println("\nDR length of the current IR is not known, detect it first");
+                    break;
+                }
+                nbits = entry->dr_len;
+                Serial.print("\nKnown DR length: "); Serial.print(nbits, DEC);
+            }
+
+            if (nbits > MAX_DR_LEN) {
+                Serial.println("\nDR length is larger than MAX_DR_LEN");
+                break;
+            }
+
             rc = parse_number(dr_in, nbits, "\nShift DR > ", &nbits);
             if (rc != OK) break;
 
@@ -313,14 +406,14 @@ void loop()
 
         // select active tap to work on
         case 's':
-            chain_print_taps(taps);
+            chain_print_taps(&chain);
             rc = parse_number(nullptr, 32, "Selecet the TAP device index (Decimal) > ", &which_tap);
             if (rc != OK) {
                 Serial.println("\nCould not get valid TAP device index");
                 break;
             }
             
-            rc = chain_tap_selector(taps, which_tap, cur_tap, ir_in, ir_out);
+            rc = chain_tap_selector(&chain, which_tap, &cur_tap);
             if (rc != OK) {
                 Serial.print("\nError selecting tap device: "); Serial.print(which_tap, DEC);
                 Serial.println("TAP device is inactive or was not discovered properly");
@@ -333,7 +426,7 @@ void loop()
         
         // print active TAPs chain
         case 'p':
-            chain_print_taps(taps);
+            chain_print_taps(&chain);
             break;
 
         // force return to RTI
@@ -345,9 +438,66 @@ void loop()
         // toggle TRST line
         case 't':
             Serial.println("Toggling TRST line");
-            digitalWrite(TRST, 0);
+            PIN_WRITE(TRST, 0);
             HC; HC; HC; HC; HC; HC; HC; HC;
-            digitalWrite(TRST, 1);
+            PIN_WRITE(TRST, 1);
+            // TRST puts the TAP in TLR and loads the default instruction
+            current_state = TEST_LOGIC_RESET;
+            ir_shadow_invalidate();
+            break;
+
+        // toggle the IR shadow cache
+        case 'k':
+            ir_shadow_enable(!ir_shadow_enabled());
+            Serial.print("\nIR shadow cache: ");
+            Serial.println(ir_shadow_enabled() ? "enabled" : "disabled");
+            break;
+
+        // set the TCK speed
+        case 'o':
+            Serial.print("\nTCK half-clock delay: "); Serial.print(tck_delay_us, DEC); Serial.println(" us");
+            rc = parse_number(nullptr, 32, "New delay in microseconds > ", &num);
+            if (rc != OK) break;
+            tck_delay_us = num;
+            break;
+
+        // save the chain table, TCK delay and instruction map for the next boot
+        case 'w':
+            command = get_character("\n(s)ave or (e)rase the configuration > ");
+            if (command == 's')
+                persist_save(&chain);
+            else if (command == 'e' && persist_erase() == OK)
+                Serial.println("\nConfiguration erased");
+            break;
+
+        // family commands of the selected device, e.g. the MAX10 FPGA flash commands
+        case 'x':
+            profile = profile_find(cur_tap->idcode);
+            if (profile == nullptr || profile->menu == nullptr) {
+                Serial.println("\nNo commands for the selected device family");
+                break;
+            }
+            profile->menu(cur_tap->ir_len, ir_in, ir_out, dr_in, dr_out);
+            break;
+
+        // pins of the selected device through its boundary register, by the BSDL of the host library
+        case 'l':
+            bscan_main(cur_tap->idcode, cur_tap->ir_len, ir_in, ir_out);
+            break;
+
+        // a target that only exposes SWD, or an SWJ-DP switched to SWD
+        case 'v':
+            arm_swd_main();
+            break;
+
+        // a target that only exposes the two wire cJTAG, all the commands then run over it
+        case 'y':
+            if (cjtag_active) {
+                cjtag_deactivate();
+                Serial.println("\ncJTAG off, back to four wire JTAG");
+                break;
+            }
+            rc = cjtag_activate();
             break;
 
         case 'h':
@@ -0,0 +1,117 @@
+"""
+@file program.py
+
+@brief Sender of the flash images that the Jtagger driver programs.
+        Programming starts with a single text line from the driver:
+
+            "@program 0x<start address> <number of words> <words per chunk>"
+
+        then for every 'R' byte the driver sends, the next chunk of the image
+        is sent as a frame (see dump.py), and an 'X' byte aborts.
+        The image is a raw file of 32 bit little endian words, such as the
+        images written by dump.py. Images shorter than the range are padded
+        with the erased value 0xFF.
+        A range of 0 words takes the whole image, and an empty frame follows
+        its last chunk: Xilinx bitstreams are sent that way, .bit files
+        without their header.
+
+@author Michael Vigdorchik
+"""
+
+import struct
+import sys
+import zlib
+
+PROGRAM_HEADER = "@program"
+
+# start of a Xilinx .bit file: the length and the content of its first field, then 1 and 'a'
+BIT_MAGIC = b"\x00\x09\x0f\xf0\x0f\xf0\x0f\xf0\x0f\xf0\x00\x00\x01"
+
+# read attempts (of the serial timeout) while waiting for the driver to ask for a chunk
+READY_RETRIES = 10
+
+
+class ProgramError(Exception):
+    pass
+
+
+def parse_header(line) -> tuple:
+    """@return (start address, number of words, words per chunk) of a "@program" line"""
+    fields = line.split()
+    if len(fields) != 4 or fields[0] != PROGRAM_HEADER:
+        raise ProgramError(f"bad program header: {line.strip()}")
+    return int(fields[1], 16), int(fields[2], 10), int(fields[3], 10)
+
+
+def strip_bit_header(image) -> bytes:
+    """@return the bitstream of a Xilinx .bit file, or the image as is if it has no .bit header"""
+    if not image.startswith(BIT_MAGIC):
+        return image
+
+    # fields 'a' - 'd' (design, part, date, time) with a 16 bit length, then 'e' with a 32 bit one
+    pos = len(BIT_MAGIC)
+    while pos < len(image):
+        key = image[pos:pos + 1]
+        if key == b"e":
+            length = struct.unpack(">I", image[pos + 1:pos + 5])[0]
+            return image[pos + 5:pos + 5 + length]
+        if key not in (b"a", b"b", b"c", b"d"):
+            break
+        length = struct.unpack(">H", image[pos + 1:pos + 3])[0]
+        pos += 3 + length
+    raise ProgramError("bad .bit header")
+
+
+def load_image(path, words, bitswap=False) -> bytes:
+    """Read an image file and fit it to the programmed range, or take all of it for 0 words"""
+    with open(path, "rb") as f:
+        image = f.read()
+    if bitswap:
+        # some RPD exports store every byte with its bits reversed
+        image = bytes(int(f"{b:08b}"[::-1], 2) for b in image)
+    if words == 0:
+        image = strip_bit_header(image)
+        if len(image) % 4:
+            raise ProgramError("the image is not made of 32 bit words")
+        return image
+    image = image[:words * 4]
+    return image + b"\xff" * (words * 4 - len(image))
+
+
+def send_frame(ser, payload):
+    ser.write(struct.pack("<H", len(payload)) + payload + struct.pack("<I", zlib.crc32(payload)))
+
+
+def send_image(ser, line, path, bitswap=False):
+    """Send the chunks of an image as the driver asks for them."""
+    _, words, chunk_words = parse_header(line)
+    image = load_image(path, words, bitswap)
+    chunk = chunk_words * 4
+
+    total = len(image) // 4
+    sent = 0
+    retries = 0
+    # a stream of unknown length ends with an empty frame
+    ended = words != 0
+    while sent < len(image) or not ended:
+        credit = ser.read(1)
+        if not credit:
+            retries += 1
+            if retries > READY_RETRIES:
+                raise ProgramError("driver stopped asking for the image")
+            continue
+        retries = 0
+
+        if credit == b"X":
+            raise ProgramError("programming aborted by the driver")
+        if credit != b"R":
+            continue
+
+        send_frame(ser, image[sent:sent + chunk])
+        ended = ended or sent == len(image)
+        sent += len(image[sent:sent + chunk])
+        sys.stdout.write(f"\rSent {sent // 4}/{total} words")
+        sys.stdout.flush()
+
+    ser.flush()
+    print(f"\nImage sent, CRC32: 0x{zlib.crc32(image):X}")
@@ -0,0 +1,126 @@
+/** @file Arduino.h
+ *
+ * @brief The part of the Arduino API that the driver uses, for host builds
+ * against the simulated targets of src/sim.
+ *
+ * Time is simulated: it only advances by delay() and delayMicroseconds(),
+ * so with JTAG_SIM every half-clock cycle (HC) costs tck_delay_us, and the
+ * times measured on the host are the times of the TCK stream on a board.
+ * Serial keeps the bytes written by the driver, and reads the bytes queued
+ * with host_serial_feed(), by the on_tx host callback or up front.
+ */
+#ifndef __HOST_ARDUINO__H__
+#define __HOST_ARDUINO__H__
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#define HEX 16
+#define DEC 10
+#define BIN 2
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+
+inline bool isDigit(int c) { return isdigit(c); }
+
+template <class T, class U> static inline T min(T a, U b) { return a < (T)b ? a : (T)b; }
+template <class T, class U> static inline T max(T a, U b) { return a > (T)b ? a : (T)b; }
+
+class String
+{
+public:
+    String() {}
+    String(const char* str) : s(str) {}
+    String(const std::string& str) : s(str) {}
+
+    unsigned int length() const { return s.size(); }
+    const char* c_str() const { return s.c_str(); }
+    char operator[](unsigned int i) const { return s[i]; }
+    char& operator[](unsigned int i) { return s[i]; }
+    bool operator==(const char* str) const { return s == str; }
+    bool operator!=(const char* str) const { return s != str; }
+    bool operator==(const String& str) const { return s == str.s; }
+    String substring(unsigned int from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+    void toCharArray(char* buf, unsigned int size) const { strncpy(buf, s.c_str(), size); }
+    long toInt() const { return atol(s.c_str()); }
+    void trim();
+
+private:
+    std::string s;
+};
+
+class HostSerial
+{
+public:
+    void begin(unsigned long) {}
+    void end() {}
+    operator bool() { return true; }
+    void setTimeout(unsigned long ms) { timeout_ms = ms; }
+    void flush() {}
+
+    int available();
+    int availableForWrite() { return 64; }
+    int read();
+    int peek();
+    size_t readBytes(char* buf, size_t len);
+    size_t readBytes(uint8_t* buf, size_t len) { return readBytes((char*)buf, len); }
+    size_t readBytesUntil(char terminator, char* buf, size_t len);
+    String readStringUntil(char terminator);
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buf, size_t len);
+    size_t write(const char* buf, size_t len) { return write((const uint8_t*)buf, len); }
+
+    size_t print(const char* str) { return write(str, strlen(str)); }
+    size_t print(const String& str) { return write(str.c_str(), str.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned long long n, int base = DEC);
+    size_t print(long long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC) { return print((unsigned long long)n, base); }
+    size_t print(long n, int base = DEC) { return print((long long)n, base); }
+    size_t print(unsigned int n, int base = DEC) { return print((unsigned long long)n, base); }
+    size_t print(int n, int base = DEC) { return print((long long)n, base); }
+    size_t print(unsigned char n, int base = DEC) { return print((unsigned long long)n, base); }
+    size_t print(unsigned short n, int base = DEC) { return print((unsigned long long)n, base); }
+    size_t print(short n, int base = DEC) { return print((long long)n, base); }
+    size_t print(double n, int digits = 2);
+
+    size_t println() { return print("\r\n"); }
+    template <class T> size_t println(T v) { return print(v) + println(); }
+    template <class T> size_t println(T v, int base) { return print(v, base) + println(); }
+
+    // the bytes written by the driver, and the bytes it may read
+    std::string tx;
+    std::string rx;
+    bool echo = false;          // copy the written bytes to stdout
+    void (*on_tx)(uint8_t c) = nullptr;    // the host side, sees every written byte
+    unsigned long timeout_ms = 1000;
+};
+
+extern HostSerial Serial;
+
+/**
+ * @brief Queue bytes for the driver to read from Serial.
+ */
+void host_serial_feed(const void* data, size_t len);
+
+#endif
@@ -0,0 +1,147 @@
+#include <stdio.h>
+
+#include "Arduino.h"
+
+HostSerial Serial;
+
+static unsigned long long now_us = 0;
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return 1; }
+
+void delay(unsigned long ms) { now_us += (unsigned long long)ms * 1000; }
+void delayMicroseconds(unsigned int us) { now_us += us; }
+unsigned long millis() { return now_us / 1000; }
+unsigned long micros() { return now_us; }
+
+void String::trim()
+{
+    size_t first = s.find_first_not_of(" \t\r\n");
+    size_t last = s.find_last_not_of(" \t\r\n");
+    s = first == std::string::npos ? std::string() : s.substr(first, last - first + 1);
+}
+
+void host_serial_feed(const void* data, size_t len) { Serial.rx.append((const char*)data, len); }
+
+int HostSerial::available()
+{
+    // a driver polling an idle line lets time pass
+    if (rx.empty())
+        delayMicroseconds(100);
+
+    return rx.size();
+}
+
+int HostSerial::read()
+{
+    if (rx.empty())
+        return -1;
+
+    int c = (uint8_t)rx[0];
+    rx.erase(0, 1);
+    return c;
+}
+
+int HostSerial::peek() { return rx.empty() ? -1 : (uint8_t)rx[0]; }
+
+size_t HostSerial::readBytes(char* buf, size_t len)
+{
+    size_t n = min(len, rx.size());
+
+    memcpy(buf, rx.data(), n);
+    rx.erase(0, n);
+
+    // a short read waited the whole timeout on a board
+    if (n < len)
+        delay(timeout_ms);
+
+    return n;
+}
+
+size_t HostSerial::readBytesUntil(char terminator, char* buf, size_t len)
+{
+    size_t n = 0;
+
+    while (n < len && !rx.empty())
+    {
+        char c = rx[0];
+        rx.erase(0, 1);
+        if (c == terminator)
+            return n;
+        buf[n++] = c;
+    }
+
+    if (n < len)
+        delay(timeout_ms);
+
+    return n;
+}
+
+String HostSerial::readStringUntil(char terminator)
+{
+    size_t end = rx.find(terminator);
+    std::string str = rx.substr(0, end);
+
+    if (end == std::string::npos)
+    {
+        rx.clear();
+        delay(timeout_ms);
+    }
+    else
+    {
+        rx.erase(0, end + 1);
+    }
+
+    return String(str);
+}
+
+size_t HostSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HostSerial::write(const uint8_t* buf, size_t len)
+{
+    tx.append((const char*)buf, len);
+    if (echo)
+        fwrite(buf, 1, len, stdout);
+
+    for (size_t i = 0; on_tx && i < len; i++)
+        on_tx(buf[i]);
+
+    return len;
+}
+
+size_t HostSerial::print(unsigned long long n, int base)
+{
+    char buf[65];
+    int i = sizeof(buf) - 1;
+
+    buf[i] = '\0';
+    do
+    {
+        int digit = n % base;
+        buf[--i] = digit < 10 ? '0' + digit : 'A' + digit - 10;
+        n /= base;
+    } while (n > 0);
+
+    return print(&buf[i]);
+}
+
+size_t HostSerial::print(long long n, int base)
+{
+    if (n < 0 && base == DEC)
+        return print('-') + print((unsigned long long)-n, base);
+
+    // like the 32 bit boards, other bases print the two's complement
+    if (n < 0)
+        return print((unsigned long long)(uint32_t)n, base);
+
+    return print((unsigned long long)n, base);
+}
+
+size_t HostSerial::print(double n, int digits)
+{
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "%.*f", digits, n);
+    return print(buf);
+}
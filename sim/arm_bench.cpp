@@ -0,0 +1,343 @@
+/** @file arm_bench.cpp
+ *
+ * @brief Runs the ADIv5 memory accesses, the core run control and the flash
+ * loader programming of the driver against the simulated Cortex-M on the host:
+ * checks their results, and reports the TCK cycles, the DAP scans and the time
+ * they take at a given half-clock cycle.
+ * Exits with 1 on the first failure.
+ *
+ * Usage: arm_bench [half-clock cycle in microseconds, default 1]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "bench.h"
+#include "../include/main.h"
+#include "../include/utils.h"
+#include "../src/jtag_drv/jtag_drv.h"
+#include "../src/arm/adiv5.h"
+#include "../src/arm/cortex_m.h"
+#include "../src/arm/arm_loader.h"
+#include "../src/arm/arm_dcc.h"
+#include "../src/arm/arm_gdb.h"
+#include "../src/sim/sim.h"
+#include "../src/sim/sim_cortex.h"
+
+#define MEM_BASE  0x08000000
+#define MEM_WORDS 0x4000    // 64KB of flash
+
+#define SRAM_BASE  0x20000000
+#define SRAM_WORDS 0x2000   // 32KB of SRAM
+
+// a loader of 1KB at the start of the SRAM, its stack and buffers above it
+#define LOADER_WORDS 256
+#define LOADER_ENTRY (SRAM_BASE + 1)
+#define LOADER_CTRL  (SRAM_BASE + 0x1000)
+
+#define DCC_WORDS 1000
+
+static uint32_t mem[MEM_WORDS];
+static uint32_t buf[MEM_WORDS];
+static uint32_t sram[SRAM_WORDS];
+static uint32_t pattern[MEM_WORDS];
+
+// image sent to the driver by the host side of the serial line
+static const uint32_t* host_words = nullptr;
+static uint32_t host_left = 0;
+
+static uint8_t ir_in[MAX_IR_LEN], ir_out[MAX_IR_LEN];
+static uint8_t dr_in[MAX_DR_LEN], dr_out[MAX_DR_LEN];
+
+/**
+ * @brief DAP scans, the counter column of the table.
+ */
+static uint32_t dap_scans()
+{
+    return sim_cortex_stats()->scans;
+}
+
+/**
+ * @brief Host side of "@program": answer every 'R' credit with the next chunk.
+ */
+static void host_program(uint8_t c)
+{
+    uint8_t frame[2 + ARM_LOADER_BUF_WORDS * 4 + 4];
+    uint32_t words, crc;
+    uint16_t len;
+
+    if (c != 'R' || host_left == 0)
+        return;
+
+    words = min(host_left, (uint32_t)ARM_LOADER_BUF_WORDS);
+    len = words * 4;
+    frame[0] = len;
+    frame[1] = len >> 8;
+    memcpy(&frame[2], host_words, len);
+    crc = crc32_update(0, &frame[2], len);
+    memcpy(&frame[2 + len], &crc, 4);
+    host_serial_feed(frame, len + 6);
+
+    host_words += words;
+    host_left -= words;
+}
+
+/**
+ * @brief Queue a request of the GDB bridge, as a frame from the host.
+ */
+static void host_gdb_request(char cmd, const uint32_t* args, uint32_t count)
+{
+    uint8_t frame[2 + 1 + ARM_GDB_MAX_WORDS * 4 + 4];
+    uint16_t len = 1 + count * 4;
+    uint32_t crc;
+
+    frame[0] = len;
+    frame[1] = len >> 8;
+    frame[2] = cmd;
+    memcpy(&frame[3], args, count * 4);
+    crc = crc32_update(0, &frame[2], len);
+    memcpy(&frame[2 + len], &crc, 4);
+    host_serial_feed(frame, len + 6);
+}
+
+/**
+ * @brief Take the next reply frame of the driver after "@gdb", at *pos of the serial TX.
+ * @return The data after the status byte, or nullptr if the reply is broken or failed.
+ */
+static const uint8_t* gdb_reply(size_t* pos, uint16_t* len)
+{
+    const std::string& tx = Serial.tx;
+    uint32_t crc;
+
+    if (*pos + 2 > tx.size())
+        return nullptr;
+    *len = (uint8_t)tx[*pos] | ((uint8_t)tx[*pos + 1] << 8);
+    if (*len == 0 || *pos + 2 + *len + 4 > tx.size())
+        return nullptr;
+
+    memcpy(&crc, &tx[*pos + 2 + *len], 4);
+    if (crc32_update(0, (const uint8_t*)&tx[*pos + 2], *len) != crc || tx[*pos + 2] != 0)
+        return nullptr;
+
+    *pos += 2 + *len + 4;
+    *len -= 1;
+    return (const uint8_t*)&tx[*pos - *len - 4];
+}
+
+/**
+ * @brief Compare the frames that follow a "@dump" or "@dcc" line written by
+ * the driver with the expected words.
+ */
+static bool check_frames(const char* tag, const uint32_t* expected, uint32_t words)
+{
+    const std::string& tx = Serial.tx;
+    size_t pos = tx.find(tag);
+    uint32_t received = 0;
+    uint16_t len;
+    uint32_t crc;
+
+    if (pos == std::string::npos || (pos = tx.find('\n', pos)) == std::string::npos)
+        return false;
+    pos++;
+
+    while (pos + 2 <= tx.size())
+    {
+        len = (uint8_t)tx[pos] | ((uint8_t)tx[pos + 1] << 8);
+        if (len == 0)
+            return received == words;
+        if (pos + 2 + len + 4 > tx.size() || received + len / 4 > words)
+            return false;
+
+        memcpy(&crc, &tx[pos + 2 + len], 4);
+        if (crc32_update(0, (const uint8_t*)&tx[pos + 2], len) != crc)
+            return false;
+        if (memcmp(&tx[pos + 2], &expected[received], len) != 0)
+            return false;
+
+        received += len / 4;
+        pos += 2 + len + 4;
+    }
+
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    // the stack grows down from the control block
+    arm_loader_t loader = { LOADER_ENTRY, LOADER_CTRL, LOADER_CTRL };
+    adiv5_dap_t dap;
+    uint32_t idcode = 0;
+    uint32_t ir_len = 0;
+    uint32_t value = 0;
+    bool halted = false;
+    bench_t b;
+    bool ok;
+
+    tck_delay_us = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+
+    srand(1);
+    for (uint32_t i = 0; i < MEM_WORDS; i++)
+    {
+        mem[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        pattern[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    }
+
+    sim_cortex_attach(MEM_BASE, mem, MEM_WORDS);
+    sim_cortex_set_sram(SRAM_BASE, sram, SRAM_WORDS);
+    sim_cortex_set_loader(LOADER_ENTRY);
+    adiv5_init(&dap, SIM_CORTEX_IR_LEN, ir_in, ir_out, dr_in, dr_out, 0);
+
+    printf("Cortex-M simulation, half-clock cycle %u us\n\n", tck_delay_us);
+    bench_counter = dap_scans;
+    bench_counter_name = "scans";
+    bench_header("words", "TCKs");
+
+    bench_begin(&b, "detect", 1);
+    ok = detect_chain(&ir_len, &idcode) == OK && ir_len == SIM_CORTEX_IR_LEN && idcode == SIM_CORTEX_IDCODE;
+    bench_end(&b, ok);
+
+    reset_tap();
+    bench_begin(&b, "power up", 0);
+    ok = adiv5_power_up(&dap) == OK;
+    ok = ok && adiv5_ap_read(&dap, 0, AP_IDR, &value) == OK && value == SIM_CORTEX_AP_IDR;
+    bench_end(&b, ok);
+
+    bench_begin(&b, "read32", 1);
+    ok = adiv5_mem_read32(&dap, MEM_BASE + 0x100, &value) == OK && value == mem[0x40];
+    bench_end(&b, ok);
+
+    // one word at a time, for comparison with the pipelined block read
+    bench_begin(&b, "read32 x 1024", 1024);
+    ok = true;
+    for (uint32_t i = 0; i < 1024 && ok; i++)
+        ok = adiv5_mem_read32(&dap, MEM_BASE + 4 * i, &buf[i]) == OK;
+    bench_end(&b, ok && memcmp(buf, mem, 1024 * 4) == 0);
+
+    memset(buf, 0, sizeof(buf));
+    bench_begin(&b, "read block", MEM_WORDS);
+    ok = adiv5_mem_read_block(&dap, MEM_BASE, buf, MEM_WORDS) == OK;
+    bench_end(&b, ok && memcmp(buf, mem, sizeof(mem)) == 0);
+
+    // unaligned to the 1KB blocks of TAR
+    memset(buf, 0, sizeof(buf));
+    bench_begin(&b, "read unaligned", 1000);
+    ok = adiv5_mem_read_block(&dap, MEM_BASE + 0x3f8, buf, 1000) == OK;
+    bench_end(&b, ok && memcmp(buf, &mem[0x3f8 / 4], 1000 * 4) == 0);
+
+    Serial.tx.clear();
+    bench_begin(&b, "dump", MEM_WORDS);
+    ok = adiv5_mem_dump(&dap, MEM_BASE, MEM_WORDS) == OK;
+    bench_end(&b, ok && check_frames("@dump", mem, MEM_WORDS));
+
+    bench_begin(&b, "write32", 1);
+    ok = adiv5_mem_write32(&dap, SRAM_BASE + 8, 0xdeadbeef) == OK && sram[2] == 0xdeadbeef;
+    bench_end(&b, ok);
+
+    bench_begin(&b, "write block", SRAM_WORDS);
+    ok = adiv5_mem_write_block(&dap, SRAM_BASE, pattern, SRAM_WORDS) == OK;
+    bench_end(&b, ok && memcmp(sram, pattern, sizeof(sram)) == 0);
+
+    bench_begin(&b, "halt + regs", 0);
+    ok = cortex_m_halt(&dap) == OK && cortex_m_reg_write(&dap, CORTEX_M_R2, 0x12345678) == OK;
+    ok = ok && cortex_m_reg_read(&dap, CORTEX_M_R2, &value) == OK && value == 0x12345678;
+    bench_end(&b, ok);
+
+    // the loader goes to SRAM the way the host sends it
+    Serial.on_tx = host_program;
+    host_words = &pattern[MEM_WORDS - LOADER_WORDS];
+    host_left = LOADER_WORDS;
+    bench_begin(&b, "load loader", LOADER_WORDS);
+    ok = arm_load_image(&dap, SRAM_BASE, LOADER_WORDS) == OK;
+    bench_end(&b, ok && memcmp(sram, &pattern[MEM_WORDS - LOADER_WORDS], LOADER_WORDS * 4) == 0);
+
+    // erased flash, programmed by the loader from the double buffered stream
+    memset(mem, 0xff, sizeof(mem));
+    host_words = pattern;
+    host_left = MEM_WORDS;
+    bench_begin(&b, "loader program", MEM_WORDS);
+    ok = arm_loader_program(&dap, &loader, MEM_BASE, MEM_WORDS) == OK;
+    ok = ok && memcmp(mem, pattern, sizeof(mem)) == 0 && sim_cortex_stats()->programs == MEM_WORDS;
+    // the loader runs with the interrupts of the firmware masked
+    ok = ok && sim_cortex_stats()->masked == 1;
+    bench_end(&b, ok && cortex_m_is_halted(&dap, &halted) == OK && halted);
+
+    // an empty range neither starts a transfer nor the loader
+    Serial.tx.clear();
+    bench_begin(&b, "program empty", 0);
+    ok = arm_load_image(&dap, SRAM_BASE, 0) == -ERR_BAD_PARAMETER;
+    ok = ok && arm_loader_program(&dap, &loader, MEM_BASE, 0) == -ERR_BAD_PARAMETER;
+    ok = ok && Serial.tx.find("@program") == std::string::npos && sim_cortex_stats()->resumes == 1;
+    bench_end(&b, ok && sim_tck_count() == 0);
+    Serial.on_tx = nullptr;
+
+    // a self-test log of the running core, drained from DCRDR
+    sim_cortex_set_dcc(pattern, DCC_WORDS);
+    ok = cortex_m_reg_write(&dap, CORTEX_M_PC, SRAM_BASE + 0x800) == OK && cortex_m_resume(&dap) == OK;
+    // a firmware resumed by the user gets its interrupts
+    ok = ok && sim_cortex_stats()->resumes == 2 && sim_cortex_stats()->masked == 1;
+    Serial.tx.clear();
+    bench_begin(&b, "dcc stream", DCC_WORDS);
+    ok = ok && arm_dcc_stream(&dap, DCC_WORDS, &value) == OK && value == DCC_WORDS;
+    bench_end(&b, ok && check_frames("@dcc", pattern, DCC_WORDS));
+    ok = cortex_m_halt(&dap) == OK;
+
+    // a stop of GDB: the registers, a block of the stack and a single step, then quit
+    {
+        const uint32_t read_args[] = { MEM_BASE + 0x200, ARM_GDB_MAX_WORDS };
+        const uint32_t no_args[] = { 0 };
+        const uint8_t* data;
+        uint16_t len = 0;
+        size_t pos;
+
+        ok = ok && cortex_m_reg_write(&dap, CORTEX_M_PC, 0x08000100) == OK;
+        Serial.tx.clear();
+        host_gdb_request('g', no_args, 0);
+        host_gdb_request('m', read_args, 2);
+        host_gdb_request('s', no_args, 0);
+        host_gdb_request('g', no_args, 0);
+        host_gdb_request('c', no_args, 0);
+        host_gdb_request('h', no_args, 0);
+        host_gdb_request('q', no_args, 0);
+        bench_begin(&b, "gdb requests", ARM_GDB_MAX_WORDS);
+        ok = ok && arm_gdb_serve(&dap) == OK;
+
+        pos = Serial.tx.find("@gdb");
+        pos = pos == std::string::npos ? pos : Serial.tx.find('\n', pos);
+        ok = ok && pos != std::string::npos;
+        pos++;
+        data = ok ? gdb_reply(&pos, &len) : nullptr;
+        ok = data != nullptr && len == ARM_GDB_REGS * 4 && memcmp(&data[4 * CORTEX_M_PC], "\x00\x01\x00\x08", 4) == 0;
+        data = ok ? gdb_reply(&pos, &len) : nullptr;
+        ok = data != nullptr && len == ARM_GDB_MAX_WORDS * 4 && memcmp(data, &mem[0x200 / 4], len) == 0;
+        ok = ok && gdb_reply(&pos, &len) != nullptr && len == 0;
+        data = ok ? gdb_reply(&pos, &len) : nullptr;
+        ok = data != nullptr && memcmp(&data[4 * CORTEX_M_PC], "\x02\x01\x00\x08", 4) == 0;
+        // continue, then interrupt: the core ran with its interrupts enabled
+        ok = ok && gdb_reply(&pos, &len) != nullptr && gdb_reply(&pos, &len) != nullptr;
+        ok = ok && sim_cortex_stats()->resumes == 3 && sim_cortex_stats()->masked == 1;
+        ok = ok && gdb_reply(&pos, &len) != nullptr && Serial.rx.empty();
+        bench_end(&b, ok);
+    }
+
+    // the driver repeats the scans answered by WAIT
+    sim_cortex_set_wait(7);
+    memset(buf, 0, sizeof(buf));
+    bench_begin(&b, "read with WAIT", MEM_WORDS);
+    ok = adiv5_mem_read_block(&dap, MEM_BASE, buf, MEM_WORDS) == OK;
+    bench_end(&b, ok && memcmp(buf, mem, sizeof(mem)) == 0 && sim_cortex_stats()->waits > 0);
+    sim_cortex_set_wait(0);
+
+    // outside of the memory, the sticky error is reported and cleared
+    bench_begin(&b, "bus fault", 2);
+    ok = adiv5_mem_read32(&dap, MEM_BASE - 4, &value) == -ERR_BUS_FAULT;
+    ok = ok && adiv5_mem_read32(&dap, MEM_BASE, &value) == OK && value == mem[0];
+    bench_end(&b, ok);
+
+    printf("\nDAP: %u scans, %u AP reads, %u AP writes, %u WAITs, %u faults, %u words programmed, %u DCC bytes\n",
+           sim_cortex_stats()->scans, sim_cortex_stats()->ap_reads, sim_cortex_stats()->ap_writes,
+           sim_cortex_stats()->waits, sim_cortex_stats()->faults, sim_cortex_stats()->programs,
+           sim_cortex_stats()->dcc_bytes);
+
+    return bench_exit();
+}
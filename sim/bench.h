@@ -0,0 +1,93 @@
+/** @file bench.h
+ *
+ * @brief Harness of the benches: runs an operation against a simulated target,
+ * and prints a row of the result table with its TCK cycles, the simulated time
+ * it took at the half-clock cycle of the run, and the host time. A bench can
+ * add a column of its own counter (DAP scans, SWD transfers ...), printed as
+ * the increase over each operation. Failed operations are counted, and
+ * bench_exit() gives the exit code of the bench.
+ */
+#ifndef __BENCH__H__
+#define __BENCH__H__
+
+#include <stdio.h>
+#include <time.h>
+
+#include "Arduino.h"
+#include "../src/sim/sim.h"
+
+typedef struct
+{
+    const char* name;
+    uint32_t units;         // words or operations
+    uint32_t count;         // bench counter at the start
+    unsigned long us;
+    clock_t wall;
+} bench_t;
+
+/**
+ * Column of the bench counter, none if bench_counter is nullptr.
+ */
+static const char* bench_counter_name = nullptr;
+static uint32_t (*bench_counter)() = nullptr;
+
+static int bench_failures = 0;
+
+/**
+ * @brief Print the title row of the table.
+ * @param units What an operation counts, "words" or "ops".
+ * @param clocks Title of the clock column, "TCKs" or "SWCLKs".
+ */
+static void bench_header(const char* units, const char* clocks)
+{
+    char rate[16];
+
+    snprintf(rate, sizeof(rate), "%s/sec", units);
+    printf("%-20s %8s ", "operation", units);
+    if (bench_counter != nullptr)
+        printf("%9s ", bench_counter_name);
+    printf("%10s %10s %12s %10s\n", clocks, "time ms", rate, "host ms");
+}
+
+static void bench_begin(bench_t* b, const char* name, uint32_t units)
+{
+    b->name = name;
+    b->units = units;
+    b->count = bench_counter != nullptr ? bench_counter() : 0;
+    b->us = micros();
+    b->wall = clock();
+    sim_tck_clear();
+}
+
+/**
+ * @return TCK cycles of the operation.
+ */
+static uint32_t bench_end(bench_t* b, bool ok)
+{
+    uint32_t tcks = sim_tck_count();
+    unsigned long us = micros() - b->us;
+    double wall_ms = 1000.0 * (clock() - b->wall) / CLOCKS_PER_SEC;
+
+    printf("%-20s %8u ", b->name, b->units);
+    if (bench_counter != nullptr)
+        printf("%9u ", bench_counter() - b->count);
+    printf("%10u %10.1f %12.0f %10.1f  %s\n", tcks, us / 1000.0, b->units && us ? b->units * 1e6 / us : 0.0,
+           wall_ms, ok ? "ok" : "FAILED");
+    if (!ok)
+        bench_failures++;
+
+    return tcks;
+}
+
+/**
+ * @return Exit code of the bench, 1 if an operation failed.
+ */
+static int bench_exit()
+{
+    if (bench_failures)
+        printf("%d operations FAILED\n", bench_failures);
+
+    return bench_failures ? 1 : 0;
+}
+
+#endif
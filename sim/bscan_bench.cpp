@@ -0,0 +1,407 @@
+/** @file bscan_bench.cpp
+ *
+ * @brief Drives the pins of a simulated device through its boundary register
+ * with the boundary scan engine: checks the pins the board sees and the
+ * levels the device captures, and compares the DR scans and TCK cycles of
+ * pin changes batched into a scan with a scan per change. The driver takes
+ * the model of the device from its pin map, sent by the host side as
+ * bsdl.py does.
+ * Exits with 1 on the first failure.
+ *
+ * Usage: bscan_bench [half-clock cycle in microseconds, default 1]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "bench.h"
+#include "../include/main.h"
+#include "../include/utils.h"
+#include "../src/jtag_drv/jtag_drv.h"
+#include "../src/bscan/bscan.h"
+#include "../src/bscan/bscan_map.h"
+#include "../src/sim/sim.h"
+#include "../src/sim/sim_bscan.h"
+
+#define IR_LEN     4
+#define EXTEST     0x0
+#define SAMPLE     0x1
+#define IDCODE     0x0a5ba093
+#define IDCODE_IR  0x2
+#define BYPASS     0xf
+
+#define DATA_PINS  8
+#define SPI_BYTES  64
+#define BUS_WRITES 64
+
+static const char* const data_ports[DATA_PINS] = { "D0", "D1", "D2", "D3", "D4", "D5", "D6", "D7" };
+
+// a bidir pin is an input, an output and a control cell, as in most BSDLs
+static bscan_cell_t cells[3 * DATA_PINS + 16];
+static bscan_model_t model = { "BSDEMO", IDCODE, IR_LEN, EXTEST, SAMPLE, 0, cells };
+
+// the pin map of the model, as compiled by bsdl.py from its BSDL
+static uint8_t pin_map[BSCAN_MAP_HEADER_LEN + 256 + sizeof(cells) / sizeof(cells[0]) * BSCAN_MAP_CELL_LEN
+                       + 4 * BSCAN_MAP_INSTRUCTION_LEN];
+static uint32_t pin_map_len = 0;
+static uint32_t host_sent = 0;
+static bool host_ended = false;
+static bool host_known = false;
+
+// the model the driver loaded, and the IDCODE bits of the part
+static bscan_model_t loaded;
+static uint32_t loaded_mask = 0;
+
+static uint8_t ir_in[MAX_IR_LEN], ir_out[MAX_IR_LEN];
+
+static bscan_t bs;
+/**
+ * @brief Boundary scans, the counter column of the table.
+ */
+static uint32_t bscan_scans()
+{
+    return bs.scans;
+}
+
+static uint16_t add_cell(uint16_t n, const char* port, uint8_t function, uint8_t safe, int16_t control, uint8_t disable)
+{
+    cells[n].port = port;
+    cells[n].function = function;
+    cells[n].safe = safe;
+    cells[n].control = control;
+    cells[n].disable = disable;
+    return n + 1;
+}
+
+/**
+ * @brief A parallel bus: D0-D7 bidir, a write strobe, an SPI port and a LED.
+ */
+static void build_model()
+{
+    uint16_t n = 0;
+    int16_t control;
+
+    for (int i = 0; i < DATA_PINS; i++)
+    {
+        control = n + 2;
+        n = add_cell(n, data_ports[i], BSCAN_INPUT, BSCAN_SAFE_X, -1, 0);
+        n = add_cell(n, data_ports[i], BSCAN_OUTPUT3, BSCAN_SAFE_X, control, 1);
+        n = add_cell(n, nullptr, BSCAN_CONTROL, 1, -1, 0);
+    }
+
+    // the bus and SPI outputs share a control cell, active low
+    control = n;
+    n = add_cell(n, nullptr, BSCAN_CONTROL, 1, -1, 0);
+    n = add_cell(n, "WR_N", BSCAN_OUTPUT3, 1, control, 1);
+    n = add_cell(n, "SCK", BSCAN_OUTPUT3, 0, control, 1);
+    n = add_cell(n, "MOSI", BSCAN_OUTPUT3, 0, control, 1);
+    n = add_cell(n, "CS_N", BSCAN_OUTPUT3, 1, control, 1);
+    n = add_cell(n, "MISO", BSCAN_INPUT, BSCAN_SAFE_X, -1, 0);
+    n = add_cell(n, "CLK", BSCAN_CLOCK, BSCAN_SAFE_X, -1, 0);
+    n = add_cell(n, "LED", BSCAN_OUTPUT2, 0, -1, 0);
+    for (int i = 0; i < 6; i++)
+        n = add_cell(n, nullptr, BSCAN_INTERNAL, 0, -1, 0);
+    n = add_cell(n, "BOOT", BSCAN_OBSERVE_ONLY, BSCAN_SAFE_X, -1, 0);
+    model.length = n;
+}
+
+static void put16(uint8_t* p, uint16_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t value)
+{
+    put16(p, value);
+    put16(p + 2, value >> 16);
+}
+
+/**
+ * @brief Offset of a name in the names table of the map, added if new.
+ */
+static uint16_t map_name(char* names, uint16_t* len, const char* name)
+{
+    for (uint16_t i = 0; i < *len; i += strlen(&names[i]) + 1)
+        if (strcmp(&names[i], name) == 0)
+            return i;
+
+    strcpy(&names[*len], name);
+    *len += strlen(name) + 1;
+    return *len - strlen(name) - 1;
+}
+
+/**
+ * @brief Compile the model into a pin map, the layout of bsdl.py: the
+ * names in the order of their first use, the instructions by name.
+ */
+static void build_map()
+{
+    static const char* const instr_names[] = { "BYPASS", "EXTEST", "IDCODE", "SAMPLE" };
+    static const uint32_t opcodes[] = { BYPASS, EXTEST, IDCODE_IR, SAMPLE };
+    char* names = (char*)&pin_map[BSCAN_MAP_HEADER_LEN];
+    uint8_t cell_map[sizeof(cells) / sizeof(cells[0]) * BSCAN_MAP_CELL_LEN];
+    uint8_t instr_map[4 * BSCAN_MAP_INSTRUCTION_LEN];
+    uint16_t names_len = 0;
+    const bscan_cell_t* cell;
+    uint8_t* p;
+
+    map_name(names, &names_len, model.name);
+    for (uint16_t i = 0; i < model.length; i++)
+    {
+        cell = &cells[i];
+        p = &cell_map[i * BSCAN_MAP_CELL_LEN];
+        put16(p, cell->port ? map_name(names, &names_len, cell->port) : BSCAN_MAP_NONE);
+        p[2] = cell->function | cell->safe << 4 | cell->disable << 6;
+        put16(p + 3, cell->control < 0 ? BSCAN_MAP_NONE : cell->control);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        put16(&instr_map[i * BSCAN_MAP_INSTRUCTION_LEN], map_name(names, &names_len, instr_names[i]));
+        put32(&instr_map[i * BSCAN_MAP_INSTRUCTION_LEN + 2], opcodes[i]);
+    }
+
+    memcpy(pin_map, "BM", 2);
+    pin_map[2] = BSCAN_MAP_VERSION;
+    pin_map[3] = IR_LEN;
+    put32(&pin_map[4], IDCODE);
+    put32(&pin_map[8], 0x0fffffff);
+    put32(&pin_map[12], EXTEST);
+    put32(&pin_map[16], SAMPLE);
+    put16(&pin_map[20], model.length);
+    put16(&pin_map[22], names_len);
+    put16(&pin_map[24], 4);
+
+    pin_map_len = BSCAN_MAP_HEADER_LEN + names_len;
+    memcpy(&pin_map[pin_map_len], cell_map, model.length * BSCAN_MAP_CELL_LEN);
+    pin_map_len += model.length * BSCAN_MAP_CELL_LEN;
+    memcpy(&pin_map[pin_map_len], instr_map, sizeof(instr_map));
+    pin_map_len += sizeof(instr_map);
+}
+
+/**
+ * @brief The host side of the link: a chunk of the pin map for every 'R'
+ * byte, and an empty frame after the last one. A device the library does
+ * not know gets the empty frame only.
+ */
+static void host_send_map(uint8_t c)
+{
+    uint8_t frame[2 + BSCAN_MAP_CHUNK_BYTES + 4];
+    uint32_t crc;
+    uint16_t len;
+
+    if (c != 'R' || host_ended)
+        return;
+
+    len = host_known ? min(pin_map_len - host_sent, (uint32_t)BSCAN_MAP_CHUNK_BYTES) : 0;
+    frame[0] = len;
+    frame[1] = len >> 8;
+    memcpy(&frame[2], &pin_map[host_sent], len);
+    crc = crc32_update(0, &frame[2], len);
+    memcpy(&frame[2 + len], &crc, 4);
+    host_serial_feed(frame, len + 6);
+
+    host_sent += len;
+    host_ended = len == 0;
+}
+
+static status_t load_map(uint32_t idcode, bool known)
+{
+    host_sent = 0;
+    host_ended = false;
+    host_known = known;
+    Serial.rx.clear();
+    Serial.tx.clear();
+    Serial.on_tx = host_send_map;
+
+    status_t rc = bscan_map_load(idcode, &loaded, &loaded_mask);
+
+    Serial.on_tx = nullptr;
+    return rc;
+}
+
+static bool same_model(const bscan_model_t* a, const bscan_model_t* b)
+{
+    const bscan_cell_t *x, *y;
+
+    if (strcmp(a->name, b->name) != 0 || a->idcode != b->idcode || a->ir_len != b->ir_len
+        || a->extest != b->extest || a->sample != b->sample || a->length != b->length)
+        return false;
+
+    for (uint16_t i = 0; i < a->length; i++)
+    {
+        x = &a->cells[i];
+        y = &b->cells[i];
+        if ((x->port == nullptr) != (y->port == nullptr) || (x->port && strcmp(x->port, y->port) != 0)
+            || x->function != y->function || x->safe != y->safe || x->control != y->control || x->disable != y->disable)
+            return false;
+    }
+    return true;
+}
+
+static uint8_t bus_level()
+{
+    uint8_t value = 0;
+
+    for (int i = 0; i < DATA_PINS; i++)
+        value |= (sim_bscan_level(data_ports[i]) & 1) << i;
+    return value;
+}
+
+int main(int argc, char** argv)
+{
+    static bscan_cell_t scratch[64];
+    bscan_pin_t data[DATA_PINS], wr, sck, mosi, miso, cs;
+    bscan_model_t broken;
+    uint32_t mask = 0;
+    uint8_t value, byte, rx, tx;
+    uint32_t idcode = 0;
+    uint32_t ir_len = 0;
+    bench_t b;
+    bool ok;
+
+    tck_delay_us = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+
+    build_model();
+    build_map();
+    sim_bscan_attach(&model);
+    sim_bscan_wire("MOSI", "MISO");
+
+    printf("Boundary scan simulation, half-clock cycle %u us, BSR of %u cells\n\n", tck_delay_us, model.length);
+    bench_counter = bscan_scans;
+    bench_counter_name = "scans";
+    bench_header("ops", "TCKs");
+
+    bench_begin(&b, "detect", 1);
+    ok = detect_chain(&ir_len, &idcode) == OK && ir_len == IR_LEN && idcode == IDCODE;
+    bench_end(&b, ok);
+
+    // another revision of the part takes the same map, an unknown part gets none
+    bench_begin(&b, "load pin map", 1);
+    ok = load_map(IDCODE ^ 0x10000000, true) == OK && same_model(&loaded, &model) && loaded_mask == 0x0fffffff;
+    ok = ok && load_map(IDCODE ^ 0x1000, false) == -ERR_NOT_FOUND;
+    ok = ok && load_map(IDCODE ^ 0x1000, true) == -ERR_BAD_IDCODE;
+    bench_end(&b, ok && load_map(IDCODE, true) == OK);
+
+    // a broken map is refused: a wrong names length, a control cell out of the BSR
+    pin_map[22]++;
+    ok = bscan_map_parse(pin_map, pin_map_len, &broken, scratch, 64, &mask) == -ERR_BAD_PARAMETER;
+    pin_map[22]--;
+    put16(&pin_map[pin_map_len - 4 * BSCAN_MAP_INSTRUCTION_LEN - 2], model.length);
+    ok = ok && bscan_map_parse(pin_map, pin_map_len, &broken, scratch, 64, &mask) == -ERR_BAD_PARAMETER;
+    put16(&pin_map[pin_map_len - 4 * BSCAN_MAP_INSTRUCTION_LEN - 2], BSCAN_MAP_NONE);
+    ok = ok && bscan_map_parse(pin_map, pin_map_len, &broken, scratch, 8, &mask) == -ERR_OUT_OF_BOUNDS;
+    ok = ok && bscan_map_parse(pin_map, pin_map_len, &broken, scratch, 64, &mask) == OK && mask == 0x0fffffff;
+
+    ok = ok && bscan_init(&bs, &loaded, ir_in, ir_out) == OK;
+    for (int i = 0; i < DATA_PINS; i++)
+        ok = ok && bscan_pin(&bs, data_ports[i], &data[i]) == OK;
+    ok = ok && bscan_pin(&bs, "WR_N", &wr) == OK && bscan_pin(&bs, "SCK", &sck) == OK;
+    ok = ok && bscan_pin(&bs, "MOSI", &mosi) == OK && bscan_pin(&bs, "MISO", &miso) == OK;
+    ok = ok && bscan_pin(&bs, "CS_N", &cs) == OK && bscan_pin(&bs, "NOPE", &cs) == -ERR_NOT_FOUND;
+    ok = ok && bscan_pin(&bs, "CS_N", &cs) == OK;
+
+    // the board holds BOOT low, the pins are sampled while the core has them
+    sim_bscan_drive("BOOT", 0);
+    bench_begin(&b, "sample", 1);
+    ok = ok && bscan_sample(&bs) == OK && bscan_get(&bs, "BOOT", &value) == OK && value == 0;
+    bench_end(&b, ok && bscan_get(&bs, "CLK", &value) == OK && value == 1);
+
+    // safe values: every output is off
+    bench_begin(&b, "extest", 1);
+    ok = bscan_extest(&bs) == OK && sim_bscan_level("D0") == SIM_BSCAN_Z && sim_bscan_level("WR_N") == SIM_BSCAN_Z;
+    bench_end(&b, ok && sim_bscan_level("LED") == 0);
+
+    // eight pins and their control cells, a single scan
+    bench_begin(&b, "set bus", 1);
+    for (int i = 0; i < DATA_PINS; i++)
+        bscan_pin_set(&bs, &data[i], (0xa5 >> i) & 1);
+    ok = bscan_flush(&bs) == OK && bus_level() == 0xa5;
+    bench_end(&b, ok);
+
+    bench_begin(&b, "flush unchanged", 1);
+    ok = bscan_flush(&bs) == OK && bs.skipped == 1;
+    bench_end(&b, ok);
+
+    // the board drives the bus, the device reads it with the scan after the one that let it go
+    bench_begin(&b, "read bus", 1);
+    for (int i = 0; i < DATA_PINS; i++)
+    {
+        bscan_pin_tristate(&bs, &data[i]);
+        sim_bscan_drive(data_ports[i], (0x3c >> i) & 1);
+    }
+    ok = bscan_flush(&bs) == OK && sim_bscan_level("D3") == SIM_BSCAN_Z && bscan_scan(&bs) == OK;
+    for (int i = 0; i < DATA_PINS && ok; i++)
+        ok = bscan_pin_get(&bs, &data[i], &byte) == OK && (byte == ((0x3c >> i) & 1));
+    bench_end(&b, ok);
+
+    // an SPI loopback (MOSI wired to MISO), mode 0: two scans a bit
+    bench_begin(&b, "spi loopback", SPI_BYTES);
+    bscan_pin_set(&bs, &cs, 0);
+    bscan_pin_set(&bs, &sck, 0);
+    ok = bscan_flush(&bs) == OK;
+    for (uint32_t n = 0; n < SPI_BYTES && ok; n++)
+    {
+        tx = n * 37 + 11;
+        rx = 0;
+        for (int bit = 7; bit >= 0; bit--)
+        {
+            bscan_pin_set(&bs, &sck, 0);
+            bscan_pin_set(&bs, &mosi, (tx >> bit) & 1);
+            bscan_flush(&bs);
+            bscan_pin_set(&bs, &sck, 1);
+            bscan_flush(&bs);
+            bscan_pin_get(&bs, &miso, &value);
+            rx = (rx << 1) | value;
+        }
+        ok = rx == tx;
+    }
+    bscan_pin_set(&bs, &cs, 1);
+    ok = ok && bscan_flush(&bs) == OK && sim_bscan_level("CS_N") == 1;
+    bench_end(&b, ok);
+
+    // bus writes: data and strobe low in a scan, strobe high in the next one
+    bench_begin(&b, "bus batched", BUS_WRITES);
+    ok = true;
+    for (uint32_t n = 0; n < BUS_WRITES && ok; n++)
+    {
+        for (int i = 0; i < DATA_PINS; i++)
+            bscan_pin_set(&bs, &data[i], (n >> i) & 1);
+        bscan_pin_set(&bs, &wr, 0);
+        bscan_flush(&bs);
+        ok = bus_level() == (uint8_t)n && sim_bscan_level("WR_N") == 0;
+        bscan_pin_set(&bs, &wr, 1);
+        bscan_flush(&bs);
+    }
+    bench_end(&b, ok);
+
+    // the same writes with a scan after every pin change, by name
+    bench_begin(&b, "bus per pin", BUS_WRITES);
+    ok = true;
+    for (uint32_t n = 0; n < BUS_WRITES && ok; n++)
+    {
+        for (int i = 0; i < DATA_PINS; i++)
+        {
+            bscan_set(&bs, data_ports[i], ((n ^ 0xff) >> i) & 1);
+            bscan_scan(&bs);
+        }
+        bscan_set(&bs, "WR_N", 0);
+        bscan_scan(&bs);
+        ok = bus_level() == (uint8_t)(n ^ 0xff);
+        bscan_set(&bs, "WR_N", 1);
+        bscan_scan(&bs);
+    }
+    bench_end(&b, ok);
+
+    // a shared control cell: the SPI port goes off with WR_N, LED has no control cell
+    bench_begin(&b, "tristate", 1);
+    ok = bscan_tristate(&bs, "WR_N") == OK && bscan_tristate(&bs, "LED") == -ERR_BAD_PARAMETER;
+    ok = ok && bscan_flush(&bs) == OK && sim_bscan_level("CS_N") == SIM_BSCAN_Z;
+    bench_end(&b, ok && bscan_get(&bs, "LED", &value) == -ERR_BAD_PARAMETER);
+
+    printf("\nBSR: %u scans, %u flushes without changes, %u captures, %u EXTEST updates\n",
+           bs.scans, bs.skipped, sim_bscan_stats()->captures, sim_bscan_stats()->updates);
+
+    return bench_exit();
+}
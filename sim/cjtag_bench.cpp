@@ -0,0 +1,120 @@
+/** @file cjtag_bench.cpp
+ *
+ * @brief Runs the same JTAG operations on the simulated MAX10 over the four
+ * wire pins and over cJTAG (OScan1, through the simulated 1149.7 adapter),
+ * checks that their results match, and reports the TCK (TCKC) cycles and the
+ * time they take at a given half-clock cycle.
+ * Exits with 1 on the first failure.
+ *
+ * Usage: cjtag_bench [half-clock cycle in microseconds, default 1]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "bench.h"
+#include "../include/main.h"
+#include "../include/utils.h"
+#include "../src/jtag_drv/jtag_drv.h"
+#include "../src/cjtag/cjtag.h"
+#include "../src/max10/max10_funcs.h"
+#include "../src/max10/max10_ir.h"
+#include "../src/sim/sim.h"
+#include "../src/sim/sim_max10.h"
+#include "../src/sim/sim_cjtag.h"
+
+#define FLASH_WORDS 0x2000  // 32KB of UFM
+#define CRC_WORDS   0x800
+
+static uint32_t flash[FLASH_WORDS];
+
+static uint8_t ir_in[MAX_IR_LEN], ir_out[MAX_IR_LEN];
+static uint8_t dr_in[MAX_DR_LEN], dr_out[MAX_DR_LEN];
+
+/**
+ * @brief The operations of both runs.
+ * @return TCK cycles of the CRC of the flash range.
+ */
+static uint32_t run(const char* prefix, uint32_t expected_crc)
+{
+    char name[32];
+    uint32_t idcode = 0;
+    uint32_t ir_len = 0;
+    uint32_t value = 0;
+    uint32_t tcks;
+    bench_t b;
+    bool ok;
+
+    snprintf(name, sizeof(name), "%s detect", prefix);
+    bench_begin(&b, name, 1);
+    ok = detect_chain(&ir_len, &idcode) == OK && ir_len == SIM_MAX10_IR_LEN && idcode == SIM_MAX10_IDCODE;
+    bench_end(&b, ok);
+
+    snprintf(name, sizeof(name), "%s usercode", prefix);
+    bench_begin(&b, name, 1);
+    int_to_bin_array(ir_in, USERCODE, SIM_MAX10_IR_LEN);
+    insert_ir(ir_in, ir_out, SIM_MAX10_IR_LEN, RUN_TEST_IDLE);
+    clear_reg(dr_in, 32);
+    insert_dr(dr_in, dr_out, 32, RUN_TEST_IDLE);
+    ok = bin_array_to_uint32(dr_out, 32, &value) == OK && value == 0x12345678;
+    bench_end(&b, ok);
+
+    snprintf(name, sizeof(name), "%s crc range", prefix);
+    reset_tap();
+    bench_begin(&b, name, CRC_WORDS);
+    ok = max10_crc_range(SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out, 0, CRC_WORDS) == expected_crc;
+    tcks = bench_end(&b, ok);
+
+    return tcks;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t crc, wire4, wire2;
+    bench_t b;
+    bool ok;
+
+    tck_delay_us = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+
+    srand(1);
+    for (uint32_t i = 0; i < FLASH_WORDS; i++)
+        flash[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    crc = crc32_update(0, (const uint8_t*)flash, CRC_WORDS * 4);
+
+    sim_max10_attach(flash, FLASH_WORDS);
+    sim_max10_set_usercode(0x12345678);
+
+    printf("cJTAG simulation, half-clock cycle %u us\n\n", tck_delay_us);
+    bench_header("words", "TCKs");
+
+    wire4 = run("4-wire", crc);
+
+    // the same MAX10 behind a cJTAG adapter, the driver goes two wire
+    sim_cjtag_attach();
+    bench_begin(&b, "activate", 0);
+    ok = cjtag_activate() == OK && sim_cjtag_stats()->activations == 1;
+    bench_end(&b, ok);
+
+    wire2 = run("OScan1", crc);
+    printf("\nOScan1: %.2f TCKC per TCK of the CRC range\n\n", wire4 ? (double)wire2 / wire4 : 0.0);
+
+    bench_begin(&b, "deactivate", 0);
+    cjtag_deactivate();
+    ok = !cjtag_active && sim_cjtag_stats()->escapes == 3;
+    bench_end(&b, ok);
+
+    // offline, nothing answers on the four wire pins
+    bench_begin(&b, "offline", 1);
+    ok = read_idcodes(&wire2, 1) != OK;
+    bench_end(&b, ok);
+
+    bench_begin(&b, "reactivate", 0);
+    ok = cjtag_activate() == OK && sim_cjtag_stats()->activations == 2;
+    bench_end(&b, ok);
+
+    printf("\nAdapter: %u OScan1 cycles, %u escapes, %u activations\n",
+           sim_cjtag_stats()->cycles, sim_cjtag_stats()->escapes, sim_cjtag_stats()->activations);
+
+    return bench_exit();
+}
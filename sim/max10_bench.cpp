@@ -0,0 +1,334 @@
+/** @file max10_bench.cpp
+ *
+ * @brief Runs the MAX10 flash operations of the driver against the simulated
+ * MAX10 on the host: checks their results, and reports the TCK cycles and the
+ * time they take at a given half-clock cycle. Exits with 1 on the first failure.
+ *
+ * Usage: max10_bench [half-clock cycle in microseconds, default 1]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "bench.h"
+#include "../include/main.h"
+#include "../include/utils.h"
+#include "../src/jtag_drv/jtag_drv.h"
+#include "../src/max10/max10_funcs.h"
+#include "../src/max10/sld_hub.h"
+#include "../src/profile/profile.h"
+#include "../src/sim/sim.h"
+#include "../src/sim/sim_max10.h"
+#include "../src/sim/sim_sld.h"
+
+#define IMAGE_WORDS (0x30000 / 4 + 0xa000)  // up to the end of CFM0
+
+static uint32_t image[IMAGE_WORDS];
+static uint32_t pattern[IMAGE_WORDS];
+
+static uint8_t ir_in[MAX_IR_LEN], ir_out[MAX_IR_LEN];
+static uint8_t dr_in[MAX_DR_LEN], dr_out[MAX_DR_LEN];
+
+// image sent to the driver by the host side of the serial line
+static const uint32_t* host_words = nullptr;
+static uint32_t host_left = 0;
+
+/**
+ * @brief Host side of "@program": answer every 'R' credit with the next chunk.
+ */
+static void host_program(uint8_t c)
+{
+    uint8_t frame[2 + MAX10_PROGRAM_CHUNK_WORDS * 4 + 4];
+    uint32_t words, crc;
+    uint16_t len;
+
+    if (c != 'R' || host_left == 0)
+        return;
+
+    words = min(host_left, (uint32_t)MAX10_PROGRAM_CHUNK_WORDS);
+    len = words * 4;
+    frame[0] = len;
+    frame[1] = len >> 8;
+    memcpy(&frame[2], host_words, len);
+    crc = crc32_update(0, &frame[2], len);
+    memcpy(&frame[2 + len], &crc, 4);
+    host_serial_feed(frame, len + 6);
+
+    host_words += words;
+    host_left -= words;
+}
+
+// cached image of the host side of an incremental dump, and what it was sent
+static uint32_t idump_cache[2 * MAX10_SECTOR_MAX_WORDS * MAX10_SECTOR_BATCH];
+static uint32_t idump_words = 0;
+static size_t idump_pos = std::string::npos;
+static uint32_t idump_requests = 0;
+static uint32_t idump_sectors[8];
+static uint32_t idump_sent = 0;
+static bool idump_total_ok = false;
+static bool idump_ended = false;
+
+/**
+ * @brief Host side of "@idump": answer every 'C' with the checksums of the
+ * cached sectors, patch the 'S' sectors into the cache, and check 'T'.
+ */
+static void host_incremental_dump(uint8_t)
+{
+    const std::string& tx = Serial.tx;
+    const uint8_t* payload;
+    uint32_t first, count, index, crc;
+    uint32_t crcs[MAX10_SECTOR_BATCH];
+    uint16_t len;
+
+    if (idump_pos == std::string::npos)
+    {
+        idump_pos = tx.find("@idump");
+        if (idump_pos != std::string::npos)
+            idump_pos = tx.find('\n', idump_pos);
+        if (idump_pos == std::string::npos)
+            return;
+        idump_pos++;
+    }
+
+    while (!idump_ended && idump_pos + 2 <= tx.size())
+    {
+        len = (uint8_t)tx[idump_pos] | ((uint8_t)tx[idump_pos + 1] << 8);
+        if (idump_pos + 2 + len + 4 > tx.size())
+            return;
+
+        payload = (const uint8_t*)&tx[idump_pos + 2];
+        memcpy(&crc, payload + len, 4);
+        idump_pos += 2 + len + 4;
+        if (crc32_update(0, payload, len) != crc)
+            continue;
+
+        if (len == 0)
+        {
+            idump_ended = true;
+        }
+        else if (payload[0] == 'C')
+        {
+            memcpy(&first, payload + 1, 4);
+            memcpy(&count, payload + 5, 4);
+            for (uint32_t i = 0; i < count && i < MAX10_SECTOR_BATCH; i++)
+            {
+                index = (first + i) * MAX10_SECTOR_MAX_WORDS;
+                crcs[i] = crc32_update(0, (const uint8_t*)&idump_cache[index],
+                                       min(idump_words - index, (uint32_t)MAX10_SECTOR_MAX_WORDS) * 4);
+            }
+            host_serial_feed(crcs, count * 4);
+            idump_requests++;
+        }
+        else if (payload[0] == 'S')
+        {
+            memcpy(&index, payload + 1, 4);
+            memcpy(&idump_cache[index * MAX10_SECTOR_MAX_WORDS], payload + 5, len - 5);
+            if (idump_sent < sizeof(idump_sectors) / sizeof(idump_sectors[0]))
+                idump_sectors[idump_sent] = index;
+            idump_sent++;
+        }
+        else if (payload[0] == 'T')
+        {
+            memcpy(&crc, payload + 1, 4);
+            idump_total_ok = crc == crc32_update(0, (const uint8_t*)idump_cache, idump_words * 4);
+        }
+    }
+}
+
+/**
+ * @brief Compare the frames of a "@dump" written by the driver with the expected words.
+ */
+static bool check_dump(const uint32_t* expected, uint32_t words)
+{
+    const std::string& tx = Serial.tx;
+    size_t pos = tx.find("@dump");
+    uint32_t received = 0;
+    uint16_t len;
+    uint32_t crc;
+
+    if (pos == std::string::npos || (pos = tx.find('\n', pos)) == std::string::npos)
+        return false;
+    pos++;
+
+    while (pos + 2 <= tx.size())
+    {
+        len = (uint8_t)tx[pos] | ((uint8_t)tx[pos + 1] << 8);
+        if (len == 0)
+            return received == words;
+        if (pos + 2 + len + 4 > tx.size() || received + len / 4 > words)
+            return false;
+
+        memcpy(&crc, &tx[pos + 2 + len], 4);
+        if (crc32_update(0, (const uint8_t*)&tx[pos + 2], len) != crc)
+            return false;
+        if (memcmp(&tx[pos + 2], &expected[received], len) != 0)
+            return false;
+
+        received += len / 4;
+        pos += 2 + len + 4;
+    }
+
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    const max10_sector_t* ufm1 = &max10_sectors[0];
+    const max10_sector_t* ufm0 = &max10_sectors[1];
+    uint32_t first_word = ufm1->start / 4;
+    uint32_t ufm0_word = ufm0->start / 4;
+    uint32_t idcode = 0;
+    uint32_t ir_len = 0;
+    uint32_t first = 0;
+    sld_hub_t hub;
+    uint32_t vdr_in[4] = { 0x11111111, 0x22222222, 0x33333333, 0xcafe0001 };
+    uint32_t vdr_out[4];
+    uint32_t vir_updates;
+    bench_t b;
+    bool ok;
+
+    tck_delay_us = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+
+    srand(1);
+    for (uint32_t i = 0; i < IMAGE_WORDS; i++)
+    {
+        image[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        pattern[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    }
+
+    sim_max10_attach(image, IMAGE_WORDS);
+    sim_max10_set_usercode(0x12345678);
+    sim_sld_attach();
+
+    printf("MAX10 simulation, half-clock cycle %u us\n\n", tck_delay_us);
+    bench_header("words", "TCKs");
+
+    reset_tap();
+    bench_begin(&b, "idcode", 1);
+    ok = read_idcodes(&idcode, 1) == OK && idcode == SIM_MAX10_IDCODE;
+    ok = ok && strcmp(profile_part_name(idcode), "10M08") == 0;
+    bench_end(&b, ok);
+
+    // the IDCODE database knows the only part of the chain, so the IR length is not probed
+    bench_begin(&b, "detect", 1);
+    ok = detect_chain(&ir_len, &idcode) == OK && ir_len == SIM_MAX10_IR_LEN && idcode == SIM_MAX10_IDCODE;
+    ok = ok && sim_tck_count() < 2 * MANY_ONES;
+    bench_end(&b, ok);
+
+    reset_tap();
+    bench_begin(&b, "usercode", 1);
+    ok = max10_read_user_code(SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out) == 0x12345678;
+    bench_end(&b, ok);
+
+    reset_tap();
+    bench_begin(&b, "crc UFM1", ufm1->words);
+    ok = max10_crc_range(SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out, ufm1->start, ufm1->words) ==
+         crc32_update(0, (const uint8_t*)&image[first_word], ufm1->words * 4);
+    bench_end(&b, ok);
+
+    reset_tap();
+    Serial.tx.clear();
+    bench_begin(&b, "dump UFM0", ufm0->words);
+    max10_dump_range(SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out, ufm0->start, ufm0->words);
+    bench_end(&b, check_dump(&image[ufm0_word], ufm0->words));
+
+    // the host cache of UFM1 and UFM0 is outdated in three sectors, the last one short
+    reset_tap();
+    idump_words = ufm1->words + ufm0->words - 100;
+    memcpy(idump_cache, &image[first_word], idump_words * 4);
+    idump_cache[3 * MAX10_SECTOR_MAX_WORDS + 7] ^= 1;
+    idump_cache[17 * MAX10_SECTOR_MAX_WORDS] ^= 0x80000000;
+    idump_cache[idump_words - 1] = ~idump_cache[idump_words - 1];
+    Serial.tx.clear();
+    Serial.on_tx = host_incremental_dump;
+    bench_begin(&b, "idump UFM1+0", idump_words);
+    ok = max10_dump_range_incremental(SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out, ufm1->start, idump_words,
+                                      MAX10_SECTOR_MAX_WORDS) == OK;
+    ok = ok && idump_ended && idump_total_ok && idump_requests == 2 && idump_sent == 3;
+    ok = ok && idump_sectors[0] == 3 && idump_sectors[1] == 17 && idump_sectors[2] == 31;
+    ok = ok && memcmp(idump_cache, &image[first_word], idump_words * 4) == 0;
+    bench_end(&b, ok);
+    Serial.on_tx = nullptr;
+
+    // the end words of the sector already read erased, the rest of it must be erased as well
+    reset_tap();
+    image[first_word] = 0xffffffff;
+    image[first_word + ufm1->words - 1] = 0xffffffff;
+    bench_begin(&b, "erase UFM1", ufm1->words);
+    ok = max10_erase_sector(SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out, 0) == OK;
+    for (uint32_t i = 0; i < ufm1->words && ok; i++)
+        ok = image[first_word + i] == 0xffffffff;
+    ok = ok && image[ufm0_word] != 0xffffffff && sim_max10_stats()->violations == 0;
+    bench_end(&b, ok);
+
+    reset_tap();
+    bench_begin(&b, "blank UFM1", ufm1->words);
+    ok = max10_blank_check(SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out, ufm1->start, ufm1->words, &first) == OK;
+    bench_end(&b, ok);
+
+    reset_tap();
+    Serial.on_tx = host_program;
+    host_words = &pattern[first_word];
+    host_left = ufm1->words;
+    bench_begin(&b, "program UFM1", ufm1->words);
+    ok = max10_program_range(SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out, ufm1->start, ufm1->words) == OK;
+    ok = ok && memcmp(&image[first_word], &pattern[first_word], ufm1->words * 4) == 0;
+    bench_end(&b, ok && sim_max10_stats()->violations == 0);
+
+    // an empty range neither starts a transfer nor enters ISC mode
+    reset_tap();
+    Serial.tx.clear();
+    bench_begin(&b, "program empty", 0);
+    ok = max10_program_range(SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out, ufm1->start, 0) == -ERR_BAD_PARAMETER;
+    bench_end(&b, ok && Serial.tx.find("@program") == std::string::npos && sim_tck_count() == 0);
+    Serial.on_tx = nullptr;
+
+    reset_tap();
+    bench_begin(&b, "erase device", IMAGE_WORDS);
+    ok = max10_erase_device(SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out) == OK;
+    bench_end(&b, ok && sim_max10_stats()->violations == 0);
+
+    reset_tap();
+    bench_begin(&b, "blank device", IMAGE_WORDS);
+    ok = max10_blank_check(SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out, 0, IMAGE_WORDS, &first) == OK;
+    bench_end(&b, ok);
+
+    // VIR of 5 instruction bits and 2 address bits, for the hub and its 2 nodes
+    reset_tap();
+    sld_hub_init(&hub, SIM_MAX10_IR_LEN, ir_in, ir_out, dr_in, dr_out);
+    bench_begin(&b, "sld enumerate", 1 + SIM_SLD_NODES);
+    ok = sld_hub_enumerate(&hub) == OK && hub.instr_len == SIM_SLD_INSTR_LEN && hub.addr_len == 2 && hub.vir_len == 7;
+    ok = ok && hub.count == SIM_SLD_NODES && hub.nodes[0].id == SIM_SLD_NODE_VJTAG && hub.nodes[0].instance == 0;
+    ok = ok && hub.nodes[1].id == SIM_SLD_NODE_VJTAG && hub.nodes[1].instance == 1 && hub.nodes[1].mfg == SIM_SLD_MFG;
+    ok = ok && sld_hub_find(&hub, SIM_SLD_NODE_VJTAG, 1) == 1 && sim_sld_stats()->info_reads == 8 * (1 + SIM_SLD_NODES);
+    bench_end(&b, ok);
+
+    // a batch shifts its VIR once, and the VDR keeps the last value written
+    vir_updates = sim_sld_stats()->vir_updates;
+    bench_begin(&b, "vjtag write", 4);
+    ok = sld_access(&hub, 1, SIM_SLD_VJTAG_DATA, vdr_in, vdr_out, 32, 4) == OK;
+    ok = ok && vdr_out[1] == vdr_in[0] && vdr_out[3] == vdr_in[2];
+    ok = ok && sim_sld_vjtag_data(1) == vdr_in[3] && sim_sld_vjtag_data(0) == 0;
+    ok = ok && sim_sld_stats()->vir_updates == vir_updates + 1;
+    bench_end(&b, ok);
+
+    // the same VIR again is not shifted
+    bench_begin(&b, "vjtag read", 1);
+    ok = sld_access(&hub, 1, SIM_SLD_VJTAG_DATA, nullptr, vdr_out, 32, 1) == OK && vdr_out[0] == vdr_in[3];
+    ok = ok && sim_sld_stats()->vir_updates == vir_updates + 1;
+    bench_end(&b, ok);
+
+    bench_begin(&b, "vjtag counter", 4);
+    ok = sld_access(&hub, 0, SIM_SLD_VJTAG_COUNTER, nullptr, vdr_out, 32, 4) == OK;
+    for (uint32_t i = 1; i < 4 && ok; i++)
+        ok = vdr_out[i] == vdr_out[0] + i;
+    ok = ok && sim_sld_stats()->vir_updates == vir_updates + 2;
+    ok = ok && sld_vir(&hub, 0, 1UL << SIM_SLD_INSTR_LEN) == -ERR_BAD_PARAMETER;
+    bench_end(&b, ok);
+
+    printf("\nflash: %u reads, %u programs, %u erases, %u timing violations\n", sim_max10_stats()->reads,
+           sim_max10_stats()->programs, sim_max10_stats()->erases, sim_max10_stats()->violations);
+
+    return bench_exit();
+}
@@ -0,0 +1,224 @@
+/** @file riscv_bench.cpp
+ *
+ * @brief Runs the DMI batches, the abstract commands, the program buffer and
+ * the system bus accesses of the driver against the simulated RISC-V hart on
+ * the host: checks their results, and reports the TCK cycles, the DMI scans
+ * and the time they take at a given half-clock cycle.
+ * Exits with 1 on the first failure.
+ *
+ * Usage: riscv_bench [half-clock cycle in microseconds, default 1]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "bench.h"
+#include "../include/main.h"
+#include "../include/utils.h"
+#include "../src/jtag_drv/jtag_drv.h"
+#include "../src/riscv/riscv_dtm.h"
+#include "../src/riscv/riscv_dm.h"
+#include "../src/sim/sim.h"
+#include "../src/sim/sim_riscv.h"
+
+#define MEM_BASE  0x80000000
+#define MEM_WORDS 0x4000    // 64KB of memory
+
+// lw x2, 0(x1); addi x2, x2, 1; sw x2, 4(x1)
+#define INSN_LW   0x0000a103
+#define INSN_ADDI 0x00110113
+#define INSN_SW   0x0020a223
+
+static uint32_t mem[MEM_WORDS];
+static uint32_t buf[MEM_WORDS];
+static uint32_t pattern[MEM_WORDS];
+
+static uint8_t ir_in[MAX_IR_LEN], ir_out[MAX_IR_LEN];
+static uint8_t dr_in[MAX_DR_LEN], dr_out[MAX_DR_LEN];
+
+static riscv_dtm_t dtm;
+/**
+ * @brief DMI scans, the counter column of the table.
+ */
+static uint32_t dtm_scans()
+{
+    return dtm.scans;
+}
+
+/**
+ * @brief Compare the frames that follow the "@dump" line written by the
+ * driver with the expected words.
+ */
+static bool check_dump(const uint32_t* expected, uint32_t words)
+{
+    const std::string& tx = Serial.tx;
+    size_t pos = tx.find("@dump");
+    uint32_t received = 0;
+    uint16_t len;
+    uint32_t crc;
+
+    if (pos == std::string::npos || (pos = tx.find('\n', pos)) == std::string::npos)
+        return false;
+    pos++;
+
+    while (pos + 2 <= tx.size())
+    {
+        len = (uint8_t)tx[pos] | ((uint8_t)tx[pos + 1] << 8);
+        if (len == 0)
+            return received == words;
+        if (pos + 2 + len + 4 > tx.size() || received + len / 4 > words)
+            return false;
+
+        memcpy(&crc, &tx[pos + 2 + len], 4);
+        if (crc32_update(0, (const uint8_t*)&tx[pos + 2], len) != crc)
+            return false;
+        if (memcmp(&tx[pos + 2], &expected[received], len) != 0)
+            return false;
+
+        received += len / 4;
+        pos += 2 + len + 4;
+    }
+
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t insns[] = { INSN_LW, INSN_ADDI, INSN_SW };
+    riscv_dm_t dm;
+    uint16_t regnos[32];
+    uint32_t values[32], expected[32];
+    uint32_t idcode = 0;
+    uint32_t ir_len = 0;
+    uint32_t value = 0;
+    uint32_t idle;
+    bench_t b;
+    bool ok;
+
+    tck_delay_us = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+
+    srand(1);
+    for (uint32_t i = 0; i < MEM_WORDS; i++)
+    {
+        mem[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        pattern[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    }
+
+    sim_riscv_attach(MEM_BASE, mem, MEM_WORDS);
+
+    printf("RISC-V simulation, half-clock cycle %u us\n\n", tck_delay_us);
+    bench_counter = dtm_scans;
+    bench_counter_name = "scans";
+    bench_header("words", "TCKs");
+
+    bench_begin(&b, "detect", 1);
+    ok = detect_chain(&ir_len, &idcode) == OK && ir_len == SIM_RISCV_IR_LEN && idcode == SIM_RISCV_IDCODE;
+    bench_end(&b, ok);
+
+    reset_tap();
+    ok = riscv_dtm_init(&dtm, SIM_RISCV_IR_LEN, ir_in, ir_out, dr_in, dr_out) == OK && dtm.abits == SIM_RISCV_ABITS;
+    bench_begin(&b, "activate", 0);
+    ok = ok && riscv_dm_init(&dm, &dtm) == OK && dm.progbufsize == 4 && !dm.impebreak && dm.sb;
+    bench_end(&b, ok);
+
+    bench_begin(&b, "halt", 0);
+    ok = riscv_dm_halt(&dm) == OK;
+    bench_end(&b, ok);
+
+    bench_begin(&b, "write register", 1);
+    regnos[0] = RISCV_CSR_DPC;
+    value = 0x80000100;
+    ok = riscv_reg_write_batch(&dm, regnos, &value, 1) == OK;
+    ok = ok && riscv_reg_read_batch(&dm, regnos, values, 1) == OK && values[0] == value;
+    bench_end(&b, ok);
+
+    for (uint32_t i = 0; i < 32; i++)
+    {
+        regnos[i] = RISCV_REG_GPR(i);
+        expected[i] = i ? pattern[i] : 0;
+    }
+
+    bench_begin(&b, "write GPRs", 32);
+    ok = riscv_reg_write_batch(&dm, regnos, pattern, 32) == OK;
+    bench_end(&b, ok);
+
+    bench_begin(&b, "read GPRs", 32);
+    ok = riscv_reg_read_batch(&dm, regnos, values, 32) == OK;
+    bench_end(&b, ok && memcmp(values, expected, sizeof(values)) == 0);
+
+    // x1 points to the memory, the program buffer increments its first word into the second
+    value = MEM_BASE;
+    ok = riscv_reg_write_batch(&dm, &regnos[1], &value, 1) == OK;
+    bench_begin(&b, "progbuf exec", 3);
+    ok = ok && riscv_progbuf_exec(&dm, insns, 3) == OK && mem[1] == mem[0] + 1;
+    bench_end(&b, ok && riscv_reg_read_batch(&dm, &regnos[2], &value, 1) == OK && value == mem[1]);
+    expected[2] = mem[1];
+
+    // the exception is reported and cleared
+    value = MEM_BASE - 4;
+    expected[1] = value;
+    ok = riscv_reg_write_batch(&dm, &regnos[1], &value, 1) == OK;
+    bench_begin(&b, "progbuf fault", 1);
+    ok = ok && riscv_progbuf_exec(&dm, insns, 1) == -ERR_GENERAL;
+    bench_end(&b, ok && riscv_reg_read_batch(&dm, regnos, &value, 1) == OK && value == 0);
+
+    memset(buf, 0, sizeof(buf));
+    bench_begin(&b, "sb read", 1);
+    ok = riscv_sb_read_block(&dm, MEM_BASE + 0x100, buf, 1) == OK && buf[0] == mem[0x40];
+    bench_end(&b, ok);
+
+    memset(buf, 0, sizeof(buf));
+    bench_begin(&b, "sb read block", MEM_WORDS);
+    ok = riscv_sb_read_block(&dm, MEM_BASE, buf, MEM_WORDS) == OK;
+    bench_end(&b, ok && memcmp(buf, mem, sizeof(mem)) == 0);
+
+    Serial.tx.clear();
+    bench_begin(&b, "dump", MEM_WORDS);
+    ok = riscv_sb_dump(&dm, MEM_BASE, MEM_WORDS) == OK;
+    bench_end(&b, ok && check_dump(mem, MEM_WORDS));
+
+    bench_begin(&b, "sb write block", MEM_WORDS);
+    ok = riscv_sb_write_block(&dm, MEM_BASE, pattern, MEM_WORDS) == OK;
+    bench_end(&b, ok && memcmp(mem, pattern, sizeof(mem)) == 0);
+
+    // a slower DMI: the busy accesses are repeated, and the idle cycles grow to fit
+    sim_riscv_set_latency(120, 0, 0);
+    idle = dtm.idle;
+    memset(buf, 0, sizeof(buf));
+    bench_begin(&b, "read with busy", MEM_WORDS);
+    ok = riscv_sb_read_block(&dm, MEM_BASE, buf, MEM_WORDS) == OK;
+    ok = ok && memcmp(buf, mem, sizeof(mem)) == 0 && dtm.busy > 0 && dtm.idle > idle;
+    bench_end(&b, ok);
+    sim_riscv_set_latency(8, 0, 0);
+
+    // abstract commands slower than the batch: one command at a time
+    sim_riscv_set_latency(8, 200, 0);
+    bench_begin(&b, "slow commands", 32);
+    ok = riscv_reg_read_batch(&dm, regnos, values, 32) == OK;
+    bench_end(&b, ok && memcmp(values, expected, sizeof(values)) == 0);
+
+    // a bus slower than the DMI: sbbusyerror, the batch is read again with more idle cycles
+    sim_riscv_set_latency(8, 0, 400);
+    memset(buf, 0, sizeof(buf));
+    bench_begin(&b, "slow bus", 1024);
+    ok = riscv_sb_read_block(&dm, MEM_BASE, buf, 1024) == OK;
+    bench_end(&b, ok && memcmp(buf, mem, 1024 * 4) == 0);
+    sim_riscv_set_latency(8, 0, 0);
+
+    // outside of the memory, sberror is reported and cleared
+    bench_begin(&b, "bus error", 2);
+    ok = riscv_sb_read_block(&dm, MEM_BASE - 4, &value, 1) == -ERR_BUS_FAULT;
+    ok = ok && riscv_sb_read_block(&dm, MEM_BASE, &value, 1) == OK && value == mem[0];
+    bench_end(&b, ok);
+
+    bench_begin(&b, "resume", 0);
+    ok = riscv_dm_resume(&dm) == OK;
+    bench_end(&b, ok);
+
+    printf("\nDMI: %u scans, %u accesses, %u busy, %u idle cycles, %u commands, %u bus reads, %u bus writes\n",
+           dtm.scans, sim_riscv_stats()->dmi_accesses, sim_riscv_stats()->busy, dtm.idle,
+           sim_riscv_stats()->commands, sim_riscv_stats()->sb_reads, sim_riscv_stats()->sb_writes);
+
+    return bench_exit();
+}
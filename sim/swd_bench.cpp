@@ -0,0 +1,132 @@
+/** @file swd_bench.cpp
+ *
+ * @brief Runs the SWD engine against the simulated Cortex-M on the host: the
+ * switch from JTAG, the ADIv5 memory accesses and the core run control over
+ * SWD, the WAIT and FAULT handling, and the switch back to JTAG. Reports the
+ * SWCLK cycles, the transfers and the time they take at a given half-clock cycle.
+ * Exits with 1 on the first failure.
+ *
+ * Usage: swd_bench [half-clock cycle in microseconds, default 1]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Arduino.h"
+#include "bench.h"
+#include "../include/main.h"
+#include "../src/jtag_drv/jtag_drv.h"
+#include "../src/swd/swd.h"
+#include "../src/arm/adiv5.h"
+#include "../src/arm/cortex_m.h"
+#include "../src/sim/sim.h"
+#include "../src/sim/sim_cortex.h"
+
+#define MEM_BASE  0x08000000
+#define MEM_WORDS 0x4000    // 64KB of flash
+
+#define SRAM_BASE  0x20000000
+#define SRAM_WORDS 0x2000   // 32KB of SRAM
+
+static uint32_t mem[MEM_WORDS];
+static uint32_t buf[MEM_WORDS];
+static uint32_t sram[SRAM_WORDS];
+static uint32_t pattern[SRAM_WORDS];
+
+/**
+ * @brief SWD transfers, the counter column of the table.
+ */
+static uint32_t transfers()
+{
+    return sim_cortex_stats()->scans;
+}
+
+int main(int argc, char** argv)
+{
+    swd_t swd;
+    adiv5_dap_t dap;
+    uint32_t idcode = 0;
+    uint32_t ir_len = 0;
+    uint32_t value = 0;
+    bench_t b;
+    bool ok;
+
+    tck_delay_us = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+
+    srand(1);
+    for (uint32_t i = 0; i < MEM_WORDS; i++)
+        mem[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+    for (uint32_t i = 0; i < SRAM_WORDS; i++)
+        pattern[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+
+    sim_cortex_attach(MEM_BASE, mem, MEM_WORDS);
+    sim_cortex_set_sram(SRAM_BASE, sram, SRAM_WORDS);
+    swd_init(&swd, SWD_WAIT_RETRIES, 0);
+    adiv5_init_swd(&dap, &swd, 0);
+
+    printf("Cortex-M over SWD simulation, half-clock cycle %u us\n\n", tck_delay_us);
+    bench_counter = transfers;
+    bench_counter_name = "transfers";
+    bench_header("words", "SWCLKs");
+
+    // the SWJ-DP starts as a JTAG-DP
+    bench_begin(&b, "connect", 0);
+    ok = swd_connect(&swd) == OK && swd.dpidr == SIM_CORTEX_DPIDR;
+    bench_end(&b, ok);
+
+    bench_begin(&b, "power up", 0);
+    ok = adiv5_power_up(&dap) == OK;
+    ok = ok && adiv5_ap_read(&dap, 0, AP_IDR, &value) == OK && value == SIM_CORTEX_AP_IDR;
+    bench_end(&b, ok);
+
+    bench_begin(&b, "read32", 1);
+    ok = adiv5_mem_read32(&dap, MEM_BASE + 0x100, &value) == OK && value == mem[0x40];
+    bench_end(&b, ok);
+
+    bench_begin(&b, "read block", MEM_WORDS);
+    ok = adiv5_mem_read_block(&dap, MEM_BASE, buf, MEM_WORDS) == OK;
+    bench_end(&b, ok && memcmp(buf, mem, sizeof(mem)) == 0);
+
+    bench_begin(&b, "write block", SRAM_WORDS);
+    ok = adiv5_mem_write_block(&dap, SRAM_BASE, pattern, SRAM_WORDS) == OK;
+    bench_end(&b, ok && memcmp(sram, pattern, sizeof(sram)) == 0);
+
+    bench_begin(&b, "halt + regs", 0);
+    ok = cortex_m_halt(&dap) == OK && cortex_m_reg_write(&dap, CORTEX_M_R2, 0x12345678) == OK;
+    ok = ok && cortex_m_reg_read(&dap, CORTEX_M_R2, &value) == OK && value == 0x12345678;
+    bench_end(&b, ok);
+
+    // the driver repeats the transfers answered by WAIT
+    sim_cortex_set_wait(7);
+    memset(buf, 0, sizeof(buf));
+    bench_begin(&b, "read with WAIT", MEM_WORDS);
+    ok = adiv5_mem_read_block(&dap, MEM_BASE, buf, MEM_WORDS) == OK;
+    bench_end(&b, ok && memcmp(buf, mem, sizeof(mem)) == 0 && swd.waits > 0);
+
+    // and gives up after the configured retries
+    sim_cortex_set_wait(1);
+    swd.retries = 0;
+    bench_begin(&b, "WAIT timeout", 0);
+    ok = adiv5_mem_read_block(&dap, MEM_BASE, buf, 4) == -ERR_TIMEOUT;
+    sim_cortex_set_wait(0);
+    swd.retries = SWD_WAIT_RETRIES;
+    ok = ok && adiv5_mem_read32(&dap, MEM_BASE + 4, &value) == OK && value == mem[1];
+    bench_end(&b, ok);
+
+    // outside of the memory, the next transfer is answered by FAULT and the flags are cleared
+    bench_begin(&b, "bus fault", 2);
+    ok = adiv5_mem_read32(&dap, MEM_BASE - 4, &value) == -ERR_BUS_FAULT && swd.faults > 0;
+    ok = ok && adiv5_mem_read32(&dap, MEM_BASE, &value) == OK && value == mem[0];
+    bench_end(&b, ok);
+
+    // back to the JTAG-DP
+    bench_begin(&b, "to JTAG", 0);
+    swd_disconnect();
+    ok = detect_chain(&ir_len, &idcode) == OK && ir_len == SIM_CORTEX_IR_LEN && idcode == SIM_CORTEX_IDCODE;
+    bench_end(&b, ok);
+
+    printf("\nSWD: %u transfers, %u WAITs, %u FAULTs, %u bus faults\n",
+           sim_cortex_stats()->scans, swd.waits, swd.faults, sim_cortex_stats()->faults);
+
+    return bench_exit();
+}
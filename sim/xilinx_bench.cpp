@@ -0,0 +1,206 @@
+/** @file xilinx_bench.cpp
+ *
+ * @brief Configures the simulated Xilinx 7-series FPGA on the host with a
+ * synthetic bitstream of the size of an XC7A35T, streamed by the host side
+ * of the serial link the way program.py does: checks that DONE goes high,
+ * that a corrupted bitstream is rejected by the CRC check, and reports the
+ * TCK cycles and the time they take at a given half-clock cycle.
+ * Exits with 1 on the first failure.
+ *
+ * Usage: xilinx_bench [half-clock cycle in microseconds, default 1]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "Arduino.h"
+#include "bench.h"
+#include "../include/main.h"
+#include "../include/utils.h"
+#include "../src/jtag_drv/jtag_drv.h"
+#include "../src/xilinx/xc7_ir.h"
+#include "../src/xilinx/xc7_cfg.h"
+#include "../src/sim/sim.h"
+#include "../src/sim/sim_xilinx.h"
+
+#define FRAME_WORDS 548000  // frame data of an XC7A35T bitstream
+
+static uint8_t ir_in[MAX_IR_LEN], ir_out[MAX_IR_LEN];
+
+static std::vector<uint8_t> bitstream;
+static size_t host_sent = 0;
+static bool host_ended = false;
+/**
+ * @brief Words taken by CFG_IN, the counter column of the table.
+ */
+static uint32_t cfg_words()
+{
+    return sim_xc7_stats()->words;
+}
+
+static void put_word(uint32_t word)
+{
+    // words are stored big endian, as in a .bit / .bin file
+    bitstream.push_back(word >> 24);
+    bitstream.push_back(word >> 16);
+    bitstream.push_back(word >> 8);
+    bitstream.push_back(word);
+}
+
+static void put_write(uint8_t reg, uint32_t data, uint32_t* crc)
+{
+    put_word(SIM_XC7_TYPE1_WRITE(reg, 1));
+    put_word(data);
+    *crc = sim_xc7_crc(*crc, reg, data);
+}
+
+/**
+ * @brief Build a bitstream in the layout of the Vivado ones: dummy and bus
+ * width words, sync, the frame data through FDRI, the CRC check and startup.
+ * @return Offset of the first frame data word in the bitstream.
+ */
+static size_t build_bitstream(uint32_t frame_words)
+{
+    uint32_t crc = 0;
+    uint32_t data;
+    size_t frames;
+
+    bitstream.clear();
+    for (int i = 0; i < 8; i++)
+        put_word(0xffffffff);
+    put_word(0x000000bb);
+    put_word(0x11220044);
+    put_word(0xffffffff);
+    put_word(0xffffffff);
+    put_word(SIM_XC7_SYNC);
+    put_word(SIM_XC7_NOOP);
+
+    put_write(SIM_XC7_REG_CMD, SIM_XC7_CMD_RCRC, &crc);
+    crc = 0;
+    put_word(SIM_XC7_NOOP);
+    put_word(SIM_XC7_NOOP);
+    put_write(SIM_XC7_REG_IDCODE, SIM_XC7_IDCODE, &crc);
+    put_write(SIM_XC7_REG_CMD, SIM_XC7_CMD_WCFG, &crc);
+    put_write(SIM_XC7_REG_FAR, 0, &crc);
+
+    put_word(SIM_XC7_TYPE1_WRITE(SIM_XC7_REG_FDRI, 0));
+    put_word(SIM_XC7_TYPE2_WRITE(frame_words));
+    frames = bitstream.size();
+    for (uint32_t i = 0; i < frame_words; i++)
+    {
+        data = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        put_word(data);
+        crc = sim_xc7_crc(crc, SIM_XC7_REG_FDRI, data);
+    }
+
+    put_word(SIM_XC7_TYPE1_WRITE(SIM_XC7_REG_CRC, 1));
+    put_word(crc);
+    put_write(SIM_XC7_REG_CMD, SIM_XC7_CMD_START, &crc);
+    put_word(SIM_XC7_NOOP);
+    put_write(SIM_XC7_REG_CMD, SIM_XC7_CMD_DESYNC, &crc);
+    for (int i = 0; i < 16; i++)
+        put_word(SIM_XC7_NOOP);
+
+    return frames;
+}
+
+/**
+ * @brief The host side of the link: a chunk of the bitstream for every
+ * 'R' byte, and an empty frame after the last one.
+ */
+static void host_configure(uint8_t c)
+{
+    uint8_t frame[2 + XC7_CFG_CHUNK_WORDS * 4 + 4];
+    uint32_t crc;
+    uint16_t len;
+
+    if (c != 'R' || host_ended)
+        return;
+
+    len = min(bitstream.size() - host_sent, (size_t)XC7_CFG_CHUNK_WORDS * 4);
+    frame[0] = len;
+    frame[1] = len >> 8;
+    memcpy(&frame[2], &bitstream[host_sent], len);
+    crc = crc32_update(0, &frame[2], len);
+    memcpy(&frame[2 + len], &crc, 4);
+    host_serial_feed(frame, len + 6);
+
+    host_sent += len;
+    host_ended = len == 0;
+}
+
+static status_t configure()
+{
+    host_sent = 0;
+    host_ended = false;
+    Serial.rx.clear();
+    Serial.tx.clear();
+    Serial.on_tx = host_configure;
+
+    status_t rc = xc7_configure(SIM_XC7_IR_LEN, ir_in, ir_out);
+
+    Serial.on_tx = nullptr;
+    return rc;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t idcode = 0;
+    uint32_t ir_len = 0;
+    uint32_t status = 0;
+    uint32_t words;
+    uint32_t tcks;
+    size_t frames;
+    bench_t b;
+    bool ok;
+
+    tck_delay_us = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+
+    srand(1);
+    frames = build_bitstream(FRAME_WORDS);
+    words = bitstream.size() / 4;
+
+    sim_xc7_attach();
+
+    printf("Xilinx 7-series simulation, half-clock cycle %u us, bitstream of %u words\n\n", tck_delay_us, words);
+    bench_counter = cfg_words;
+    bench_counter_name = "CFG words";
+    bench_header("words", "TCKs");
+
+    bench_begin(&b, "detect", 1);
+    ok = detect_chain(&ir_len, &idcode) == OK && ir_len == SIM_XC7_IR_LEN && idcode == SIM_XC7_IDCODE;
+    bench_end(&b, ok);
+
+    reset_tap();
+    bench_begin(&b, "status", 0);
+    ok = xc7_status(SIM_XC7_IR_LEN, ir_in, ir_out, &status) == OK;
+    bench_end(&b, ok && (status & 3) == 1 && (status & XC7_IR_INIT_COMPLETE) && !(status & XC7_IR_DONE));
+
+    bench_begin(&b, "configure", words);
+    ok = configure() == OK;
+    ok = ok && xc7_status(SIM_XC7_IR_LEN, ir_in, ir_out, &status) == OK && (status & XC7_IR_DONE);
+    ok = ok && sim_xc7_stats()->fdri_words == FRAME_WORDS && sim_xc7_stats()->crc_checks == 1;
+    tcks = bench_end(&b, ok && sim_xc7_stats()->crc_errors == 0 && sim_xc7_stats()->startups == 1);
+
+    // a flipped bit of the frame data: the CRC check fails, and DONE stays low
+    bitstream[frames + 4 * (FRAME_WORDS / 2)] ^= 0x10;
+    bench_begin(&b, "bad crc", words);
+    ok = configure() == -ERR_TIMEOUT;
+    ok = ok && xc7_status(SIM_XC7_IR_LEN, ir_in, ir_out, &status) == OK && !(status & XC7_IR_DONE);
+    bench_end(&b, ok && sim_xc7_stats()->crc_errors == 1 && sim_xc7_stats()->startups == 1);
+    bitstream[frames + 4 * (FRAME_WORDS / 2)] ^= 0x10;
+
+    // JPROGRAM clears the failed configuration
+    bench_begin(&b, "reconfigure", words);
+    ok = configure() == OK;
+    ok = ok && xc7_status(SIM_XC7_IR_LEN, ir_in, ir_out, &status) == OK && (status & XC7_IR_DONE);
+    bench_end(&b, ok && sim_xc7_stats()->crc_errors == 1 && sim_xc7_stats()->startups == 2);
+
+    printf("\nConfigure: %.3f TCK/bit\n", tcks / (words * 32.0));
+    printf("CFG_IN: %u words, %u frame words, %u CRC checks, %u CRC errors, %u startups\n",
+           sim_xc7_stats()->words, sim_xc7_stats()->fdri_words, sim_xc7_stats()->crc_checks,
+           sim_xc7_stats()->crc_errors, sim_xc7_stats()->startups);
+
+    return bench_exit();
+}
@@ -0,0 +1,397 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "adiv5.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+// sticky flags of a JTAG-DP, cleared by writing them as 1
+#define DP_STICKY_FLAGS (DP_STICKYERR | DP_STICKYCMP | DP_STICKYORUN)
+
+void adiv5_init(adiv5_dap_t* dap, const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, uint8_t ap)
+{
+    memset(dap, 0, sizeof(adiv5_dap_t));
+    dap->ir_len = ir_len;
+    dap->ir_in = ir_in;
+    dap->ir_out = ir_out;
+    dap->dr_in = dr_in;
+    dap->dr_out = dr_out;
+    dap->ap = ap;
+}
+
+void adiv5_init_swd(adiv5_dap_t* dap, swd_t* swd, uint8_t ap)
+{
+    memset(dap, 0, sizeof(adiv5_dap_t));
+    dap->swd = swd;
+    dap->ap = ap;
+}
+
+void adiv5_invalidate(adiv5_dap_t* dap)
+{
+    dap->select_valid = false;
+    dap->csw_valid = false;
+    dap->tar_valid = false;
+}
+
+/**
+ * @brief A single DPACC or APACC scan, repeated while the DP answers WAIT.
+ * @param instr JTAG_DP_DPACC or JTAG_DP_APACC, dropped by the IR shadow cache if loaded.
+ * @param reg Register address, only A[3:2] are shifted.
+ * @param out If not nullptr, gets the result of the previous access.
+ */
+static status_t adiv5_scan(adiv5_dap_t* dap, uint8_t instr, uint8_t reg, bool read, uint32_t in, uint32_t* out)
+{
+    uint32_t ack = 0;
+
+    int_to_bin_array(dap->ir_in, instr, dap->ir_len);
+    insert_ir(dap->ir_in, dap->ir_out, dap->ir_len, RUN_TEST_IDLE);
+
+    dap->dr_in[0] = read ? 1 : 0;
+    dap->dr_in[1] = (reg >> 2) & 1;
+    dap->dr_in[2] = (reg >> 3) & 1;
+    int_to_bin_array(&dap->dr_in[3], in, 32);
+
+    for (uint32_t retry = 0; retry <= ADIV5_WAIT_RETRIES; retry++)
+    {
+        insert_dr(dap->dr_in, dap->dr_out, ADIV5_SCAN_LEN, RUN_TEST_IDLE);
+        bin_array_to_uint32(dap->dr_out, 3, &ack);
+
+        if (ack == ADIV5_ACK_OK)
+        {
+            if (out != nullptr)
+                bin_array_to_uint32(&dap->dr_out[3], 32, out);
+            return OK;
+        }
+
+        // no DAP in front of the driver
+        if (ack != ADIV5_ACK_WAIT)
+            return -ERR_TAP_DEVICE_UNAVAILABLE;
+
+        // the access was dropped, repeat it
+        dap->waits++;
+    }
+
+    return -ERR_TIMEOUT;
+}
+
+/**
+ * @brief A DP register access, that returns its own result: over the JTAG-DP
+ * a read takes a RDBUFF scan, unless it is the RDBUFF read itself.
+ */
+static status_t adiv5_dp_access(adiv5_dap_t* dap, uint8_t reg, bool read, uint32_t in, uint32_t* out)
+{
+    status_t rc;
+
+    if (dap->swd != nullptr)
+        return swd_transfer(dap->swd, false, read, reg, in, out);
+
+    if (!read || reg == DP_RDBUFF)
+        return adiv5_scan(dap, JTAG_DP_DPACC, reg, read, in, out);
+
+    rc = adiv5_scan(dap, JTAG_DP_DPACC, reg, true, 0, nullptr);
+    if (rc == OK)
+        rc = adiv5_scan(dap, JTAG_DP_DPACC, DP_RDBUFF, true, 0, out);
+
+    return rc;
+}
+
+/**
+ * @brief An AP register access of the selected AP and bank.
+ * @param prev If not nullptr, gets the result of the previous (AP read) access.
+ */
+static status_t adiv5_ap_access(adiv5_dap_t* dap, uint8_t reg, bool read, uint32_t in, uint32_t* prev)
+{
+    if (dap->swd != nullptr)
+        return swd_transfer(dap->swd, true, read, reg, in, prev);
+
+    return adiv5_scan(dap, JTAG_DP_APACC, reg, read, in, prev);
+}
+
+/**
+ * @brief Select the AP and the register bank of an AP access, skipped if selected.
+ */
+static status_t adiv5_select(adiv5_dap_t* dap, uint8_t ap, uint8_t reg)
+{
+    uint32_t select = ((uint32_t)ap << 24) | (reg & 0xf0);
+    status_t rc;
+
+    if (dap->select_valid && dap->select == select)
+        return OK;
+
+    rc = adiv5_dp_access(dap, DP_SELECT, false, select, nullptr);
+    dap->select = select;
+    dap->select_valid = (rc == OK);
+
+    return rc;
+}
+
+status_t adiv5_dp_read(adiv5_dap_t* dap, uint8_t reg, uint32_t* value)
+{
+    return adiv5_dp_access(dap, reg, true, 0, value);
+}
+
+status_t adiv5_dp_write(adiv5_dap_t* dap, uint8_t reg, uint32_t value)
+{
+    if (reg == DP_SELECT)
+        dap->select_valid = false;
+
+    return adiv5_dp_access(dap, reg, false, value, nullptr);
+}
+
+status_t adiv5_ap_read(adiv5_dap_t* dap, uint8_t ap, uint8_t reg, uint32_t* value)
+{
+    status_t rc = adiv5_select(dap, ap, reg);
+
+    if (rc == OK)
+        rc = adiv5_ap_access(dap, reg, true, 0, nullptr);
+    if (rc == OK)
+        rc = adiv5_dp_access(dap, DP_RDBUFF, true, 0, value);
+
+    return rc;
+}
+
+status_t adiv5_ap_post_read(adiv5_dap_t* dap, uint8_t ap, uint8_t reg, uint32_t* prev)
+{
+    status_t rc = adiv5_select(dap, ap, reg);
+
+    if (rc == OK)
+        rc = adiv5_ap_access(dap, reg, true, 0, prev);
+
+    return rc;
+}
+
+status_t adiv5_ap_write(adiv5_dap_t* dap, uint8_t ap, uint8_t reg, uint32_t value)
+{
+    status_t rc = adiv5_select(dap, ap, reg);
+
+    if (rc == OK)
+        rc = adiv5_ap_access(dap, reg, false, value, nullptr);
+
+    if (ap == dap->ap && reg == AP_CSW)
+    {
+        dap->csw = value;
+        dap->csw_valid = (rc == OK);
+    }
+
+    return rc;
+}
+
+/**
+ * @brief Clear the sticky flags: written back as 1 to CTRL/STAT of a JTAG-DP,
+ * keeping the power up requests, or through ABORT over SWD.
+ */
+static status_t adiv5_clear_sticky(adiv5_dap_t* dap, uint32_t stat)
+{
+    if (dap->swd != nullptr)
+        return swd_transfer(dap->swd, false, false, SWD_DP_ABORT, SWD_ABORT_CLEAR_ALL, nullptr);
+
+    return adiv5_dp_write(dap, DP_CTRL_STAT, (stat & (DP_CSYSPWRUPREQ | DP_CDBGPWRUPREQ)) | DP_STICKY_FLAGS);
+}
+
+status_t adiv5_power_up(adiv5_dap_t* dap)
+{
+    unsigned long start = millis();
+    uint32_t stat = 0;
+    status_t rc;
+
+    adiv5_invalidate(dap);
+
+    rc = adiv5_clear_sticky(dap, DP_CSYSPWRUPREQ | DP_CDBGPWRUPREQ);
+    if (rc == OK && dap->swd != nullptr)
+        rc = adiv5_dp_write(dap, DP_CTRL_STAT, DP_CSYSPWRUPREQ | DP_CDBGPWRUPREQ);
+    if (rc != OK)
+        return rc;
+
+    do
+    {
+        rc = adiv5_dp_read(dap, DP_CTRL_STAT, &stat);
+        if (rc != OK)
+            return rc;
+
+        if ((stat & (DP_CSYSPWRUPACK | DP_CDBGPWRUPACK)) == (DP_CSYSPWRUPACK | DP_CDBGPWRUPACK))
+            return OK;
+    } while (millis() - start < ADIV5_POWER_UP_TIMEOUT_MS);
+
+    Serial.print("\nDAP power up not acknowledged, CTRL/STAT: 0x"); Serial.println(stat, HEX);
+
+    return -ERR_TIMEOUT;
+}
+
+status_t adiv5_check_errors(adiv5_dap_t* dap)
+{
+    uint32_t stat = 0;
+    status_t rc = adiv5_dp_read(dap, DP_CTRL_STAT, &stat);
+
+    if (rc != OK)
+        return rc;
+
+    if (!(stat & DP_STICKY_FLAGS))
+        return OK;
+
+    adiv5_clear_sticky(dap, stat);
+
+    return -ERR_BUS_FAULT;
+}
+
+/**
+ * @brief Make the MEM-AP do 32 bit accesses that increment TAR. The CSW is
+ * read once and cached, so the setup usually costs no scan at all.
+ */
+static status_t adiv5_mem_setup(adiv5_dap_t* dap)
+{
+    uint32_t csw = dap->csw;
+    status_t rc;
+
+    if (!dap->csw_valid)
+    {
+        rc = adiv5_ap_read(dap, dap->ap, AP_CSW, &csw);
+        if (rc != OK)
+            return rc;
+    }
+    else if ((csw & (AP_CSW_SIZE_MASK | AP_CSW_ADDRINC_MASK)) == (AP_CSW_SIZE_32 | AP_CSW_ADDRINC_SINGLE))
+    {
+        return OK;
+    }
+
+    csw = (csw & ~(uint32_t)(AP_CSW_SIZE_MASK | AP_CSW_ADDRINC_MASK)) | AP_CSW_SIZE_32 | AP_CSW_ADDRINC_SINGLE;
+
+    return adiv5_ap_write(dap, dap->ap, AP_CSW, csw);
+}
+
+status_t adiv5_mem_read32(adiv5_dap_t* dap, uint32_t addr, uint32_t* value)
+{
+    return adiv5_mem_read_block(dap, addr, value, 1);
+}
+
+status_t adiv5_mem_write32(adiv5_dap_t* dap, uint32_t addr, uint32_t value)
+{
+    status_t rc;
+
+    if (addr & 3)
+        return -ERR_BAD_PARAMETER;
+
+    rc = adiv5_mem_setup(dap);
+    if (rc == OK)
+        rc = adiv5_ap_write(dap, dap->ap, AP_TAR, addr);
+    if (rc == OK)
+        rc = adiv5_ap_write(dap, dap->ap, AP_DRW, value);
+    if (rc == OK)
+        rc = adiv5_check_errors(dap);
+
+    return rc;
+}
+
+status_t adiv5_mem_read_block(adiv5_dap_t* dap, uint32_t addr, uint32_t* buf, uint32_t words)
+{
+    uint32_t count;
+    status_t rc;
+
+    if (addr & 3)
+        return -ERR_BAD_PARAMETER;
+
+    rc = adiv5_mem_setup(dap);
+
+    while (words > 0 && rc == OK)
+    {
+        // up to the end of the 1KB block of TAR
+        count = min(words, (ADIV5_TAR_BLOCK - (addr & (ADIV5_TAR_BLOCK - 1))) / 4);
+
+        rc = adiv5_ap_write(dap, dap->ap, AP_TAR, addr);
+        if (rc != OK)
+            break;
+
+        // the first read only starts the access of the first word,
+        // every following one returns the word of the previous read
+        rc = adiv5_ap_access(dap, AP_DRW, true, 0, nullptr);
+        for (uint32_t i = 1; i < count && rc == OK; i++)
+            rc = adiv5_ap_access(dap, AP_DRW, true, 0, &buf[i - 1]);
+
+        // and RDBUFF drains the last one
+        if (rc == OK)
+            rc = adiv5_dp_access(dap, DP_RDBUFF, true, 0, &buf[count - 1]);
+
+        addr += count * 4;
+        buf += count;
+        words -= count;
+    }
+
+    if (rc == OK)
+        rc = adiv5_check_errors(dap);
+
+    return rc;
+}
+
+status_t adiv5_mem_write_begin(adiv5_dap_t* dap, uint32_t addr)
+{
+    status_t rc;
+
+    if (addr & 3)
+        return -ERR_BAD_PARAMETER;
+
+    // TAR is written along with the first word
+    rc = adiv5_mem_setup(dap);
+    dap->tar = addr;
+    dap->tar_valid = false;
+
+    return rc;
+}
+
+status_t adiv5_mem_write_next(adiv5_dap_t* dap, uint32_t value)
+{
+    status_t rc = OK;
+
+    // first word, or TAR wrapped around within its 1KB block
+    if (!dap->tar_valid || (dap->tar & (ADIV5_TAR_BLOCK - 1)) == 0)
+    {
+        rc = adiv5_ap_write(dap, dap->ap, AP_TAR, dap->tar);
+        dap->tar_valid = (rc == OK);
+    }
+
+    if (rc == OK)
+        rc = adiv5_ap_access(dap, AP_DRW, false, value, nullptr);
+    dap->tar += 4;
+
+    return rc;
+}
+
+status_t adiv5_mem_write_end(adiv5_dap_t* dap) { return adiv5_check_errors(dap); }
+
+status_t adiv5_mem_write_block(adiv5_dap_t* dap, uint32_t addr, const uint32_t* buf, uint32_t words)
+{
+    status_t rc = adiv5_mem_write_begin(dap, addr);
+
+    for (uint32_t i = 0; i < words && rc == OK; i++)
+        rc = adiv5_mem_write_next(dap, buf[i]);
+
+    if (rc == OK)
+        rc = adiv5_mem_write_end(dap);
+
+    return rc;
+}
+
+status_t adiv5_mem_dump(adiv5_dap_t* dap, uint32_t addr, uint32_t words)
+{
+    uint32_t buf[ADIV5_DUMP_FRAME_WORDS];
+    uint32_t left = words;
+    uint32_t count;
+    status_t rc = OK;
+
+    send_dump_header_to_host(addr, words, ADIV5_DUMP_FRAME_WORDS);
+
+    while (left > 0)
+    {
+        count = min(left, (uint32_t)ADIV5_DUMP_FRAME_WORDS);
+        rc = adiv5_mem_read_block(dap, addr, buf, count);
+        if (rc != OK)
+            break;
+
+        send_words_frame_to_host(buf, count);
+        addr += count * 4;
+        left -= count;
+    }
+
+    send_dump_end_to_host(addr, rc);
+
+    return rc;
+}
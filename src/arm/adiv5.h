@@ -0,0 +1,242 @@
+/** @file adiv5.h
+ *
+ * @brief ARM Debug Interface v5 over a JTAG-DP, or over SWD (swd.h): DP and
+ * AP register access, and MEM-AP access to the memory of the target (e.g. the
+ * Cortex-M4 TAP of the STM32F4 chain, see chain.h).
+ *
+ *  - DPACC / APACC scan: 35 bits, shifted LSB first.
+ *      in:  RnW [0], A[3:2] [2:1], data [34:3]
+ *      out: ACK [2:0], data [34:3]
+ *    The data shifted out is the result of the previous access, the result
+ *    of the last one is read with a DPACC read of RDBUFF.
+ *  - ACK OK/FAULT (0b010) accepts the access, WAIT (0b001) drops it and the
+ *    scan is repeated. Faults of the memory bus set STICKYERR in CTRL/STAT.
+ *
+ * The DP SELECT register and the MEM-AP CSW are cached, so only the TAR and
+ * the DRW accesses remain in a memory access. Bulk reads use the TAR auto
+ * increment and the one access pipeline of the DP: each APACC read of DRW
+ * returns the previous word, so a word costs a single DR scan, and the IR
+ * shadow cache of the driver keeps APACC loaded in between. Bulk writes are
+ * posted the same way, a scan per word, and checked once at their end.
+ *
+ * Over SWD, an access is an SWD transfer instead of a scan. AP reads are
+ * posted the same way, DP reads return their own result, and the sticky
+ * flags are cleared through the ABORT register.
+ */
+#ifndef __ADIV5__H__
+#define __ADIV5__H__
+
+#include <stdint.h>
+
+#include "../swd/swd.h"
+#include "../../include/status.h"
+
+/**
+ * JTAG-DP instructions (4 bit IR).
+ */
+#define JTAG_DP_ABORT  0x8
+#define JTAG_DP_DPACC  0xa
+#define JTAG_DP_APACC  0xb
+#define JTAG_DP_IDCODE 0xe
+#define JTAG_DP_BYPASS 0xf
+
+/**
+ * Length of the DPACC, APACC and ABORT scans.
+ */
+#define ADIV5_SCAN_LEN 35
+
+#define ADIV5_ACK_WAIT 0x1
+#define ADIV5_ACK_OK   0x2
+
+/**
+ * DP registers.
+ */
+#define DP_CTRL_STAT 0x4
+#define DP_SELECT    0x8
+#define DP_RDBUFF    0xc
+
+/**
+ * CTRL/STAT bits. The sticky flags are cleared by writing them back as 1.
+ */
+#define DP_CSYSPWRUPACK (1UL << 31)
+#define DP_CSYSPWRUPREQ (1UL << 30)
+#define DP_CDBGPWRUPACK (1UL << 29)
+#define DP_CDBGPWRUPREQ (1UL << 28)
+#define DP_WDATAERR     (1UL << 7)
+#define DP_STICKYERR    (1UL << 5)
+#define DP_STICKYCMP    (1UL << 4)
+#define DP_STICKYORUN   (1UL << 1)
+
+/**
+ * MEM-AP registers, bank 0 (CSW, TAR, DRW) and bank 0xf (IDR).
+ */
+#define AP_CSW 0x00
+#define AP_TAR 0x04
+#define AP_DRW 0x0c
+#define AP_IDR 0xfc
+
+/**
+ * CSW fields: 32 bit accesses, TAR incremented after every DRW access.
+ */
+#define AP_CSW_SIZE_MASK   0x07
+#define AP_CSW_SIZE_32     0x02
+#define AP_CSW_ADDRINC_MASK 0x30
+#define AP_CSW_ADDRINC_SINGLE 0x10
+
+/**
+ * The TAR auto increment is only guaranteed within 1KB blocks,
+ * TAR is written again at every block boundary.
+ */
+#define ADIV5_TAR_BLOCK 0x400
+
+/**
+ * A scan answered by WAIT is repeated up to ADIV5_WAIT_RETRIES times.
+ */
+#define ADIV5_WAIT_RETRIES 100
+
+/**
+ * Time to wait for the acknowledge of the debug and system power up.
+ */
+#define ADIV5_POWER_UP_TIMEOUT_MS 100
+
+/**
+ * Number of 32 bit words in every binary frame of a memory dump.
+ */
+#define ADIV5_DUMP_FRAME_WORDS 64
+
+typedef struct
+{
+    swd_t* swd;             // SWD port of the DAP, nullptr for a JTAG-DP
+
+    // driver context of the DAP TAP
+    uint8_t ir_len;
+    uint8_t* ir_in;
+    uint8_t* ir_out;
+    uint8_t* dr_in;
+    uint8_t* dr_out;
+
+    uint8_t ap;             // MEM-AP used for the memory accesses
+
+    bool select_valid;      // select holds the value of the DP SELECT register
+    uint32_t select;
+    bool csw_valid;         // csw holds the value of the MEM-AP CSW register
+    uint32_t csw;
+    bool tar_valid;         // TAR holds the address of the next bulk write
+    uint32_t tar;           // address of the next DRW write of adiv5_mem_write_next()
+
+    uint32_t waits;         // WAIT acknowledges since adiv5_init()
+} adiv5_dap_t;
+
+/**
+ * @brief Attach the DAP to its TAP and the driver's registers, and use the
+ * MEM-AP with the given index for the memory accesses.
+ */
+void adiv5_init(adiv5_dap_t* dap, const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, uint8_t ap);
+
+/**
+ * @brief Attach the DAP to a connected SWD port (see swd_connect()), and use
+ * the MEM-AP with the given index for the memory accesses.
+ */
+void adiv5_init_swd(adiv5_dap_t* dap, swd_t* swd, uint8_t ap);
+
+/**
+ * @brief Forget the cached SELECT, CSW and TAR values, after the target was reset.
+ */
+void adiv5_invalidate(adiv5_dap_t* dap);
+
+/**
+ * @brief Power up the debug and the system domains, and clear the sticky errors.
+ * @return OK, or -ERR_TIMEOUT if the power up is not acknowledged.
+ */
+status_t adiv5_power_up(adiv5_dap_t* dap);
+
+/**
+ * @brief Read a DP register.
+ */
+status_t adiv5_dp_read(adiv5_dap_t* dap, uint8_t reg, uint32_t* value);
+
+/**
+ * @brief Write a DP register.
+ */
+status_t adiv5_dp_write(adiv5_dap_t* dap, uint8_t reg, uint32_t value);
+
+/**
+ * @brief Read a register of an AP, its bank is selected as needed.
+ */
+status_t adiv5_ap_read(adiv5_dap_t* dap, uint8_t ap, uint8_t reg, uint32_t* value);
+
+/**
+ * @brief Write a register of an AP, its bank is selected as needed.
+ */
+status_t adiv5_ap_write(adiv5_dap_t* dap, uint8_t ap, uint8_t reg, uint32_t value);
+
+/**
+ * @brief Start a read of an AP register without draining it, a single scan
+ * for polling: the result arrives with the next access, or with RDBUFF.
+ * @param prev Gets the result of the previous access.
+ */
+status_t adiv5_ap_post_read(adiv5_dap_t* dap, uint8_t ap, uint8_t reg, uint32_t* prev);
+
+/**
+ * @brief Check and clear the sticky errors of CTRL/STAT.
+ * @return OK, or -ERR_BUS_FAULT if an access failed since the last check.
+ */
+status_t adiv5_check_errors(adiv5_dap_t* dap);
+
+/**
+ * @brief Read a 32 bit word of the target memory.
+ * @param addr Word aligned address.
+ */
+status_t adiv5_mem_read32(adiv5_dap_t* dap, uint32_t addr, uint32_t* value);
+
+/**
+ * @brief Write a 32 bit word of the target memory.
+ * @param addr Word aligned address.
+ */
+status_t adiv5_mem_write32(adiv5_dap_t* dap, uint32_t addr, uint32_t value);
+
+/**
+ * @brief Read consecutive 32 bit words of the target memory, a DR scan
+ * per word plus one per 1KB block.
+ * @param addr Word aligned address.
+ * @return OK, -ERR_BUS_FAULT if an access failed (buf is then undefined),
+ * or -ERR_TIMEOUT if the target kept answering WAIT.
+ */
+status_t adiv5_mem_read_block(adiv5_dap_t* dap, uint32_t addr, uint32_t* buf, uint32_t words);
+
+/**
+ * @brief Start a bulk write of consecutive 32 bit words of the target memory.
+ * Every following adiv5_mem_write_next() writes the next word with a single
+ * DR scan, TAR is written again at every 1KB block boundary.
+ * @param addr Word aligned address.
+ */
+status_t adiv5_mem_write_begin(adiv5_dap_t* dap, uint32_t addr);
+
+/**
+ * @brief Write the next word of a bulk write started by adiv5_mem_write_begin().
+ * The write is posted, its errors are reported by adiv5_mem_write_end().
+ */
+status_t adiv5_mem_write_next(adiv5_dap_t* dap, uint32_t value);
+
+/**
+ * @brief End a bulk write.
+ * @return OK, or -ERR_BUS_FAULT if any of its writes failed.
+ */
+status_t adiv5_mem_write_end(adiv5_dap_t* dap);
+
+/**
+ * @brief Write consecutive 32 bit words of the target memory,
+ * a DR scan per word plus one per 1KB block.
+ * @param addr Word aligned address.
+ */
+status_t adiv5_mem_write_block(adiv5_dap_t* dap, uint32_t addr, const uint32_t* buf, uint32_t words);
+
+/**
+ * @brief Stream a memory range to the host tool, in the format of the MAX10
+ * flash dump: the text line "@dump 0x<start> <words> <words per frame>",
+ * followed by frames (see send_frame_to_host) and an empty frame.
+ * A failed access ends the dump early.
+ */
+status_t adiv5_mem_dump(adiv5_dap_t* dap, uint32_t addr, uint32_t words);
+
+#endif
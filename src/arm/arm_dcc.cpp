@@ -0,0 +1,136 @@
+#include <Arduino.h>
+
+#include "arm_dcc.h"
+#include "cortex_m.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+/**
+ * @brief Point TAR at DCRDR, and keep it there: 32 bit accesses, no increment.
+ * The cached CSW makes the next memory access restore the increment.
+ */
+static status_t arm_dcc_setup(adiv5_dap_t* dap)
+{
+    uint32_t csw = dap->csw;
+    status_t rc = OK;
+
+    if (!dap->csw_valid)
+        rc = adiv5_ap_read(dap, dap->ap, AP_CSW, &csw);
+    if (rc != OK)
+        return rc;
+
+    csw = (csw & ~(uint32_t)(AP_CSW_SIZE_MASK | AP_CSW_ADDRINC_MASK)) | AP_CSW_SIZE_32;
+    rc = adiv5_ap_write(dap, dap->ap, AP_CSW, csw);
+    if (rc == OK)
+        rc = adiv5_ap_write(dap, dap->ap, AP_TAR, CORTEX_M_DCRDR);
+    dap->tar_valid = false;
+
+    return rc;
+}
+
+/**
+ * @brief Send the words collected so far as a frame.
+ */
+static void arm_dcc_flush(uint8_t* frame, uint32_t* bytes)
+{
+    // whole words only, a partial one stays for the next frame
+    uint32_t len = *bytes & ~3UL;
+
+    if (len == 0)
+        return;
+
+    send_frame_to_host(frame, len);
+    for (uint32_t i = len; i < *bytes; i++)
+        frame[i - len] = frame[i];
+    *bytes -= len;
+}
+
+status_t arm_dcc_stream(adiv5_dap_t* dap, uint32_t words, uint32_t* got)
+{
+    uint8_t frame[ARM_DCC_FRAME_WORDS * 4];
+    uint32_t bytes = 0;
+    uint32_t sent = 0;
+    uint32_t value = 0;
+    uint32_t idle_us = 0;
+    unsigned long since = 0;
+    bool primed = false;
+    bool check_host = true;
+    status_t rc = arm_dcc_setup(dap);
+
+    if (rc != OK)
+        return rc;
+
+    Serial.print("\n@dcc "); Serial.println(ARM_DCC_FRAME_WORDS, DEC);
+    Serial.flush();
+
+    while (words == 0 || sent + bytes / 4 < words)
+    {
+        // the host is heard while the channel idles, and after every frame
+        if (check_host && Serial.available() > 0 && Serial.read() == ARM_DCC_EXIT_CHAR)
+            break;
+        check_host = false;
+
+        // every poll returns DCRDR as read by the previous one, so the
+        // channel is polled with APACC scans only and no IR load in between
+        rc = adiv5_ap_post_read(dap, dap->ap, AP_DRW, &value);
+        if (rc != OK)
+            break;
+
+        // the first poll after a clear returns the result of the clear
+        if (!primed)
+        {
+            primed = true;
+            continue;
+        }
+
+        if (value & ARM_DCC_BUSY)
+        {
+            // the target waits for the clear before writing the next byte,
+            // so the busy byte read again by the last poll is dropped
+            rc = adiv5_ap_write(dap, dap->ap, AP_DRW, 0);
+            if (rc != OK)
+                break;
+            primed = false;
+
+            if (bytes < 4)
+                since = millis();
+            frame[bytes++] = value >> ARM_DCC_DATA_SHIFT;
+            idle_us = 0;
+
+            if (bytes == sizeof(frame))
+            {
+                arm_dcc_flush(frame, &bytes);
+                sent += ARM_DCC_FRAME_WORDS;
+                check_host = true;
+            }
+            continue;
+        }
+
+        // a slow writer still gets its words to the host in time
+        if (bytes >= 4 && millis() - since >= ARM_DCC_FLUSH_MS)
+        {
+            sent += bytes / 4;
+            arm_dcc_flush(frame, &bytes);
+        }
+
+        // nothing to read, poll less often while the channel stays idle
+        idle_us = idle_us ? min(2 * idle_us, (uint32_t)ARM_DCC_IDLE_MAX_US) : tck_delay_us + 1;
+        delayMicroseconds(idle_us);
+        check_host = true;
+    }
+
+    sent += bytes / 4;
+    arm_dcc_flush(frame, &bytes);
+
+    // end of the stream
+    send_frame_to_host(frame, 0);
+    Serial.flush();
+
+    if (got != nullptr)
+        *got = sent;
+
+    if (rc == OK)
+        rc = adiv5_check_errors(dap);
+
+    return rc;
+}
@@ -0,0 +1,64 @@
+/** @file arm_dcc.h
+ *
+ * @brief Debug Communications Channel of a running Cortex-M: a target to
+ * host log channel through DCRDR, the way the target side of OpenOCD's
+ * libdcc (dcc_stdio.c) writes it.
+ *
+ * The target sends a byte by writing (byte << 8) | ARM_DCC_BUSY to the low
+ * halfword of DCRDR, after waiting for ARM_DCC_BUSY to clear. The driver
+ * takes the byte and clears DCRDR, which lets the target write the next one.
+ * Words are sent LSB first, 4 bytes each.
+ *
+ * The channel is drained by the driver alone: TAR stays on DCRDR with the
+ * address increment off, and every APACC read of DRW returns the poll before
+ * it, so an idle poll is one scan and a byte three (two polls and the clear),
+ * without IR loads in between. Words are collected in
+ * binary frames (see send_frame_to_host()), and the host only sees:
+ *
+ *   "@dcc <frame words>\n", frames of up to ARM_DCC_FRAME_WORDS words, an empty frame.
+ */
+#ifndef __ARM_DCC__H__
+#define __ARM_DCC__H__
+
+#include <stdint.h>
+
+#include "adiv5.h"
+#include "../../include/status.h"
+
+/**
+ * DCRDR: data byte [15:8], written by the target with the busy flag [0].
+ */
+#define ARM_DCC_BUSY       0x1
+#define ARM_DCC_DATA_SHIFT 8
+
+/**
+ * Number of 32 bit words in every binary frame to the host.
+ */
+#define ARM_DCC_FRAME_WORDS 64
+
+/**
+ * A partial frame is sent once its first word waited that long, in milliseconds.
+ */
+#define ARM_DCC_FLUSH_MS 20
+
+/**
+ * Longest pause between polls of an idle channel, in microseconds.
+ * The pause doubles on every empty poll and resets when a byte shows up.
+ */
+#define ARM_DCC_IDLE_MAX_US 16000
+
+/**
+ * Host character that ends the streaming (Ctrl-]).
+ */
+#define ARM_DCC_EXIT_CHAR 0x1d
+
+/**
+ * @brief Forward the words the running core writes to the DCC to the host,
+ * in binary frames, until ARM_DCC_EXIT_CHAR is received or words were forwarded.
+ * @param words Number of 32 bit words to forward, 0 for no limit.
+ * @param got If not nullptr, gets the number of words forwarded.
+ * @return OK, or the error of a DAP access.
+ */
+status_t arm_dcc_stream(adiv5_dap_t* dap, uint32_t words, uint32_t* got);
+
+#endif
@@ -0,0 +1,201 @@
+/* --------------------------------------------------------------------------------------- */
+/* ------------------- Commands of ARM cores behind a JTAG-DP -----------------------------*/
+/* --------------------------------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+
+#include "arm_funcs.h"
+#include "adiv5.h"
+#include "cortex_m.h"
+#include "arm_loader.h"
+#include "arm_dcc.h"
+#include "arm_gdb.h"
+#include "../swd/swd.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+// the DAP of the selected TAP, kept between the menu commands
+static adiv5_dap_t dap;
+
+// the SWD port of arm_swd_main()
+static swd_t swd;
+
+// the flash loader last loaded to SRAM
+static arm_loader_t loader;
+
+/**
+ * @brief Print the ARM DAP menu.
+ */
+static void arm_print_menu()
+{
+    Serial.flush();
+    Serial.print("\n\nARM DAP Menu:\n");
+    Serial.print(dap.swd ? "p - Connect over SWD and power up the debug port\n" : "p - Power up the debug port\n");
+    Serial.print("r - Read memory word\n");
+    Serial.print("w - Write memory word\n");
+    Serial.print("d - Dump memory range to host (binary)\n");
+    Serial.print("h - Halt core\n");
+    Serial.print("c - Resume core\n");
+    Serial.print("l - Load image from host to memory (e.g. a flash loader to SRAM)\n");
+    Serial.print("f - Program flash range from host image through the flash loader\n");
+    Serial.print("g - Stream the DCC log of the running core to host (binary)\n");
+    Serial.print("b - Serve the GDB bridge of the host\n");
+    Serial.print("z - Exit\n");
+    Serial.flush();
+}
+
+/**
+ * @brief Run a command of the ARM DAP menu on the DAP, over JTAG or SWD.
+ */
+static void arm_command(char command)
+{
+    uint32_t addr = 0;
+    uint32_t num = 0;
+    uint32_t value = 0;
+    status_t rc = OK;
+
+    switch (command)
+    {
+    case 'p':
+        if (dap.swd != nullptr)
+        {
+            rc = swd_connect(&swd);
+            if (rc != OK)
+                break;
+            Serial.print("\nSWD-DP connected, DPIDR: 0x"); Serial.println(swd.dpidr, HEX);
+        }
+        else
+        {
+            reset_tap();
+        }
+        adiv5_invalidate(&dap);
+        if (adiv5_power_up(&dap) != OK)
+            break;
+        rc = adiv5_ap_read(&dap, dap.ap, AP_IDR, &value);
+        if (rc != OK)
+            break;
+        Serial.print("\nDebug port powered up, AP 0 IDR: 0x"); Serial.println(value, HEX);
+        break;
+
+    case 'r':
+        if (parse_number(NULL, 32, "\nInsert addr > ", &addr) != OK)
+            break;
+        rc = adiv5_mem_read32(&dap, addr, &value);
+        if (rc != OK)
+            break;
+        Serial.print("\n0x"); Serial.print(addr, HEX);
+        Serial.print(": 0x"); Serial.println(value, HEX);
+        break;
+
+    case 'w':
+        if (parse_number(NULL, 32, "\nInsert addr > ", &addr) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert value > ", &value) != OK)
+            break;
+        rc = adiv5_mem_write32(&dap, addr, value);
+        break;
+
+    case 'd':
+        // stream a memory range to the host tool, which writes it to an image file
+        if (parse_number(NULL, 32, "\nInsert start addr > ", &addr) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert amount of words to dump > ", &num) != OK)
+            break;
+        rc = adiv5_mem_dump(&dap, addr, num);
+        break;
+
+    case 'h':
+        rc = cortex_m_halt(&dap);
+        if (rc == OK)
+            Serial.println("\nCore halted");
+        break;
+
+    case 'c':
+        rc = cortex_m_resume(&dap);
+        break;
+
+    case 'l':
+        // e.g. the flash loader of the part, the host tool streams the image
+        if (parse_number(NULL, 32, "\nInsert start addr > ", &addr) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert amount of words to load > ", &num) != OK)
+            break;
+        rc = arm_load_image(&dap, addr, num);
+        break;
+
+    case 'f':
+        // the loader in SRAM programs the buffers the host image is streamed to
+        if (parse_number(NULL, 32, "\nInsert loader entry addr > ", &loader.entry) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert loader stack addr > ", &loader.stack) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert loader control block addr > ", &loader.ctrl) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert flash start addr > ", &addr) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert amount of words to program > ", &num) != OK)
+            break;
+        rc = arm_loader_program(&dap, &loader, addr, num);
+        break;
+
+    case 'g':
+        // the self-tests of the target report over the DCC, Ctrl-] ends the stream
+        if (parse_number(NULL, 32, "\nInsert amount of words, 0 until Ctrl-] > ", &num) != OK)
+            break;
+        rc = arm_dcc_stream(&dap, num, &value);
+        if (rc != OK)
+            break;
+        Serial.print("\nForwarded "); Serial.print(value, DEC); Serial.println(" DCC words");
+        break;
+
+    case 'b':
+        // the host bridge turns GDB packets into requests, until GDB detaches
+        rc = arm_gdb_serve(&dap);
+        break;
+
+    case 'z':
+        // quit ARM commands menu, an SWJ-DP goes back to JTAG
+        if (dap.swd != nullptr)
+        {
+            swd_disconnect();
+            dap.swd = nullptr;
+        }
+        Serial.print("\nGoing back to main menu...");
+        break;
+
+    default:
+        break;
+    }
+
+    if (rc != OK)
+    {
+        Serial.print("\nDAP access failed: "); Serial.println(rc, DEC);
+    }
+}
+
+/**
+ * @brief Prompts the user to choose what to execute
+ * from the available menu of ARM DAP commands.
+ */
+void arm_main(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out)
+{
+    // memory accesses go through MEM-AP 0, the AHB-AP of Cortex-M cores
+    if (dap.swd != nullptr || dap.ir_len != ir_len || dap.ir_in != ir_in)
+        adiv5_init(&dap, ir_len, ir_in, ir_out, dr_in, dr_out, 0);
+
+    arm_print_menu();
+    arm_command(get_character("\narm > "));
+}
+
+void arm_swd_main()
+{
+    if (dap.swd != &swd)
+    {
+        swd_init(&swd, SWD_WAIT_RETRIES, 0);
+        adiv5_init_swd(&dap, &swd, 0);
+    }
+
+    arm_print_menu();
+    arm_command(get_character("\nswd > "));
+}
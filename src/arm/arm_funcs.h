@@ -0,0 +1,16 @@
+#ifndef __ARM_FUNCS_H__
+#define __ARM_FUNCS_H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+
+void arm_main(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out);
+
+/**
+ * @brief The ARM DAP menu over SWD, on the JTAG pins (SWCLK on TCK, SWDIO on TMS).
+ * "p" switches the SWJ-DP to SWD, "z" back to JTAG.
+ */
+void arm_swd_main();
+
+#endif
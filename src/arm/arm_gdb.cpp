@@ -0,0 +1,146 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "arm_gdb.h"
+#include "cortex_m.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+static uint32_t arm_gdb_get32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void arm_gdb_put32(uint8_t* p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+/**
+ * @brief Run a single request.
+ * @param reply Gets the data of the reply, after its status byte.
+ * @param len Gets the length of the data.
+ */
+static status_t arm_gdb_request(adiv5_dap_t* dap, const uint8_t* req, uint16_t req_len, uint8_t* reply, uint16_t* len)
+{
+    uint32_t words[ARM_GDB_MAX_WORDS];
+    uint32_t addr, num;
+    bool halted = false;
+    status_t rc = OK;
+
+    *len = 0;
+
+    switch (req[0])
+    {
+    case 'm':
+        if (req_len != 9)
+            return -ERR_BAD_PARAMETER;
+        addr = arm_gdb_get32(&req[1]);
+        num = arm_gdb_get32(&req[5]);
+        if (num == 0 || num > ARM_GDB_MAX_WORDS)
+            return -ERR_OUT_OF_BOUNDS;
+
+        rc = adiv5_mem_read_block(dap, addr, words, num);
+        if (rc != OK)
+            return rc;
+        for (uint32_t i = 0; i < num; i++)
+            arm_gdb_put32(&reply[4 * i], words[i]);
+        *len = num * 4;
+        break;
+
+    case 'M':
+        num = (req_len - 5) / 4;
+        if (req_len < 9 || (req_len - 5) % 4 != 0 || num > ARM_GDB_MAX_WORDS)
+            return -ERR_BAD_PARAMETER;
+        addr = arm_gdb_get32(&req[1]);
+
+        for (uint32_t i = 0; i < num; i++)
+            words[i] = arm_gdb_get32(&req[5 + 4 * i]);
+        rc = adiv5_mem_write_block(dap, addr, words, num);
+        break;
+
+    case 'g':
+        for (uint8_t reg = 0; reg < ARM_GDB_REGS && rc == OK; reg++)
+        {
+            rc = cortex_m_reg_read(dap, reg, &words[reg]);
+            arm_gdb_put32(&reply[4 * reg], words[reg]);
+        }
+        if (rc == OK)
+            *len = ARM_GDB_REGS * 4;
+        break;
+
+    case 'G':
+        if (req_len != 1 + ARM_GDB_REGS * 4)
+            return -ERR_BAD_PARAMETER;
+        for (uint8_t reg = 0; reg < ARM_GDB_REGS && rc == OK; reg++)
+            rc = cortex_m_reg_write(dap, reg, arm_gdb_get32(&req[1 + 4 * reg]));
+        break;
+
+    case 'h':
+        rc = cortex_m_halt(dap);
+        break;
+
+    case 'c':
+        rc = cortex_m_resume(dap);
+        break;
+
+    case 's':
+        rc = cortex_m_step(dap);
+        break;
+
+    case '?':
+        rc = cortex_m_is_halted(dap, &halted);
+        reply[0] = halted;
+        *len = rc == OK ? 1 : 0;
+        break;
+
+    case 'q':
+        break;
+
+    default:
+        return -ERR_BAD_PARAMETER;
+    }
+
+    return rc;
+}
+
+status_t arm_gdb_serve(adiv5_dap_t* dap)
+{
+    uint8_t req[5 + ARM_GDB_MAX_WORDS * 4];
+    uint8_t reply[1 + ARM_GDB_MAX_WORDS * 4];
+    frame_rx_t rx;
+    uint16_t len = 0;
+    status_t rc;
+
+    Serial.print("\n@gdb "); Serial.println(ARM_GDB_MAX_WORDS, DEC);
+    Serial.flush();
+
+    while (true)
+    {
+        frame_rx_begin(&rx, req, sizeof(req));
+        rc = frame_rx_wait(&rx, ARM_GDB_IDLE_TIMEOUT_MS);
+        if (rc == -ERR_TIMEOUT)
+        {
+            Serial.println("\nGDB bridge timed out");
+            return rc;
+        }
+
+        if (rc == OK && rx.len == 0)
+            rc = -ERR_BAD_PARAMETER;
+        if (rc == OK)
+            rc = arm_gdb_request(dap, req, rx.len, &reply[1], &len);
+        else
+            clear_serial_rx_buf();  // a broken frame, the host sends the request again
+
+        // the error codes are small, the status byte holds them without the sign
+        reply[0] = (uint8_t)-rc;
+        send_frame_to_host(reply, rc == OK ? len + 1 : 1);
+        Serial.flush();
+
+        if (rx.complete && req[0] == 'q')
+            return OK;
+    }
+}
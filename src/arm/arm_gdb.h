@@ -0,0 +1,51 @@
+/** @file arm_gdb.h
+ *
+ * @brief Debug requests of the host GDB bridge (gdb_bridge.py) on a
+ * Cortex-M: the bridge translates the GDB remote protocol into binary
+ * request frames (see send_frame_to_host()), and the driver answers every
+ * request with a frame. A request is a command byte followed by its
+ * arguments, little endian; a reply is a status byte (0, or the error
+ * code without its sign) followed by the data:
+ *
+ *   'm' addr u32, words u32  -> words of memory, up to ARM_GDB_MAX_WORDS
+ *   'M' addr u32, words      -> nothing
+ *   'g'                      -> r0-r12, sp, lr, pc, xpsr (ARM_GDB_REGS words)
+ *   'G' ARM_GDB_REGS words   -> nothing
+ *   'h' halt, 'c' resume, 's' single step -> nothing
+ *   '?'                      -> halted u8
+ *   'q'                      -> nothing, and the driver goes back to the menu
+ *
+ * Breakpoints are set by the bridge in the FPB, with memory writes.
+ * The serving starts with "@gdb <max words>\n", and ends as well if no
+ * request came for ARM_GDB_IDLE_TIMEOUT_MS.
+ */
+#ifndef __ARM_GDB__H__
+#define __ARM_GDB__H__
+
+#include <stdint.h>
+
+#include "adiv5.h"
+#include "../../include/status.h"
+
+/**
+ * Most words of a memory request.
+ */
+#define ARM_GDB_MAX_WORDS 128
+
+/**
+ * Core registers of the 'g' and 'G' requests, in DCRSR order.
+ */
+#define ARM_GDB_REGS 17
+
+/**
+ * Time without requests after which the host is considered gone, in milliseconds.
+ */
+#define ARM_GDB_IDLE_TIMEOUT_MS 60000
+
+/**
+ * @brief Serve the requests of the host GDB bridge until it quits.
+ * @return OK, or -ERR_TIMEOUT if the host went quiet.
+ */
+status_t arm_gdb_serve(adiv5_dap_t* dap);
+
+#endif
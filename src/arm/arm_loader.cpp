@@ -0,0 +1,297 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "arm_loader.h"
+#include "cortex_m.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+// words of the control block
+#define CTRL_DEST(i)  (2 * (i))
+#define CTRL_COUNT(i) (2 * (i) + 1)
+#define CTRL_STATUS   4
+
+status_t arm_crc_range(adiv5_dap_t* dap, uint32_t addr, uint32_t num, uint32_t* crc)
+{
+    uint32_t buf[ARM_LOADER_BUF_WORDS];
+    uint8_t bytes[ARM_LOADER_BUF_WORDS * 4];
+    uint32_t words;
+    status_t rc = OK;
+
+    *crc = 0;
+    while (num > 0 && rc == OK)
+    {
+        words = min(num, (uint32_t)ARM_LOADER_BUF_WORDS);
+        rc = adiv5_mem_read_block(dap, addr, buf, words);
+        words_to_le_bytes(buf, bytes, words);
+        *crc = crc32_update(*crc, bytes, words * 4);
+
+        addr += words * 4;
+        num -= words;
+    }
+
+    return rc;
+}
+
+/**
+ * @brief Wait for the loader to free one of its buffers.
+ * @param rx If not nullptr, a frame arriving meanwhile, kept from overflowing the serial RX buffer.
+ */
+static status_t arm_loader_wait(adiv5_dap_t* dap, const arm_loader_t* loader, uint32_t buf, frame_rx_t* rx)
+{
+    uint32_t ctrl[ARM_LOADER_CTRL_WORDS];
+    unsigned long start = millis();
+    status_t rc;
+
+    do
+    {
+        rc = adiv5_mem_read_block(dap, loader->ctrl, ctrl, ARM_LOADER_CTRL_WORDS);
+        if (rc == OK && rx != nullptr)
+            rc = frame_rx_poll(rx);
+        if (rc != OK)
+            return rc;
+
+        if (ctrl[CTRL_STATUS] != 0)
+        {
+            Serial.print("\nLoader failed, status: 0x"); Serial.println(ctrl[CTRL_STATUS], HEX);
+            return -ERR_GENERAL;
+        }
+
+        if (ctrl[CTRL_COUNT(buf)] == 0)
+            return OK;
+    } while (millis() - start < ARM_LOADER_TIMEOUT_MS);
+
+    Serial.println("\nLoader does not respond");
+
+    return -ERR_TIMEOUT;
+}
+
+/**
+ * @brief Receive an image from the host and write it to the target, straight
+ * to its address, or through the buffers of a running loader.
+ * Chunks are double buffered, the next one arrives while one is written.
+ * @param loader The running loader, or nullptr to write the memory directly.
+ * @param crc Gets the CRC-32 of the image.
+ */
+static status_t arm_stream(adiv5_dap_t* dap, const arm_loader_t* loader, uint32_t start, uint32_t num, uint32_t* crc)
+{
+    uint8_t chunks[2][ARM_LOADER_BUF_WORDS * 4];
+    frame_rx_t rx[2];
+    uint32_t cur = 0;
+    uint32_t buf = 0;
+    uint32_t written = 0;
+    uint32_t words, addr, word = 0;
+    uint32_t ctrl[2];
+    bool more = false;
+    status_t rc = OK;
+
+    *crc = 0;
+
+    // the host reads a header of 0 words as a stream of unknown length
+    if (num == 0)
+    {
+        Serial.println("\nNothing to write");
+        return -ERR_BAD_PARAMETER;
+    }
+
+    Serial.print("\n@program 0x"); Serial.print(start, HEX);
+    Serial.print(" "); Serial.print(num, DEC);
+    Serial.print(" "); Serial.println(ARM_LOADER_BUF_WORDS, DEC);
+    Serial.flush();
+
+    clear_serial_rx_buf();
+    frame_rx_begin(&rx[cur], chunks[cur], sizeof(chunks[cur]));
+    Serial.write('R');
+
+    while (written < num && rc == OK)
+    {
+        rc = frame_rx_wait(&rx[cur], ARM_LOADER_RX_TIMEOUT_MS);
+        if (rc != OK)
+            break;
+
+        words = rx[cur].len / 4;
+        if (words == 0 || rx[cur].len % 4 != 0 || words > num - written)
+        {
+            rc = -ERR_BAD_PARAMETER;
+            break;
+        }
+
+        *crc = crc32_update(*crc, chunks[cur], rx[cur].len);
+
+        // ask for the next chunk, it arrives while this one is written
+        more = written + words < num;
+        if (more)
+        {
+            frame_rx_begin(&rx[cur ^ 1], chunks[cur ^ 1], sizeof(chunks[cur ^ 1]));
+            Serial.write('R');
+        }
+
+        addr = start + written * 4;
+        if (loader != nullptr)
+        {
+            // the buffer written two chunks ago must be programmed by now
+            rc = arm_loader_wait(dap, loader, buf, more ? &rx[cur ^ 1] : nullptr);
+            addr = loader->ctrl + 4 * (ARM_LOADER_CTRL_WORDS + buf * ARM_LOADER_BUF_WORDS);
+        }
+
+        if (rc == OK)
+            rc = adiv5_mem_write_begin(dap, addr);
+
+        for (uint32_t i = 0; i < words && rc == OK; i++)
+        {
+            word = (uint32_t)chunks[cur][4 * i] | ((uint32_t)chunks[cur][4 * i + 1] << 8) |
+                   ((uint32_t)chunks[cur][4 * i + 2] << 16) | ((uint32_t)chunks[cur][4 * i + 3] << 24);
+            rc = adiv5_mem_write_next(dap, word);
+
+            // keep the serial RX buffer from overflowing
+            if (more && rc == OK)
+                rc = frame_rx_poll(&rx[cur ^ 1]);
+        }
+
+        if (rc == OK)
+            rc = adiv5_mem_write_end(dap);
+
+        // hand the buffer over to the loader, the count goes last
+        if (rc == OK && loader != nullptr)
+        {
+            ctrl[0] = start + written * 4;
+            ctrl[1] = words;
+            rc = adiv5_mem_write_block(dap, loader->ctrl + 4 * CTRL_DEST(buf), ctrl, 2);
+        }
+
+        written += words;
+        cur ^= 1;
+        buf ^= 1;
+    }
+
+    if (rc != OK)
+    {
+        Serial.write('X');
+        Serial.print("\nWriting failed after "); Serial.print(written, DEC);
+        Serial.print(" words, error: "); Serial.println(rc, DEC);
+    }
+
+    return rc;
+}
+
+status_t arm_load_image(adiv5_dap_t* dap, uint32_t addr, uint32_t num)
+{
+    uint32_t crc, readback = 0;
+    status_t rc = arm_stream(dap, nullptr, addr, num, &crc);
+
+    if (rc == OK)
+        rc = arm_crc_range(dap, addr, num, &readback);
+    if (rc != OK)
+        return rc;
+
+    if (readback != crc)
+    {
+        Serial.println("\nVerify failed: memory does not match the image");
+        return -ERR_BAD_CHECKSUM;
+    }
+
+    Serial.print("\nLoaded and verified "); Serial.print(num, DEC);
+    Serial.print(" words, CRC32: 0x"); Serial.println(crc, HEX);
+
+    return OK;
+}
+
+/**
+ * @brief Halt the core, and start it at the loader's entry point.
+ */
+static status_t arm_loader_start(adiv5_dap_t* dap, const arm_loader_t* loader)
+{
+    uint32_t ctrl[ARM_LOADER_CTRL_WORDS] = {0};
+    status_t rc = cortex_m_halt(dap);
+
+    if (rc == OK)
+        rc = adiv5_mem_write_block(dap, loader->ctrl, ctrl, ARM_LOADER_CTRL_WORDS);
+    if (rc == OK)
+        rc = cortex_m_reg_write(dap, CORTEX_M_R0, loader->ctrl);
+    if (rc == OK)
+        rc = cortex_m_reg_write(dap, CORTEX_M_R1, ARM_LOADER_BUF_WORDS);
+    if (rc == OK)
+        rc = cortex_m_reg_write(dap, CORTEX_M_SP, loader->stack);
+    if (rc == OK)
+        rc = cortex_m_reg_write(dap, CORTEX_M_PC, loader->entry & ~1UL);
+    if (rc == OK)
+        rc = cortex_m_reg_write(dap, CORTEX_M_XPSR, CORTEX_M_XPSR_T);
+    if (rc == OK)
+        rc = cortex_m_resume_masked(dap);
+
+    return rc;
+}
+
+/**
+ * @brief Let the loader program the last buffers, end it and wait for it to halt.
+ */
+static status_t arm_loader_finish(adiv5_dap_t* dap, const arm_loader_t* loader, uint32_t buffers)
+{
+    // the loader takes the buffers in turn, the next one is buffers % 2
+    uint32_t next = buffers & 1;
+    uint32_t status = 0;
+    status_t rc = arm_loader_wait(dap, loader, next ^ 1, nullptr);
+
+    if (rc == OK)
+        rc = arm_loader_wait(dap, loader, next, nullptr);
+    if (rc == OK)
+        rc = adiv5_mem_write32(dap, loader->ctrl + 4 * CTRL_COUNT(next), ARM_LOADER_DONE);
+    if (rc == OK)
+        rc = cortex_m_wait_halt(dap, ARM_LOADER_TIMEOUT_MS);
+    if (rc == OK)
+        rc = adiv5_mem_read32(dap, loader->ctrl + 4 * CTRL_STATUS, &status);
+
+    if (rc == OK && status != 0)
+    {
+        Serial.print("\nLoader failed, status: 0x"); Serial.println(status, HEX);
+        rc = -ERR_GENERAL;
+    }
+
+    return rc;
+}
+
+status_t arm_loader_program(adiv5_dap_t* dap, const arm_loader_t* loader, uint32_t start, uint32_t num)
+{
+    uint32_t crc, readback = 0;
+    status_t rc;
+
+    // an empty range leaves the core alone
+    if (num == 0)
+    {
+        Serial.println("\nNothing to program");
+        return -ERR_BAD_PARAMETER;
+    }
+
+    rc = arm_loader_start(dap, loader);
+    if (rc != OK)
+    {
+        Serial.println("\nCould not start the loader");
+        return rc;
+    }
+
+    rc = arm_stream(dap, loader, start, num, &crc);
+    if (rc == OK)
+        rc = arm_loader_finish(dap, loader, (num + ARM_LOADER_BUF_WORDS - 1) / ARM_LOADER_BUF_WORDS);
+
+    // never leave the loader running
+    if (rc != OK)
+    {
+        cortex_m_halt(dap);
+        return rc;
+    }
+
+    rc = arm_crc_range(dap, start, num, &readback);
+    if (rc != OK)
+        return rc;
+
+    if (readback != crc)
+    {
+        Serial.println("\nVerify failed: flash does not match the image");
+        return -ERR_BAD_CHECKSUM;
+    }
+
+    Serial.print("\nProgrammed and verified "); Serial.print(num, DEC);
+    Serial.print(" words, CRC32: 0x"); Serial.println(crc, HEX);
+
+    return OK;
+}
@@ -0,0 +1,90 @@
+/** @file arm_loader.h
+ *
+ * @brief Programming of the internal flash of a Cortex-M through a flash
+ * loader: a small target specific algorithm that runs from the target SRAM
+ * and programs the data the driver streams into two SRAM buffers, so the
+ * driver fills one buffer while the loader programs the other.
+ *
+ * The loader is started with R0 = address of its control block and
+ * R1 = ARM_LOADER_BUF_WORDS. The control block is laid out as:
+ *
+ *   ctrl + 0            dest[0]     flash address of buffer 0
+ *   ctrl + 4            count[0]    words in buffer 0, cleared by the loader once programmed
+ *   ctrl + 8            dest[1]     flash address of buffer 1
+ *   ctrl + 12           count[1]    words in buffer 1
+ *   ctrl + 16           status      0, or an error code set by the loader
+ *   ctrl + 20           buffer 0    ARM_LOADER_BUF_WORDS words
+ *   ctrl + 20 + 4 * ARM_LOADER_BUF_WORDS    buffer 1
+ *
+ * The loader waits for count[i] of the buffer in turn (0, 1, 0, ...),
+ * programs it and clears count[i]. ARM_LOADER_DONE in count[i] ends the
+ * programming, and the loader halts on a BKPT instruction. It halts as well
+ * after setting a non-zero status.
+ *
+ * The images (the loader itself and the flash data) are streamed by the host
+ * tool as in the MAX10 programming, see program.py.
+ */
+#ifndef __ARM_LOADER__H__
+#define __ARM_LOADER__H__
+
+#include <stdint.h>
+
+#include "adiv5.h"
+#include "../../include/status.h"
+
+/**
+ * Number of 32 bit words in every chunk of an image from the host, and in
+ * every SRAM buffer of the loader. Two chunks are buffered on the driver side.
+ */
+#define ARM_LOADER_BUF_WORDS 64
+
+/**
+ * Size of the control block in 32 bit words, without the buffers.
+ */
+#define ARM_LOADER_CTRL_WORDS 5
+
+/**
+ * count[i] value that ends the programming.
+ */
+#define ARM_LOADER_DONE 0xffffffff
+
+/**
+ * Time to wait for a chunk of the image from the host,
+ * for the loader to free a buffer, and for the loader to halt at the end.
+ */
+#define ARM_LOADER_RX_TIMEOUT_MS 2000
+#define ARM_LOADER_TIMEOUT_MS 2000
+
+typedef struct
+{
+    uint32_t entry;     // address of the loader's entry point
+    uint32_t stack;     // initial stack pointer
+    uint32_t ctrl;      // address of the control block, followed by the buffers
+} arm_loader_t;
+
+/**
+ * @brief Write an image streamed by the host to the target memory (e.g. the
+ * loader to SRAM) with bulk writes, and verify it with a CRC-32 read back.
+ * @param addr Word aligned address.
+ * @param num Number of 32 bit words.
+ * @return OK, -ERR_BAD_PARAMETER for an empty range, or an error of the transfer.
+ */
+status_t arm_load_image(adiv5_dap_t* dap, uint32_t addr, uint32_t num);
+
+/**
+ * @brief Program the flash with an image streamed by the host through a loader
+ * already in SRAM. The core is halted, started at the loader's entry, and
+ * is left halted. The flash is verified with a CRC-32 read back.
+ * @param start Flash address.
+ * @param num Number of 32 bit words.
+ * @return OK, -ERR_BAD_PARAMETER for an empty range (the core is not halted),
+ * or an error of the transfer or the loader.
+ */
+status_t arm_loader_program(adiv5_dap_t* dap, const arm_loader_t* loader, uint32_t start, uint32_t num);
+
+/**
+ * @brief CRC-32 of a range of the target memory, only the digest crosses the link.
+ */
+status_t arm_crc_range(adiv5_dap_t* dap, uint32_t addr, uint32_t num, uint32_t* crc);
+
+#endif
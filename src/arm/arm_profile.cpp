@@ -0,0 +1,33 @@
+/* --------------------------------------------------------------------------------------- */
+/* ----------------------- Device profile of ARM JTAG debug ports --------------------------*/
+/* --------------------------------------------------------------------------------------- */
+#include <stdint.h>
+
+#include "adiv5.h"
+#include "arm_funcs.h"
+#include "../profile/profile.h"
+
+static constexpr profile_part_t arm_parts[] = {
+    { "Cortex-M3/M4 JTAG-DP", 0x0ba00477 },
+};
+
+static constexpr profile_instr_t arm_instrs[] = {
+    { "ABORT",  JTAG_DP_ABORT,  ADIV5_SCAN_LEN, 0 },
+    { "DPACC",  JTAG_DP_DPACC,  ADIV5_SCAN_LEN, 0 },
+    { "APACC",  JTAG_DP_APACC,  ADIV5_SCAN_LEN, 0 },
+    { "IDCODE", JTAG_DP_IDCODE, 32,             0 },
+    { "BYPASS", JTAG_DP_BYPASS, 1,              0 },
+};
+
+// JTAG-DPs designed by ARM, of any DP version and revision
+extern constexpr profile_t arm_profile = {
+    "ARM DAP",
+    4,
+    0x0fff0fff,
+    0x0ba00477,
+    arm_parts,
+    sizeof(arm_parts) / sizeof(arm_parts[0]),
+    arm_instrs,
+    sizeof(arm_instrs) / sizeof(arm_instrs[0]),
+    arm_main,
+};
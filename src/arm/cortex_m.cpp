@@ -0,0 +1,108 @@
+#include <Arduino.h>
+
+#include "cortex_m.h"
+
+status_t cortex_m_is_halted(adiv5_dap_t* dap, bool* halted)
+{
+    uint32_t dhcsr = 0;
+    status_t rc = adiv5_mem_read32(dap, CORTEX_M_DHCSR, &dhcsr);
+
+    *halted = (dhcsr & CORTEX_M_S_HALT) != 0;
+
+    return rc;
+}
+
+status_t cortex_m_wait_halt(adiv5_dap_t* dap, uint32_t timeout_ms)
+{
+    unsigned long start = millis();
+    bool halted = false;
+    status_t rc;
+
+    do
+    {
+        rc = cortex_m_is_halted(dap, &halted);
+        if (rc != OK || halted)
+            return rc;
+    } while (millis() - start < timeout_ms);
+
+    return -ERR_TIMEOUT;
+}
+
+status_t cortex_m_halt(adiv5_dap_t* dap)
+{
+    // C_MASKINTS only changes while the core is halted, the resume sets it
+    status_t rc = adiv5_mem_write32(dap, CORTEX_M_DHCSR, CORTEX_M_DBGKEY | CORTEX_M_C_HALT | CORTEX_M_C_DEBUGEN);
+
+    if (rc != OK)
+        return rc;
+
+    rc = cortex_m_wait_halt(dap, CORTEX_M_HALT_TIMEOUT_MS);
+    if (rc == -ERR_TIMEOUT)
+        Serial.println("\nCore did not halt");
+
+    return rc;
+}
+
+status_t cortex_m_resume(adiv5_dap_t* dap)
+{
+    return adiv5_mem_write32(dap, CORTEX_M_DHCSR, CORTEX_M_DBGKEY | CORTEX_M_C_DEBUGEN);
+}
+
+status_t cortex_m_resume_masked(adiv5_dap_t* dap)
+{
+    return adiv5_mem_write32(dap, CORTEX_M_DHCSR, CORTEX_M_DBGKEY | CORTEX_M_C_MASKINTS | CORTEX_M_C_DEBUGEN);
+}
+
+status_t cortex_m_step(adiv5_dap_t* dap)
+{
+    status_t rc = adiv5_mem_write32(dap, CORTEX_M_DHCSR,
+                                    CORTEX_M_DBGKEY | CORTEX_M_C_MASKINTS | CORTEX_M_C_STEP | CORTEX_M_C_DEBUGEN);
+
+    if (rc != OK)
+        return rc;
+
+    return cortex_m_wait_halt(dap, CORTEX_M_HALT_TIMEOUT_MS);
+}
+
+/**
+ * @brief Wait for the end of a core register transfer.
+ */
+static status_t cortex_m_wait_regrdy(adiv5_dap_t* dap)
+{
+    unsigned long start = millis();
+    uint32_t dhcsr = 0;
+    status_t rc;
+
+    do
+    {
+        rc = adiv5_mem_read32(dap, CORTEX_M_DHCSR, &dhcsr);
+        if (rc != OK || (dhcsr & CORTEX_M_S_REGRDY))
+            return rc;
+    } while (millis() - start < CORTEX_M_REG_TIMEOUT_MS);
+
+    return -ERR_TIMEOUT;
+}
+
+status_t cortex_m_reg_read(adiv5_dap_t* dap, uint8_t reg, uint32_t* value)
+{
+    status_t rc = adiv5_mem_write32(dap, CORTEX_M_DCRSR, reg);
+
+    if (rc == OK)
+        rc = cortex_m_wait_regrdy(dap);
+    if (rc == OK)
+        rc = adiv5_mem_read32(dap, CORTEX_M_DCRDR, value);
+
+    return rc;
+}
+
+status_t cortex_m_reg_write(adiv5_dap_t* dap, uint8_t reg, uint32_t value)
+{
+    status_t rc = adiv5_mem_write32(dap, CORTEX_M_DCRDR, value);
+
+    if (rc == OK)
+        rc = adiv5_mem_write32(dap, CORTEX_M_DCRSR, CORTEX_M_DCRSR_WRITE | reg);
+    if (rc == OK)
+        rc = cortex_m_wait_regrdy(dap);
+
+    return rc;
+}
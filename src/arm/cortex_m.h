@@ -0,0 +1,110 @@
+/** @file cortex_m.h
+ *
+ * @brief Run control of a Cortex-M core through its debug registers, which
+ * are accessed over the MEM-AP of the DAP (adiv5.h):
+ *
+ *  - DHCSR: halt, resume, single step and the halt status. Writes need the debug key.
+ *  - DCRSR / DCRDR: transfer of the core registers while the core is halted.
+ */
+#ifndef __CORTEX_M__H__
+#define __CORTEX_M__H__
+
+#include <stdint.h>
+
+#include "adiv5.h"
+#include "../../include/status.h"
+
+/**
+ * Debug registers of the System Control Space.
+ */
+#define CORTEX_M_DHCSR 0xe000edf0
+#define CORTEX_M_DCRSR 0xe000edf4
+#define CORTEX_M_DCRDR 0xe000edf8
+#define CORTEX_M_DEMCR 0xe000edfc
+
+/**
+ * DHCSR bits.
+ */
+#define CORTEX_M_DBGKEY     0xa05f0000
+#define CORTEX_M_C_DEBUGEN  (1UL << 0)
+#define CORTEX_M_C_HALT     (1UL << 1)
+#define CORTEX_M_C_STEP     (1UL << 2)
+#define CORTEX_M_C_MASKINTS (1UL << 3)
+#define CORTEX_M_S_REGRDY   (1UL << 16)
+#define CORTEX_M_S_HALT     (1UL << 17)
+
+/**
+ * DCRSR: register number [6:0], write access [16].
+ */
+#define CORTEX_M_DCRSR_WRITE (1UL << 16)
+
+/**
+ * Core register numbers of DCRSR.
+ */
+#define CORTEX_M_R0   0
+#define CORTEX_M_R1   1
+#define CORTEX_M_R2   2
+#define CORTEX_M_R3   3
+#define CORTEX_M_SP   13
+#define CORTEX_M_LR   14
+#define CORTEX_M_PC   15
+#define CORTEX_M_XPSR 16
+
+/**
+ * Thumb state bit of xPSR, must be set for the core to run.
+ */
+#define CORTEX_M_XPSR_T (1UL << 24)
+
+/**
+ * Time to wait for the core to halt, and for a core register transfer.
+ */
+#define CORTEX_M_HALT_TIMEOUT_MS 100
+#define CORTEX_M_REG_TIMEOUT_MS  10
+
+/**
+ * @brief Halt the core.
+ * @return OK, or -ERR_TIMEOUT if the core does not halt.
+ */
+status_t cortex_m_halt(adiv5_dap_t* dap);
+
+/**
+ * @brief Resume the halted core, with its interrupts enabled.
+ */
+status_t cortex_m_resume(adiv5_dap_t* dap);
+
+/**
+ * @brief Resume the halted core with the interrupts masked, for code run by
+ * the driver (the flash loader) that the firmware interrupts must not preempt.
+ */
+status_t cortex_m_resume_masked(adiv5_dap_t* dap);
+
+/**
+ * @brief Run a single instruction of the halted core, with the interrupts masked.
+ * @return OK, or -ERR_TIMEOUT if the core does not halt again.
+ */
+status_t cortex_m_step(adiv5_dap_t* dap);
+
+/**
+ * @brief Check if the core is halted.
+ */
+status_t cortex_m_is_halted(adiv5_dap_t* dap, bool* halted);
+
+/**
+ * @brief Wait for the core to halt by itself, e.g. on a BKPT instruction.
+ * @return OK, or -ERR_TIMEOUT.
+ */
+status_t cortex_m_wait_halt(adiv5_dap_t* dap, uint32_t timeout_ms);
+
+/**
+ * @brief Read a core register of the halted core.
+ * @param reg Register number of DCRSR, e.g. CORTEX_M_PC.
+ */
+status_t cortex_m_reg_read(adiv5_dap_t* dap, uint8_t reg, uint32_t* value);
+
+/**
+ * @brief Write a core register of the halted core.
+ * @param reg Register number of DCRSR, e.g. CORTEX_M_PC.
+ */
+status_t cortex_m_reg_write(adiv5_dap_t* dap, uint8_t reg, uint32_t value);
+
+#endif
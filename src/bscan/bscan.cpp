@@ -0,0 +1,214 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "bscan.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+static inline void bscan_put(uint8_t* bits, int16_t cell, uint8_t value)
+{
+    if (value)
+        bits[cell >> 3] |= 1 << (cell & 7);
+    else
+        bits[cell >> 3] &= ~(1 << (cell & 7));
+}
+
+static inline uint8_t bscan_bit(const uint8_t* bits, int16_t cell)
+{
+    return (bits[cell >> 3] >> (cell & 7)) & 1;
+}
+
+/**
+ * @brief Change a cell of the shadow, it is only shifted if it changed.
+ */
+static inline void bscan_latch(bscan_t* bs, int16_t cell, uint8_t value)
+{
+    if (bscan_bit(bs->shadow, cell) != value)
+    {
+        bscan_put(bs->shadow, cell, value);
+        bs->dirty = true;
+    }
+}
+
+static void bscan_load_ir(bscan_t* bs, uint32_t instr)
+{
+    int_to_bin_array(bs->ir_in, instr, bs->model->ir_len);
+    insert_ir(bs->ir_in, bs->ir_out, bs->model->ir_len, RUN_TEST_IDLE);
+}
+
+/**
+ * @brief Shift the shadow through the BSR, and keep the capture.
+ */
+static void bscan_shift(bscan_t* bs)
+{
+    insert_dr_packed(bs->shadow, bs->capture, bs->model->length, RUN_TEST_IDLE);
+    bs->dirty = false;
+    bs->scans++;
+}
+
+status_t bscan_init(bscan_t* bs, const bscan_model_t* model, uint8_t* ir_in, uint8_t* ir_out)
+{
+    const bscan_cell_t* cell;
+
+    if (model->length > BSCAN_MAX_LEN)
+        return -ERR_OUT_OF_BOUNDS;
+
+    memset(bs, 0, sizeof(*bs));
+    bs->model = model;
+    bs->ir_in = ir_in;
+    bs->ir_out = ir_out;
+
+    for (uint16_t i = 0; i < model->length; i++)
+    {
+        cell = &model->cells[i];
+        bscan_put(bs->shadow, i, cell->safe == 1);
+    }
+
+    // the outputs stay off, whatever the safe values of their control cells are
+    for (uint16_t i = 0; i < model->length; i++)
+    {
+        cell = &model->cells[i];
+        if (cell->control >= 0 && cell->control < model->length)
+            bscan_put(bs->shadow, cell->control, cell->disable);
+    }
+
+    bs->dirty = true;
+    return OK;
+}
+
+status_t bscan_sample(bscan_t* bs)
+{
+    bscan_load_ir(bs, bs->model->sample);
+    bscan_shift(bs);
+    bs->extest = false;
+
+    return OK;
+}
+
+status_t bscan_extest(bscan_t* bs)
+{
+    // the update latches hold the shadow before EXTEST drives the pins
+    bscan_sample(bs);
+    bscan_load_ir(bs, bs->model->extest);
+    bs->extest = true;
+
+    return OK;
+}
+
+status_t bscan_pin(const bscan_t* bs, const char* name, bscan_pin_t* pin)
+{
+    const bscan_cell_t* cell;
+    bool found = false;
+
+    pin->output = -1;
+    pin->input = -1;
+    pin->control = -1;
+    pin->disable = 0;
+
+    for (uint16_t i = 0; i < bs->model->length; i++)
+    {
+        cell = &bs->model->cells[i];
+        if (cell->port == nullptr || strcmp(cell->port, name) != 0)
+            continue;
+        found = true;
+
+        switch (cell->function)
+        {
+        case BSCAN_BIDIR:
+            pin->input = i;
+            // fall through
+        case BSCAN_OUTPUT2:
+        case BSCAN_OUTPUT3:
+            pin->output = i;
+            pin->control = cell->control;
+            pin->disable = cell->disable;
+            break;
+
+        case BSCAN_INPUT:
+        case BSCAN_CLOCK:
+        case BSCAN_OBSERVE_ONLY:
+            pin->input = i;
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    return found ? OK : -ERR_NOT_FOUND;
+}
+
+status_t bscan_pin_set(bscan_t* bs, const bscan_pin_t* pin, uint8_t value)
+{
+    if (pin->output < 0)
+        return -ERR_BAD_PARAMETER;
+
+    bscan_latch(bs, pin->output, value ? 1 : 0);
+    if (pin->control >= 0)
+        bscan_latch(bs, pin->control, !pin->disable);
+
+    return OK;
+}
+
+status_t bscan_pin_tristate(bscan_t* bs, const bscan_pin_t* pin)
+{
+    if (pin->control < 0)
+        return -ERR_BAD_PARAMETER;
+
+    bscan_latch(bs, pin->control, pin->disable);
+    return OK;
+}
+
+status_t bscan_pin_get(const bscan_t* bs, const bscan_pin_t* pin, uint8_t* value)
+{
+    if (pin->input < 0)
+        return -ERR_BAD_PARAMETER;
+
+    *value = bscan_bit(bs->capture, pin->input);
+    return OK;
+}
+
+status_t bscan_set(bscan_t* bs, const char* name, uint8_t value)
+{
+    bscan_pin_t pin;
+    status_t rc = bscan_pin(bs, name, &pin);
+
+    return rc == OK ? bscan_pin_set(bs, &pin, value) : rc;
+}
+
+status_t bscan_tristate(bscan_t* bs, const char* name)
+{
+    bscan_pin_t pin;
+    status_t rc = bscan_pin(bs, name, &pin);
+
+    return rc == OK ? bscan_pin_tristate(bs, &pin) : rc;
+}
+
+status_t bscan_get(const bscan_t* bs, const char* name, uint8_t* value)
+{
+    bscan_pin_t pin;
+    status_t rc = bscan_pin(bs, name, &pin);
+
+    return rc == OK ? bscan_pin_get(bs, &pin, value) : rc;
+}
+
+status_t bscan_flush(bscan_t* bs)
+{
+    if (!bs->dirty)
+    {
+        bs->skipped++;
+        return OK;
+    }
+
+    return bscan_scan(bs);
+}
+
+status_t bscan_scan(bscan_t* bs)
+{
+    // EXTEST stays loaded, a dropped IR scan costs nothing
+    bscan_load_ir(bs, bs->extest ? bs->model->extest : bs->model->sample);
+    bscan_shift(bs);
+
+    return OK;
+}
@@ -0,0 +1,160 @@
+/** @file bscan.h
+ *
+ * @brief Boundary scan (IEEE 1149.1 EXTEST) of a device described by its
+ * boundary register, as in the BOUNDARY_REGISTER of its BSDL: pins are set,
+ * read and tristated by their port names.
+ *
+ * The engine keeps a shadow of the update latches of the BSR. Setting or
+ * tristating a pin only changes the shadow, and bscan_flush() shifts it in a
+ * single EXTEST DR scan when it changed, so any number of pin changes cost
+ * one scan. Every scan captures the BSR as well, and the pins are read from
+ * that capture. The capture comes before the update of the same scan, so the
+ * levels that follow a change are read by the next scan. EXTEST stays loaded
+ * between the scans, the IR shadow cache of the driver drops the IR scans.
+ *
+ * Cell i of the boundary register is bit i of the DR (the one closest to
+ * TDO, shifted first). The BSR is shifted from and to packed bits, 8 a byte,
+ * see insert_dr_packed().
+ */
+#ifndef __BSCAN__H__
+#define __BSCAN__H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+
+/**
+ * Longest boundary register, in cells.
+ */
+#define BSCAN_MAX_LEN 2048
+
+/**
+ * Cell functions of the BSDL.
+ */
+#define BSCAN_INPUT        0
+#define BSCAN_OUTPUT2      1
+#define BSCAN_OUTPUT3      2
+#define BSCAN_CONTROL      3
+#define BSCAN_CONTROLR     4
+#define BSCAN_INTERNAL     5
+#define BSCAN_BIDIR        6
+#define BSCAN_CLOCK        7
+#define BSCAN_OBSERVE_ONLY 8
+
+/**
+ * Safe value of a cell that does not care (X in the BSDL).
+ */
+#define BSCAN_SAFE_X 2
+
+/**
+ * A cell of the boundary register.
+ */
+typedef struct
+{
+    const char* port;   // port name, nullptr for a cell without one (* in the BSDL)
+    uint8_t function;   // BSCAN_*
+    uint8_t safe;       // 0, 1 or BSCAN_SAFE_X
+    int16_t control;    // cell that enables the output, -1 if none
+    uint8_t disable;    // value of the control cell that turns the output off
+} bscan_cell_t;
+
+/**
+ * Boundary scan model of a device.
+ */
+typedef struct
+{
+    const char* name;
+    uint32_t idcode;
+    uint8_t ir_len;
+    uint32_t extest;            // EXTEST opcode
+    uint32_t sample;            // SAMPLE/PRELOAD opcode
+    uint16_t length;            // BOUNDARY_LENGTH
+    const bscan_cell_t* cells;  // length cells, by cell number
+} bscan_model_t;
+
+/**
+ * Cells of a pin, resolved once by bscan_pin().
+ */
+typedef struct
+{
+    int16_t output;     // output or bidir cell, -1 if none
+    int16_t input;      // input, clock, observe only or bidir cell, -1 if none
+    int16_t control;    // control cell of the output, -1 if none
+    uint8_t disable;
+} bscan_pin_t;
+
+typedef struct
+{
+    const bscan_model_t* model;
+    uint8_t* ir_in;
+    uint8_t* ir_out;
+    uint8_t shadow[BSCAN_MAX_LEN / 8];  // update latches, shifted in
+    uint8_t capture[BSCAN_MAX_LEN / 8]; // BSR captured by the last scan
+    bool dirty;                         // the shadow changed since the last scan
+    bool extest;                        // EXTEST loaded, the pins follow the shadow
+    uint32_t scans;                     // DR scans of the BSR
+    uint32_t skipped;                   // flushes without changes, no scan
+} bscan_t;
+
+/**
+ * @brief Bind a device model, and fill the shadow with the safe values of
+ * the cells (outputs off, X taken as 0). Nothing is shifted.
+ * @return OK, or -ERR_OUT_OF_BOUNDS if the BSR is longer than BSCAN_MAX_LEN.
+ */
+status_t bscan_init(bscan_t* bs, const bscan_model_t* model, uint8_t* ir_in, uint8_t* ir_out);
+
+/**
+ * @brief Load SAMPLE/PRELOAD and shift the shadow: the pins are captured
+ * while the core keeps them, and the shadow is preloaded for EXTEST.
+ */
+status_t bscan_sample(bscan_t* bs);
+
+/**
+ * @brief Preload the shadow and load EXTEST, the pins follow the shadow from
+ * now on. The device must be reset (TLR) to get its pins back.
+ */
+status_t bscan_extest(bscan_t* bs);
+
+/**
+ * @brief Resolve the cells of a pin by its port name.
+ * @return OK, or -ERR_NOT_FOUND.
+ */
+status_t bscan_pin(const bscan_t* bs, const char* name, bscan_pin_t* pin);
+
+/**
+ * @brief Drive a pin (in the shadow), and enable its output.
+ * @return OK, or -ERR_BAD_PARAMETER if the pin has no output cell.
+ */
+status_t bscan_pin_set(bscan_t* bs, const bscan_pin_t* pin, uint8_t value);
+
+/**
+ * @brief Turn the output of a pin off (in the shadow). Pins that share the
+ * control cell are turned off as well.
+ * @return OK, or -ERR_BAD_PARAMETER if the output has no control cell.
+ */
+status_t bscan_pin_tristate(bscan_t* bs, const bscan_pin_t* pin);
+
+/**
+ * @brief Level of a pin in the last capture.
+ * @return OK, or -ERR_BAD_PARAMETER if the pin has no input cell.
+ */
+status_t bscan_pin_get(const bscan_t* bs, const bscan_pin_t* pin, uint8_t* value);
+
+/**
+ * @brief The same, by port name, resolved on every call.
+ */
+status_t bscan_set(bscan_t* bs, const char* name, uint8_t value);
+status_t bscan_tristate(bscan_t* bs, const char* name);
+status_t bscan_get(const bscan_t* bs, const char* name, uint8_t* value);
+
+/**
+ * @brief Apply the pin changes with a single DR scan, if there are any.
+ */
+status_t bscan_flush(bscan_t* bs);
+
+/**
+ * @brief Shift the shadow even if it did not change, to capture the pins again.
+ */
+status_t bscan_scan(bscan_t* bs);
+
+#endif
@@ -0,0 +1,139 @@
+/* --------------------------------------------------------------------------------------- */
+/* -------------------- Boundary scan commands of a device with a BSDL --------------------*/
+/* --------------------------------------------------------------------------------------- */
+#include <stdint.h>
+
+#include "bscan_funcs.h"
+#include "bscan.h"
+#include "bscan_map.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+// the pins keep their levels between the commands, until the map is loaded again
+static bscan_model_t model;
+static uint32_t mask = 0;
+static bscan_t bs;
+static bool loaded = false;
+
+/**
+ * @brief Print the boundary scan menu.
+ */
+static void bscan_print_menu()
+{
+    Serial.flush();
+    Serial.print("\n\nBoundary Scan Menu:\n");
+    Serial.print("l - Load the pin map from the host BSDL library\n");
+    Serial.print("s - Sample the pins (SAMPLE/PRELOAD)\n");
+    Serial.print("e - Take the pins (EXTEST)\n");
+    Serial.print("w - Set a pin\n");
+    Serial.print("t - Tristate a pin\n");
+    Serial.print("r - Read a pin\n");
+    Serial.print("f - Apply the pin changes\n");
+    Serial.print("z - Exit\n");
+    Serial.flush();
+}
+
+/**
+ * @brief Load the pin map of a device and take its pins, if the map fits its IR.
+ */
+static status_t bscan_load(uint32_t idcode, const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out)
+{
+    status_t rc;
+
+    loaded = false;
+    rc = bscan_map_load(idcode, &model, &mask);
+    if (rc == OK && model.ir_len != ir_len)
+    {
+        Serial.print("\nIR length of the BSDL is "); Serial.println(model.ir_len, DEC);
+        rc = -ERR_INVALID_IR_OR_DR_LEN;
+    }
+    if (rc == OK)
+        rc = bscan_init(&bs, &model, ir_in, ir_out);
+
+    loaded = rc == OK;
+    return rc;
+}
+
+/**
+ * @brief Prompts the user to choose what to execute
+ * from the available menu of boundary scan commands.
+ */
+void bscan_main(uint32_t idcode, const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out)
+{
+    String name;
+    uint32_t value = 0;
+    uint8_t level = 0;
+    bool fresh = false;
+    status_t rc = OK;
+
+    // a device gets its map once, the other commands work on the loaded one.
+    // the map tells which IDCODE bits identify the part it serves
+    if (!loaded || (model.idcode ^ idcode) & mask)
+    {
+        if (bscan_load(idcode, ir_len, ir_in, ir_out) != OK)
+            return;
+        fresh = true;
+    }
+
+    bscan_print_menu();
+    char command = get_character("\nbscan > ");
+
+    switch (command)
+    {
+    case 'l':
+        // the map was just loaded for this command
+        if (!fresh)
+            rc = bscan_load(idcode, ir_len, ir_in, ir_out);
+        break;
+
+    case 's':
+        rc = bscan_sample(&bs);
+        break;
+
+    case 'e':
+        rc = bscan_extest(&bs);
+        Serial.println("\nEXTEST loaded, reset the TAP to give the pins back to the device");
+        break;
+
+    case 'w':
+        name = get_string("Pin name > ");
+        rc = parse_number(nullptr, 32, "Value (0 or 1) > ", &value);
+        if (rc == OK)
+            rc = bscan_set(&bs, name.c_str(), value & 1);
+        break;
+
+    case 't':
+        name = get_string("Pin name > ");
+        rc = bscan_tristate(&bs, name.c_str());
+        break;
+
+    case 'r':
+        name = get_string("Pin name > ");
+        // a fresh capture, with the pending changes applied
+        rc = bscan_scan(&bs);
+        if (rc == OK)
+            rc = bscan_get(&bs, name.c_str(), &level);
+        if (rc == OK) {
+            Serial.print("\n"); Serial.print(name); Serial.print(": "); Serial.println(level, DEC);
+        }
+        break;
+
+    case 'f':
+        rc = bscan_flush(&bs);
+        break;
+
+    case 'z':
+        // quit boundary scan commands menu
+        Serial.print("\nGoing back to main menu...");
+        break;
+
+    default:
+        break;
+    }
+
+    if (rc != OK)
+    {
+        Serial.print("\nBoundary scan failed: "); Serial.println(rc, DEC);
+    }
+}
@@ -0,0 +1,10 @@
+#ifndef __BSCAN_FUNCS_H__
+#define __BSCAN_FUNCS_H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+
+void bscan_main(uint32_t idcode, const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out);
+
+#endif
@@ -0,0 +1,133 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "bscan_map.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+// the model of the last loaded map points into these
+static uint8_t bscan_map[BSCAN_MAP_MAX_BYTES];
+static bscan_cell_t bscan_map_cells[BSCAN_MAX_LEN];
+
+static uint16_t bscan_map_get16(const uint8_t* p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+static uint32_t bscan_map_get32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+status_t bscan_map_parse(const uint8_t* map, uint32_t len, bscan_model_t* model, bscan_cell_t* cells,
+                         uint16_t max_cells, uint32_t* mask)
+{
+    const uint8_t* cell;
+    const char* names;
+    uint16_t names_len, instructions, port, control;
+    uint8_t flags;
+
+    if (len < BSCAN_MAP_HEADER_LEN || map[0] != 'B' || map[1] != 'M' || map[2] != BSCAN_MAP_VERSION)
+        return -ERR_BAD_PARAMETER;
+
+    model->ir_len = map[3];
+    model->idcode = bscan_map_get32(&map[4]);
+    *mask = bscan_map_get32(&map[8]);
+    model->extest = bscan_map_get32(&map[12]);
+    model->sample = bscan_map_get32(&map[16]);
+    model->length = bscan_map_get16(&map[20]);
+    names_len = bscan_map_get16(&map[22]);
+    instructions = bscan_map_get16(&map[24]);
+
+    if (model->length > max_cells)
+        return -ERR_OUT_OF_BOUNDS;
+
+    // the instructions are for the host tools, they only have to fit
+    if (names_len == 0 || len != BSCAN_MAP_HEADER_LEN + names_len + (uint32_t)model->length * BSCAN_MAP_CELL_LEN
+                                  + (uint32_t)instructions * BSCAN_MAP_INSTRUCTION_LEN)
+        return -ERR_BAD_PARAMETER;
+
+    // every name ends in the table
+    names = (const char*)&map[BSCAN_MAP_HEADER_LEN];
+    if (names[names_len - 1] != '\0')
+        return -ERR_BAD_PARAMETER;
+    model->name = names;
+
+    cell = &map[BSCAN_MAP_HEADER_LEN + names_len];
+    for (uint16_t i = 0; i < model->length; i++, cell += BSCAN_MAP_CELL_LEN)
+    {
+        port = bscan_map_get16(&cell[0]);
+        flags = cell[2];
+        control = bscan_map_get16(&cell[3]);
+
+        if ((port != BSCAN_MAP_NONE && port >= names_len) || (flags & 0xf) > BSCAN_OBSERVE_ONLY
+            || ((flags >> 4) & 3) > BSCAN_SAFE_X || (control != BSCAN_MAP_NONE && control >= model->length))
+            return -ERR_BAD_PARAMETER;
+
+        cells[i].port = port == BSCAN_MAP_NONE ? nullptr : &names[port];
+        cells[i].function = flags & 0xf;
+        cells[i].safe = (flags >> 4) & 3;
+        cells[i].control = control == BSCAN_MAP_NONE ? -1 : (int16_t)control;
+        cells[i].disable = (flags >> 6) & 1;
+    }
+
+    model->cells = cells;
+    return OK;
+}
+
+status_t bscan_map_load(uint32_t idcode, bscan_model_t* model, uint32_t* mask)
+{
+    frame_rx_t rx;
+    uint32_t len = 0;
+    uint32_t size;
+    status_t rc = OK;
+
+    Serial.print("\n@bsdl 0x"); Serial.print(idcode, HEX);
+    Serial.print(" "); Serial.println(BSCAN_MAP_CHUNK_BYTES, DEC);
+    Serial.flush();
+
+    clear_serial_rx_buf();
+    while (true)
+    {
+        // the last chunks of a map too large for the driver fail as too long
+        size = BSCAN_MAP_MAX_BYTES - len < BSCAN_MAP_CHUNK_BYTES ? BSCAN_MAP_MAX_BYTES - len : BSCAN_MAP_CHUNK_BYTES;
+        frame_rx_begin(&rx, &bscan_map[len], size);
+        Serial.write('R');
+
+        rc = frame_rx_wait(&rx, BSCAN_MAP_TIMEOUT_MS);
+        if (rc != OK || rx.len == 0)
+            break;
+        len += rx.len;
+    }
+
+    if (rc != OK)
+    {
+        Serial.write('X');
+        Serial.print("\nPin map transfer failed after "); Serial.print(len, DEC);
+        Serial.print(" bytes, error: "); Serial.println(rc, DEC);
+        return rc;
+    }
+
+    if (len == 0)
+    {
+        Serial.println("\nNo BSDL of the device in the host library");
+        return -ERR_NOT_FOUND;
+    }
+
+    rc = bscan_map_parse(bscan_map, len, model, bscan_map_cells, BSCAN_MAX_LEN, mask);
+    if (rc != OK)
+    {
+        Serial.println("\nBroken pin map");
+        return rc;
+    }
+
+    if ((idcode & *mask) != (model->idcode & *mask))
+    {
+        Serial.print("\nThe pin map is of IDCODE 0x"); Serial.println(model->idcode, HEX);
+        return -ERR_BAD_IDCODE;
+    }
+
+    Serial.print("\nLoaded "); Serial.print(model->name);
+    Serial.print(", BSR of "); Serial.print(model->length, DEC); Serial.println(" cells");
+    return OK;
+}
@@ -0,0 +1,76 @@
+/** @file bscan_map.h
+ *
+ * @brief Boundary scan models loaded from the compact pin maps of the host
+ * BSDL library (bsdl.py), so a detected device gets its full model without
+ * the driver parsing any BSDL text. A pin map is little endian:
+ *
+ *   header       : "BM", version u8, IR length u8, IDCODE u32, IDCODE mask u32,
+ *                  EXTEST u32, SAMPLE u32, boundary length u16, names length u16,
+ *                  instructions u16
+ *   names        : NUL terminated strings, the entity name first
+ *   cells        : per cell -> port u16 (offset in names, 0xFFFF for none),
+ *                  function | safe << 4 | disable << 6 u8, control cell u16 (0xFFFF for none)
+ *   instructions : per opcode -> name u16 (offset in names), opcode u32
+ *
+ * The model points into the map: the port names are used in place.
+ * Loading starts with "@bsdl 0x<idcode> <bytes per chunk>\n", then the map
+ * is received as frames (see send_frame_to_host()), a chunk for every 'R'
+ * byte, and ends with an empty frame. 'X' aborts.
+ */
+#ifndef __BSCAN_MAP__H__
+#define __BSCAN_MAP__H__
+
+#include <stdint.h>
+
+#include "bscan.h"
+#include "../../include/status.h"
+
+#define BSCAN_MAP_VERSION 1
+
+/**
+ * Sizes of the records of a pin map, in bytes.
+ */
+#define BSCAN_MAP_HEADER_LEN      26
+#define BSCAN_MAP_CELL_LEN        5
+#define BSCAN_MAP_INSTRUCTION_LEN 6
+
+/**
+ * Port or control cell of none.
+ */
+#define BSCAN_MAP_NONE 0xffff
+
+/**
+ * Largest pin map the driver keeps, a BSR of BSCAN_MAX_LEN cells with short port names.
+ */
+#define BSCAN_MAP_MAX_BYTES 16384
+
+/**
+ * Bytes of a frame of the map.
+ */
+#define BSCAN_MAP_CHUNK_BYTES 1024
+
+/**
+ * Time to wait for a frame of the map, in milliseconds.
+ */
+#define BSCAN_MAP_TIMEOUT_MS 2000
+
+/**
+ * @brief Fill a model and its cells from a pin map. The map must stay in place
+ * while the model is used.
+ * @param mask Gets the IDCODE bits that identify the part.
+ * @return OK, -ERR_BAD_PARAMETER if the map is broken, or -ERR_OUT_OF_BOUNDS
+ * if it has more than max_cells cells.
+ */
+status_t bscan_map_parse(const uint8_t* map, uint32_t len, bscan_model_t* model, bscan_cell_t* cells,
+                         uint16_t max_cells, uint32_t* mask);
+
+/**
+ * @brief Load the pin map of a device from the host library. The map and the
+ * cells are kept by the driver until the next load.
+ * @param mask Gets the IDCODE bits that identify the part.
+ * @return OK, -ERR_NOT_FOUND if the library has no map of the IDCODE,
+ * -ERR_BAD_IDCODE if the map is of another part, or an error of the frames.
+ */
+status_t bscan_map_load(uint32_t idcode, bscan_model_t* model, uint32_t* mask);
+
+#endif
@@ -8,188 +8,283 @@
 #include "../../include/utils.h"
 
 
-// Count number of active devices in chain
-static uint32_t chain_active_devices = 0;
-static uint32_t chain_added_devices = 0;
-static uint32_t chain_ir_len = 0;
+uint32_t chain_get_active_devices(const chain_t* chain) { return chain->active; }
 
-uint32_t chain_get_active_devices() { return chain_active_devices; }
+uint32_t chain_get_total_ir_len(const chain_t* chain) { return chain->ir_len; }
 
-uint32_t chain_get_total_ir_len() { return chain_ir_len; }
+tap_t* chain_get_tap(chain_t* chain, const uint32_t index)
+{
+    if (index >= chain->count)
+        return nullptr;
+
+    return &chain->taps[index];
+}
 
-void chain_taps_init(tap_t* taps)
+const char* chain_tap_name(const chain_t* chain, const tap_t* tap)
 {
-    for (size_t i = 0; i < MAX_ALLOWED_TAPS; i++)
-    {
-        memset(taps[i].name, 0, 32);
-        taps[i].idcode = 0;
-        taps[i].ir_len = 0;
-        taps[i].ir_in_idx = 0;
-        taps[i].ir_out_idx = 0;
-        taps[i].active = false;
+    return &chain->names[tap->name_idx];
+}
+
+/**
+ * @brief Program the driver's bypass padding according to the
+ * prefix sums of the selected device. Constant time.
+ */
+static void chain_update_padding(chain_t* chain)
+{
+    if (chain->selected == CHAIN_NONE_SELECTED) {
+        jtag_set_padding(0, 0, 0, 0);
+        return;
     }
 
-    chain_ir_len = 0;
-    chain_added_devices = 0;
-    chain_active_devices = 0;
+    tap_t* tap = &chain->taps[chain->selected];
+    jtag_set_padding(tap->ir_in_idx,
+                     chain->ir_len - tap->ir_in_idx - tap->ir_len,
+                     tap->dr_idx,
+                     chain->active - tap->dr_idx - 1);
+}
+
+void chain_taps_init(chain_t* chain)
+{
+    memset(chain, 0, sizeof(chain_t));
+    chain->selected = CHAIN_NONE_SELECTED;
+    jtag_set_padding(0, 0, 0, 0);
 }
 
-status_t chain_tap_add(tap_t* taps, const uint32_t index, const char* name, const uint32_t idcode, const uint32_t ir_len)
+status_t chain_tap_add(chain_t* chain, const uint32_t index, const char* name, const uint32_t idcode, const uint32_t ir_len)
 {
-    if (index >= MAX_ALLOWED_TAPS)
+    uint32_t name_len;
+    tap_t* tap;
+
+    if (chain->count >= MAX_ALLOWED_TAPS || index > chain->count)
         return -ERR_OUT_OF_BOUNDS;
-        
-    if (ir_len > MAX_IR_LEN)
+
+    if (ir_len == 0 || ir_len > MAX_IR_LEN)
         return -ERR_INVALID_IR_OR_DR_LEN;
 
     if (name == nullptr || idcode == 0)
         return -ERR_BAD_PARAMETER;
 
-    if (taps[index].active)
-        return -ERR_TAP_DEVICE_ALREADY_ACTIVE;
-    
+    name_len = strnlen(name, CHAIN_MAX_NAME_LEN);
+    if (chain->names_used + name_len + 1 > CHAIN_NAMES_POOL_SIZE)
+        return -ERR_RESOURCE_EXHAUSTED;
 
-    // the new tap should be the first one in chain or adjacent
-    // after an exisiting active TAP
-    if (index != 0 && chain_active_devices != 0)
-    {
-        if (chain_active_devices - 1 != index)
-            return -ERR_BAD_PARAMETER;
-
-        if (!taps[index - 1].active)
-            Serial.println("chain: tap device should be activated");
-            return -ERR_TAP_DEVICE_UNAVAILABLE;
-    }        
-
-    strncpy(taps[index].name, name, 32);
-    taps[index].idcode = idcode;
-    taps[index].ir_len = ir_len;
-    taps[index].ir_in_idx = 0;
-    taps[index].ir_out_idx = 0;
-    taps[index].active = false;
-    chain_added_devices++;
+    // make room for the new device, the ones above it move towards JTDI
+    memmove(&chain->taps[index + 1], &chain->taps[index], (chain->count - index) * sizeof(tap_t));
+
+    tap = &chain->taps[index];
+    tap->idcode = idcode;
+    tap->ir_len = ir_len;
+    tap->active = false;
+
+    // an inactive device starts exactly where the next device starts
+    if (index < chain->count) {
+        tap->ir_in_idx = chain->taps[index + 1].ir_in_idx;
+        tap->dr_idx = chain->taps[index + 1].dr_idx;
+    } else {
+        tap->ir_in_idx = chain->ir_len;
+        tap->dr_idx = chain->active;
+    }
+
+    // append the name to the pool
+    tap->name_idx = chain->names_used;
+    memcpy(&chain->names[chain->names_used], name, name_len);
+    chain->names[chain->names_used + name_len] = '\0';
+    chain->names_used += name_len + 1;
+
+    chain->count++;
+
+    if (chain->selected != CHAIN_NONE_SELECTED && chain->selected >= index)
+        chain->selected++;
 
     return OK;
 }
 
-status_t chain_tap_remove(tap_t* taps, const uint32_t index)
+status_t chain_tap_remove(chain_t* chain, const uint32_t index)
 {
-    if (index >= MAX_ALLOWED_TAPS)
+    uint16_t name_idx, name_size;
+
+    if (index >= chain->count)
         return -ERR_OUT_OF_BOUNDS;
-    
+
     // tap should be deactivated first
-    if (taps[index].active) 
+    if (chain->taps[index].active)
     {
-        Serial.println("chain: tap device should be activated prior removal");
+        Serial.println("chain: tap device should be deactivated prior removal");
         return -ERR_TAP_DEVICE_REMOVE_ISSUE;
     }
 
-    memset(taps[index].name, 0, 32);
-    taps[index].idcode = 0;
-    taps[index].ir_len = 0;
-    taps[index].ir_in_idx = 0;
-    taps[index].ir_out_idx = 0;
-    chain_added_devices--;
+    // compact the names pool
+    name_idx = chain->taps[index].name_idx;
+    name_size = strlen(&chain->names[name_idx]) + 1;
+    memmove(&chain->names[name_idx], &chain->names[name_idx + name_size], chain->names_used - name_idx - name_size);
+    chain->names_used -= name_size;
+
+    memmove(&chain->taps[index], &chain->taps[index + 1], (chain->count - index - 1) * sizeof(tap_t));
+    chain->count--;
+
+    for (uint32_t i = 0; i < chain->count; i++)
+    {
+        if (chain->taps[i].name_idx > name_idx)
+            chain->taps[i].name_idx -= name_size;
+    }
+
+    // an inactive device does not take part in the prefix sums,
+    // so only the selected index needs fixing
+    if (chain->selected != CHAIN_NONE_SELECTED)
+    {
+        if (chain->selected == index)
+            chain->selected = CHAIN_NONE_SELECTED;
+        else if (chain->selected > index)
+            chain->selected--;
+    }
 
     return OK;
 }
 
-status_t chain_tap_activate(tap_t* taps, const uint32_t index)
+status_t chain_tap_activate(chain_t* chain, const uint32_t index)
 {
-    if (index >= MAX_ALLOWED_TAPS)
+    tap_t* tap;
+
+    if (index >= chain->count)
         return -ERR_OUT_OF_BOUNDS;
-    
-    if (taps[index].active)
+
+    tap = &chain->taps[index];
+    if (tap->active)
         return -ERR_TAP_DEVICE_ALREADY_ACTIVE;
 
-    // make sure the activated device has IR length that
-    // does not exceeds the available maximum we set
-    uint32_t available_ir_len = MAX_IR_LEN - chain_ir_len;
-    if (taps[index].ir_len > available_ir_len)
-        return -ERR_RESOURCE_EXHAUSTED;
+    tap->active = true;
+    chain->ir_len += tap->ir_len;
+    chain->active++;
 
-    // if tap device is first in chain
-    if (index == 0) {
-        taps[index].ir_in_idx = 0;
-        taps[index].ir_out_idx = taps[index].ir_len - 1;
-    } else {
-        taps[index].ir_in_idx = taps[index - 1].ir_out_idx + 1;
-        taps[index].ir_out_idx = taps[index - 1].ir_out_idx + 1 + taps[index].ir_len - 1;
+    // every device after this one is shifted by this device's IR and bypass bit
+    for (uint32_t i = index + 1; i < chain->count; i++)
+    {
+        chain->taps[i].ir_in_idx += tap->ir_len;
+        chain->taps[i].dr_idx++;
     }
 
-    taps[index].active = true;
-    chain_ir_len += taps[index].ir_len;
-    chain_active_devices++;
+    chain_update_padding(chain);
 
     return OK;
 }
 
-status_t chain_tap_deactivate(tap_t* taps, const uint32_t index)
+status_t chain_tap_deactivate(chain_t* chain, const uint32_t index)
 {
-    if (index >= MAX_ALLOWED_TAPS)
+    tap_t* tap;
+
+    if (index >= chain->count)
         return -ERR_OUT_OF_BOUNDS;
 
-    // first or not last
-    // make sure the tap device after this device is not active
-    if ((index == 0) || (index == (MAX_ALLOWED_TAPS - 1)))
+    tap = &chain->taps[index];
+    if (!tap->active)
+        return -ERR_TAP_DEVICE_UNAVAILABLE;
+
+    tap->active = false;
+    chain->ir_len -= tap->ir_len;
+    chain->active--;
+
+    for (uint32_t i = index + 1; i < chain->count; i++)
     {
-        if (taps[index + 1].active) {
-            return -ERR_TAP_DEVICE_REMOVE_ISSUE;
-        }
+        chain->taps[i].ir_in_idx -= tap->ir_len;
+        chain->taps[i].dr_idx--;
     }
 
-    chain_ir_len -= taps[index].ir_len;
-    chain_active_devices--;
-    taps[index].active = false;
+    if (chain->selected == index)
+        chain->selected = CHAIN_NONE_SELECTED;
+
+    chain_update_padding(chain);
 
     return OK;
 }
 
-status_t chain_tap_selector(tap_t* taps, const uint32_t index, tap_t* out, uint8_t* ir_in, uint8_t* ir_out)
+status_t chain_tap_selector(chain_t* chain, const uint32_t index, tap_t** out)
 {
-    if (index >= MAX_ALLOWED_TAPS)
+    tap_t* tap;
+
+    if (index >= chain->count)
         return -ERR_OUT_OF_BOUNDS;
 
-    if (!taps[index].active)
+    tap = &chain->taps[index];
+    if (!tap->active)
         return -ERR_TAP_DEVICE_UNAVAILABLE;
 
-    // put all devices to bypass.
-    // bypass is standarized as the "ones" instruction
-    // i.e IR is filled with ones
-    for (uint32_t i = 0; i < chain_ir_len; i++)
-        ir_in[i] = 1;
-
-    Serial.print("\nchain_tap_selector putting all active devices to bypass");
-    insert_ir(ir_in, ir_out, chain_ir_len, RUN_TEST_IDLE);
-    out = &taps[index];
+    // all the other active devices are put in bypass by the driver's
+    // padding on every following IR scan. bypass is standarized
+    // as the "ones" instruction i.e IR is filled with ones
+    chain->selected = index;
+    chain_update_padding(chain);
+    *out = tap;
 
     Serial.print("\nSelected TAP device: "); Serial.print(index, DEC);
-    Serial.print(" idcode: "); Serial.print(out->idcode, HEX);
-    Serial.print(" ir len: "); Serial.println(out->ir_len, DEC);
+    Serial.print(" idcode: "); Serial.print(tap->idcode, HEX);
+    Serial.print(" ir len: "); Serial.println(tap->ir_len, DEC);
     Serial.flush();
 
     return OK;
 }
 
-void chain_print_taps(tap_t* taps)
+status_t chain_verify_idcodes(const chain_t* chain)
+{
+    uint32_t idcodes[MAX_ALLOWED_TAPS];
+    uint32_t n = 0;
+    status_t rc = OK;
+
+    if (chain->active == 0)
+        return -ERR_TAP_DEVICE_UNAVAILABLE;
+
+    rc = read_idcodes(idcodes, chain->active);
+    if (rc != OK)
+    {
+        Serial.println("\nchain: found more devices than expected");
+        return rc;
+    }
+
+    for (uint32_t i = 0; i < chain->count; i++)
+    {
+        const tap_t* tap = &chain->taps[i];
+        if (!tap->active)
+            continue;
+
+        if ((idcodes[n] ^ tap->idcode) & CHAIN_IDCODE_MASK)
+        {
+            Serial.print("\nchain: device "); Serial.print(i, DEC);
+            Serial.print(" expected idcode 0x"); Serial.print(tap->idcode, HEX);
+            Serial.print(" found 0x"); Serial.println(idcodes[n], HEX);
+            return -ERR_BAD_IDCODE;
+        }
+        n++;
+    }
+
+    return OK;
+}
+
+void chain_print_taps(chain_t* chain)
 {
-    Serial.print("\nTotal active devices: "); Serial.print(chain_active_devices, DEC);
-    Serial.print("\nTotal IR length: "); Serial.print(chain_ir_len, DEC);
+    tap_t* tap;
+
+    Serial.print("\nTotal devices: "); Serial.print(chain->count, DEC);
+    Serial.print("\nTotal active devices: "); Serial.print(chain->active, DEC);
+    Serial.print("\nTotal IR length: "); Serial.print(chain->ir_len, DEC);
     Serial.flush();
 
-    for (uint32_t i = 0; i < chain_added_devices; i++)
+    for (uint32_t i = 0; i < chain->count; i++)
     {
+        tap = &chain->taps[i];
+
         Serial.print("\nChain index "); Serial.print(i, DEC);
-        if (taps[i].active)
+        if (tap->active)
             Serial.print(" [Active]");
         else
             Serial.print(" [Not Active]");
-
-        Serial.print("\nname: "); Serial.println(taps[i].name);
-        Serial.print("idcode: 0x"); Serial.print(taps[i].idcode, HEX);
-        Serial.print(" ir Length: "); Serial.println(taps[i].ir_len, DEC);
-        Serial.print("ir in index: "); Serial.println(taps[i].ir_in_idx, DEC);
-        Serial.print("ir out index: "); Serial.println(taps[i].ir_out_idx, DEC);
+        if (chain->selected == i)
+            Serial.print(" [Selected]");
+
+        Serial.print("\nname: "); Serial.println(chain_tap_name(chain, tap));
+        Serial.print("idcode: 0x"); Serial.print(tap->idcode, HEX);
+        Serial.print(" ir Length: "); Serial.println(tap->ir_len, DEC);
+        Serial.print("ir in index: "); Serial.println(tap->ir_in_idx, DEC);
+        Serial.print("ir out index: "); Serial.println(tap->ir_in_idx + tap->ir_len - 1, DEC);
+        Serial.print("dr index: "); Serial.println(tap->dr_idx, DEC);
         Serial.flush();
     }
 }
@@ -9,45 +9,106 @@
  *  The total number of exisitng TAPs/Devices in the system that
  *  can be registered.
  */
-#define MAX_ALLOWED_TAPS 16
+#define MAX_ALLOWED_TAPS 64
 
+/**
+ * Size in bytes of the pool that stores the null terminated
+ * names of all registered TAP devices.
+ */
+#define CHAIN_NAMES_POOL_SIZE 768
+
+/**
+ * Maximum length of a single TAP device name (without the null terminator).
+ */
+#define CHAIN_MAX_NAME_LEN 31
+
+/**
+ * Index value of chain_t.selected when no TAP device is selected.
+ */
+#define CHAIN_NONE_SELECTED 0xff
+
+/**
+ * IDCODE bits compared when verifying a chain. The version field [31:28]
+ * is ignored, so boards with other silicon revisions of the same parts match.
+ */
+#define CHAIN_IDCODE_MASK 0x0fffffff
+
+/**
+ * A single TAP device entry in the chain table.
+ *
+ * ir_in_idx and dr_idx are prefix sums over the active TAP devices
+ * that come before this one (closer to JTDO). They are maintained
+ * incrementally on every add/remove/activate/deactivate, so locating
+ * a device inside the chain IR / DR is always a constant time lookup.
+ */
 typedef struct
 {
-    char name[32]; // must be null terminated
     uint32_t idcode;
-    uint32_t ir_len;
-    uint32_t ir_in_idx;
-    uint32_t ir_out_idx;
+    uint16_t name_idx;  // offset of the null terminated name in the names pool
+    uint16_t ir_in_idx; // sum of IR lengths of the active devices before this one
+    uint8_t ir_len;
+    uint8_t dr_idx;     // number of active devices (bypass bits) before this one
     bool active;
-}__attribute__((packed)) tap_t;
+} tap_t;
+
+/**
+ * The chain table. Index 0 is the TAP device closest to JTDO.
+ * Devices are stored in chain order, names are kept in a separate pool.
+ */
+typedef struct
+{
+    tap_t taps[MAX_ALLOWED_TAPS];
+    char names[CHAIN_NAMES_POOL_SIZE];
+    uint16_t names_used;
+    uint16_t ir_len;    // total IR length of all active devices
+    uint8_t count;      // number of registered devices
+    uint8_t active;     // number of active devices
+    uint8_t selected;   // index of the selected device or CHAIN_NONE_SELECTED
+} chain_t;
 
-uint32_t chain_get_active_devices();
+uint32_t chain_get_active_devices(const chain_t* chain);
 
-uint32_t chain_get_total_ir_len();
+uint32_t chain_get_total_ir_len(const chain_t* chain);
 
 /**
- * Initialize the TAPs array of tap_t structs.
+ * @brief Get a TAP device entry from the chain table.
+ * @return Pointer to the entry, or nullptr if index is out of bounds.
  */
-void chain_taps_init(tap_t* taps);
+tap_t* chain_get_tap(chain_t* chain, const uint32_t index);
 
 /**
- * @brief Add a new TAP device.
- * You can only add a new one after an existing active TAP,
- * or if its the first TAP device.
+ * @brief Get the name of a TAP device from the names pool.
  */
-status_t chain_tap_add(tap_t* taps, const uint32_t index, const char* name, const uint32_t idcode, const uint32_t ir_len);
+const char* chain_tap_name(const chain_t* chain, const tap_t* tap);
 
-status_t chain_tap_remove(tap_t* taps, const uint32_t index);
+/**
+ * Initialize the chain table to an empty chain.
+ */
+void chain_taps_init(chain_t* chain);
 
 /**
- * The function activates an appended new TAP device
- * and assigns the appropriate ir in/out indexes in the global
- * IR array according to the previous active TAP devices.
- * 
+ * @brief Insert a new (inactive) TAP device at any position of the chain.
+ * Devices at index and above move one position towards JTDI.
+ * @param index Position in chain, 0 is the device closest to JTDO.
+ * Must be in the range [0, number of registered devices].
+ */
+status_t chain_tap_add(chain_t* chain, const uint32_t index, const char* name, const uint32_t idcode, const uint32_t ir_len);
+
+/**
+ * @brief Remove an inactive TAP device from any position of the chain.
+ * Devices above index move one position towards JTDO.
+ */
+status_t chain_tap_remove(chain_t* chain, const uint32_t index);
+
+/**
+ * The function activates a TAP device at any position of the chain
+ * and updates the ir in/out indexes in the global IR array of all
+ * the active TAP devices that come after it.
+ *
  *         Global IR register
- * 
+ *
  * example: array/register of 12 bits
- * 
+ *
  *    MSB                                LSB
  *    11 10  9  8  7   6  5  4  3    2  1  0
  *    |_||_||_||_||_| |_||_||_||_|  |_||_||_|
@@ -55,29 +116,31 @@ status_t chain_tap_remove(tap_t* taps, const uint32_t index);
  *     out        in   out     in    out  in
  *     { dev 2     }   { dev 1  }    { dev 0 }
  *     { len 5     }   { len 4  }    { len 3 }
- * 
+ *
  * When activating a tap device, we assign its "in" entrance index
  * into the global IR, as well as the "out" output point from the IR.
  * Knowing the entrance index allows us to prepare the appropriate
  * payload to insert into the global IR by taking into consideration
  * the offset relative to the first bit (MSB  bit 0).
- * 
+ *
  * Explanation according to the above example:
  *  device 0: in = 0, out = 2
  *  device 1: in = 3, out = 6
  *  device 2: in = 7, out = 11
- * 
+ *
+ * The same is done for the DR, where every active device that is not
+ * selected adds a single bypass bit.
  */
-status_t chain_tap_activate(tap_t* taps, const uint32_t index);
+status_t chain_tap_activate(chain_t* chain, const uint32_t index);
 
 /**
- * Deactivate the selected TAP device.
+ * Deactivate the selected TAP device, at any position of the chain.
  */
-status_t chain_tap_deactivate(tap_t* taps, const uint32_t index);
+status_t chain_tap_deactivate(chain_t* chain, const uint32_t index);
 
 /**
  * Example of a system/board where 2 TAPs exist in a single SOC:
- * 
+ *
  * The STM32F4xx MCUs integrate two serially connected JTAG TAPs, the boundary scan
  * TAP (IR is 5-bit wide) and the Cortex®-M4 with FPU TAP (IR is 4-bit wide).
  * To access the TAP of the Cortex®-M4 with FPU for debug purposes:
@@ -86,20 +149,31 @@ status_t chain_tap_deactivate(tap_t* taps, const uint32_t index);
  * instruction must be shifted in using the BYPASS instruction.
  * 3. For each data shift, the unused TAP, which is in BYPASS mode, adds 1 extra data bit in
  * the data scan chain.
- * 
+ *
  *           ____________       ____________
  * JTDI --> |tdi      tdo|---->|tdi      tdo|--> JTDO
  *          |            |     |            |
  *          |boundry scan|     |cortex-m4   |
  *          | tap  5-bit |     | tap  4-bit |
  *          |____________|     |____________|
- * 
+ *
+ * Selecting a device programs the driver's IR/DR padding from the
+ * device's prefix sums, so every following insert_ir / insert_dr
+ * targets the selected device only and puts the rest in bypass.
+ * @param out Will point to the selected TAP device entry.
+ */
+status_t chain_tap_selector(chain_t* chain, const uint32_t index, tap_t** out);
+
+/**
+ * @brief Check that the physical chain holds the active devices of the
+ * chain table, in the same order, with a single IDCODE scan.
+ * @return OK if every active device matches its IDCODE.
  */
-status_t chain_tap_selector(tap_t* taps, const uint32_t index, tap_t* out, uint8_t* ir_in, uint8_t* ir_out);
+status_t chain_verify_idcodes(const chain_t* chain);
 
 /**
- * Print all active TAP devices in TAPs chain array.
+ * Print all TAP devices in the chain table.
  */
-void chain_print_taps(tap_t* taps);
+void chain_print_taps(chain_t* chain);
 
-#endif /* __CHAIN_H__ */
\ No newline at end of file
+#endif /* __CHAIN_H__ */
@@ -0,0 +1,151 @@
+#include <Arduino.h>
+
+#include "cjtag.h"
+#include "../jtag_drv/jtag_drv.h"
+
+bool cjtag_active = false;
+uint8_t cjtag_tdo = 1;
+
+// four wire levels of the driver, sent with the next cycle
+static uint8_t cjtag_tms = 1;
+static uint8_t cjtag_tdi = 1;
+static uint8_t cjtag_tck = 0;
+
+static uint8_t tmsc_level = 1;      // level driven on TMSC
+static bool tmsc_released = false;  // the target drives TMSC
+
+/**
+ * @brief Take TMSC back after the TDO slot, once TCKC is low.
+ */
+static inline void cjtag_drive()
+{
+    if (tmsc_released)
+    {
+        PIN_MODE(TMSC, OUTPUT);
+        tmsc_released = false;
+    }
+}
+
+/**
+ * @brief A TCKC cycle with the driver on TMSC. TMSC only changes while
+ * TCKC is low, or it would be taken as an escape.
+ */
+static inline void cjtag_slot(uint8_t tmsc)
+{
+    PIN_WRITE(TCKC, 0);
+    cjtag_drive();
+    if (tmsc != tmsc_level)
+    {
+        PIN_WRITE(TMSC, tmsc);
+        tmsc_level = tmsc;
+    }
+    HC;
+    PIN_WRITE(TCKC, 1); HC;
+}
+
+/**
+ * @brief A TCK of the TAP: the nTDI, TMS and TDO slots.
+ */
+static void cjtag_cycle()
+{
+    cjtag_slot(!cjtag_tdi);
+    cjtag_slot(cjtag_tms);
+
+    // the target drives TDO while TCKC is low, and keeps it until the next falling edge
+    PIN_WRITE(TCKC, 0);
+    PIN_MODE(TMSC, INPUT_PULLUP);
+    tmsc_released = true;
+    HC;
+    PIN_WRITE(TCKC, 1);
+    cjtag_tdo = PIN_READ(TMSC);
+    HC;
+}
+
+/**
+ * @brief Toggle TMSC edges times during a TCKC high period.
+ * An even number of edges leaves TMSC where it was.
+ */
+static void cjtag_escape(uint8_t edges)
+{
+    PIN_WRITE(TCKC, 0);
+    cjtag_drive();
+    HC;
+    PIN_WRITE(TCKC, 1); HC;
+
+    for (uint8_t i = 0; i < edges; i++)
+    {
+        tmsc_level ^= 1;
+        PIN_WRITE(TMSC, tmsc_level); HC;
+    }
+
+    PIN_WRITE(TCKC, 0); HC;
+}
+
+void cjtag_write(uint8_t pin, uint8_t val)
+{
+    switch (pin)
+    {
+    case TMS:
+        cjtag_tms = val ? 1 : 0;
+        break;
+
+    case TDI:
+        cjtag_tdi = val ? 1 : 0;
+        break;
+
+    case TCK:
+        // the TAP samples TMS and TDI on the rising edge
+        if (val && !cjtag_tck)
+            cjtag_cycle();
+        cjtag_tck = val ? 1 : 0;
+        break;
+
+    default:
+        break;
+    }
+}
+
+status_t cjtag_activate()
+{
+    uint32_t packets = CJTAG_OAC | (CJTAG_EC << 4) | (CJTAG_CP << 8);
+    uint32_t idcode = 0;
+    status_t rc;
+
+    cjtag_active = false;
+    cjtag_tck = 0;
+    PIN_WRITE(TCKC, 0);
+    cjtag_drive();
+    PIN_WRITE(TMSC, 1);
+    tmsc_level = 1;
+
+    cjtag_escape(CJTAG_RESET_EDGES);
+    cjtag_escape(CJTAG_SELECT_EDGES);
+    for (uint8_t i = 0; i < 12; i++)
+        cjtag_slot((packets >> i) & 1);
+
+    // from here on the JTAG driver runs in OScan1
+    cjtag_active = true;
+    rc = read_idcodes(&idcode, 1);
+
+    // TDO held high by the pull up, or low, when nothing answers
+    if ((rc != OK && rc != -ERR_OUT_OF_BOUNDS) || !(idcode & 1) || idcode == 0xffffffff)
+    {
+        cjtag_active = false;
+        Serial.println("\nNo TAP answered in OScan1");
+        return -ERR_TAP_DEVICE_UNAVAILABLE;
+    }
+
+    Serial.print("\ncJTAG OScan1 online, IDCODE: 0x"); Serial.println(idcode, HEX);
+    return OK;
+}
+
+void cjtag_deactivate()
+{
+    if (!cjtag_active)
+        return;
+
+    reset_tap();
+    cjtag_active = false;
+    cjtag_escape(CJTAG_DESELECT_EDGES);
+    ir_shadow_invalidate();
+}
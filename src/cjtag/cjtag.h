@@ -0,0 +1,81 @@
+/** @file cjtag.h
+ *
+ * @brief IEEE 1149.7 (cJTAG) two wire mode on the JTAG pins: TCKC on TCK and
+ * TMSC on TMS, as SWD uses them. While it is active, the four wire signals of
+ * the JTAG driver go through the OScan1 encoder instead of the pins, so
+ * insert_ir(), insert_dr(), advance_tap_state() and everything built on them
+ * run unchanged.
+ *
+ * Every TCK of the driver is sent as three TCKC cycles (slots) on TMSC:
+ *
+ *   nTDI (driver), TMS (driver), TDO (target)
+ *
+ * and the TAP advances after the TDO slot. The slots are clocked when the
+ * driver raises TCK, with the TMS and TDI levels it set before, and the
+ * half-clock delays of the driver are replaced by those of the slots:
+ * a bit costs 3 TCKC cycles, nothing more.
+ *
+ * Escapes are TMSC edges while TCKC is high: 4-5 deselect the TAP.7
+ * controller, 6-7 select it and 8 or more reset it. The controller is put
+ * online with a reset and a selection escape, followed by the activation
+ * packets OAC, EC and CP (4 bits each, LSB first).
+ */
+#ifndef __CJTAG__H__
+#define __CJTAG__H__
+
+#include <stdint.h>
+
+#include "../../include/main.h"
+#include "../../include/status.h"
+
+#define TCKC TCK
+#define TMSC TMS
+
+/**
+ * TMSC edges of the escapes.
+ */
+#define CJTAG_DESELECT_EDGES 4
+#define CJTAG_SELECT_EDGES   6
+#define CJTAG_RESET_EDGES    10
+
+/**
+ * Online activation packets, OScan1 with the TAP.7 controller in front of a
+ * four wire TAP (T4 to T0).
+ */
+#define CJTAG_OAC 0xc
+#define CJTAG_EC  0x8
+#define CJTAG_CP  0x0
+
+// true while the JTAG driver goes through OScan1
+extern bool cjtag_active;
+// TDO of the last OScan1 cycle
+extern uint8_t cjtag_tdo;
+
+/**
+ * @brief A four wire signal of the JTAG driver in OScan1: TMS and TDI are
+ * kept for the next cycle, and a rising TCK sends the cycle.
+ */
+void cjtag_write(uint8_t pin, uint8_t val);
+
+/**
+ * Four wire signals of the JTAG driver: straight to the pins, or through the
+ * OScan1 encoder while cJTAG is active.
+ */
+#define TAP_WRITE(pin, val) do { if (cjtag_active) cjtag_write(pin, val); else PIN_WRITE(pin, val); } while (0)
+#define TAP_READ(pin) (cjtag_active ? cjtag_tdo : PIN_READ(pin))
+#define TAP_HC do { if (!cjtag_active) { HC } } while (0)
+
+/**
+ * @brief Put the TAP.7 controller online in OScan1, and switch the JTAG
+ * driver to it. The TAP is reset, and an IDCODE is read to check the link.
+ * @return OK, or -ERR_TAP_DEVICE_UNAVAILABLE if no TAP answers.
+ */
+status_t cjtag_activate();
+
+/**
+ * @brief Take the TAP.7 controller offline with a deselection escape, and
+ * switch the JTAG driver back to the four wire pins.
+ */
+void cjtag_deactivate();
+
+#endif
@@ -0,0 +1,126 @@
+#include <Arduino.h>
+#include <string.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define flash_read(dst, src, len) memcpy_P(dst, src, len)
+#define flash_strncpy(dst, src, len) strncpy_P(dst, src, len)
+#else
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#define flash_read(dst, src, len) memcpy(dst, src, len)
+#define flash_strncpy(dst, src, len) strncpy(dst, src, len)
+#endif
+
+#include "idcode.h"
+
+typedef struct
+{
+    uint32_t idcode;    // masked IDCODE, 0 for an empty slot
+    uint16_t name;      // offset of the part name in idcode_names
+    uint8_t ir_len;
+} idcode_entry_t;
+
+typedef struct
+{
+    uint16_t code;      // JEP106 manufacturer ID, IDCODE bits [11:1]
+    uint16_t name;      // offset of the name in idcode_names
+} idcode_mfg_t;
+
+#include "idcode_table.h"
+
+/**
+ * @brief The hash of idcode_db.py.
+ */
+static inline uint32_t idcode_hash(uint32_t key, uint32_t seed)
+{
+    uint32_t h = (key ^ seed) * 0x9e3779b1;
+
+    return h ^ (h >> 16);
+}
+
+/**
+ * @brief Copy a name of the table into a buffer of IDCODE_NAME_LEN bytes.
+ */
+static void idcode_copy_name(char* dst, uint16_t offset)
+{
+    flash_strncpy(dst, &idcode_names[offset], IDCODE_NAME_LEN - 1);
+    dst[IDCODE_NAME_LEN - 1] = '\0';
+}
+
+/**
+ * @brief Binary search of the manufacturer table.
+ * @return The index of the manufacturer, or -1 if unknown.
+ */
+static int idcode_find_mfg(uint16_t code)
+{
+    int low = 0, high = IDCODE_MFGS - 1, mid;
+    idcode_mfg_t mfg;
+
+    while (low <= high)
+    {
+        mid = (low + high) / 2;
+        flash_read(&mfg, &idcode_mfgs[mid], sizeof(mfg));
+        if (mfg.code == code)
+            return mid;
+        if (mfg.code < code)
+            low = mid + 1;
+        else
+            high = mid - 1;
+    }
+
+    return -1;
+}
+
+status_t idcode_lookup(uint32_t idcode, idcode_info_t* info)
+{
+    uint32_t key = idcode & IDCODE_PART_MASK;
+    uint16_t seed;
+    idcode_entry_t entry;
+    idcode_mfg_t mfg;
+    int i;
+
+    info->manufacturer[0] = '\0';
+    info->part[0] = '\0';
+    info->ir_len = 0;
+
+    if (!(idcode & 1))
+        return -ERR_BAD_IDCODE;
+
+    i = idcode_find_mfg((idcode >> 1) & 0x7ff);
+    if (i >= 0)
+    {
+        flash_read(&mfg, &idcode_mfgs[i], sizeof(mfg));
+        idcode_copy_name(info->manufacturer, mfg.name);
+    }
+
+    // the bucket's seed places every IDCODE of the table in a slot of its own
+    flash_read(&seed, &idcode_seeds[idcode_hash(key, 0) & (IDCODE_BUCKETS - 1)], sizeof(seed));
+    flash_read(&entry, &idcode_entries[idcode_hash(key, seed) & (IDCODE_SLOTS - 1)], sizeof(entry));
+    if (entry.idcode != key)
+        return -ERR_NOT_FOUND;
+
+    idcode_copy_name(info->part, entry.name);
+    info->ir_len = entry.ir_len;
+
+    return OK;
+}
+
+void idcode_print(uint32_t idcode)
+{
+    idcode_info_t info;
+    status_t rc = idcode_lookup(idcode, &info);
+
+    Serial.print("Manufacturer: ");
+    Serial.println(info.manufacturer[0] ? info.manufacturer : "unknown");
+    if (rc == OK)
+    {
+        Serial.print("Part: "); Serial.print(info.part);
+        Serial.print(", IR length: "); Serial.println(info.ir_len, DEC);
+    }
+    else
+    {
+        Serial.println("Part: unknown");
+    }
+}
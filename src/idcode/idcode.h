@@ -0,0 +1,49 @@
+/** @file idcode.h
+ *
+ * @brief Database of known JTAG devices: the manufacturer, the part name and
+ * the IR length of a device by its IDCODE, so a recognized device needs no
+ * IR length probing.
+ *
+ * The table is generated by idcode_db.py from idcodes.txt into a perfect
+ * hash table kept in flash (idcode_table.h). A lookup takes two hashes and
+ * a single compare, whatever the size of the table. To add a device, add
+ * its line to idcodes.txt and run idcode_db.py.
+ */
+#ifndef __IDCODE__H__
+#define __IDCODE__H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+
+/**
+ * IDCODE bits that identify a part number, the version field [31:28] is ignored.
+ */
+#define IDCODE_PART_MASK 0x0fffffff
+
+/**
+ * Size of the name buffers of idcode_info_t, with the null terminator.
+ */
+#define IDCODE_NAME_LEN 32
+
+typedef struct
+{
+    char manufacturer[IDCODE_NAME_LEN]; // empty if unknown
+    char part[IDCODE_NAME_LEN];         // empty if unknown
+    uint8_t ir_len;                     // 0 if unknown
+} idcode_info_t;
+
+/**
+ * @brief Look up a device by its IDCODE. The manufacturer is filled in
+ * from the IDCODE's manufacturer field even if the part is unknown.
+ * @return OK if the part is known, -ERR_NOT_FOUND if not,
+ * -ERR_BAD_IDCODE if the LSB of the IDCODE is 0.
+ */
+status_t idcode_lookup(uint32_t idcode, idcode_info_t* info);
+
+/**
+ * @brief Print the manufacturer and the part of a device, as far as known.
+ */
+void idcode_print(uint32_t idcode);
+
+#endif
@@ -0,0 +1,173 @@
+/** @file idcode_table.h
+ *
+ * @brief Generated by idcode_db.py from idcodes.txt, do not edit.
+ * Included by idcode.cpp only.
+ */
+#ifndef __IDCODE_TABLE__H__
+#define __IDCODE_TABLE__H__
+
+#define IDCODE_PARTS   52
+#define IDCODE_BUCKETS 16
+#define IDCODE_SLOTS   64
+#define IDCODE_MFGS    14
+
+static const uint16_t idcode_seeds[IDCODE_BUCKETS] PROGMEM = {
+    12,     2,     3,    60,    30,     1,    96,     3,
+    9,    43,     1,    13,     4,     9,    14,     2,
+};
+
+static const idcode_entry_t idcode_entries[IDCODE_SLOTS] PROGMEM = {
+    { 0x04001093,   323,  6 },  // XC6SLX9
+    { 0x0318d0dd,   267, 10 },  // 10M40
+    { 0x09608093,   518,  8 },  // XC95144XL
+    { 0x031810dd,   231, 10 },  // 10M02
+    { 0x0000563d,    11,  5 },  // GD32VF103
+    { 0x020f20dd,   144, 10 },  // EP4CE15
+    { 0x06411041,   383,  5 },  // STM32F2xx
+    { 0x04004093,   340,  6 },  // XC6SLX25
+    { 0x06414041,   429,  5 },  // STM32F10x high density
+    { 0x020034e5,    93,  5 },  // ESP32
+    { 0x00000000,     0,  0 },
+    { 0x00000000,     0,  0 },
+    { 0x0362d093,   281,  6 },  // XC7A35T
+    { 0x00000000,     0,  0 },
+    { 0x031820dd,   237, 10 },  // 10M08
+    { 0x020a40dd,   121, 10 },  // EPM2210
+    { 0x06419041,   480,  5 },  // STM32F42x/43x
+    { 0x00000000,     0,  0 },
+    { 0x0100481b,    28,  8 },  // GW1N-9
+    { 0x03722093,   307,  6 },  // XC7Z010
+    { 0x02b150dd,   201, 10 },  // 5CEBA2/5CEBA4
+    { 0x020a10dd,    99, 10 },  // EPM240
+    { 0x03727093,   315,  6 },  // XC7Z020
+    { 0x06e5e093,   494,  8 },  // XC2C64A
+    { 0x020f40dd,   160, 10 },  // EP4CE30/EP4CE40
+    { 0x020f70dd,   192, 10 },  // EP4CE115
+    { 0x00000000,     0,  0 },
+    { 0x00000000,     0,  0 },
+    { 0x06410041,   358,  5 },  // STM32F10x medium density
+    { 0x0ba00477,   528,  4 },  // CoreSight JTAG-DP
+    { 0x00000000,     0,  0 },
+    { 0x02d020dd,   215, 10 },  // 5CSEBA6/5CSEMA5
+    { 0x0900281b,   502,  8 },  // GW1N-1
+    { 0x00000000,     0,  0 },
+    { 0x04008093,   349,  6 },  // XC6SLX45
+    { 0x00000000,     0,  0 },
+    { 0x012b5043,    65,  8 },  // LCMXO2-7000HC
+    { 0x0100381b,    21,  8 },  // GW1N-4
+    { 0x020f60dd,   184, 10 },  // EP4CE75
+    { 0x09604093,   509,  8 },  // XC9572XL
+    { 0x020a30dd,   113, 10 },  // EPM1270
+    { 0x020f30dd,   152, 10 },  // EP4CE22
+    { 0x01112043,    45,  8 },  // LFE5U-45F
+    { 0x0362c093,   273,  6 },  // XC7A50T
+    { 0x031840dd,   249, 10 },  // 10M25
+    { 0x020f10dd,   129, 10 },  // EP4CE6/EP4CE10
+    { 0x01111043,    35,  8 },  // LFE5U-25F
+    { 0x06412041,   393,  5 },  // STM32F10x low density
+    { 0x06413041,   415,  5 },  // STM32F40x/41x
+    { 0x00000913,     0,  5 },  // SiFive E31
+    { 0x031830dd,   243, 10 },  // 10M16
+    { 0x00000000,     0,  0 },
+    { 0x01113043,    55,  8 },  // LFE5U-85F
+    { 0x03631093,   289,  6 },  // XC7A100T
+    { 0x00000000,     0,  0 },
+    { 0x06418041,   452,  5 },  // STM32F10x connectivity line
+    { 0x012ba043,    79,  8 },  // LCMXO2-1200HC
+    { 0x020a20dd,   106, 10 },  // EPM570
+    { 0x04002093,   331,  6 },  // XC6SLX16
+    { 0x031850dd,   255, 10 },  // 10M50
+    { 0x0318a0dd,   261, 10 },  // 10M04
+    { 0x00000000,     0,  0 },
+    { 0x03636093,   298,  6 },  // XC7A200T
+    { 0x020f50dd,   176, 10 },  // EP4CE55
+};
+
+// sorted by code
+static const idcode_mfg_t idcode_mfgs[IDCODE_MFGS] PROGMEM = {
+    { 0x00e,   546 },  // Freescale
+    { 0x015,   556 },  // NXP
+    { 0x017,   560 },  // Texas Instruments
+    { 0x01f,   578 },  // Atmel
+    { 0x020,   584 },  // STMicroelectronics
+    { 0x021,   603 },  // Lattice
+    { 0x029,   611 },  // Microchip
+    { 0x049,   621 },  // Xilinx
+    { 0x06e,   628 },  // Altera
+    { 0x23b,   635 },  // ARM
+    { 0x272,   639 },  // Tensilica
+    { 0x31e,   649 },  // GigaDevice
+    { 0x40d,   660 },  // Gowin
+    { 0x489,   666 },  // SiFive
+};
+
+static const char idcode_names[] PROGMEM =
+    "SiFive E31\0"
+    "GD32VF103\0"
+    "GW1N-4\0"
+    "GW1N-9\0"
+    "LFE5U-25F\0"
+    "LFE5U-45F\0"
+    "LFE5U-85F\0"
+    "LCMXO2-7000HC\0"
+    "LCMXO2-1200HC\0"
+    "ESP32\0"
+    "EPM240\0"
+    "EPM570\0"
+    "EPM1270\0"
+    "EPM2210\0"
+    "EP4CE6/EP4CE10\0"
+    "EP4CE15\0"
+    "EP4CE22\0"
+    "EP4CE30/EP4CE40\0"
+    "EP4CE55\0"
+    "EP4CE75\0"
+    "EP4CE115\0"
+    "5CEBA2/5CEBA4\0"
+    "5CSEBA6/5CSEMA5\0"
+    "10M02\0"
+    "10M08\0"
+    "10M16\0"
+    "10M25\0"
+    "10M50\0"
+    "10M04\0"
+    "10M40\0"
+    "XC7A50T\0"
+    "XC7A35T\0"
+    "XC7A100T\0"
+    "XC7A200T\0"
+    "XC7Z010\0"
+    "XC7Z020\0"
+    "XC6SLX9\0"
+    "XC6SLX16\0"
+    "XC6SLX25\0"
+    "XC6SLX45\0"
+    "STM32F10x medium density\0"
+    "STM32F2xx\0"
+    "STM32F10x low density\0"
+    "STM32F40x/41x\0"
+    "STM32F10x high density\0"
+    "STM32F10x connectivity line\0"
+    "STM32F42x/43x\0"
+    "XC2C64A\0"
+    "GW1N-1\0"
+    "XC9572XL\0"
+    "XC95144XL\0"
+    "CoreSight JTAG-DP\0"
+    "Freescale\0"
+    "NXP\0"
+    "Texas Instruments\0"
+    "Atmel\0"
+    "STMicroelectronics\0"
+    "Lattice\0"
+    "Microchip\0"
+    "Xilinx\0"
+    "Altera\0"
+    "ARM\0"
+    "Tensilica\0"
+    "GigaDevice\0"
+    "Gowin\0"
+    "SiFive\0"
+    ;
+
+#endif
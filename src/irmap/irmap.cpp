@@ -0,0 +1,152 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "irmap.h"
+#include "../profile/profile.h"
+#include "../../include/utils.h"
+
+// entries sorted by ir, for a binary search lookup
+static irmap_entry_t irmap[IRMAP_MAX_ENTRIES];
+static uint32_t irmap_used = 0;
+static uint32_t irmap_idcode = 0;
+
+/**
+ * @brief Binary search for an instruction.
+ * @return Index of the entry, or the index to insert it at if not found.
+ */
+static uint32_t irmap_find(uint32_t ir)
+{
+    uint32_t lo = 0, hi = irmap_used;
+
+    while (lo < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (irmap[mid].ir < ir)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+void irmap_select(uint32_t idcode)
+{
+    const profile_t* profile = profile_find(idcode);
+
+    idcode &= IRMAP_IDCODE_MASK;
+    if (idcode == irmap_idcode)
+        return;
+
+    irmap_idcode = idcode;
+    irmap_used = 0;
+
+    // the documented instructions of a known family, the host adds what was measured
+    if (profile != nullptr)
+        profile_seed_irmap(profile);
+
+    irmap_load_from_host();
+}
+
+uint32_t irmap_count() { return irmap_used; }
+
+uint32_t irmap_part() { return irmap_idcode; }
+
+const irmap_entry_t* irmap_entries() { return irmap; }
+
+void irmap_assign(uint32_t idcode)
+{
+    irmap_idcode = idcode & IRMAP_IDCODE_MASK;
+    irmap_used = 0;
+}
+
+const irmap_entry_t* irmap_get(uint32_t ir)
+{
+    uint32_t i = irmap_find(ir);
+
+    if (i < irmap_used && irmap[i].ir == ir)
+        return &irmap[i];
+
+    return nullptr;
+}
+
+status_t irmap_put(uint32_t ir, uint32_t dr_len, uint32_t capture)
+{
+    uint32_t i = irmap_find(ir);
+
+    if (dr_len == 0 || dr_len > 0xffff)
+        return -ERR_INVALID_IR_OR_DR_LEN;
+
+    if (i >= irmap_used || irmap[i].ir != ir)
+    {
+        if (irmap_used >= IRMAP_MAX_ENTRIES)
+            return -ERR_RESOURCE_EXHAUSTED;
+
+        memmove(&irmap[i + 1], &irmap[i], (irmap_used - i) * sizeof(irmap_entry_t));
+        irmap_used++;
+    }
+
+    irmap[i].ir = ir;
+    irmap[i].dr_len = dr_len;
+    irmap[i].capture = capture;
+
+    return OK;
+}
+
+void irmap_report(const irmap_entry_t* entry)
+{
+    Serial.print("\n@irmap 0x"); Serial.print(irmap_idcode, HEX);
+    Serial.print(" 0x"); Serial.print(entry->ir, HEX);
+    Serial.print(" "); Serial.print(entry->dr_len, DEC);
+    Serial.print(" 0x"); Serial.print(entry->capture, HEX);
+    Serial.flush();
+}
+
+status_t irmap_load_from_host()
+{
+    char token[32];
+    uint32_t len = 0;
+    uint32_t loaded = 0;
+    char c = '\0';
+    char* field;
+    status_t rc = OK;
+
+    Serial.print("\n@irmap? 0x"); Serial.print(irmap_idcode, HEX);
+    notify_input_and_busy_wait_for_serial_input(" > ");
+
+    // parse "ir:len:capture" tokens as they arrive, the line may be long
+    while (true)
+    {
+        if (Serial.readBytes(&c, 1) != 1)
+            c = '\n'; // timeout, take what we have
+
+        if (c != ',' && c != '\n' && c != '\r')
+        {
+            if (len < sizeof(token) - 1)
+                token[len++] = c;
+            continue;
+        }
+
+        token[len] = '\0';
+        if (len > 0)
+        {
+            uint32_t ir = strtoul(token, &field, 16);
+            uint32_t dr_len = (*field == ':') ? strtoul(field + 1, &field, 16) : 0;
+            uint32_t capture = (*field == ':') ? strtoul(field + 1, &field, 16) : 0;
+
+            rc = irmap_put(ir, dr_len, capture);
+            if (rc == OK)
+                loaded++;
+        }
+        len = 0;
+
+        if (c == '\n')
+            break;
+    }
+
+    Serial.print("\nInstruction map: "); Serial.print(loaded, DEC);
+    Serial.print(" known instructions for part 0x"); Serial.println(irmap_idcode, HEX);
+    Serial.flush();
+
+    return rc;
+}
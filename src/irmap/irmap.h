@@ -0,0 +1,89 @@
+/** @file irmap.h
+ *
+ * @brief Instruction map of the selected part: the known DR length and
+ * capture value of each instruction, so scans can be sized without probing.
+ *
+ * The map is kept per part number and backed by the host tool's persistent
+ * instruction database, which is exchanged over the serial port:
+ *
+ *   device -> host:  "@irmap? 0x<idcode> >"          request the known entries
+ *   host -> device:  "<ir>:<dr len>:<capture>,...\n" hexadecimal, empty line if none
+ *   device -> host:  "@irmap 0x<idcode> 0x<ir> <dr len> 0x<capture>"  a new entry
+ */
+#ifndef __IRMAP__H__
+#define __IRMAP__H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+
+/**
+ * Maximum number of instructions kept in the map, enough for a 10 bit IR.
+ * Every entry takes 12 bytes of SRAM, lower it on boards with little SRAM.
+ */
+#define IRMAP_MAX_ENTRIES 1024
+
+/**
+ * IDCODE bits that identify a part number. The version field [31:28] is
+ * ignored, so all the boards and revisions of a part share the same map.
+ */
+#define IRMAP_IDCODE_MASK 0x0fffffff
+
+typedef struct
+{
+    uint32_t ir;
+    uint32_t capture;
+    uint16_t dr_len;
+} irmap_entry_t;
+
+/**
+ * @brief Make the map belong to the given part. If it belonged to another
+ * part it is cleared, seeded with the instructions of the part's profile
+ * (see profile.h), and the known entries are requested from the host.
+ */
+void irmap_select(uint32_t idcode);
+
+/**
+ * @brief Number of entries in the map.
+ */
+uint32_t irmap_count();
+
+/**
+ * @brief IDCODE of the part the map belongs to (masked), 0 if none.
+ */
+uint32_t irmap_part();
+
+/**
+ * @brief All the entries of the map, sorted by instruction.
+ */
+const irmap_entry_t* irmap_entries();
+
+/**
+ * @brief Clear the map and make it belong to the given part, without
+ * asking the host. Used to restore saved entries with irmap_put().
+ */
+void irmap_assign(uint32_t idcode);
+
+/**
+ * @brief Look up an instruction in the map.
+ * @return Pointer to the entry, or nullptr if the instruction is unknown.
+ */
+const irmap_entry_t* irmap_get(uint32_t ir);
+
+/**
+ * @brief Add or update an instruction in the map.
+ */
+status_t irmap_put(uint32_t ir, uint32_t dr_len, uint32_t capture);
+
+/**
+ * @brief Print an entry in the machine readable format that the host stores.
+ */
+void irmap_report(const irmap_entry_t* entry);
+
+/**
+ * @brief Request the known entries of the selected part from the host,
+ * and merge them into the map.
+ */
+status_t irmap_load_from_host();
+
+#endif
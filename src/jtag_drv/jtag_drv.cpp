@@ -1,8 +1,28 @@
 #include "jtag_drv.h"
 #include "../chain/chain.h"
+#include "../cjtag/cjtag.h"
+#include "../irmap/irmap.h"
+#include "../idcode/idcode.h"
 #include "../../include/utils.h"
 
 tap_state current_state = TEST_LOGIC_RESET;
+uint32_t tck_delay_us = DELAY_US;
+
+// bypass bits around the selected TAP device, see jtag_set_padding
+static uint32_t pad_ir_pre = 0;
+static uint32_t pad_ir_post = 0;
+static uint32_t pad_dr_pre = 0;
+static uint32_t pad_dr_post = 0;
+
+// shadow of the last instruction shifted into the chain, see ir_shadow_enable.
+// together with the padding it describes the IR of every device in chain.
+static bool ir_shadow_on = IR_SHADOW_CACHE;
+static bool ir_shadow_valid = false;
+static uint32_t ir_shadow_len = 0;
+static uint32_t ir_shadow_pre = 0;
+static uint32_t ir_shadow_post = 0;
+static uint8_t ir_shadow_in[MAX_IR_LEN];
+static uint8_t ir_shadow_out[MAX_IR_LEN];
 
 void reset_tap()
 {
@@ -11,63 +31,83 @@ void reset_tap()
 #endif
     for (uint8_t i = 0; i < 5; ++i)
     {
-        digitalWrite(TMS, 1);
-        digitalWrite(TCK, 0); HC;
-        digitalWrite(TCK, 1); HC;
+        TAP_WRITE(TMS, 1);
+        TAP_WRITE(TCK, 0); TAP_HC;
+        TAP_WRITE(TCK, 1); TAP_HC;
     }
     current_state = TEST_LOGIC_RESET;
+
+    // TLR loads the default instruction of every device
+    ir_shadow_valid = false;
 }
 
-status_t detect_chain(uint32_t* out_ir_len, uint32_t* out_idcode)
+void ir_shadow_enable(bool enable)
 {
-    uint8_t id_bits[32] = {0};
-    uint32_t idcode = 0;
-    uint32_t i = 0;
-    uint8_t counter = 0;
-    status_t rc = OK;
+    ir_shadow_on = enable;
+    ir_shadow_valid = false;
+}
 
-    reset_tap();
-    Serial.println("Attempting to detect active chain");
+bool ir_shadow_enabled() { return ir_shadow_on; }
 
-    // try to read IDCODE first and then detect the IR length
-    advance_tap_state(RUN_TEST_IDLE);
-    advance_tap_state(SELECT_DR);
-    advance_tap_state(CAPTURE_DR);
-    advance_tap_state(SHIFT_DR);
-    
-    // shift out the IDCODE from the id code register
-    // assumed that the IDCODE IR is the default IR after power up.
-    // first bit to read out is the LSB of the IDCODE.
-    for (i = 0; i < 32; i++)
+void ir_shadow_invalidate() { ir_shadow_valid = false; }
+
+/**
+ * @brief Check if the instruction to shift is already loaded in chain.
+ * The IR can only be kept as is from RTI or one of the Update states,
+ * any other path to Shift-IR goes through Capture-IR / Update-IR.
+ */
+static bool ir_shadow_hit(uint8_t* ir_in, uint32_t ir_len)
+{
+    if (!ir_shadow_on || !ir_shadow_valid)
+        return false;
+
+    if (current_state != RUN_TEST_IDLE && current_state != UPDATE_DR && current_state != UPDATE_IR)
+        return false;
+
+    if (ir_len != ir_shadow_len || pad_ir_pre != ir_shadow_pre || pad_ir_post != ir_shadow_post)
+        return false;
+
+    for (uint32_t i = 0; i < ir_len; i++)
     {
-        advance_tap_state(SHIFT_DR);
-        id_bits[i] = digitalRead(TDO);
+        if ((ir_in[i] ? 1 : 0) != ir_shadow_in[i])
+            return false;
     }
-    advance_tap_state(EXIT1_DR);
 
-    // LSB of IDCODE must be 1.
-    if (id_bits[0] != 1)
-    {
-        Serial.println("\n\nBad IDCODE or not implemented, LSB = 0");
-        return -ERR_BAD_IDCODE;
+    return true;
+}
+
+static void ir_shadow_store(uint8_t* ir_in, uint8_t* ir_out, uint32_t ir_len)
+{
+    if (!ir_shadow_on || ir_len > MAX_IR_LEN) {
+        ir_shadow_valid = false;
+        return;
     }
 
-    // turn IDCODE bits into unsigned integer
-    rc = bin_array_to_uint32(id_bits, 32, &idcode);
-    if (rc != OK) {
-        Serial.println("\nCould not convert IDCODE");
-        *out_ir_len = 0;
-        *out_idcode = 0;
-        return rc;
+    for (uint32_t i = 0; i < ir_len; i++)
+    {
+        ir_shadow_in[i] = ir_in[i] ? 1 : 0;
+        ir_shadow_out[i] = ir_out[i];
     }
 
-    Serial.print("\nFound IDCODE: ");
-    print_array(id_bits, 32); Serial.print(" (0x");
-    Serial.print(idcode, HEX); Serial.print(")");
+    ir_shadow_len = ir_len;
+    ir_shadow_pre = pad_ir_pre;
+    ir_shadow_post = pad_ir_post;
+    ir_shadow_valid = true;
+}
+
+/**
+ * @brief Measure the IR length of the whole chain: fill every IR with ones,
+ * then count the TCKs a single zero takes to come out. Loads BYPASS into
+ * every device and ends in RTI.
+ * @return OK, or -ERR_INVALID_IR_OR_DR_LEN if the zero never came out.
+ */
+static status_t measure_ir_len(uint32_t* ir_len)
+{
+    uint32_t i;
+    uint32_t counter = 0;
 
-    // find ir length.
-    Serial.println("\nAttempting to find IR length of target ...");
     reset_tap();
+    ir_shadow_valid = false;
     advance_tap_state(RUN_TEST_IDLE);
     advance_tap_state(SELECT_DR);
     advance_tap_state(SELECT_IR);
@@ -78,68 +118,236 @@ status_t detect_chain(uint32_t* out_ir_len, uint32_t* out_idcode)
     // from its previos content. then shift a single zero followed by
     // a bunch of ones and cout the amount of clock cycles from inserting zero
     // till we read it back in TDO.
-    digitalWrite(TDI, 1);
+    TAP_WRITE(TDI, 1);
     for (i = 0; i < MANY_ONES; ++i) 
     {
         advance_tap_state(SHIFT_IR);
     }
 
-    digitalWrite(TDI, 0);
+    TAP_WRITE(TDI, 0);
     advance_tap_state(SHIFT_IR);
 
-    digitalWrite(TDI, 1);
+    TAP_WRITE(TDI, 1);
     for (i = 0; i < MANY_ONES; ++i)
     {
         advance_tap_state(SHIFT_IR);
-
-        if (digitalRead(TDO) == 0)
-        {
-            counter++;
-            *out_ir_len = counter;
-            *out_idcode = idcode;
-            Serial.print("IR length: "); Serial.println(counter, DEC);
-            return OK;
-        }
         counter++;
+
+        if (TAP_READ(TDO) == 0)
+            break;
     }
 
+    // the ones shifted last leave BYPASS in every IR
     advance_tap_state(EXIT1_IR);
     advance_tap_state(UPDATE_IR);
     advance_tap_state(RUN_TEST_IDLE);
 
-    *out_ir_len = 0;
-    *out_idcode = 0;
-    Serial.println("\nDidn't find valid IR length");
+    *ir_len = i < MANY_ONES ? counter : 0;
+    return i < MANY_ONES ? OK : -ERR_INVALID_IR_OR_DR_LEN;
+}
+
+status_t detect_chain(uint32_t* out_ir_len, uint32_t* out_idcode)
+{
+    uint8_t id_bits[32] = {0};
+    uint32_t idcodes[MAX_ALLOWED_TAPS];
+    uint32_t devices = MAX_ALLOWED_TAPS;
+    uint32_t ir_len = 0;
+    idcode_info_t info;
+    bool known;
+    status_t rc;
+
+    Serial.println("Attempting to detect active chain");
+
+    // the IDCODEs of the whole chain in a single DR scan, assumed that the
+    // IDCODE IR is the default IR after power up. zeros follow the last device.
+    known = read_idcodes(idcodes, MAX_ALLOWED_TAPS) == OK;
+    while (devices > 0 && idcodes[devices - 1] == 0)
+        devices--;
+
+    // LSB of IDCODE must be 1.
+    if ((idcodes[0] & 1) != 1)
+    {
+        Serial.println("\n\nBad IDCODE or not implemented, LSB = 0");
+        return -ERR_BAD_IDCODE;
+    }
+
+    int_to_bin_array(id_bits, idcodes[0], 32);
+    Serial.print("\nFound IDCODE: ");
+    print_array(id_bits, 32); Serial.print(" (0x");
+    Serial.print(idcodes[0], HEX); Serial.println(")");
+    idcode_print(idcodes[0]);
+
+    // a chain of known parts needs no probing, its IR length is the sum of
+    // theirs. a device without an IDCODE (a 0 between them) is unknown
+    for (uint32_t i = 0; i < devices && known; i++)
+    {
+        known = idcode_lookup(idcodes[i], &info) == OK && info.ir_len != 0;
+        ir_len += info.ir_len;
+    }
+
+    if (known)
+    {
+        if (devices > 1)
+        {
+            Serial.print("\nKnown parts in chain: "); Serial.println(devices, DEC);
+        }
+    }
+    else
+    {
+        // find ir length.
+        Serial.println("\nAttempting to find IR length of target ...");
+        rc = measure_ir_len(&ir_len);
+        if (rc != OK)
+        {
+            *out_ir_len = 0;
+            *out_idcode = 0;
+            Serial.println("\nDidn't find valid IR length");
+            return rc;
+        }
+    }
+
+    *out_ir_len = ir_len;
+    *out_idcode = idcodes[0];
+    Serial.print("IR length: "); Serial.println(ir_len, DEC);
+
+    return OK;
+}
+
+status_t read_idcodes(uint32_t* idcodes, uint32_t count)
+{
+    uint32_t i, bit = 0;
+    uint8_t trail = 0;
+
+    // TLR loads IDCODE (or BYPASS) into the DR of every device
+    reset_tap();
+    advance_tap_state(RUN_TEST_IDLE);
+    advance_tap_state(SELECT_DR);
+    advance_tap_state(CAPTURE_DR);
+    advance_tap_state(SHIFT_DR);
+
+    // zeros shifted in behind the devices come out right after the last one
+    TAP_WRITE(TDI, 0);
+    for (i = 0; i < count; i++)
+    {
+        advance_tap_state(SHIFT_DR);
+        idcodes[i] = TAP_READ(TDO);
+
+        // a device without an IDCODE register captures a single 0 bypass bit
+        if (idcodes[i] == 0)
+            continue;
+
+        for (bit = 1; bit < 32; bit++)
+        {
+            advance_tap_state(SHIFT_DR);
+            idcodes[i] |= (uint32_t)TAP_READ(TDO) << bit;
+        }
+    }
+
+    // another device with an IDCODE would shift out its LSB of 1 here
+    for (i = 0; i < 32; i++)
+    {
+        advance_tap_state(SHIFT_DR);
+        trail |= TAP_READ(TDO);
+    }
+
+    advance_tap_state(EXIT1_DR);
+    advance_tap_state(UPDATE_DR);
+    advance_tap_state(RUN_TEST_IDLE);
+    TAP_WRITE(TDI, 1);
+
+    return trail ? -ERR_OUT_OF_BOUNDS : OK;
+}
 
-    return -ERR_INVALID_IR_OR_DR_LEN;
+void jtag_set_padding(uint32_t ir_pre, uint32_t ir_post, uint32_t dr_pre, uint32_t dr_post)
+{
+    pad_ir_pre = ir_pre;
+    pad_ir_post = ir_post;
+    pad_dr_pre = dr_pre;
+    pad_dr_post = dr_post;
 }
 
-void insert_ir(uint8_t* ir_in, uint8_t* ir_out, uint32_t ir_len, uint8_t end_state)
+/**
+ * @brief Shift len bits of data framed by pre and post padding bits,
+ * while being in SHIFT_IR or SHIFT_DR. The very last bit is shifted
+ * on the way to exit_state. Only the TDO bits of the data are stored.
+ */
+static void shift_padded(uint8_t* in, uint8_t* out, uint32_t len, uint32_t pre, uint32_t post, uint8_t pad, uint8_t exit_state)
 {
-    // make sure that current state is TLR (test logic reset)
+    uint32_t total = pre + len + post;
     uint32_t i = 0;
 
+    // padding of the devices closer to JTDO
+    TAP_WRITE(TDI, pad);
+    for (i = 0; i < pre; i++)
+    {
+        if (i == total - 1) {
+            advance_tap_state(exit_state);
+            return;
+        }
+        TAP_WRITE(TCK, 0); TAP_HC;
+        TAP_WRITE(TCK, 1); TAP_HC;
+    }
+
+    // shift data bits. make sure that first bit is LSB
+    for (i = 0; i < len; i++)
+    {
+        TAP_WRITE(TDI, in[i]);
+        if (pre + i == total - 1) {
+            advance_tap_state(exit_state);
+        } else {
+            TAP_WRITE(TCK, 0); TAP_HC;
+            TAP_WRITE(TCK, 1); TAP_HC;
+        }
+        out[i] = TAP_READ(TDO);  // read the shifted out bits. LSB first
+    }
+
+    // padding of the devices closer to JTDI
+    TAP_WRITE(TDI, pad);
+    for (i = 0; i < post; i++)
+    {
+        if (i == post - 1) {
+            advance_tap_state(exit_state);
+            return;
+        }
+        TAP_WRITE(TCK, 0); TAP_HC;
+        TAP_WRITE(TCK, 1); TAP_HC;
+    }
+}
+
+void insert_ir(uint8_t* ir_in, uint8_t* ir_out, uint32_t ir_len, uint8_t end_state)
+{
+    // same instruction is already loaded, only move to the end state
+    if (ir_shadow_hit(ir_in, ir_len))
+    {
+        for (uint32_t i = 0; i < ir_len; i++)
+            ir_out[i] = ir_shadow_out[i];
+
+        if (end_state == RUN_TEST_IDLE){
+            if (current_state != RUN_TEST_IDLE)
+                advance_tap_state(RUN_TEST_IDLE);
+        }
+        else if (end_state == SELECT_IR){
+            if (current_state == RUN_TEST_IDLE || current_state == UPDATE_DR || current_state == UPDATE_IR)
+                advance_tap_state(SELECT_DR);
+            advance_tap_state(SELECT_IR);
+        }
+        else if (end_state == TEST_LOGIC_RESET){
+            reset_tap();
+        }
+        return;
+    }
+
     advance_tap_state(RUN_TEST_IDLE);
     advance_tap_state(SELECT_DR);
     advance_tap_state(SELECT_IR);
     advance_tap_state(CAPTURE_IR);
     advance_tap_state(SHIFT_IR);
 
-    // shift data bits into the IR. make sure that first bit is LSB
-    for (i = 0; i < ir_len - 1; i++)
-    {
-        digitalWrite(TDI, ir_in[i]);
-        digitalWrite(TCK, 0); HC;
-        digitalWrite(TCK, 1); HC;
-        ir_out[i] = digitalRead(TDO);  // read the shifted out bits. LSB first
-    }
-
-    // read and write the last IR bit and continue to the end state
-    digitalWrite(TDI, ir_in[i]);
-    advance_tap_state(EXIT1_IR);
-    ir_out[i] = digitalRead(TDO);
+    // the other devices in chain get the bypass (all ones) instruction
+    shift_padded(ir_in, ir_out, ir_len, pad_ir_pre, pad_ir_post, 1, EXIT1_IR);
 
     advance_tap_state(UPDATE_IR);
+    ir_shadow_store(ir_in, ir_out, ir_len);
 
     if (end_state == RUN_TEST_IDLE){	
         advance_tap_state(RUN_TEST_IDLE);
@@ -154,31 +362,65 @@ void insert_ir(uint8_t* ir_in, uint8_t* ir_out, uint32_t ir_len, uint8_t end_sta
 
 void insert_dr(uint8_t* dr_in,  uint8_t* dr_out, uint32_t dr_len, uint8_t end_state)
 {
-    uint32_t i = 0;
-
     // make sure that current TAP machine state is TLR
     advance_tap_state(RUN_TEST_IDLE);
     advance_tap_state(SELECT_DR);
     advance_tap_state(CAPTURE_DR);
     advance_tap_state(SHIFT_DR);
 
-    // shift data bits into DR. make sure that first bit is LSB
-    for (i = 0; i < dr_len - 1; i++)
-    {
-        digitalWrite(TDI, dr_in[i]);
-        digitalWrite(TCK, 0); HC;
-        digitalWrite(TCK, 1); HC;
-        dr_out[i] = digitalRead(TDO);  // read the shifted out bits . LSB first
+    // the other devices in chain are in bypass and add a single bit each
+    shift_padded(dr_in, dr_out, dr_len, pad_dr_pre, pad_dr_post, 0, EXIT1_DR);
+
+    advance_tap_state(UPDATE_DR);
+
+    if (end_state == RUN_TEST_IDLE){	
+        advance_tap_state(RUN_TEST_IDLE);
+    }
+    else if (end_state == SELECT_DR){
+        advance_tap_state(SELECT_DR);
+    }
+    else if (end_state == TEST_LOGIC_RESET){
+        reset_tap();
     }
+}
 
-    // read and write the last DR bit and continue to the end state
-    digitalWrite(TDI, dr_in[i]);
-    advance_tap_state(EXIT1_DR);
-    dr_out[i] = digitalRead(TDO); 
+void insert_dr_packed(const uint8_t* dr_in, uint8_t* dr_out, uint32_t dr_len, uint8_t end_state)
+{
+    uint32_t total = pad_dr_pre + dr_len + pad_dr_post;
+    uint32_t bit;
+    uint8_t mask;
+
+    advance_tap_state(RUN_TEST_IDLE);
+    advance_tap_state(SELECT_DR);
+    advance_tap_state(CAPTURE_DR);
+    advance_tap_state(SHIFT_DR);
+
+    // the other devices in chain are in bypass and add a single zero bit each
+    for (uint32_t i = 0; i < total; i++)
+    {
+        bit = i - pad_dr_pre;
+        mask = 1 << (bit & 7);
+        TAP_WRITE(TDI, i >= pad_dr_pre && bit < dr_len && (dr_in[bit >> 3] & mask) ? 1 : 0);
+
+        if (i == total - 1) {
+            advance_tap_state(EXIT1_DR);
+        } else {
+            TAP_WRITE(TCK, 0); TAP_HC;
+            TAP_WRITE(TCK, 1); TAP_HC;
+        }
+
+        if (i >= pad_dr_pre && bit < dr_len)
+        {
+            if (TAP_READ(TDO))
+                dr_out[bit >> 3] |= mask;
+            else
+                dr_out[bit >> 3] &= ~mask;
+        }
+    }
 
     advance_tap_state(UPDATE_DR);
 
-    if (end_state == RUN_TEST_IDLE){	
+    if (end_state == RUN_TEST_IDLE){
         advance_tap_state(RUN_TEST_IDLE);
     }
     else if (end_state == SELECT_DR){
@@ -189,16 +431,188 @@ void insert_dr(uint8_t* dr_in,  uint8_t* dr_out, uint32_t dr_len, uint8_t end_st
     }
 }
 
-uint32_t detect_dr_len(uint8_t* instruction, uint32_t ir_len, uint32_t process_ticks)
+void dr_stream_begin()
+{
+    advance_tap_state(RUN_TEST_IDLE);
+    advance_tap_state(SELECT_DR);
+    advance_tap_state(CAPTURE_DR);
+    advance_tap_state(SHIFT_DR);
+
+    // the devices in bypass closer to JTDO, the data follows them
+    TAP_WRITE(TDI, 0);
+    for (uint32_t i = 0; i < pad_dr_pre; i++)
+    {
+        TAP_WRITE(TCK, 0); TAP_HC;
+        TAP_WRITE(TCK, 1); TAP_HC;
+    }
+}
+
+void dr_stream_shift(const uint8_t* data, uint32_t bytes, bool msb_first)
+{
+    uint8_t byte, bit;
+
+    if (current_state == PAUSE_DR)
+    {
+        advance_tap_state(EXIT2_DR);
+        advance_tap_state(SHIFT_DR);
+    }
+
+    for (uint32_t i = 0; i < bytes; i++)
+    {
+        byte = data[i];
+        for (uint8_t b = 0; b < 8; b++)
+        {
+            bit = msb_first ? (byte >> (7 - b)) & 1 : (byte >> b) & 1;
+            TAP_WRITE(TDI, bit);
+
+            // the last bit of the chunk is shifted on the way to PAUSE_DR
+            if (i == bytes - 1 && b == 7) {
+                advance_tap_state(EXIT1_DR);
+            } else {
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
+            }
+        }
+    }
+
+    advance_tap_state(PAUSE_DR);
+}
+
+void dr_stream_end(uint8_t end_state)
+{
+    advance_tap_state(EXIT2_DR);
+
+    // the devices in bypass closer to JTDI
+    if (pad_dr_post > 0)
+    {
+        advance_tap_state(SHIFT_DR);
+        TAP_WRITE(TDI, 0);
+        for (uint32_t i = 0; i < pad_dr_post - 1; i++)
+        {
+            TAP_WRITE(TCK, 0); TAP_HC;
+            TAP_WRITE(TCK, 1); TAP_HC;
+        }
+        advance_tap_state(EXIT1_DR);
+    }
+
+    advance_tap_state(UPDATE_DR);
+
+    if (end_state == RUN_TEST_IDLE){
+        advance_tap_state(RUN_TEST_IDLE);
+    }
+    else if (end_state == TEST_LOGIC_RESET){
+        reset_tap();
+    }
+}
+
+/**
+ * Marker patterns shifted into a DR of unknown length while probing it.
+ * Bit 0 is shifted first, and must be zero so a marker that is preceded
+ * by the flushed ones can only be matched when it is fully aligned.
+ */
+#define DR_PROBE_MARKER  0x96  // 0b10010110
+#define DR_PROBE_CONFIRM 0xb4  // 0b10110100
+
+// last 8 TDO reads while probing, bit 0 holds the oldest one
+static uint8_t probe_history = 0;
+// number of consecutive ones read right before the oldest bit of probe_history
+static uint32_t probe_run = 0;
+// number of TDO reads since entering SHIFT_DR, and the first 32 captured bits
+// of the probed device (the reads of the bypass bits before it are skipped)
+static uint32_t probe_reads = 0;
+static uint32_t probe_capture = 0;
+
+/**
+ * @brief Clock a single bit through the DR while staying in SHIFT_DR,
+ * and keep track of the TDO reads.
+ */
+static void probe_clock(uint8_t tdi)
+{
+    TAP_WRITE(TDI, tdi);
+    TAP_WRITE(TCK, 0); TAP_HC;
+    TAP_WRITE(TCK, 1); TAP_HC;
+
+    uint8_t tdo = TAP_READ(TDO);
+    uint32_t bit = probe_reads - pad_dr_pre;
+
+    if (probe_reads >= pad_dr_pre && bit < 32 && tdo)
+        probe_capture |= (uint32_t)1 << bit;
+    probe_reads++;
+
+    probe_run = (probe_history & 1) ? probe_run + 1 : 0;
+    probe_history = (probe_history >> 1) | (tdo << 7);
+}
+
+/**
+ * @brief Shift an 8 bit marker followed by ones, and watch TDO for it.
+ * The marker appears on TDO after exactly dr_len clocks. Since the marker starts
+ * with a zero, a true match is preceded by all of the ones that were shifted
+ * right before the marker. Older content of the register (captured value,
+ * previous markers) that looks like the marker is filtered out by that run.
+ * @param marker The marker pattern, bit 0 is shifted first.
+ * @param run Number of ones that were shifted right before the marker.
+ * @param watch Maximum number of clocks to wait for the marker after shifting it.
+ * @return The number of clocks it took the marker to appear, or 0 if it did not.
+ */
+static uint32_t probe_marker(uint8_t marker, uint32_t run, uint32_t watch)
+{
+    for (uint32_t t = 0; t < 8 + watch; t++)
+    {
+        probe_clock(t < 8 ? (marker >> t) & 1 : 1);
+
+        if (t >= 8 && probe_history == marker && probe_run >= run)
+            return t - 7;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Adaptive DR length probing, while being in SHIFT_DR.
+ * Flushes the register with an exponentially growing window of ones,
+ * shifts a marker pattern and stops as soon as the marker reappears on TDO.
+ * A match is then confirmed with a second marker that must appear after exactly
+ * the same number of clocks.
+ * Measuring a 1 bit BYPASS register costs a few dozen TCKs instead of 2 * MAX_DR_LEN.
+ * @param max_len Maximum length to look for.
+ * @return The DR length, or 0 if TDO is stuck or the DR is longer than max_len.
+ */
+static uint32_t probe_dr_len(uint32_t max_len)
+{
+    uint32_t window = 8;
+    uint32_t len = 0;
+
+    probe_history = 0;
+    probe_run = 0;
+    probe_reads = 0;
+    probe_capture = 0;
+
+    while (true)
+    {
+        for (uint32_t i = 0; i < window; i++)
+            probe_clock(1);
+
+        len = probe_marker(DR_PROBE_MARKER, window, window);
+
+        // the len ones shifted while watching flush a register of that length
+        if (len != 0 && probe_marker(DR_PROBE_CONFIRM, len, len) == len)
+            return len;
+
+        if (window >= max_len)
+            return 0;
+
+        window = (window * 2 < max_len) ? window * 2 : max_len;
+    }
+}
+
+uint32_t detect_dr_len(uint8_t* instruction, uint32_t ir_len, uint32_t process_ticks, uint32_t max_dr_len, uint32_t* capture)
 {	
     // temporary array to strore the shifted out bits from IR
     uint8_t tmp[ir_len];
-    uint32_t i, counter = 0;
-
-    // make sure that current state is TLR prior this calling this function.
-    reset_tap();
+    uint32_t i, len = 0;
 
-    // insert the instruction we wish to check into ir
+    // insert the instruction we wish to check into ir.
+    // there is no need to go through TLR, the IR is simply reloaded.
     insert_ir(instruction, tmp, ir_len, RUN_TEST_IDLE);
     
     // a couple of clock cycles to process the instruction
@@ -207,53 +621,44 @@ uint32_t detect_dr_len(uint8_t* instruction, uint32_t ir_len, uint32_t process_t
         HC; HC;
     }
 
-    /* 
-        check the length of the DR register between TDI and TDO
-        by inserting many ones (MAX_DR_LEN) to clean the register.
-        afterwards, insert a single zero and start counting the amount
-        of TCK clock cycles till the appearence of that zero in TDO.
-    */
     advance_tap_state(SELECT_DR);
     advance_tap_state(CAPTURE_DR);
     advance_tap_state(SHIFT_DR);
 
-    digitalWrite(TDI, 1);
-    for (i = 0; i < MAX_DR_LEN; ++i)
-    {
-        advance_tap_state(SHIFT_DR);
-    }
+    // the other devices in chain are in bypass and add a bit each
+    len = probe_dr_len(max_dr_len + pad_dr_pre + pad_dr_post);
 
-    digitalWrite(TDI, 0);
-    advance_tap_state(SHIFT_DR);
+    advance_tap_state(EXIT1_DR);
+    advance_tap_state(UPDATE_DR);
+    advance_tap_state(RUN_TEST_IDLE);
 
-    digitalWrite(TDI, 1);
-    for (i = 0; i < MAX_DR_LEN; ++i)
-    {
-        advance_tap_state(SHIFT_DR);
+    if (len <= pad_dr_pre + pad_dr_post)
+        return 0;
 
-        if (digitalRead(TDO) == 0){
-            ++counter;
-            return counter;
-        }
-        counter++;
-    }
+    len -= pad_dr_pre + pad_dr_post;
 
-    return 0;
+    // the first bits read out are the value captured by the DR
+    if (capture != nullptr)
+        *capture = (len < 32) ? probe_capture & (((uint32_t)1 << len) - 1) : probe_capture;
+
+    return len;
 }
 
 status_t discovery(uint32_t first, uint32_t last, uint32_t max_dr_len, uint32_t ir_len, uint8_t* ir_in)
 {
-    uint32_t instruction, len = 0;
+    uint32_t instruction, len, capture = 0;
+    const irmap_entry_t* entry;
     status_t rc = OK;
 
     // discover all dr lengths corresponding to their ir.
     Serial.print("\n\nDiscovery of instructions from 0x"); Serial.print(first, HEX);
     Serial.print(" to 0x"); Serial.println(last, HEX);
 
+    // a single reset, afterwards every instruction is simply loaded over the previous one
+    reset_tap();
+
     for (instruction=first; instruction <= last; instruction++)
     {
-        // reset tap
-        reset_tap();
         len = 0;
 
         // prepare to shift instruction
@@ -264,16 +669,28 @@ status_t discovery(uint32_t first, uint32_t last, uint32_t max_dr_len, uint32_t
         Serial.print(" (0x"); Serial.print(instruction, HEX); Serial.print(")");
         Serial.flush();
 
-        len = detect_dr_len(ir_in, ir_len, 4);
-        if (len == max_dr_len)
+        // instructions known from the host's database are not probed again
+        entry = irmap_get(instruction);
+        if (entry != nullptr)
         {
-            Serial.println("\nDiscovery: TDO is stuck at 1");
-            rc = -ERR_TDO_STUCK_AT_1;
-            break;
+            Serial.print(" ... "); Serial.print(entry->dr_len, DEC);
+            Serial.print(" (known)");
+            continue;
+        }
+
+        len = detect_dr_len(ir_in, ir_len, 4, max_dr_len, &capture);
+        if (len == 0)
+        {
+            Serial.print(" ... not found (TDO stuck or DR longer than max)");
+            continue;
         }
 
         Serial.print(" ... "); Serial.print(len, DEC);
         Serial.flush();
+
+        // let the host store the new instruction
+        if (irmap_put(instruction, len, capture) == OK)
+            irmap_report(irmap_get(instruction));
     }
 
     reset_tap();
@@ -291,48 +708,48 @@ status_t advance_tap_state(uint8_t next_state)
         case TEST_LOGIC_RESET:
             if (next_state == RUN_TEST_IDLE) {
                 // go to run test idle
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = RUN_TEST_IDLE;
             }
             else if (next_state == TEST_LOGIC_RESET) {
                 // stay in test logic reset
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
             }
             break;
 
         case RUN_TEST_IDLE:
             if (next_state == SELECT_DR) {
                 // go to select dr
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = SELECT_DR;
             }
             else if (next_state == RUN_TEST_IDLE) {
                 // stay in run test idle
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
             }
             break;
 
         case SELECT_DR:
             if (next_state == CAPTURE_DR) {
                 // go to capture dr
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = CAPTURE_DR;
             }
             else if (next_state == SELECT_IR) { 
                 // go to select ir
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = SELECT_IR;
             }
             break;
@@ -340,16 +757,16 @@ status_t advance_tap_state(uint8_t next_state)
         case CAPTURE_DR:
             if (next_state == SHIFT_DR) {
                 // go to shift dr
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = SHIFT_DR;
             }
             else if (next_state == EXIT1_DR) { 
                 // go to exit1 dr
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = EXIT1_DR;
             }
             break;
@@ -357,15 +774,15 @@ status_t advance_tap_state(uint8_t next_state)
         case SHIFT_DR:
             if (next_state == SHIFT_DR) {
                 // stay in shift dr
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
             }
             else if (next_state == EXIT1_DR) {
                 // go to exit1 dr
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = EXIT1_DR;
             }
             break;
@@ -373,16 +790,16 @@ status_t advance_tap_state(uint8_t next_state)
         case EXIT1_DR:
             if (next_state == PAUSE_DR) {
                 // go to pause dr
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = PAUSE_DR;
             }
             else if (next_state == UPDATE_DR) {
                 // go to update dr
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = UPDATE_DR;
             }
             break;
@@ -390,15 +807,15 @@ status_t advance_tap_state(uint8_t next_state)
         case PAUSE_DR:
             if (next_state == PAUSE_DR) {
                 // stay in pause dr
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
             }
             else if (next_state == EXIT2_DR) {
                 // go to exit2 dr
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = EXIT2_DR;
             }
             break;
@@ -406,16 +823,16 @@ status_t advance_tap_state(uint8_t next_state)
         case EXIT2_DR:
             if (next_state == SHIFT_DR) {
                 // go to shift dr
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = SHIFT_DR;
             }
             else if (next_state == UPDATE_DR) {
                 // go to update dr
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = UPDATE_DR;
             }
             break;
@@ -423,16 +840,16 @@ status_t advance_tap_state(uint8_t next_state)
         case UPDATE_DR:
             if (next_state == RUN_TEST_IDLE) {
                 // go to run test idle
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = RUN_TEST_IDLE;
             }
             else if (next_state == SELECT_DR) {
                 // go to select dr
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = SELECT_DR;
             }
             break;
@@ -440,16 +857,16 @@ status_t advance_tap_state(uint8_t next_state)
         case SELECT_IR:
             if (next_state == CAPTURE_IR) {
                 // go to capture ir
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = CAPTURE_IR;
             }
             else if (next_state == TEST_LOGIC_RESET) {
                 // go to test logic reset
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = TEST_LOGIC_RESET;
             }
             break;
@@ -457,16 +874,16 @@ status_t advance_tap_state(uint8_t next_state)
         case CAPTURE_IR:
             if (next_state == SHIFT_IR) {
                 // go to shift ir
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = SHIFT_IR;
             }
             else if (next_state == EXIT1_IR) {
                 // go to exit1 ir
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = EXIT1_IR;
             }
             break;
@@ -474,15 +891,15 @@ status_t advance_tap_state(uint8_t next_state)
         case SHIFT_IR:
             if (next_state == SHIFT_IR) {
                 // stay in shift ir
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
             }
             else if (next_state == EXIT1_IR) {
                 // go to exit1 ir
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = EXIT1_IR;
             }
             break;
@@ -490,16 +907,16 @@ status_t advance_tap_state(uint8_t next_state)
         case EXIT1_IR:
             if (next_state == PAUSE_IR) {
                 // go to pause ir
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = PAUSE_IR;
             }
             else if (next_state == UPDATE_IR) {
                 // go to update ir
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = UPDATE_IR;
             }
             break;
@@ -507,15 +924,15 @@ status_t advance_tap_state(uint8_t next_state)
         case PAUSE_IR:
             if (next_state == PAUSE_IR) {
                 // stay in pause ir
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
             }
             else if (next_state == EXIT2_IR) {
                 // go to exit2 dr
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = EXIT2_IR;
             }
             break;
@@ -523,16 +940,16 @@ status_t advance_tap_state(uint8_t next_state)
         case EXIT2_IR:
             if (next_state == SHIFT_IR) {
                 // go to shift ir
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = SHIFT_IR;
             }
             else if (next_state == UPDATE_IR) {
                 // go to update ir
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = UPDATE_IR;
             }
             break;
@@ -540,22 +957,23 @@ status_t advance_tap_state(uint8_t next_state)
         case UPDATE_IR:
             if (next_state == RUN_TEST_IDLE) {
                 // go to run test idle
-                digitalWrite(TMS, 0);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 0);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = RUN_TEST_IDLE;
             }
             else if (next_state == SELECT_DR) {
                 // go to select dr
-                digitalWrite(TMS, 1);
-                digitalWrite(TCK, 0); HC;
-                digitalWrite(TCK, 1); HC;
+                TAP_WRITE(TMS, 1);
+                TAP_WRITE(TCK, 0); TAP_HC;
+                TAP_WRITE(TCK, 1); TAP_HC;
                 current_state = SELECT_DR;
             }
             break;
 
         default:
             Serial.println("Error: incorrent TAP state !");
+            ir_shadow_valid = false;
             rc = -ERR_BAD_TAP_STATE;
             break;
     }
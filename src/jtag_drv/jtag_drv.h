@@ -1,3 +1,6 @@
+#ifndef __JTAG_DRV__H__
+#define __JTAG_DRV__H__
+
 #include <stdint.h>
 
 #include "../../include/status.h"
@@ -21,19 +24,64 @@ extern tap_state current_state;
  */
 void reset_tap();
 
+/**
+ * @brief Set the bypass padding that surrounds the selected TAP device in a chain.
+ * Every insert_ir shifts ir_pre ones before and ir_post ones after the given
+ * instruction, and every insert_dr shifts dr_pre and dr_post zeros around the data.
+ * "pre" bits are shifted first and belong to the devices closer to JTDO.
+ * All zeros (the default) means a single device chain.
+ */
+void jtag_set_padding(uint32_t ir_pre, uint32_t ir_post, uint32_t dr_pre, uint32_t dr_post);
+
+/**
+ * @brief Enable or disable the IR shadow cache. When enabled, an insert_ir that
+ * would shift the same instruction (with the same chain padding) that is already
+ * loaded is dropped, or reduced to a state move towards its end state.
+ * ir_out then holds the bits captured by the last real IR scan.
+ * Disabling the cache also invalidates it.
+ */
+void ir_shadow_enable(bool enable);
+
+/**
+ * @brief Returns true if the IR shadow cache is enabled.
+ */
+bool ir_shadow_enabled();
+
+/**
+ * @brief Forget the shadowed instruction, so the next insert_ir is always shifted.
+ * Must be called whenever the IR content is changed behind the driver's back,
+ * e.g. TRST was toggled. TLR (reset_tap) and unknown TAP states invalidate it as well.
+ */
+void ir_shadow_invalidate();
+
 /**
  * @brief Detects the the existence of a chain and checks the ir length.
  * @param out_ir_len An integer that represents the length of the instructions.
  * Most certainly less than 255 bits.
  * @param out_id_code An integer that represents the idcode that is
  * available in the currently active TAP (device) between JTDI and JTDO.
+ * out_ir_len is the IR length of the whole chain. The IDCODEs of the chain
+ * are read first (read_idcodes()): if every device is known to the IDCODE
+ * database (idcode.h), their IR lengths are added up and nothing is probed,
+ * otherwise the IR length is measured.
  */
 status_t detect_chain(uint32_t* out_ir_len, uint32_t* out_idcode);
 
+/**
+ * @brief Read the IDCODEs of the first count devices in chain with a single DR scan.
+ * Resets the TAP first, so every device has IDCODE or BYPASS loaded. Ends in RTI.
+ * @param idcodes Output array of count IDCODEs, index 0 is the device closest to JTDO.
+ * A device without an IDCODE register reads as 0.
+ * @param count Number of devices expected in chain.
+ * @return OK, or -ERR_OUT_OF_BOUNDS if there are more devices in chain.
+ */
+status_t read_idcodes(uint32_t* idcodes, uint32_t count);
+
 /**
 *	@brief Insert data of length ir_len to IR, and end the interaction
 *	in the state end_state which can be one of the following:
-*	TLR, RTI, SelectDR.
+*	TLR, RTI, SelectIR.
+*	The scan is skipped if the IR shadow cache holds the same instruction.
 *	@param ir_in Pointer to the input data array. (bytes array)
 *	@param ir_out Pointer to the output data array. (bytes array)
 *	@param ir_len Length of the register currently connected between tdi and tdo.
@@ -52,21 +100,58 @@ void insert_ir(uint8_t* ir_in, uint8_t* ir_out, uint32_t ir_len, uint8_t end_sta
 */
 void insert_dr(uint8_t* dr_in, uint8_t* dr_out, uint32_t dr_len, uint8_t end_state);
 
+/**
+ * @brief The same as insert_dr(), with the bits packed 8 a byte (bit i is
+ * bit i % 8 of byte i / 8), for registers too long for a byte per bit, such
+ * as a boundary register.
+ */
+void insert_dr_packed(const uint8_t* dr_in, uint8_t* dr_out, uint32_t dr_len, uint8_t end_state);
+
+/**
+ * @brief Start a DR scan that is shifted in chunks with dr_stream_shift(),
+ * e.g. a configuration bitstream that is much longer than the memory.
+ * Moves to SHIFT_DR and shifts the padding of the devices closer to JTDO.
+ */
+void dr_stream_begin();
+
+/**
+ * @brief Shift the next chunk of a streamed DR scan, packed 8 bits a byte.
+ * The TAP waits in PAUSE_DR after the chunk, which keeps the DR content while
+ * the next chunk arrives. TDO is not read.
+ * @param data Chunk to shift, its first byte first.
+ * @param bytes Length of the chunk, at least 1.
+ * @param msb_first Shift the bits of every byte MSB first, else LSB first.
+ */
+void dr_stream_shift(const uint8_t* data, uint32_t bytes, bool msb_first);
+
+/**
+ * @brief End a streamed DR scan: shift the padding of the devices closer to
+ * JTDI, update the DR and move to end_state (TLR or RTI).
+ */
+void dr_stream_end(uint8_t end_state);
+
 /**
  * @brief Find out the dr length of a specific instruction.
- * Make sure that current state is TLR prior this calling this function.
+ * The instruction is loaded from the current state (TLR, RTI or an Update state),
+ * and the DR is measured with an adaptive marker probe that stops as soon
+ * as the length is known. Ends in RTI.
  * @param instruction Pointer to the bytes array that contains the instruction.
  * @param ir_len The length of the IR. (Needs to be know prior to function call).
  * @param process_ticks Number of TCK ticks to wait for the inserted instruction to "process in".
+ * @param max_dr_len Maximum DR length to look for.
+ * @param capture If not nullptr, gets the first (up to 32) bits captured by the DR.
  * @return Counter that represents the size of the DR. Or 0 if didn't find
- * a valid size. (DR may not be implemented or some other reason).
+ * a valid size. (DR may not be implemented, TDO is stuck or DR is longer than max_dr_len).
  */
-uint32_t detect_dr_len(uint8_t* instruction, uint32_t ir_len, uint32_t process_ticks);
+uint32_t detect_dr_len(uint8_t* instruction, uint32_t ir_len, uint32_t process_ticks, uint32_t max_dr_len, uint32_t* capture);
 
 /**
  * @brief Similarly to discovery command in urjtag, performs a brute force search
  * of each possible values of the IR register to get its corresponding DR leght in bits.
- * Test Logic Reset (TLR) state is being reached after each instruction.
+ * Test Logic Reset (TLR) state is reached once at the beginning, afterwards
+ * each instruction is loaded directly over the previous one.
+ * Instructions that are in the instruction map (see irmap.h) are not probed,
+ * and newly measured ones are added to it and reported to the host.
  * @param first ir value to begin with.
  * @param last Usually 2 to the power of (ir_len) - 1.
  * @param max_dr_len Maximum data register allowed.
@@ -81,3 +166,5 @@ status_t discovery(uint32_t first, uint32_t last, uint32_t max_dr_len, uint32_t
 *	@param next_state The next state to advance to.
 */
 status_t advance_tap_state(uint8_t next_state);
+
+#endif
@@ -2,8 +2,11 @@
 /* ------------------- Custom functions for MAX10 FPGA project ----------------------------*/
 /* --------------------------------------------------------------------------------------- */
 #include <stdint.h>
+#include <string.h>
 
 #include "max10_ir.h"
+#include "max10_funcs.h"
+#include "sld_hub.h"
 #include "../jtag_drv/jtag_drv.h"
 #include "../../include/main.h"
 #include "../../include/utils.h"
@@ -30,9 +33,11 @@ uint32_t max10_read_user_code(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_
 }
 
 /**
- * @brief Perform read flash operation on the MAX10 FPGA, by getting an address range and 
- * incrementing the given address in each iteration with ISC_ADDRESS_SHIFT, before invoking ISC_READ.
- * @param ir_in Pointer to the input data array. Bytes array, where each
+ * @brief Perform read flash operation on the MAX10 FPGA over an address range.
+ * ISC_READ increments the address by itself, so the range is read with the
+ * burst read: the start address is shifted once, instead of an ISC_ADDRESS_SHIFT
+ * and an ISC_READ scan for every word.
+ * @param ir_in Pointer to the input data array. (bytes array)
  * @param ir_out Pointer to the output data array. (bytes array)
  * @param dr_in Pointer to the input data array. (bytes array)
  * @param dr_out Pointer to the output data array. (bytes array)
@@ -41,36 +46,82 @@ uint32_t max10_read_user_code(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_
 */
 void max10_read_ufm_range(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num)
 {
-    uint32_t res = 0;
+    max10_read_ufm_range_burst(ir_len, ir_in, ir_out, dr_in, dr_out, start, num);
+}
 
-    Serial.println("\nReading flash in address iteration fashion");
-    int_to_bin_array(ir_in, ir_len, ISC_ENABLE);
+/**
+ * @brief Start a burst read of the flash: enter ISC mode, shift the start
+ * address once and load ISC_READ. Every following max10_burst_next() reads
+ * the next 32 bit word, the address is incremented by the device.
+ * @param ir_in Pointer to the input data array.  (bytes array)
+ * @param ir_out Pointer to the output data array. (bytes array)
+ * @param dr_in Pointer to the input data array. (bytes array)
+ * @param dr_out Pointer to the output data array. (bytes array)
+ * @param start Address from which to start the flash reading.
+ */
+void max10_burst_begin(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start)
+{
+    int_to_bin_array(ir_in, ISC_ENABLE, ir_len);
     insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
 
     // delay between ISC_Enable and read attenpt.(may be shortened)
     delay(15);
-    
-    for (uint32_t j=start; j < (start + num); j += 4)
-    {
-        // shift address instruction
-        int_to_bin_array(ir_in, ir_len, ISC_ADDRESS_SHIFT);
-        insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
-        
-        // shift address value
-        clear_reg(dr_in, 32);
-        int_to_bin_array(dr_in, j, 23);
-        insert_dr(dr_in, dr_out, 23, RUN_TEST_IDLE);
-        
-        // shift read instruction
-        int_to_bin_array(ir_in, ir_len, ISC_READ);
-        insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
 
-        // read data
-        clear_reg(dr_in, 32);
-        insert_dr(dr_in, dr_out, 32, RUN_TEST_IDLE);
+    // shift address instruction
+    int_to_bin_array(ir_in, ISC_ADDRESS_SHIFT, ir_len);
+    insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+
+    // shift address value
+    clear_reg(dr_in, 32);
+    int_to_bin_array(dr_in, start, 23);
+    insert_dr(dr_in, dr_out, 23, RUN_TEST_IDLE);
+
+    // shift read instruction
+    int_to_bin_array(ir_in, ISC_READ, ir_len);
+    insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+
+    clear_reg(dr_in, 32);
+}
+
+/**
+ * @brief Read the next 32 bit word of a burst read started by max10_burst_begin().
+ * @param dr_in Pointer to the input data array, first 32 cells must be cleared.
+ * @param dr_out Pointer to the output data array. (bytes array)
+ * @return The flash word.
+ */
+uint32_t max10_burst_next(uint8_t* dr_in, uint8_t* dr_out)
+{
+    uint32_t res = 0;
+
+    insert_dr(dr_in, dr_out, 32, RUN_TEST_IDLE);
+    bin_array_to_uint32(dr_out, 32, &res);
+
+    return res;
+}
+
+/**
+ * @brief Perform read flash operation on the MAX10 FPGA, by shifting the start address
+ * once, and reading the following words with ISC_READ in burst fashion.
+ * @param ir_in Pointer to the input data array.  (bytes array)
+ * @param ir_out Pointer to the output data array. (bytes array)
+ * @param dr_in Pointer to the input data array. (bytes array)
+ * @param dr_out Pointer to the output data array. (bytes array)
+ * @param start Address from which to start the flash reading.
+ * @param num Amount of 32 bit words to read, starting from the start address.
+*/
+void max10_read_ufm_range_burst(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num)
+{
+    uint32_t res = 0;
+
+    Serial.println("\nReading flash in burst fashion");    
+    max10_burst_begin(ir_len, ir_in, ir_out, dr_in, dr_out, start);
+
+    for (uint32_t j=start ; j < (start + num); j += 4)
+    {
+        // read data in burst fashion
+        res = max10_burst_next(dr_in, dr_out);
 
         // print address and corresponding data
-        int_to_bin_array(dr_out, res, 32);
         Serial.print("\n0x"); Serial.print(j, HEX);
         Serial.print(": 0x"); Serial.print(res, HEX);
         Serial.flush();
@@ -78,52 +129,337 @@ void max10_read_ufm_range(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out,
 }
 
 /**
- * @brief Perform read flash operation on the MAX10 FPGA, by getting an address range and 
- * incrementing the given address in each iteration with ISC_ADDRESS_SHIFT, before invoking ISC_READ.
+ * @brief Stream a flash range to the host in binary. The range is sent once as a text line
+ *
+ *   "@dump 0x<start> <words> <words per frame>"
+ *
+ * followed by frames of raw 32 bit words (little endian), see send_frame_to_host().
+ * The last frame is an empty one. Nothing else is printed until the dump ends.
  * @param ir_in Pointer to the input data array.  (bytes array)
  * @param ir_out Pointer to the output data array. (bytes array)
  * @param dr_in Pointer to the input data array. (bytes array)
  * @param dr_out Pointer to the output data array. (bytes array)
  * @param start Address from which to start the flash reading.
  * @param num Amount of 32 bit words to read, starting from the start address.
-*/
-void max10_read_ufm_range_burst(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num)
+ */
+void max10_dump_range(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num)
 {
+    uint32_t buf[MAX10_DUMP_FRAME_WORDS];
+    uint32_t left = num;
+    uint32_t words;
+
+    max10_burst_begin(ir_len, ir_in, ir_out, dr_in, dr_out, start);
+
+    send_dump_header_to_host(start, num, MAX10_DUMP_FRAME_WORDS);
+
+    while (left > 0)
+    {
+        words = min(left, (uint32_t)MAX10_DUMP_FRAME_WORDS);
+        for (uint32_t i = 0; i < words; i++)
+            buf[i] = max10_burst_next(dr_in, dr_out);
+
+        send_words_frame_to_host(buf, words);
+        left -= words;
+    }
+
+    send_dump_end_to_host(start + 4 * num, OK);
+}
+
+/**
+ * @brief Stream only the sectors of a flash range that differ from the host's cached image.
+ * The range is sent once as a text line
+ *
+ *   "@idump 0x<start> <words> <words per sector>"
+ *
+ * followed by frames (see send_frame_to_host), the first payload byte tells the kind:
+ *
+ *   'C' <first u32> <count u32>   request the checksums of sectors [first, first + count).
+ *                                 the host answers with count raw CRC-32s (u32, little endian)
+ *   'S' <index u32> <words>       a sector whose checksum differs, sent in full
+ *   'T' <crc u32>                 CRC-32 of the whole range, to verify the patched image
+ *
+ * and an empty frame that ends the dump. The range is read once with the burst read.
+ * @param ir_in Pointer to the input data array.  (bytes array)
+ * @param ir_out Pointer to the output data array. (bytes array)
+ * @param dr_in Pointer to the input data array. (bytes array)
+ * @param dr_out Pointer to the output data array. (bytes array)
+ * @param start Address from which to start the flash reading.
+ * @param num Amount of 32 bit words to read, starting from the start address.
+ * @param sector_words Amount of 32 bit words in a sector, up to MAX10_SECTOR_MAX_WORDS.
+ */
+status_t max10_dump_range_incremental(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num, const uint32_t sector_words)
+{
+    // kind and index bytes are followed by the sector words
+    uint8_t frame[5 + MAX10_SECTOR_MAX_WORDS * 4];
+    uint8_t expected[MAX10_SECTOR_BATCH * 4];
+    uint32_t sectors, first, count, index, words, crc, res = 0;
+    uint32_t total = 0;
+    uint32_t sent = 0;
+    status_t rc = OK;
+
+    if (sector_words == 0 || sector_words > MAX10_SECTOR_MAX_WORDS)
+        return -ERR_BAD_PARAMETER;
+
+    sectors = (num + sector_words - 1) / sector_words;
+    max10_burst_begin(ir_len, ir_in, ir_out, dr_in, dr_out, start);
+
+    Serial.print("\n@idump 0x"); Serial.print(start, HEX);
+    Serial.print(" "); Serial.print(num, DEC);
+    Serial.print(" "); Serial.println(sector_words, DEC);
+
+    for (first = 0; first < sectors && rc == OK; first += count)
+    {
+        count = min(sectors - first, (uint32_t)MAX10_SECTOR_BATCH);
+
+        // ask for the checksums of the cached sectors
+        frame[0] = 'C';
+        memcpy(&frame[1], &first, 4);
+        memcpy(&frame[5], &count, 4);
+        send_frame_to_host(frame, 9);
+        Serial.flush();
+
+        if (Serial.readBytes((char*)expected, count * 4) != count * 4)
+        {
+            rc = -ERR_GENERAL;
+            break;
+        }
+
+        for (uint32_t k = 0; k < count; k++)
+        {
+            index = first + k;
+            words = min(num - index * sector_words, sector_words);
+
+            for (uint32_t i = 0; i < words; i++)
+            {
+                res = max10_burst_next(dr_in, dr_out);
+                frame[5 + 4 * i] = res;
+                frame[5 + 4 * i + 1] = res >> 8;
+                frame[5 + 4 * i + 2] = res >> 16;
+                frame[5 + 4 * i + 3] = res >> 24;
+            }
+
+            crc = crc32_update(0, &frame[5], words * 4);
+            total = crc32_update(total, &frame[5], words * 4);
+
+            if (memcmp(&crc, &expected[4 * k], 4) != 0)
+            {
+                frame[0] = 'S';
+                memcpy(&frame[1], &index, 4);
+                send_frame_to_host(frame, 5 + words * 4);
+                sent++;
+            }
+        }
+    }
+
+    if (rc == OK)
+    {
+        frame[0] = 'T';
+        memcpy(&frame[1], &total, 4);
+        send_frame_to_host(frame, 5);
+    }
+
+    // end of dump
+    send_frame_to_host(frame, 0);
+    Serial.flush();
+
+    if (rc != OK) {
+        Serial.println("\nNo sector checksums from host, dump aborted");
+    }
+    else {
+        Serial.print("\nSent "); Serial.print(sent, DEC);
+        Serial.print(" of "); Serial.print(sectors, DEC); Serial.println(" sectors");
+    }
+
+    return rc;
+}
+
+/**
+ * @brief Compute the CRC-32 of a flash range on the device, with the burst read.
+ * The words are taken as little endian bytes, so the result equals the
+ * CRC-32 (zlib) of the same range in a dumped image file.
+ * @param ir_in Pointer to the input data array.  (bytes array)
+ * @param ir_out Pointer to the output data array. (bytes array)
+ * @param dr_in Pointer to the input data array. (bytes array)
+ * @param dr_out Pointer to the output data array. (bytes array)
+ * @param start Address from which to start the flash reading.
+ * @param num Amount of 32 bit words to read, starting from the start address.
+ * @return CRC-32 of the range.
+ */
+uint32_t max10_crc_range(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num)
+{
+    uint32_t crc = 0;
     uint32_t res = 0;
+    uint8_t bytes[4];
 
-    Serial.println("\nReading flash in burst fashion");    
-    int_to_bin_array(ir_in, ir_len, ISC_ENABLE);
-    insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+    max10_burst_begin(ir_len, ir_in, ir_out, dr_in, dr_out, start);
 
-    // delay between ISC_Enable and read attenpt.(may be shortened)
-    delay(15);
+    for (uint32_t i = 0; i < num; i++)
+    {
+        res = max10_burst_next(dr_in, dr_out);
+        bytes[0] = res;
+        bytes[1] = res >> 8;
+        bytes[2] = res >> 16;
+        bytes[3] = res >> 24;
+        crc = crc32_update(crc, bytes, 4);
+    }
 
-    // shift address instruction
-    int_to_bin_array(ir_in, ir_len, ISC_ADDRESS_SHIFT);
+    return crc;
+}
+
+/**
+ * @brief Check that a flash range is erased (all words are 0xFFFFFFFF), with the burst read.
+ * Stops at the first word that is not blank.
+ * @param ir_in Pointer to the input data array.  (bytes array)
+ * @param ir_out Pointer to the output data array. (bytes array)
+ * @param dr_in Pointer to the input data array. (bytes array)
+ * @param dr_out Pointer to the output data array. (bytes array)
+ * @param start Address from which to start the flash reading.
+ * @param num Amount of 32 bit words to read, starting from the start address.
+ * @param first Gets the address of the first word that is not blank.
+ * @return OK if the range is blank, else -ERR_NOT_BLANK.
+ */
+status_t max10_blank_check(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num, uint32_t* first)
+{
+    max10_burst_begin(ir_len, ir_in, ir_out, dr_in, dr_out, start);
+
+    for (uint32_t i = 0; i < num; i++)
+    {
+        if (max10_burst_next(dr_in, dr_out) != 0xffffffff)
+        {
+            *first = start + 4 * i;
+            return -ERR_NOT_BLANK;
+        }
+    }
+
+    return OK;
+}
+
+/**
+ * @brief Program a flash range with an image streamed from the host, and verify it.
+ * The range is sent once as a text line
+ *
+ *   "@program 0x<start> <words> <words per chunk>"
+ *
+ * and then the host sends a chunk of the image (a frame, see send_frame_to_host)
+ * for every 'R' byte it gets. The next chunk is requested before the current one
+ * is programmed, and received in between the programmed words, so the link and
+ * the programming overlap. An 'X' byte tells the host to stop.
+ * Words are programmed with ISC_PROGRAM, the device increments the address.
+ * At the end the range is read back and its CRC-32 compared with the received image.
+ * The range must be erased first.
+ * @param ir_in Pointer to the input data array.  (bytes array)
+ * @param ir_out Pointer to the output data array. (bytes array)
+ * @param dr_in Pointer to the input data array. (bytes array)
+ * @param dr_out Pointer to the output data array. (bytes array)
+ * @param start Address from which to start programming.
+ * @param num Amount of 32 bit words to program, starting from the start address.
+ * @return OK if the range was programmed and verified, -ERR_BAD_PARAMETER for an empty range.
+ */
+status_t max10_program_range(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num)
+{
+    uint8_t chunks[2][MAX10_PROGRAM_CHUNK_WORDS * 4];
+    frame_rx_t rx[2];
+    uint32_t cur = 0;
+    uint32_t programmed = 0;
+    uint32_t words, word = 0;
+    uint32_t crc = 0;
+    bool more = false;
+    status_t rc = OK;
+
+    // the host reads a header of 0 words as a stream of unknown length, and
+    // would wait for an 'R' that never comes
+    if (num == 0)
+    {
+        Serial.println("\nNothing to program");
+        return -ERR_BAD_PARAMETER;
+    }
+
+    Serial.print("\n@program 0x"); Serial.print(start, HEX);
+    Serial.print(" "); Serial.print(num, DEC);
+    Serial.print(" "); Serial.println(MAX10_PROGRAM_CHUNK_WORDS, DEC);
+    Serial.flush();
+
+    int_to_bin_array(ir_in, ISC_ENABLE, ir_len);
     insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+    delay(15);
 
-    // shift address value
+    int_to_bin_array(ir_in, ISC_ADDRESS_SHIFT, ir_len);
+    insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
     clear_reg(dr_in, 32);
     int_to_bin_array(dr_in, start, 23);
     insert_dr(dr_in, dr_out, 23, RUN_TEST_IDLE);
 
-    // shift read instruction
-    int_to_bin_array(ir_in, ir_len, ISC_READ);
+    int_to_bin_array(ir_in, ISC_PROGRAM, ir_len);
     insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
 
-    clear_reg(dr_in, 32);
+    clear_serial_rx_buf();
+    frame_rx_begin(&rx[cur], chunks[cur], sizeof(chunks[cur]));
+    Serial.write('R');
 
-    for (uint32_t j=start ; j < (start + num); j += 4)
+    while (programmed < num && rc == OK)
     {
-        // read data in burst fashion
-        insert_dr(dr_in, dr_out, 32, RUN_TEST_IDLE);
+        rc = frame_rx_wait(&rx[cur], MAX10_PROGRAM_TIMEOUT_MS);
+        if (rc != OK)
+            break;
 
-        // print address and corresponding data
-        bin_array_to_uint32(dr_out, 32, &res);
-        Serial.print("\n0x"); Serial.print(j, HEX);
-        Serial.print(": 0x"); Serial.print(res, HEX);
-        Serial.flush();
+        words = rx[cur].len / 4;
+        if (words == 0 || rx[cur].len % 4 != 0 || words > num - programmed)
+        {
+            rc = -ERR_BAD_PARAMETER;
+            break;
+        }
+
+        crc = crc32_update(crc, chunks[cur], rx[cur].len);
+
+        // ask for the next chunk, it arrives while this one is programmed
+        more = programmed + words < num;
+        if (more)
+        {
+            frame_rx_begin(&rx[cur ^ 1], chunks[cur ^ 1], sizeof(chunks[cur ^ 1]));
+            Serial.write('R');
+        }
+
+        for (uint32_t i = 0; i < words && rc == OK; i++)
+        {
+            word = (uint32_t)chunks[cur][4 * i] | ((uint32_t)chunks[cur][4 * i + 1] << 8) |
+                   ((uint32_t)chunks[cur][4 * i + 2] << 16) | ((uint32_t)chunks[cur][4 * i + 3] << 24);
+            int_to_bin_array(dr_in, word, 32);
+            insert_dr(dr_in, dr_out, 32, RUN_TEST_IDLE);
+            delayMicroseconds(MAX10_PROGRAM_WAIT_US);
+            programmed++;
+
+            // keep the serial RX buffer from overflowing
+            if (more)
+                rc = frame_rx_poll(&rx[cur ^ 1]);
+        }
+
+        cur ^= 1;
     }
+
+    int_to_bin_array(ir_in, ISC_DISABLE, ir_len);
+    insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+    delay(1);
+
+    if (rc != OK)
+    {
+        Serial.write('X');
+        Serial.print("\nProgramming failed after "); Serial.print(programmed, DEC);
+        Serial.print(" words, error: "); Serial.println(rc, DEC);
+        return rc;
+    }
+
+    // read back on the device, only the result crosses the link
+    clear_reg(dr_in, 32);
+    if (max10_crc_range(ir_len, ir_in, ir_out, dr_in, dr_out, start, num) != crc)
+    {
+        Serial.println("\nVerify failed: flash does not match the image");
+        return -ERR_BAD_CHECKSUM;
+    }
+
+    Serial.print("\nProgrammed and verified "); Serial.print(num, DEC);
+    Serial.print(" words, CRC32: 0x"); Serial.println(crc, HEX);
+
+    return OK;
 }
 
 /**
@@ -159,6 +495,55 @@ void max10_read_flash_session(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_
 }
 
 
+const max10_sector_t max10_sectors[MAX10_SECTORS] = {
+    { "UFM1", 0x00000, 0x1000 },
+    { "UFM0", 0x04000, 0x1000 },
+    { "CFM2", 0x08000, 0x5000 },
+    { "CFM1", 0x1c000, 0x5000 },
+    { "CFM0", 0x30000, 0xa000 },
+};
+
+/**
+ * @brief Wait the erase time, then blank check every word of sectors [first, last].
+ * The flash has no erase status over JTAG, a read while it erases is not
+ * defined, and the erase must not be cut short by ISC_DISABLE, so nothing
+ * is read before MAX10_ERASE_WAIT_MS.
+ * @return OK, or -ERR_NOT_BLANK.
+ */
+static status_t max10_check_erased(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t first, const uint32_t last)
+{
+    const max10_sector_t* sector;
+    uint32_t addr = 0;
+    status_t rc = OK;
+
+    delay(MAX10_ERASE_WAIT_MS);
+
+    for (uint32_t i = first; i <= last && rc == OK; i++)
+    {
+        sector = &max10_sectors[i];
+        rc = max10_blank_check(ir_len, ir_in, ir_out, dr_in, dr_out, sector->start, sector->words, &addr);
+    }
+
+    if (rc != OK) {
+        Serial.print("\nNot erased at 0x"); Serial.println(addr, HEX);
+    }
+
+    return rc;
+}
+
+/**
+ * @brief Print the result of an erase.
+ */
+static void max10_erase_report(status_t rc, uint32_t begin)
+{
+    if (rc != OK) {
+        Serial.println("\nErase failed");
+    }
+    else {
+        Serial.print("\nDone in "); Serial.print(millis() - begin, DEC); Serial.println(" ms");
+    }
+}
+
 /**
  * According to MAX10 BSDL
  * 
@@ -167,36 +552,127 @@ void max10_read_flash_session(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_
         "(ISC_ADDRESS_SHIFT 23:000000 WAIT TCK 1)" &
       "(DSM_CLEAR                   WAIT 350.0e-3)," &
  *
- * @brief Erase the entire flash
+ * @brief Erase the entire flash, and blank check every sector after the erase time.
  * @param ir_in Pointer to ir_in register.
  * @param ir_out Pointer to ir_out register.
+ * @return OK, or -ERR_NOT_BLANK.
  */
-void max10_erase_device(const uint8_t ir_len, uint8_t* ir_in, uint8_t * ir_out, uint8_t* dr_in, uint8_t* dr_out)
+status_t max10_erase_device(const uint8_t ir_len, uint8_t* ir_in, uint8_t * ir_out, uint8_t* dr_in, uint8_t* dr_out)
 {
+    uint32_t begin = 0;
+    status_t rc = OK;
+
     Serial.println("\nErasing device ...");
 
     clear_reg(ir_in, ir_len);
     clear_reg(dr_in, 32);
 
-    int_to_bin_array(ir_in, ir_len, ISC_ENABLE);
+    int_to_bin_array(ir_in, ISC_ENABLE, ir_len);
     insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
 
     delay(1);
 
-    int_to_bin_array(ir_in, ir_len, ISC_ADDRESS_SHIFT);
+    int_to_bin_array(ir_in, ISC_ADDRESS_SHIFT, ir_len);
     insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
     
-    int_to_bin_array(dr_in, 23, 0x00);
+    int_to_bin_array(dr_in, 0x00, 23);
     insert_dr(dr_in, dr_out, 23, RUN_TEST_IDLE);
 
+    begin = millis();
+    int_to_bin_array(ir_in, DSM_CLEAR, ir_len);
+    insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+
+    rc = max10_check_erased(ir_len, ir_in, ir_out, dr_in, dr_out, 0, MAX10_SECTORS - 1);
+
+    int_to_bin_array(ir_in, ISC_DISABLE, ir_len);
+    insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+
+    max10_erase_report(rc, begin);
+    return rc;
+}
+
+/**
+ * @brief Erase a single sector of the flash, selected by its address in ISC_ADDRESS_SHIFT,
+ * and blank check it after the erase time. The other sectors are kept, so the UFM can be
+ * updated without wiping the configuration image.
+ * @param ir_in Pointer to ir_in register.
+ * @param ir_out Pointer to ir_out register.
+ * @param sector Index in max10_sectors.
+ * @return OK, -ERR_OUT_OF_BOUNDS or -ERR_NOT_BLANK.
+ */
+status_t max10_erase_sector(const uint8_t ir_len, uint8_t* ir_in, uint8_t * ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t sector)
+{
+    uint32_t begin = 0;
+    status_t rc = OK;
+
+    if (sector >= MAX10_SECTORS)
+        return -ERR_OUT_OF_BOUNDS;
+
+    Serial.print("\nErasing sector "); Serial.print(max10_sectors[sector].name); Serial.println(" ...");
+
+    int_to_bin_array(ir_in, ISC_ENABLE, ir_len);
+    insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+
     delay(1);
 
-    int_to_bin_array(ir_in, ir_len, DSM_CLEAR);
+    int_to_bin_array(ir_in, ISC_ADDRESS_SHIFT, ir_len);
+    insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+
+    clear_reg(dr_in, 32);
+    int_to_bin_array(dr_in, max10_sectors[sector].start, 23);
+    insert_dr(dr_in, dr_out, 23, RUN_TEST_IDLE);
+
+    begin = millis();
+    int_to_bin_array(ir_in, ISC_ERASE, ir_len);
     insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
 
-    delay(400);
+    rc = max10_check_erased(ir_len, ir_in, ir_out, dr_in, dr_out, sector, sector);
+
+    int_to_bin_array(ir_in, ISC_DISABLE, ir_len);
+    insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+
+    max10_erase_report(rc, begin);
+    return rc;
+}
+
+// node map of the SLD hub, kept between menu commands
+static sld_hub_t hub;
+
+/**
+ * @brief Read a Virtual JTAG node register count times with a single VIR,
+ * and print the values.
+ * @param node Index of the node in the node map.
+ * @param instr Node instruction that selects the register.
+ * @param len Length of the register, 1 to 32.
+ * @param count Number of reads.
+ */
+static void max10_vjtag_read(sld_hub_t* hub, uint32_t node, uint32_t instr, uint32_t len, uint32_t count)
+{
+    uint32_t values[MAX10_DUMP_FRAME_WORDS];
+    uint32_t n;
+    status_t rc;
 
-    Serial.println("\nDone");
+    for (uint32_t done = 0; done < count; done += n)
+    {
+        n = min(count - done, (uint32_t)MAX10_DUMP_FRAME_WORDS);
+
+        // the VIR is shifted only for the first batch
+        rc = sld_access(hub, node, instr, nullptr, values, len, n);
+        if (rc != OK)
+        {
+            Serial.print("\nVirtual JTAG access failed: "); Serial.println(rc, DEC);
+            return;
+        }
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if ((done + i) % 8 == 0)
+                Serial.println();
+            Serial.print("0x"); Serial.print(values[i], HEX); Serial.print(" ");
+        }
+    }
+    Serial.println();
+    Serial.flush();
 }
 
 void max10_print_menu()
@@ -206,6 +682,14 @@ void max10_print_menu()
     Serial.print("a - Read flash\n");
     Serial.print("b - Read user code\n");
     Serial.print("c - Erase flash\n");
+    Serial.print("s - Erase a single sector\n");
+    Serial.print("d - Dump flash range to host (binary)\n");
+    Serial.print("e - CRC32 of flash range\n");
+    Serial.print("f - Blank check of flash range\n");
+    Serial.print("g - Incremental dump of flash range to host (changed sectors only)\n");
+    Serial.print("p - Program flash range from host image\n");
+    Serial.print("h - Enumerate SLD hub nodes (Virtual JTAG)\n");
+    Serial.print("v - Batched read of a Virtual JTAG node register\n");
     Serial.print("z - Exit\n");
     Serial.flush();
 }
@@ -216,6 +700,11 @@ void max10_print_menu()
  */
 void max10_main(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out)
 {
+    uint32_t start = 0;
+    uint32_t num = 0;
+    uint32_t first = 0;
+    uint32_t len = 0;
+
     max10_print_menu();
     char command = get_character("\nmax10 > ");
 
@@ -239,6 +728,106 @@ void max10_main(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t*
         max10_erase_device(ir_len, ir_in, ir_out, dr_in, dr_out);
         break;
 
+    case 'd':
+        // stream a flash range to the host tool, which writes it to an image file
+        if (parse_number(NULL, 32, "\nInsert start addr > ", &start) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert amount of words to dump > ", &num) != OK)
+            break;
+        reset_tap();
+        max10_dump_range(ir_len, ir_in, ir_out, dr_in, dr_out, start, num);
+        break;
+
+    case 'e':
+        // checksum a range on the device, only the digest crosses the link
+        if (parse_number(NULL, 32, "\nInsert start addr > ", &start) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert amount of words > ", &num) != OK)
+            break;
+        reset_tap();
+        Serial.print("\nCRC32: 0x");
+        Serial.println(max10_crc_range(ir_len, ir_in, ir_out, dr_in, dr_out, start, num), HEX);
+        break;
+
+    case 'f':
+        // check that a range is erased
+        if (parse_number(NULL, 32, "\nInsert start addr > ", &start) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert amount of words > ", &num) != OK)
+            break;
+        reset_tap();
+        if (max10_blank_check(ir_len, ir_in, ir_out, dr_in, dr_out, start, num, &first) == OK) {
+            Serial.println("\nBlank");
+        }
+        else {
+            Serial.print("\nNot blank at 0x"); Serial.println(first, HEX);
+        }
+        break;
+
+    case 'g':
+        // stream only the sectors that changed since the host's last dump of the range
+        if (parse_number(NULL, 32, "\nInsert start addr > ", &start) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert amount of words to dump > ", &num) != OK)
+            break;
+        reset_tap();
+        max10_dump_range_incremental(ir_len, ir_in, ir_out, dr_in, dr_out, start, num, MAX10_SECTOR_MAX_WORDS);
+        break;
+
+    case 'p':
+        // program a range with an image streamed by the host tool
+        if (parse_number(NULL, 32, "\nInsert start addr > ", &start) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert amount of words to program > ", &num) != OK)
+            break;
+        reset_tap();
+        max10_program_range(ir_len, ir_in, ir_out, dr_in, dr_out, start, num);
+        break;
+
+    case 's':
+        // erase one of the UFM / CFM sectors, keeping the others
+        for (uint32_t i = 0; i < MAX10_SECTORS; i++)
+        {
+            Serial.print("\n"); Serial.print(i, DEC); Serial.print(" - ");
+            Serial.print(max10_sectors[i].name); Serial.print(" at 0x");
+            Serial.print(max10_sectors[i].start, HEX);
+        }
+        if (parse_number(NULL, 32, "\nInsert sector > ", &num) != OK)
+            break;
+        reset_tap();
+        max10_erase_sector(ir_len, ir_in, ir_out, dr_in, dr_out, num);
+        break;
+
+    case 'h':
+        // read and cache the node map of the SLD hub
+        reset_tap();
+        sld_hub_init(&hub, ir_len, ir_in, ir_out, dr_in, dr_out);
+        if (sld_hub_enumerate(&hub) == OK)
+            sld_hub_print(&hub);
+        break;
+
+    case 'v':
+        // bulk read of a node register, the node is selected once for all the reads
+        if (hub.count == 0)
+        {
+            Serial.println("\nEnumerate the SLD hub first");
+            break;
+        }
+        sld_hub_print(&hub);
+        if (parse_number(NULL, 32, "\nInsert node > ", &start) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert node instruction > ", &first) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert register length > ", &len) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert amount of reads > ", &num) != OK)
+            break;
+        // other commands reset the TAP, which also resets the VIR of the hub
+        reset_tap();
+        sld_vir_invalidate(&hub);
+        max10_vjtag_read(&hub, start, first, len, num);
+        break;
+
     case 'z':
         // quit max10 commands menu
         Serial.print("\nGoing back to main menu...");
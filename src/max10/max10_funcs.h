@@ -3,11 +3,79 @@
 
 #include <stdint.h>
 
+#include "../../include/status.h"
+
+/**
+ * Number of 32 bit words in every binary frame of a flash dump.
+ */
+#define MAX10_DUMP_FRAME_WORDS 64
+
+/**
+ * Largest sector (in 32 bit words) of an incremental dump, a whole sector
+ * is held in SRAM while its checksum is compared.
+ */
+#define MAX10_SECTOR_MAX_WORDS 256
+
+/**
+ * Number of sector checksums the host sends per request of an incremental dump.
+ * Keep their size (4 bytes each) below the serial RX buffer.
+ */
+#define MAX10_SECTOR_BATCH 16
+
+/**
+ * Number of 32 bit words in every chunk of a programming image from the host.
+ * Two chunks are buffered, one is programmed while the next one arrives.
+ */
+#define MAX10_PROGRAM_CHUNK_WORDS 64
+
+/**
+ * Time to wait in RTI after every programmed word (BSDL: ISC_PROGRAM WAIT 350.0e-6).
+ */
+#define MAX10_PROGRAM_WAIT_US 350
+
+/**
+ * Time to wait for a chunk of the image from the host.
+ */
+#define MAX10_PROGRAM_TIMEOUT_MS 2000
+
+/**
+ * The flash has no erase status over JTAG, and is not read while it erases:
+ * the erase time of the BSDL (DSM_CLEAR WAIT 350.0e-3, taken for ISC_ERASE
+ * as well) passes first, then the erased sectors are blank checked.
+ */
+#define MAX10_ERASE_WAIT_MS 350
+
+/**
+ * A flash sector that can be erased on its own.
+ */
+typedef struct
+{
+    const char* name;
+    uint32_t start;     // first address, selects the sector in ISC_ADDRESS_SHIFT
+    uint32_t words;     // size in 32 bit words
+} max10_sector_t;
+
+#define MAX10_SECTORS 5
+
+/**
+ * Sector map of the 10M08 (dual configuration image). Other densities have
+ * other sector sizes, take them from the address map of the On-Chip Flash IP.
+ */
+extern const max10_sector_t max10_sectors[MAX10_SECTORS];
+
 uint32_t max10_read_user_code(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out);
 void max10_read_ufm_range(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num);
+void max10_burst_begin(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start);
+uint32_t max10_burst_next(uint8_t* dr_in, uint8_t* dr_out);
 void max10_read_ufm_range_burst(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num);
+void max10_dump_range(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num);
+status_t max10_dump_range_incremental(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num, const uint32_t sector_words);
+status_t max10_program_range(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num);
+uint32_t max10_crc_range(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num);
+status_t max10_blank_check(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t start, const uint32_t num, uint32_t* first);
 void max10_read_flash_session(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out);
-void max10_erase_device(const uint8_t ir_len, uint8_t* ir_in, uint8_t * ir_out, uint8_t* dr_in, uint8_t* dr_out);
+status_t max10_erase_device(const uint8_t ir_len, uint8_t* ir_in, uint8_t * ir_out, uint8_t* dr_in, uint8_t* dr_out);
+status_t max10_erase_sector(const uint8_t ir_len, uint8_t* ir_in, uint8_t * ir_out, uint8_t* dr_in, uint8_t* dr_out, const uint32_t sector);
 void max10_main(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out);
 
 #endif
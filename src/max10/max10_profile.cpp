@@ -0,0 +1,60 @@
+/* --------------------------------------------------------------------------------------- */
+/* ----------------------- Device profile of the MAX10 FPGA family -------------------------*/
+/* --------------------------------------------------------------------------------------- */
+#include <stdint.h>
+
+#include "max10_ir.h"
+#include "max10_funcs.h"
+#include "../profile/profile.h"
+
+static constexpr profile_part_t max10_parts[] = {
+    { "10M02", 0x031810dd },
+    { "10M04", 0x0318a0dd },
+    { "10M08", 0x031820dd },
+    { "10M16", 0x031830dd },
+    { "10M25", 0x031840dd },
+    { "10M40", 0x0318d0dd },
+    { "10M50", 0x031850dd },
+};
+
+// DR lengths of the BSDL, boundary scan and SLD hub registers depend on the part or the design
+static constexpr profile_instr_t max10_instrs[] = {
+    { "PULSE_NCONFIG",      PULSE_NCONFIG,      1,  0 },
+    { "PRELOAD_SAMPLE",     PRELOAD_SAMPLE,     0,  0 },
+    { "IDCODE",             IDCODE,             32, 0 },
+    { "USERCODE",           USERCODE,           32, 0 },
+    { "CLAMP",              CLAMP,              1,  0 },
+    { "HIGHZ",              HIGHZ,              1,  0 },
+    { "USER0",              USER0,              0,  0 },
+    { "CONFIG_IO",          CONFIG_IO,          0,  0 },
+    { "USER1",              USER1,              0,  0 },
+    { "EXTEST",             EXTEST,             0,  0 },
+    { "ISC_DISABLE",        ISC_DISABLE,        1,  0 },
+    { "ISC_ADDRESS_SHIFT",  ISC_ADDRESS_SHIFT,  23, 0 },
+    { "ISC_READ",           ISC_READ,           32, 0 },
+    { "ISC_NOOP",           ISC_NOOP,           1,  0 },
+    { "ISC_ENABLE",         ISC_ENABLE,         1,  0 },
+    { "ISC_ERASE",          ISC_ERASE,          1,  0 },
+    { "ISC_PROGRAM",        ISC_PROGRAM,        32, 0 },
+    { "DSM_CLEAR",          DSM_CLEAR,          1,  0 },
+    { "BYPASS",             BYPASS,             1,  0 },
+
+    // undocumented, found by discovery
+    { "UNDOC_90",           0x90,               4,  0 },
+    { "UNDOC_206",          0x206,              32, 0 },
+    { "UNDOC_207",          0x207,              32, 0 },
+    { "UNDOC_303",          0x303,              16, 0 },
+};
+
+// all the parts share the Altera manufacturer ID and the 0x318 family bits
+extern constexpr profile_t max10_profile = {
+    "MAX10",
+    10,
+    0x0fff0fff,
+    0x031800dd,
+    max10_parts,
+    sizeof(max10_parts) / sizeof(max10_parts[0]),
+    max10_instrs,
+    sizeof(max10_instrs) / sizeof(max10_instrs[0]),
+    max10_main,
+};
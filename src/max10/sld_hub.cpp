@@ -0,0 +1,184 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "sld_hub.h"
+#include "max10_ir.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+void sld_hub_init(sld_hub_t* hub, const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out)
+{
+    memset(hub, 0, sizeof(sld_hub_t));
+    hub->ir_len = ir_len;
+    hub->ir_in = ir_in;
+    hub->ir_out = ir_out;
+    hub->dr_in = dr_in;
+    hub->dr_out = dr_out;
+}
+
+void sld_vir_invalidate(sld_hub_t* hub) { hub->vir_valid = false; }
+
+/**
+ * @brief Shift a value into the DR selected by a MAX10 instruction.
+ */
+static uint32_t sld_scan(sld_hub_t* hub, uint32_t instruction, uint32_t in, uint32_t len)
+{
+    uint32_t res = 0;
+
+    // a repeated instruction is dropped by the IR shadow cache
+    int_to_bin_array(hub->ir_in, instruction, hub->ir_len);
+    insert_ir(hub->ir_in, hub->ir_out, hub->ir_len, RUN_TEST_IDLE);
+
+    int_to_bin_array(hub->dr_in, in, len);
+    insert_dr(hub->dr_in, hub->dr_out, len, RUN_TEST_IDLE);
+    bin_array_to_uint32(hub->dr_out, len, &res);
+
+    return res;
+}
+
+/**
+ * @brief Read a 32 bit info word as 8 nibble VDR scans, least significant nibble first.
+ */
+static uint32_t sld_read_info(sld_hub_t* hub)
+{
+    uint32_t info = 0;
+
+    for (uint32_t i = 0; i < 8; i++)
+        info |= (sld_scan(hub, USER0, 0, 4) & 0x0f) << (4 * i);
+
+    return info;
+}
+
+status_t sld_hub_enumerate(sld_hub_t* hub)
+{
+    uint32_t nodes, addr_len = 0;
+
+    hub->count = 0;
+    hub->vir_valid = false;
+
+    // VIR of zeros selects the hub info (address 0, instruction 0), its width is still unknown
+    int_to_bin_array(hub->ir_in, USER1, hub->ir_len);
+    insert_ir(hub->ir_in, hub->ir_out, hub->ir_len, RUN_TEST_IDLE);
+    clear_reg(hub->dr_in, SLD_HUB_INFO_SCAN_LEN);
+    insert_dr(hub->dr_in, hub->dr_out, SLD_HUB_INFO_SCAN_LEN, RUN_TEST_IDLE);
+
+    hub->info = sld_read_info(hub);
+    nodes = (hub->info >> 19) & 0xff;
+    hub->instr_len = hub->info & 0xff;
+
+    // address bits to select the hub (0) and every node (1 .. nodes)
+    while ((1UL << addr_len) < nodes + 1)
+        addr_len++;
+    hub->addr_len = addr_len;
+    hub->vir_len = hub->instr_len + addr_len;
+
+    if (hub->info == 0 || hub->info == 0xffffffff || hub->instr_len == 0 || hub->instr_len >= 32 || hub->vir_len > 32)
+    {
+        Serial.println("\nNo SLD hub found");
+        return -ERR_TAP_DEVICE_UNAVAILABLE;
+    }
+
+    // the node infos follow the hub info
+    for (uint32_t i = 0; i < nodes; i++)
+    {
+        uint32_t info = sld_read_info(hub);
+        if (i >= SLD_MAX_NODES)
+            continue;
+
+        sld_node_t* node = &hub->nodes[hub->count++];
+        node->info = info;
+        node->instance = info & 0xff;
+        node->mfg = (info >> 8) & 0x7ff;
+        node->id = (info >> 19) & 0xff;
+        node->version = info >> 27;
+    }
+
+    if (nodes > SLD_MAX_NODES)
+        Serial.println("\nToo many SLD nodes, only the first ones are kept");
+
+    return OK;
+}
+
+void sld_hub_print(const sld_hub_t* hub)
+{
+    const sld_node_t* node;
+
+    Serial.print("\nSLD hub info: 0x"); Serial.print(hub->info, HEX);
+    Serial.print(" instruction bits: "); Serial.print(hub->instr_len, DEC);
+    Serial.print(" address bits: "); Serial.print(hub->addr_len, DEC);
+    Serial.print(" nodes: "); Serial.println(hub->count, DEC);
+
+    for (uint32_t i = 0; i < hub->count; i++)
+    {
+        node = &hub->nodes[i];
+        Serial.print(i, DEC); Serial.print(" - id: "); Serial.print(node->id, DEC);
+        Serial.print(" instance: "); Serial.print(node->instance, DEC);
+        Serial.print(" mfg: 0x"); Serial.print(node->mfg, HEX);
+        Serial.print(" version: "); Serial.print(node->version, DEC);
+        if (node->id == SLD_NODE_ID_JTAG_UART)
+            Serial.print(" (JTAG UART)");
+        Serial.println();
+    }
+    Serial.flush();
+}
+
+int sld_hub_find(const sld_hub_t* hub, uint8_t id, uint8_t instance)
+{
+    for (uint32_t i = 0; i < hub->count; i++)
+    {
+        if (hub->nodes[i].id == id && hub->nodes[i].instance == instance)
+            return i;
+    }
+
+    return -ERR_NOT_FOUND;
+}
+
+status_t sld_vir(sld_hub_t* hub, uint32_t node, uint32_t instr)
+{
+    uint32_t vir;
+
+    if (node >= hub->count)
+        return -ERR_OUT_OF_BOUNDS;
+
+    if (instr >= (1UL << hub->instr_len))
+        return -ERR_BAD_PARAMETER;
+
+    // node addresses start at 1 above the instruction, the hub itself is 0
+    vir = ((node + 1) << hub->instr_len) | instr;
+    if (hub->vir_valid && hub->vir == vir)
+        return OK;
+
+    sld_scan(hub, USER1, vir, hub->vir_len);
+    hub->vir = vir;
+    hub->vir_valid = true;
+
+    return OK;
+}
+
+uint32_t sld_vdr(sld_hub_t* hub, uint32_t in, uint32_t len)
+{
+    return sld_scan(hub, USER0, in, len);
+}
+
+status_t sld_access(sld_hub_t* hub, uint32_t node, uint32_t instr, const uint32_t* in, uint32_t* out, uint32_t len, uint32_t count)
+{
+    uint32_t res;
+    status_t rc;
+
+    if (len == 0 || len > 32)
+        return -ERR_INVALID_IR_OR_DR_LEN;
+
+    rc = sld_vir(hub, node, instr);
+    if (rc != OK)
+        return rc;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        res = sld_vdr(hub, in ? in[i] : 0, len);
+        if (out)
+            out[i] = res;
+    }
+
+    return OK;
+}
@@ -0,0 +1,122 @@
+/** @file sld_hub.h
+ *
+ * @brief Access to Intel's SLD hub (System Level Debug), which connects
+ * the Virtual JTAG nodes of a design (Signal Tap, JTAG UART, user
+ * Virtual JTAG instances ...) to the device TAP.
+ *
+ *  - VIR scan: IR = USER1, DR = virtual instruction of a node, m + n bits.
+ *    VIR value = (node address << m) | node instruction, where m is the
+ *    node instruction width (hub info [7:0]) and n the address width,
+ *    enough bits for the hub (address 0) and every node.
+ *  - VDR scan: IR = USER0, DR = data register selected by the last VIR.
+ *
+ * The hub and node infos are read once and cached. The last VIR value is
+ * cached too, so batched accesses to a node shift its VIR only once, and
+ * the IR shadow cache of the driver drops the repeated USER0 loads.
+ */
+#ifndef __SLD_HUB__H__
+#define __SLD_HUB__H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+
+/**
+ * Maximum number of nodes kept in the node map.
+ */
+#define SLD_MAX_NODES 16
+
+/**
+ * Width of the VIR scan that selects the hub info, wider than any hub VIR.
+ */
+#define SLD_HUB_INFO_SCAN_LEN 64
+
+/**
+ * Node ID of Intel's JTAG UART.
+ */
+#define SLD_NODE_ID_JTAG_UART 128
+
+typedef struct
+{
+    uint32_t info;      // raw node info
+    uint8_t id;         // node ID [26:19]
+    uint8_t instance;   // instance [7:0]
+    uint8_t version;    // version [31:27]
+    uint16_t mfg;       // manufacturer ID [18:8]
+} sld_node_t;
+
+typedef struct
+{
+    // driver context of the MAX10 TAP
+    uint8_t ir_len;
+    uint8_t* ir_in;
+    uint8_t* ir_out;
+    uint8_t* dr_in;
+    uint8_t* dr_out;
+
+    uint32_t info;      // raw hub info
+    uint8_t instr_len;  // m, node instruction width
+    uint8_t addr_len;   // n, node address width
+    uint8_t vir_len;    // m + n, VIR scan width
+    uint8_t count;      // number of nodes in the node map
+    sld_node_t nodes[SLD_MAX_NODES];
+
+    bool vir_valid;     // vir holds the VIR value loaded in the hub
+    uint32_t vir;
+} sld_hub_t;
+
+/**
+ * @brief Attach the hub to the MAX10 TAP and the driver's registers.
+ * The node map is empty until sld_hub_enumerate() is called.
+ */
+void sld_hub_init(sld_hub_t* hub, const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out);
+
+/**
+ * @brief Read the hub info and the info of every node, and cache them.
+ * @return OK, or -ERR_TAP_DEVICE_UNAVAILABLE if no hub answers.
+ */
+status_t sld_hub_enumerate(sld_hub_t* hub);
+
+/**
+ * @brief Print the cached hub and node map.
+ */
+void sld_hub_print(const sld_hub_t* hub);
+
+/**
+ * @brief Find a node in the node map by its ID and instance.
+ * @return Index of the node, or -ERR_NOT_FOUND.
+ */
+int sld_hub_find(const sld_hub_t* hub, uint8_t id, uint8_t instance);
+
+/**
+ * @brief Load a virtual instruction into a node. Skipped if it is already loaded.
+ * @param node Index of the node in the node map.
+ * @param instr Node instruction, m bits.
+ */
+status_t sld_vir(sld_hub_t* hub, uint32_t node, uint32_t instr);
+
+/**
+ * @brief Scan the virtual data register selected by the last VIR.
+ * @param in Value to shift in, up to 32 bits.
+ * @param len Length of the data register, 1 to 32.
+ * @return The shifted out value.
+ */
+uint32_t sld_vdr(sld_hub_t* hub, uint32_t in, uint32_t len);
+
+/**
+ * @brief Batched access: a single VIR, followed by count VDR scans.
+ * @param node Index of the node in the node map.
+ * @param instr Node instruction.
+ * @param in Values to shift in, or nullptr to shift zeros.
+ * @param out Shifted out values, or nullptr.
+ * @param len Length of the data register, 1 to 32.
+ * @param count Number of VDR scans.
+ */
+status_t sld_access(sld_hub_t* hub, uint32_t node, uint32_t instr, const uint32_t* in, uint32_t* out, uint32_t len, uint32_t count);
+
+/**
+ * @brief Forget the cached VIR, after the TAP was reset.
+ */
+void sld_vir_invalidate(sld_hub_t* hub);
+
+#endif
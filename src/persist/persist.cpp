@@ -0,0 +1,245 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "persist.h"
+#include "../irmap/irmap.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+#if defined(ARDUINO_ARCH_SAM)
+// last pages of flash bank 1, the sketch runs from bank 0 while they are written
+#define PERSIST_PAGE_SIZE IFLASH1_PAGE_SIZE
+#define PERSIST_SIZE      (64 * IFLASH1_PAGE_SIZE)
+#define PERSIST_ADDR      (IFLASH1_ADDR + IFLASH1_SIZE - PERSIST_SIZE)
+#elif defined(ARDUINO_ARCH_AVR)
+#include <EEPROM.h>
+#define PERSIST_PAGE_SIZE 32
+#define PERSIST_SIZE      (E2END + 1)
+#else
+#define PERSIST_PAGE_SIZE 32
+#define PERSIST_SIZE      (16 * 1024)
+static uint8_t persist_ram[PERSIST_SIZE];
+#endif
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t layout;   // sizeof(chain_t), another build may lay it out differently
+    uint32_t length;   // number of bytes after the header
+    uint32_t crc;      // CRC-32 of the bytes after the header
+} persist_header_t;
+
+// followed by the chain table and irmap_count instruction map entries
+typedef struct
+{
+    uint32_t tck_delay_us;
+    uint32_t irmap_part;
+    uint32_t irmap_count;
+} persist_settings_t;
+
+// pages are written whole, data is collected here first
+static uint32_t page_buf[PERSIST_PAGE_SIZE / 4];
+static uint32_t page_fill = 0;
+static uint32_t page_offset = 0;
+
+static void storage_read(uint32_t offset, void* data, uint32_t len)
+{
+#if defined(ARDUINO_ARCH_SAM)
+    memcpy(data, (const void*)(PERSIST_ADDR + offset), len);
+#elif defined(ARDUINO_ARCH_AVR)
+    for (uint32_t i = 0; i < len; i++)
+        ((uint8_t*)data)[i] = EEPROM.read(offset + i);
+#else
+    memcpy(data, &persist_ram[offset], len);
+#endif
+}
+
+static status_t storage_program_page(uint32_t offset, const uint32_t* page)
+{
+#if defined(ARDUINO_ARCH_SAM)
+    volatile uint32_t* dst = (volatile uint32_t*)(PERSIST_ADDR + offset);
+    uint32_t page_num = (PERSIST_ADDR + offset - IFLASH1_ADDR) / IFLASH1_PAGE_SIZE;
+
+    // fill the latch buffer of the EEFC, then erase and write the page
+    for (uint32_t i = 0; i < PERSIST_PAGE_SIZE / 4; i++)
+        dst[i] = page[i];
+
+    if (efc_perform_command(EFC1, EFC_FCMD_EWP, page_num) != EFC_RC_OK)
+        return -ERR_GENERAL;
+#elif defined(ARDUINO_ARCH_AVR)
+    // only the bytes that changed are written, sparing the EEPROM
+    for (uint32_t i = 0; i < PERSIST_PAGE_SIZE; i++)
+        EEPROM.update(offset + i, ((const uint8_t*)page)[i]);
+#else
+    memcpy(&persist_ram[offset], page, PERSIST_PAGE_SIZE);
+#endif
+
+    return OK;
+}
+
+static status_t storage_write(const void* data, uint32_t len)
+{
+    const uint8_t* src = (const uint8_t*)data;
+    status_t rc = OK;
+
+    while (len > 0)
+    {
+        uint32_t n = min(len, (uint32_t)(PERSIST_PAGE_SIZE - page_fill));
+
+        memcpy((uint8_t*)page_buf + page_fill, src, n);
+        page_fill += n;
+        src += n;
+        len -= n;
+
+        if (page_fill == PERSIST_PAGE_SIZE)
+        {
+            rc = storage_program_page(page_offset, page_buf);
+            if (rc != OK)
+                return rc;
+
+            page_offset += PERSIST_PAGE_SIZE;
+            page_fill = 0;
+        }
+    }
+
+    return OK;
+}
+
+static status_t storage_flush()
+{
+    status_t rc = OK;
+
+    if (page_fill > 0)
+    {
+        memset((uint8_t*)page_buf + page_fill, 0xff, PERSIST_PAGE_SIZE - page_fill);
+        rc = storage_program_page(page_offset, page_buf);
+    }
+
+    page_fill = 0;
+    page_offset = 0;
+
+    return rc;
+}
+
+status_t persist_save(const chain_t* chain)
+{
+    persist_header_t header, saved;
+    persist_settings_t settings;
+    uint32_t room = (PERSIST_SIZE - sizeof(persist_header_t) - sizeof(persist_settings_t) - sizeof(chain_t)) / sizeof(irmap_entry_t);
+    status_t rc = OK;
+
+    settings.tck_delay_us = tck_delay_us;
+    settings.irmap_part = irmap_part();
+    settings.irmap_count = min(irmap_count(), room);
+
+    header.magic = PERSIST_MAGIC;
+    header.version = PERSIST_VERSION;
+    header.layout = sizeof(chain_t);
+    header.length = sizeof(settings) + sizeof(chain_t) + settings.irmap_count * sizeof(irmap_entry_t);
+    header.crc = crc32_update(0, (const uint8_t*)&settings, sizeof(settings));
+    header.crc = crc32_update(header.crc, (const uint8_t*)chain, sizeof(chain_t));
+    header.crc = crc32_update(header.crc, (const uint8_t*)irmap_entries(), settings.irmap_count * sizeof(irmap_entry_t));
+
+    // nothing changed, spare the flash an erase cycle
+    storage_read(0, &saved, sizeof(saved));
+    if (memcmp(&saved, &header, sizeof(header)) == 0)
+    {
+        Serial.println("\nConfiguration is already saved");
+        return OK;
+    }
+
+    page_fill = 0;
+    page_offset = 0;
+    rc = storage_write(&header, sizeof(header));
+    if (rc == OK)
+        rc = storage_write(&settings, sizeof(settings));
+    if (rc == OK)
+        rc = storage_write(chain, sizeof(chain_t));
+    if (rc == OK)
+        rc = storage_write(irmap_entries(), settings.irmap_count * sizeof(irmap_entry_t));
+    if (rc == OK)
+        rc = storage_flush();
+
+    if (rc != OK)
+    {
+        Serial.println("\nFailed writing the configuration");
+        return rc;
+    }
+
+    Serial.print("\nSaved configuration: "); Serial.print(chain->count, DEC);
+    Serial.print(" devices, "); Serial.print(settings.irmap_count, DEC);
+    Serial.println(" known instructions");
+    if (settings.irmap_count < irmap_count())
+        Serial.println("Not enough room for the whole instruction map");
+    Serial.flush();
+
+    return OK;
+}
+
+status_t persist_load(chain_t* chain)
+{
+    persist_header_t header;
+    persist_settings_t settings;
+    irmap_entry_t entry;
+    uint8_t chunk[64];
+    uint32_t crc = 0;
+    uint32_t offset, n;
+
+    storage_read(0, &header, sizeof(header));
+    if (header.magic != PERSIST_MAGIC || header.version != PERSIST_VERSION || header.layout != sizeof(chain_t))
+        return -ERR_NOT_FOUND;
+
+    if (header.length < sizeof(settings) + sizeof(chain_t) || header.length > PERSIST_SIZE - sizeof(header))
+        return -ERR_BAD_CHECKSUM;
+
+    for (offset = 0; offset < header.length; offset += n)
+    {
+        n = min((uint32_t)sizeof(chunk), header.length - offset);
+        storage_read(sizeof(header) + offset, chunk, n);
+        crc = crc32_update(crc, chunk, n);
+    }
+
+    if (crc != header.crc)
+    {
+        Serial.println("\nSaved configuration is corrupted");
+        return -ERR_BAD_CHECKSUM;
+    }
+
+    offset = sizeof(header);
+    storage_read(offset, &settings, sizeof(settings));
+    offset += sizeof(settings);
+    if (header.length != sizeof(settings) + sizeof(chain_t) + settings.irmap_count * sizeof(irmap_entry_t))
+        return -ERR_BAD_CHECKSUM;
+
+    storage_read(offset, chain, sizeof(chain_t));
+    offset += sizeof(chain_t);
+
+    tck_delay_us = settings.tck_delay_us;
+
+    irmap_assign(settings.irmap_part);
+    for (uint32_t i = 0; i < settings.irmap_count; i++)
+    {
+        storage_read(offset, &entry, sizeof(entry));
+        offset += sizeof(entry);
+        irmap_put(entry.ir, entry.dr_len, entry.capture);
+    }
+
+    return OK;
+}
+
+status_t persist_erase()
+{
+    persist_header_t header;
+    status_t rc = OK;
+
+    memset(&header, 0, sizeof(header));
+
+    page_fill = 0;
+    page_offset = 0;
+    rc = storage_write(&header, sizeof(header));
+    if (rc == OK)
+        rc = storage_flush();
+
+    return rc;
+}
@@ -0,0 +1,46 @@
+/** @file persist.h
+ *
+ * @brief Saved configuration of the Jtagger in on-chip non volatile memory:
+ * the chain table, the TCK half-clock delay and the instruction map
+ * (known DR lengths) of the selected part, protected by a CRC-32.
+ *
+ * At boot the saved chain is checked with a single IDCODE scan
+ * (see chain_verify_idcodes), instead of a full chain detection.
+ *
+ * Storage:
+ *   Arduino Due  - the last 16KB of flash bank 1, written with the EEFC.
+ *                  Note that uploading a sketch erases the whole flash.
+ *   AVR boards   - the EEPROM. The instruction map is cut to what fits.
+ *   other        - a RAM buffer, the configuration is lost on reset.
+ */
+#ifndef __PERSIST__H__
+#define __PERSIST__H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+#include "../chain/chain.h"
+
+#define PERSIST_MAGIC 0x4746434a   // "JCFG"
+#define PERSIST_VERSION 1
+
+/**
+ * @brief Save the chain table, the TCK delay and the instruction map.
+ * Only written if it differs from what is already saved.
+ */
+status_t persist_save(const chain_t* chain);
+
+/**
+ * @brief Load the saved configuration, if there is a valid one.
+ * Restores the TCK delay and the instruction map. The chain table is
+ * copied as is, select a device afterwards to program the driver's padding.
+ * @param chain Output chain table, only written if the configuration is valid.
+ */
+status_t persist_load(chain_t* chain);
+
+/**
+ * @brief Invalidate the saved configuration, next boot runs a full chain detection.
+ */
+status_t persist_erase();
+
+#endif
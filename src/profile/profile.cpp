@@ -0,0 +1,85 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "profile.h"
+#include "../irmap/irmap.h"
+
+extern const profile_t max10_profile;
+extern const profile_t arm_profile;
+extern const profile_t riscv_profile;
+extern const profile_t xc7_profile;
+
+// all the known families
+static const profile_t* const profiles[] = {
+    &max10_profile,
+    &arm_profile,
+    &riscv_profile,
+    &xc7_profile,
+};
+
+const profile_t* profile_find(uint32_t idcode)
+{
+    for (uint32_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+    {
+        if ((idcode & profiles[i]->idcode_mask) == profiles[i]->idcode)
+            return profiles[i];
+    }
+
+    return nullptr;
+}
+
+const char* profile_part_name(uint32_t idcode)
+{
+    const profile_t* profile = profile_find(idcode);
+
+    if (profile == nullptr)
+        return nullptr;
+
+    for (uint32_t i = 0; i < profile->part_count; i++)
+    {
+        if (profile->parts[i].idcode == (idcode & IRMAP_IDCODE_MASK))
+            return profile->parts[i].name;
+    }
+
+    return profile->name;
+}
+
+const profile_instr_t* profile_instr(const profile_t* profile, const char* name)
+{
+    for (uint32_t i = 0; i < profile->instr_count; i++)
+    {
+        if (strcmp(profile->instrs[i].name, name) == 0)
+            return &profile->instrs[i];
+    }
+
+    return nullptr;
+}
+
+const profile_instr_t* profile_instr_by_ir(const profile_t* profile, uint32_t ir)
+{
+    for (uint32_t i = 0; i < profile->instr_count; i++)
+    {
+        if (profile->instrs[i].ir == ir)
+            return &profile->instrs[i];
+    }
+
+    return nullptr;
+}
+
+uint32_t profile_seed_irmap(const profile_t* profile)
+{
+    const profile_instr_t* instr;
+    uint32_t added = 0;
+
+    for (uint32_t i = 0; i < profile->instr_count; i++)
+    {
+        instr = &profile->instrs[i];
+        if (instr->dr_len == 0 || irmap_get(instr->ir) != nullptr)
+            continue;
+
+        if (irmap_put(instr->ir, instr->dr_len, instr->capture) == OK)
+            added++;
+    }
+
+    return added;
+}
@@ -0,0 +1,81 @@
+/** @file profile.h
+ *
+ * @brief Registry of device profiles. A profile describes a device family:
+ * the IR length, the named instructions with their known DR lengths and
+ * capture values, and optional hooks for family specific operations.
+ *
+ * The profile of a device is picked by its IDCODE. Its instructions seed
+ * the instruction map (irmap.h), so scans of a known part are sized without
+ * probing, and discovery only probes the instructions the profile lacks.
+ *
+ * To add a family, define its profile next to its code (see max10_profile.cpp)
+ * and list it in the registry of profile.cpp.
+ */
+#ifndef __PROFILE__H__
+#define __PROFILE__H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+
+typedef struct
+{
+    const char* name;
+    uint32_t ir;
+    uint16_t dr_len;    // 0 if it depends on the part or the design
+    uint32_t capture;   // value captured by the DR, 0 if unknown
+} profile_instr_t;
+
+typedef struct
+{
+    const char* name;
+    uint32_t idcode;        // IDCODE without the version field
+} profile_part_t;
+
+typedef struct
+{
+    const char* name;
+    uint8_t ir_len;
+    uint32_t idcode_mask;   // IDCODE bits that identify the family
+    uint32_t idcode;        // value of these bits
+    const profile_part_t* parts;
+    uint32_t part_count;
+    const profile_instr_t* instrs;
+    uint32_t instr_count;
+
+    // family commands menu, if not nullptr
+    void (*menu)(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out);
+} profile_t;
+
+/**
+ * @brief Find the profile of a device.
+ * @return The profile, or nullptr if the family is unknown.
+ */
+const profile_t* profile_find(uint32_t idcode);
+
+/**
+ * @brief Name of the part with the given IDCODE, or of its family if the part
+ * is not listed, or nullptr if the family is unknown.
+ */
+const char* profile_part_name(uint32_t idcode);
+
+/**
+ * @brief Look up an instruction of a profile by its name.
+ * @return The instruction, or nullptr.
+ */
+const profile_instr_t* profile_instr(const profile_t* profile, const char* name);
+
+/**
+ * @brief Look up an instruction of a profile by its value.
+ * @return The instruction, or nullptr.
+ */
+const profile_instr_t* profile_instr_by_ir(const profile_t* profile, uint32_t ir);
+
+/**
+ * @brief Put the instructions of a profile with a known DR length in the
+ * instruction map. Entries already in the map are kept.
+ * @return Number of instructions added.
+ */
+uint32_t profile_seed_irmap(const profile_t* profile);
+
+#endif
@@ -0,0 +1,351 @@
+#include <Arduino.h>
+
+#include "riscv_dm.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+// repeats of a system bus batch the bus was too slow for
+#define SB_BUSY_RETRIES 5
+
+status_t riscv_dm_init(riscv_dm_t* dm, riscv_dtm_t* dtm)
+{
+    uint32_t dmcontrol = 0, dmstatus = 0, abstractcs = 0, sbcs = 0;
+    unsigned long start = millis();
+    status_t rc;
+
+    dm->dtm = dtm;
+
+    rc = riscv_dmi_write(dtm, RISCV_DM_DMCONTROL, RISCV_DMCONTROL_DMACTIVE);
+    while (rc == OK && !(dmcontrol & RISCV_DMCONTROL_DMACTIVE))
+    {
+        rc = riscv_dmi_read(dtm, RISCV_DM_DMCONTROL, &dmcontrol);
+        if (millis() - start >= RISCV_DM_TIMEOUT_MS)
+            rc = -ERR_TIMEOUT;
+    }
+
+    if (rc == OK)
+        rc = riscv_dmi_read(dtm, RISCV_DM_DMSTATUS, &dmstatus);
+    if (rc != OK)
+        return rc;
+
+    if (RISCV_DMSTATUS_VERSION(dmstatus) != RISCV_DM_VERSION_013)
+    {
+        Serial.print("\nNo RISC-V 0.13 debug module, dmstatus: 0x"); Serial.println(dmstatus, HEX);
+        return -ERR_NOT_FOUND;
+    }
+
+    rc = riscv_dmi_read(dtm, RISCV_DM_ABSTRACTCS, &abstractcs);
+    if (rc == OK)
+        rc = riscv_dmi_read(dtm, RISCV_DM_SBCS, &sbcs);
+
+    dm->datacount = RISCV_ABSTRACTCS_DATACOUNT(abstractcs);
+    dm->progbufsize = RISCV_ABSTRACTCS_PROGBUFSIZE(abstractcs);
+    dm->impebreak = (dmstatus & RISCV_DMSTATUS_IMPEBREAK) != 0;
+    dm->sb = RISCV_SBCS_VERSION(sbcs) == 1 && (sbcs & RISCV_SBCS_ACCESS32);
+
+    return rc;
+}
+
+/**
+ * @brief Request a halt or a resume of hart 0, and wait for the status bit.
+ */
+static status_t riscv_dm_request(riscv_dm_t* dm, uint32_t request, uint32_t status)
+{
+    unsigned long start = millis();
+    uint32_t dmstatus = 0;
+    status_t rc = riscv_dmi_write(dm->dtm, RISCV_DM_DMCONTROL, RISCV_DMCONTROL_DMACTIVE | request);
+
+    while (rc == OK && !(dmstatus & status))
+    {
+        rc = riscv_dmi_read(dm->dtm, RISCV_DM_DMSTATUS, &dmstatus);
+        if (millis() - start >= RISCV_DM_TIMEOUT_MS)
+            rc = -ERR_TIMEOUT;
+    }
+
+    // the request bits are not sticky, take them back
+    if (rc == OK)
+        rc = riscv_dmi_write(dm->dtm, RISCV_DM_DMCONTROL, RISCV_DMCONTROL_DMACTIVE);
+
+    return rc;
+}
+
+status_t riscv_dm_halt(riscv_dm_t* dm)
+{
+    status_t rc = riscv_dm_request(dm, RISCV_DMCONTROL_HALTREQ, RISCV_DMSTATUS_ALLHALTED);
+
+    if (rc == -ERR_TIMEOUT)
+        Serial.println("\nHart did not halt");
+
+    return rc;
+}
+
+status_t riscv_dm_resume(riscv_dm_t* dm)
+{
+    return riscv_dm_request(dm, RISCV_DMCONTROL_RESUMEREQ, RISCV_DMSTATUS_ALLRESUMEACK);
+}
+
+/**
+ * @brief Wait for the abstract command to complete.
+ * @param abstractcs The abstractcs read back with the last command, then its final value.
+ */
+static status_t riscv_abstract_wait(riscv_dm_t* dm, uint32_t* abstractcs)
+{
+    unsigned long start = millis();
+    status_t rc = OK;
+
+    while (rc == OK && (*abstractcs & RISCV_ABSTRACTCS_BUSY))
+    {
+        rc = riscv_dmi_read(dm->dtm, RISCV_DM_ABSTRACTCS, abstractcs);
+        if (millis() - start >= RISCV_DM_TIMEOUT_MS)
+            rc = -ERR_TIMEOUT;
+    }
+
+    return rc;
+}
+
+/**
+ * @brief Report and clear the error of the last abstract commands.
+ */
+static status_t riscv_abstract_check(riscv_dm_t* dm, uint32_t abstractcs)
+{
+    uint32_t cmderr = RISCV_ABSTRACTCS_CMDERR(abstractcs);
+
+    if (cmderr == 0)
+        return OK;
+
+    riscv_dmi_write(dm->dtm, RISCV_DM_ABSTRACTCS, RISCV_ABSTRACTCS_CMDERR_CLEAR);
+    Serial.print("\nAbstract command failed, cmderr: "); Serial.println(cmderr, DEC);
+
+    return -ERR_GENERAL;
+}
+
+/**
+ * @brief Access registers with a batch of abstract commands, or one command
+ * at a time if the hart did not keep up with the batch (cmderr busy).
+ * @param values Read into, or written from.
+ */
+static status_t riscv_reg_access(riscv_dm_t* dm, const uint16_t* regnos, uint32_t* values, uint32_t count, bool write)
+{
+    riscv_dmi_op_t ops[2 * RISCV_DM_BATCH_REGS + 1];
+    uint32_t command, abstractcs = 0;
+    uint32_t n = 0;
+    status_t rc;
+
+    if (count > RISCV_DM_BATCH_REGS)
+        return -ERR_OUT_OF_BOUNDS;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        command = RISCV_CMD_AARSIZE_32 | RISCV_CMD_TRANSFER | (write ? RISCV_CMD_WRITE : 0) | regnos[i];
+        if (write)
+            ops[n++] = { RISCV_DMI_WRITE, RISCV_DM_DATA0, values[i], nullptr };
+        ops[n++] = { RISCV_DMI_WRITE, RISCV_DM_COMMAND, command, nullptr };
+        if (!write)
+            ops[n++] = { RISCV_DMI_READ, RISCV_DM_DATA0, 0, &values[i] };
+    }
+    ops[n++] = { RISCV_DMI_READ, RISCV_DM_ABSTRACTCS, 0, &abstractcs };
+
+    rc = riscv_dmi_batch(dm->dtm, ops, n);
+    if (rc != OK)
+        return rc;
+
+    if (RISCV_ABSTRACTCS_CMDERR(abstractcs) != 1 || count == 1)
+    {
+        rc = riscv_abstract_wait(dm, &abstractcs);
+        return rc == OK ? riscv_abstract_check(dm, abstractcs) : rc;
+    }
+
+    // busy: a command was started before the previous one completed,
+    // cmderr can only be cleared once the running one is done
+    rc = riscv_abstract_wait(dm, &abstractcs);
+    if (rc != OK)
+        return rc;
+    riscv_dmi_write(dm->dtm, RISCV_DM_ABSTRACTCS, RISCV_ABSTRACTCS_CMDERR_CLEAR);
+
+    for (uint32_t i = 0; i < count && rc == OK; i++)
+    {
+        command = RISCV_CMD_AARSIZE_32 | RISCV_CMD_TRANSFER | (write ? RISCV_CMD_WRITE : 0) | regnos[i];
+        n = 0;
+        if (write)
+            ops[n++] = { RISCV_DMI_WRITE, RISCV_DM_DATA0, values[i], nullptr };
+        ops[n++] = { RISCV_DMI_WRITE, RISCV_DM_COMMAND, command, nullptr };
+        ops[n++] = { RISCV_DMI_READ, RISCV_DM_ABSTRACTCS, 0, &abstractcs };
+
+        rc = riscv_dmi_batch(dm->dtm, ops, n);
+        if (rc == OK)
+            rc = riscv_abstract_wait(dm, &abstractcs);
+        if (rc == OK)
+            rc = riscv_abstract_check(dm, abstractcs);
+        if (rc == OK && !write)
+            rc = riscv_dmi_read(dm->dtm, RISCV_DM_DATA0, &values[i]);
+    }
+
+    return rc;
+}
+
+status_t riscv_reg_read_batch(riscv_dm_t* dm, const uint16_t* regnos, uint32_t* values, uint32_t count)
+{
+    return riscv_reg_access(dm, regnos, values, count, false);
+}
+
+status_t riscv_reg_write_batch(riscv_dm_t* dm, const uint16_t* regnos, const uint32_t* values, uint32_t count)
+{
+    return riscv_reg_access(dm, regnos, (uint32_t*)values, count, true);
+}
+
+status_t riscv_progbuf_exec(riscv_dm_t* dm, const uint32_t* insns, uint32_t count)
+{
+    riscv_dmi_op_t ops[32 + 2];
+    uint32_t abstractcs = 0;
+    uint32_t n = 0;
+    status_t rc;
+
+    if (count + (dm->impebreak ? 0 : 1) > dm->progbufsize)
+        return -ERR_OUT_OF_BOUNDS;
+
+    for (uint32_t i = 0; i < count; i++)
+        ops[n++] = { RISCV_DMI_WRITE, (uint8_t)(RISCV_DM_PROGBUF0 + i), insns[i], nullptr };
+    if (!dm->impebreak)
+        ops[n++] = { RISCV_DMI_WRITE, (uint8_t)(RISCV_DM_PROGBUF0 + count), RISCV_EBREAK, nullptr };
+
+    // no transfer, only the execution of the program buffer
+    ops[n++] = { RISCV_DMI_WRITE, RISCV_DM_COMMAND, RISCV_CMD_AARSIZE_32 | RISCV_CMD_POSTEXEC, nullptr };
+    ops[n++] = { RISCV_DMI_READ, RISCV_DM_ABSTRACTCS, 0, &abstractcs };
+
+    rc = riscv_dmi_batch(dm->dtm, ops, n);
+    if (rc == OK)
+        rc = riscv_abstract_wait(dm, &abstractcs);
+    if (rc == OK)
+        rc = riscv_abstract_check(dm, abstractcs);
+
+    return rc;
+}
+
+/**
+ * @brief Check and clear the errors of the system bus.
+ * @return OK, -ERR_BUS_FAULT on a bus error, or -ERR_TIMEOUT if the DMI
+ * accessed sbdata0 before the bus completed the previous access.
+ */
+static status_t riscv_sb_check(riscv_dm_t* dm, uint32_t sbcs)
+{
+    if (!(sbcs & RISCV_SBCS_BUSYERROR) && RISCV_SBCS_ERROR(sbcs) == 0)
+        return OK;
+
+    riscv_dmi_write(dm->dtm, RISCV_DM_SBCS, RISCV_SBCS_BUSYERROR | RISCV_SBCS_ERROR_CLEAR);
+
+    return RISCV_SBCS_ERROR(sbcs) ? -ERR_BUS_FAULT : -ERR_TIMEOUT;
+}
+
+status_t riscv_sb_read_block(riscv_dm_t* dm, uint32_t addr, uint32_t* buf, uint32_t words)
+{
+    riscv_dmi_op_t ops[RISCV_SB_BATCH_WORDS + 4];
+    uint32_t base = RISCV_SBCS_ACCESS_32 | RISCV_SBCS_AUTOINCREMENT | RISCV_SBCS_READONADDR;
+    uint32_t first = base | RISCV_SBCS_READONDATA;
+    uint32_t count, sbcs = 0;
+    uint32_t retries = 0;
+    uint32_t n;
+    status_t rc = OK;
+
+    if (addr & 3)
+        return -ERR_BAD_PARAMETER;
+    if (!dm->sb)
+        return -ERR_NOT_FOUND;
+
+    while (words > 0)
+    {
+        count = min(words, (uint32_t)RISCV_SB_BATCH_WORDS);
+        n = 0;
+
+        // the address write reads the first word, every sbdata0 read but the last one the next
+        ops[n++] = { RISCV_DMI_WRITE, RISCV_DM_SBCS, count > 1 ? first : base, nullptr };
+        ops[n++] = { RISCV_DMI_WRITE, RISCV_DM_SBADDRESS0, addr, nullptr };
+        for (uint32_t i = 0; i + 1 < count; i++)
+            ops[n++] = { RISCV_DMI_READ, RISCV_DM_SBDATA0, 0, &buf[i] };
+        if (count > 1)
+            ops[n++] = { RISCV_DMI_WRITE, RISCV_DM_SBCS, base, nullptr };
+        ops[n++] = { RISCV_DMI_READ, RISCV_DM_SBDATA0, 0, &buf[count - 1] };
+        ops[n++] = { RISCV_DMI_READ, RISCV_DM_SBCS, 0, &sbcs };
+
+        rc = riscv_dmi_batch(dm->dtm, ops, n);
+        if (rc == OK)
+            rc = riscv_sb_check(dm, sbcs);
+
+        // the bus is slower than the DMI, give it more time and read the batch again
+        if (rc == -ERR_TIMEOUT && retries++ < SB_BUSY_RETRIES)
+        {
+            dm->dtm->idle = min(dm->dtm->idle + dm->dtm->idle / 2 + 1, (uint32_t)RISCV_DTM_MAX_IDLE);
+            continue;
+        }
+        if (rc != OK)
+            break;
+
+        addr += count * 4;
+        buf += count;
+        words -= count;
+        retries = 0;
+    }
+
+    return rc;
+}
+
+status_t riscv_sb_write_block(riscv_dm_t* dm, uint32_t addr, const uint32_t* buf, uint32_t words)
+{
+    riscv_dmi_op_t ops[RISCV_SB_BATCH_WORDS + 3];
+    uint32_t count, sbcs = 0;
+    uint32_t n;
+    status_t rc = OK;
+
+    if (addr & 3)
+        return -ERR_BAD_PARAMETER;
+    if (!dm->sb)
+        return -ERR_NOT_FOUND;
+
+    while (words > 0 && rc == OK)
+    {
+        count = min(words, (uint32_t)RISCV_SB_BATCH_WORDS);
+        n = 0;
+
+        // every sbdata0 write writes a word and increments the address
+        ops[n++] = { RISCV_DMI_WRITE, RISCV_DM_SBCS, RISCV_SBCS_ACCESS_32 | RISCV_SBCS_AUTOINCREMENT, nullptr };
+        ops[n++] = { RISCV_DMI_WRITE, RISCV_DM_SBADDRESS0, addr, nullptr };
+        for (uint32_t i = 0; i < count; i++)
+            ops[n++] = { RISCV_DMI_WRITE, RISCV_DM_SBDATA0, buf[i], nullptr };
+        ops[n++] = { RISCV_DMI_READ, RISCV_DM_SBCS, 0, &sbcs };
+
+        rc = riscv_dmi_batch(dm->dtm, ops, n);
+        if (rc == OK)
+            rc = riscv_sb_check(dm, sbcs);
+
+        addr += count * 4;
+        buf += count;
+        words -= count;
+    }
+
+    return rc;
+}
+
+status_t riscv_sb_dump(riscv_dm_t* dm, uint32_t addr, uint32_t words)
+{
+    uint32_t buf[RISCV_SB_BATCH_WORDS];
+    uint32_t left = words;
+    uint32_t count;
+    status_t rc = OK;
+
+    send_dump_header_to_host(addr, words, RISCV_SB_BATCH_WORDS);
+
+    while (left > 0)
+    {
+        count = min(left, (uint32_t)RISCV_SB_BATCH_WORDS);
+        rc = riscv_sb_read_block(dm, addr, buf, count);
+        if (rc != OK)
+            break;
+
+        send_words_frame_to_host(buf, count);
+        addr += count * 4;
+        left -= count;
+    }
+
+    send_dump_end_to_host(addr, rc);
+
+    return rc;
+}
@@ -0,0 +1,177 @@
+/** @file riscv_dm.h
+ *
+ * @brief RISC-V Debug Module 0.13 over the DTM (riscv_dtm.h): run control of
+ * the selected hart, abstract register access, program buffer execution and
+ * system bus access.
+ *
+ * Every operation is a single DMI batch where it can be, so its accesses are
+ * pipelined a scan each:
+ *  - Abstract commands are batched: the transfers of several registers run
+ *    back to back, and abstractcs is read once at the end of the batch. An
+ *    error, e.g. a register that does not exist, fails the whole batch.
+ *  - System bus reads use sbreadonaddr, sbreadondata and sbautoincrement:
+ *    every read of sbdata0 returns a word and starts the read of the next one.
+ *    Before the last word sbreadondata is turned off, so no word past the
+ *    block is read.
+ */
+#ifndef __RISCV_DM__H__
+#define __RISCV_DM__H__
+
+#include <stdint.h>
+
+#include "riscv_dtm.h"
+#include "../../include/status.h"
+
+/**
+ * DM registers.
+ */
+#define RISCV_DM_DATA0       0x04
+#define RISCV_DM_DMCONTROL   0x10
+#define RISCV_DM_DMSTATUS    0x11
+#define RISCV_DM_ABSTRACTCS  0x16
+#define RISCV_DM_COMMAND     0x17
+#define RISCV_DM_PROGBUF0    0x20
+#define RISCV_DM_SBCS        0x38
+#define RISCV_DM_SBADDRESS0  0x39
+#define RISCV_DM_SBDATA0     0x3c
+
+/**
+ * dmcontrol bits.
+ */
+#define RISCV_DMCONTROL_DMACTIVE  (1UL << 0)
+#define RISCV_DMCONTROL_NDMRESET  (1UL << 1)
+#define RISCV_DMCONTROL_RESUMEREQ (1UL << 30)
+#define RISCV_DMCONTROL_HALTREQ   (1UL << 31)
+
+/**
+ * dmstatus fields.
+ */
+#define RISCV_DMSTATUS_VERSION(x)    ((x) & 0xf)
+#define RISCV_DMSTATUS_ANYHALTED     (1UL << 8)
+#define RISCV_DMSTATUS_ALLHALTED     (1UL << 9)
+#define RISCV_DMSTATUS_ALLRUNNING    (1UL << 11)
+#define RISCV_DMSTATUS_ALLRESUMEACK  (1UL << 17)
+#define RISCV_DMSTATUS_IMPEBREAK     (1UL << 22)
+
+#define RISCV_DM_VERSION_013 2
+
+/**
+ * abstractcs fields. cmderr is cleared by writing it back as 1s.
+ */
+#define RISCV_ABSTRACTCS_DATACOUNT(x)   ((x) & 0xf)
+#define RISCV_ABSTRACTCS_CMDERR(x)      (((x) >> 8) & 0x7)
+#define RISCV_ABSTRACTCS_CMDERR_CLEAR   (0x7UL << 8)
+#define RISCV_ABSTRACTCS_BUSY           (1UL << 12)
+#define RISCV_ABSTRACTCS_PROGBUFSIZE(x) (((x) >> 24) & 0x1f)
+
+/**
+ * Access register command: 32 bit registers.
+ */
+#define RISCV_CMD_AARSIZE_32 (2UL << 20)
+#define RISCV_CMD_POSTEXEC   (1UL << 18)
+#define RISCV_CMD_TRANSFER   (1UL << 17)
+#define RISCV_CMD_WRITE      (1UL << 16)
+
+/**
+ * Register numbers of the access register command.
+ */
+#define RISCV_REG_CSR(n) (n)
+#define RISCV_REG_GPR(n) (0x1000 + (n))
+#define RISCV_CSR_DPC 0x7b1
+
+/**
+ * sbcs fields. sbbusyerror and sberror are cleared by writing them back as 1s.
+ */
+#define RISCV_SBCS_VERSION(x)      (((x) >> 29) & 0x7)
+#define RISCV_SBCS_BUSYERROR       (1UL << 22)
+#define RISCV_SBCS_BUSY            (1UL << 21)
+#define RISCV_SBCS_READONADDR      (1UL << 20)
+#define RISCV_SBCS_ACCESS_32       (2UL << 17)
+#define RISCV_SBCS_AUTOINCREMENT   (1UL << 16)
+#define RISCV_SBCS_READONDATA      (1UL << 15)
+#define RISCV_SBCS_ERROR(x)        (((x) >> 12) & 0x7)
+#define RISCV_SBCS_ERROR_CLEAR     (0x7UL << 12)
+#define RISCV_SBCS_ACCESS32        (1UL << 2)
+
+/**
+ * Instruction appended to the program buffer, unless the DM has an implicit ebreak.
+ */
+#define RISCV_EBREAK 0x00100073
+
+/**
+ * Most registers of an abstract command batch, and words of a system bus batch.
+ */
+#define RISCV_DM_BATCH_REGS 32
+#define RISCV_SB_BATCH_WORDS 64
+
+/**
+ * Time to wait for a hart to halt or resume, and for an abstract command.
+ */
+#define RISCV_DM_TIMEOUT_MS 100
+
+typedef struct
+{
+    riscv_dtm_t* dtm;
+    uint8_t datacount;      // data registers
+    uint8_t progbufsize;    // program buffer words
+    bool impebreak;         // an ebreak follows the program buffer
+    bool sb;                // 32 bit system bus access is supported
+} riscv_dm_t;
+
+/**
+ * @brief Activate the DM, and read its abstract command and system bus features.
+ * @return OK, or -ERR_NOT_FOUND if it is not a 0.13 DM.
+ */
+status_t riscv_dm_init(riscv_dm_t* dm, riscv_dtm_t* dtm);
+
+/**
+ * @brief Halt hart 0, and wait for it to halt.
+ */
+status_t riscv_dm_halt(riscv_dm_t* dm);
+
+/**
+ * @brief Resume hart 0, and wait for it to acknowledge.
+ */
+status_t riscv_dm_resume(riscv_dm_t* dm);
+
+/**
+ * @brief Read registers of the halted hart with a batch of abstract commands.
+ * @param regnos Register numbers, e.g. RISCV_REG_GPR(n), up to RISCV_DM_BATCH_REGS.
+ * @return OK, or -ERR_GENERAL with the cmderr printed.
+ */
+status_t riscv_reg_read_batch(riscv_dm_t* dm, const uint16_t* regnos, uint32_t* values, uint32_t count);
+
+/**
+ * @brief Write registers of the halted hart with a batch of abstract commands.
+ */
+status_t riscv_reg_write_batch(riscv_dm_t* dm, const uint16_t* regnos, const uint32_t* values, uint32_t count);
+
+/**
+ * @brief Execute instructions in the program buffer of the halted hart.
+ * An ebreak is appended unless the DM has an implicit one.
+ * @return OK, -ERR_OUT_OF_BOUNDS if they do not fit, or -ERR_GENERAL if the
+ * execution failed (e.g. an exception).
+ */
+status_t riscv_progbuf_exec(riscv_dm_t* dm, const uint32_t* insns, uint32_t count);
+
+/**
+ * @brief Read consecutive 32 bit words through the system bus, a DMI scan
+ * per word plus a few per RISCV_SB_BATCH_WORDS words. The hart keeps running.
+ * @param addr Word aligned address.
+ * @return OK, -ERR_BUS_FAULT if the bus reported an error, or a DMI error.
+ */
+status_t riscv_sb_read_block(riscv_dm_t* dm, uint32_t addr, uint32_t* buf, uint32_t words);
+
+/**
+ * @brief Write consecutive 32 bit words through the system bus, a DMI scan per word.
+ * @param addr Word aligned address.
+ */
+status_t riscv_sb_write_block(riscv_dm_t* dm, uint32_t addr, const uint32_t* buf, uint32_t words);
+
+/**
+ * @brief Send a memory range read through the system bus to the host, as the
+ * "@dump" frames of adiv5_mem_dump().
+ */
+status_t riscv_sb_dump(riscv_dm_t* dm, uint32_t addr, uint32_t words);
+
+#endif
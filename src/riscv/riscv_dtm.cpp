@@ -0,0 +1,149 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "riscv_dtm.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+/**
+ * @brief Scan DTMCS, writing the given value.
+ */
+static uint32_t riscv_dtmcs_scan(riscv_dtm_t* dtm, uint32_t value)
+{
+    uint32_t dtmcs = 0;
+
+    int_to_bin_array(dtm->ir_in, RISCV_DTM_DTMCS, dtm->ir_len);
+    insert_ir(dtm->ir_in, dtm->ir_out, dtm->ir_len, RUN_TEST_IDLE);
+
+    int_to_bin_array(dtm->dr_in, value, 32);
+    insert_dr(dtm->dr_in, dtm->dr_out, 32, RUN_TEST_IDLE);
+    bin_array_to_uint32(dtm->dr_out, 32, &dtmcs);
+
+    return dtmcs;
+}
+
+status_t riscv_dtm_init(riscv_dtm_t* dtm, const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out)
+{
+    uint32_t dtmcs;
+
+    memset(dtm, 0, sizeof(riscv_dtm_t));
+    dtm->ir_len = ir_len;
+    dtm->ir_in = ir_in;
+    dtm->ir_out = ir_out;
+    dtm->dr_in = dr_in;
+    dtm->dr_out = dr_out;
+
+    dtmcs = riscv_dtmcs_scan(dtm, 0);
+    if (RISCV_DTMCS_VERSION(dtmcs) != RISCV_DTMCS_VERSION_013 || RISCV_DTMCS_ABITS(dtmcs) == 0)
+    {
+        Serial.print("\nNo RISC-V 0.13 DTM, DTMCS: 0x"); Serial.println(dtmcs, HEX);
+        return -ERR_NOT_FOUND;
+    }
+
+    dtm->abits = min((uint32_t)RISCV_DTMCS_ABITS(dtmcs), (uint32_t)(RISCV_DMI_MAX_LEN - 34));
+    dtm->idle = RISCV_DTMCS_IDLE(dtmcs);
+
+    return OK;
+}
+
+/**
+ * @brief A single DMI scan, followed by the idle cycles.
+ * @param data Gets the data of the previous access.
+ * @return The op shifted out: the result of the previous access.
+ */
+static uint32_t riscv_dmi_scan(riscv_dtm_t* dtm, uint8_t op, uint8_t addr, uint32_t in, uint32_t* data)
+{
+    uint32_t len = dtm->abits + 34;
+    uint32_t result = 0;
+
+    int_to_bin_array(dtm->ir_in, RISCV_DTM_DMI, dtm->ir_len);
+    insert_ir(dtm->ir_in, dtm->ir_out, dtm->ir_len, RUN_TEST_IDLE);
+
+    int_to_bin_array(dtm->dr_in, op, 2);
+    int_to_bin_array(&dtm->dr_in[2], in, 32);
+    int_to_bin_array(&dtm->dr_in[34], addr, dtm->abits);
+    insert_dr(dtm->dr_in, dtm->dr_out, len, RUN_TEST_IDLE);
+
+    // time for the access to complete before the next scan captures it
+    for (uint32_t i = 0; i < dtm->idle; i++)
+        advance_tap_state(RUN_TEST_IDLE);
+
+    bin_array_to_uint32(dtm->dr_out, 2, &result);
+    bin_array_to_uint32(&dtm->dr_out[2], 32, data);
+    dtm->scans++;
+
+    return result;
+}
+
+/**
+ * @brief Clear the sticky busy or failed state of the DMI.
+ * @param slower If true, the accesses get more idle cycles.
+ */
+static void riscv_dmi_reset(riscv_dtm_t* dtm, bool slower)
+{
+    riscv_dtmcs_scan(dtm, RISCV_DTMCS_DMIRESET);
+
+    if (slower)
+        dtm->idle = min(dtm->idle + dtm->idle / 2 + 1, (uint32_t)RISCV_DTM_MAX_IDLE);
+}
+
+status_t riscv_dmi_batch(riscv_dtm_t* dtm, riscv_dmi_op_t* ops, uint32_t count)
+{
+    riscv_dmi_op_t* pending = nullptr;  // the access whose result the next scan returns
+    uint32_t busy = 0;
+    uint32_t result, data = 0;
+    uint32_t i = 0;
+
+    // the scan after the last access only collects its result
+    while (i <= count)
+    {
+        if (i < count)
+            result = riscv_dmi_scan(dtm, ops[i].op, ops[i].addr, ops[i].data, &data);
+        else
+            result = riscv_dmi_scan(dtm, RISCV_DMI_NOP, 0, 0, &data);
+
+        if (result == RISCV_DMI_BUSY)
+        {
+            // this access was dropped, the pending one completes meanwhile
+            // and its result comes with the repeated scan
+            dtm->busy++;
+            if (++busy > RISCV_DTM_BUSY_RETRIES)
+            {
+                riscv_dmi_reset(dtm, false);
+                return -ERR_TIMEOUT;
+            }
+            riscv_dmi_reset(dtm, true);
+            continue;
+        }
+
+        if (result != RISCV_DMI_SUCCESS)
+        {
+            riscv_dmi_reset(dtm, false);
+            return -ERR_GENERAL;
+        }
+
+        if (pending != nullptr && pending->op == RISCV_DMI_READ && pending->value != nullptr)
+            *pending->value = data;
+
+        pending = i < count ? &ops[i] : nullptr;
+        busy = 0;
+        i++;
+    }
+
+    return OK;
+}
+
+status_t riscv_dmi_read(riscv_dtm_t* dtm, uint8_t addr, uint32_t* value)
+{
+    riscv_dmi_op_t op = { RISCV_DMI_READ, addr, 0, value };
+
+    return riscv_dmi_batch(dtm, &op, 1);
+}
+
+status_t riscv_dmi_write(riscv_dtm_t* dtm, uint8_t addr, uint32_t value)
+{
+    riscv_dmi_op_t op = { RISCV_DMI_WRITE, addr, value, nullptr };
+
+    return riscv_dmi_batch(dtm, &op, 1);
+}
@@ -0,0 +1,123 @@
+/** @file riscv_dtm.h
+ *
+ * @brief JTAG Debug Transport Module of the RISC-V External Debug Support
+ * 0.13: access to the registers of the Debug Module (riscv_dm.h) through the
+ * DMI register of the DTM.
+ *
+ *  - DTMCS (32 bits): version [3:0], abits [9:4], dmistat [11:10],
+ *    idle [14:12], dmireset [16], dmihardreset [17].
+ *  - DMI (abits + 34 bits, LSB first): op [1:0], data [33:2], address [abits + 33:34].
+ *    The op and data shifted out are the result of the previous access: a
+ *    read returns its data in the next scan, so back to back accesses cost a
+ *    scan each, and the IR shadow cache of the driver keeps DMI loaded.
+ *
+ * An access started while the previous one is still running returns busy,
+ * and the DTM ignores the scans until dmireset. The DTM then gets more idle
+ * cycles in Run-Test/Idle after every scan, so the next accesses do not hit
+ * busy again, and the dropped access is repeated: its scan returns the result
+ * of the access before it, completed meanwhile.
+ */
+#ifndef __RISCV_DTM__H__
+#define __RISCV_DTM__H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+
+/**
+ * DTM instructions (5 bit IR).
+ */
+#define RISCV_DTM_IDCODE 0x01
+#define RISCV_DTM_DTMCS  0x10
+#define RISCV_DTM_DMI    0x11
+#define RISCV_DTM_BYPASS 0x1f
+
+/**
+ * DTMCS fields.
+ */
+#define RISCV_DTMCS_VERSION(x) ((x) & 0xf)
+#define RISCV_DTMCS_ABITS(x)   (((x) >> 4) & 0x3f)
+#define RISCV_DTMCS_IDLE(x)    (((x) >> 12) & 0x7)
+#define RISCV_DTMCS_DMIRESET     (1UL << 16)
+#define RISCV_DTMCS_DMIHARDRESET (1UL << 17)
+
+#define RISCV_DTMCS_VERSION_013 1
+
+/**
+ * DMI op, shifted in.
+ */
+#define RISCV_DMI_NOP   0
+#define RISCV_DMI_READ  1
+#define RISCV_DMI_WRITE 2
+
+/**
+ * DMI op, shifted out.
+ */
+#define RISCV_DMI_SUCCESS 0
+#define RISCV_DMI_FAILED  2
+#define RISCV_DMI_BUSY    3
+
+/**
+ * Longest DMI register: 34 bits and up to 32 address bits.
+ */
+#define RISCV_DMI_MAX_LEN (34 + 32)
+
+/**
+ * Most idle cycles after a DMI scan, and the consecutive busy results
+ * after which an access gives up.
+ */
+#define RISCV_DTM_MAX_IDLE 1000
+#define RISCV_DTM_BUSY_RETRIES 20
+
+typedef struct
+{
+    // driver context of the DTM TAP
+    uint8_t ir_len;
+    uint8_t* ir_in;
+    uint8_t* ir_out;
+    uint8_t* dr_in;
+    uint8_t* dr_out;
+
+    uint8_t abits;          // DMI address bits, from DTMCS
+    uint32_t idle;          // Run-Test/Idle cycles after every DMI scan
+    uint32_t scans;         // DMI scans since riscv_dtm_init()
+    uint32_t busy;          // busy results since riscv_dtm_init()
+} riscv_dtm_t;
+
+/**
+ * A DMI access of a batch.
+ */
+typedef struct
+{
+    uint8_t op;             // RISCV_DMI_READ or RISCV_DMI_WRITE
+    uint8_t addr;           // DM register
+    uint32_t data;          // written by a write
+    uint32_t* value;        // gets the data of a read, if not nullptr
+} riscv_dmi_op_t;
+
+/**
+ * @brief Attach the DTM to its TAP and the driver's registers, and read DTMCS.
+ * The idle cycles start from the hint of DTMCS.
+ * @return OK, or -ERR_NOT_FOUND if the DTM is not version 0.13.
+ */
+status_t riscv_dtm_init(riscv_dtm_t* dtm, const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out);
+
+/**
+ * @brief Run DMI accesses back to back, a scan each plus one for the result
+ * of the last. Busy accesses are repeated with more idle cycles.
+ * @return OK, -ERR_GENERAL if an access failed, or -ERR_TIMEOUT if the DTM
+ * kept answering busy.
+ */
+status_t riscv_dmi_batch(riscv_dtm_t* dtm, riscv_dmi_op_t* ops, uint32_t count);
+
+/**
+ * @brief Read a DM register.
+ */
+status_t riscv_dmi_read(riscv_dtm_t* dtm, uint8_t addr, uint32_t* value);
+
+/**
+ * @brief Write a DM register.
+ */
+status_t riscv_dmi_write(riscv_dtm_t* dtm, uint8_t addr, uint32_t value);
+
+#endif
@@ -0,0 +1,166 @@
+/* --------------------------------------------------------------------------------------- */
+/* -------------------- Commands of RISC-V harts behind a 0.13 DTM ------------------------*/
+/* --------------------------------------------------------------------------------------- */
+#include <stdint.h>
+#include <string.h>
+
+#include "riscv_funcs.h"
+#include "riscv_dtm.h"
+#include "riscv_dm.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+// the DTM and DM of the selected TAP, kept between the menu commands
+static riscv_dtm_t dtm;
+static riscv_dm_t dm;
+static bool dm_ready = false;
+
+/**
+ * @brief Print the RISC-V menu.
+ */
+static void riscv_print_menu()
+{
+    Serial.flush();
+    Serial.print("\n\nRISC-V Debug Menu:\n");
+    Serial.print("a - Activate the debug module\n");
+    Serial.print("h - Halt hart\n");
+    Serial.print("c - Resume hart\n");
+    Serial.print("r - Read register (0-31 GPR, else CSR)\n");
+    Serial.print("w - Write register (0-31 GPR, else CSR)\n");
+    Serial.print("g - Read all GPRs\n");
+    Serial.print("e - Execute instruction in the program buffer\n");
+    Serial.print("m - Read memory word (system bus)\n");
+    Serial.print("d - Dump memory range to host (binary, system bus)\n");
+    Serial.print("z - Exit\n");
+    Serial.flush();
+}
+
+/**
+ * @brief Register number of the access register command for a number typed by the user.
+ */
+static uint16_t riscv_regno(uint32_t num)
+{
+    return num < 32 ? RISCV_REG_GPR(num) : RISCV_REG_CSR(num);
+}
+
+/**
+ * @brief Prompts the user to choose what to execute
+ * from the available menu of RISC-V debug commands.
+ */
+void riscv_main(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out)
+{
+    uint16_t regnos[32];
+    uint32_t values[32];
+    uint32_t addr = 0;
+    uint32_t num = 0;
+    uint32_t value = 0;
+    status_t rc = OK;
+
+    riscv_print_menu();
+    char command = get_character("\nriscv > ");
+
+    if (command != 'a' && command != 'z' && (!dm_ready || dtm.ir_len != ir_len || dtm.ir_in != ir_in))
+    {
+        Serial.println("\nActivate the debug module first");
+        return;
+    }
+
+    switch (command)
+    {
+    case 'a':
+        dm_ready = false;
+        rc = riscv_dtm_init(&dtm, ir_len, ir_in, ir_out, dr_in, dr_out);
+        if (rc == OK)
+            rc = riscv_dm_init(&dm, &dtm);
+        if (rc != OK)
+            break;
+        dm_ready = true;
+        Serial.print("\nDebug module active, abits: "); Serial.print(dtm.abits, DEC);
+        Serial.print(", progbuf: "); Serial.print(dm.progbufsize, DEC);
+        Serial.print(", system bus: "); Serial.println(dm.sb ? "yes" : "no");
+        break;
+
+    case 'h':
+        rc = riscv_dm_halt(&dm);
+        if (rc == OK)
+            Serial.println("\nHart halted");
+        break;
+
+    case 'c':
+        rc = riscv_dm_resume(&dm);
+        break;
+
+    case 'r':
+        if (parse_number(NULL, 32, "\nInsert register number > ", &num) != OK)
+            break;
+        regnos[0] = riscv_regno(num);
+        rc = riscv_reg_read_batch(&dm, regnos, &value, 1);
+        if (rc != OK)
+            break;
+        Serial.print("\n0x"); Serial.println(value, HEX);
+        break;
+
+    case 'w':
+        if (parse_number(NULL, 32, "\nInsert register number > ", &num) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert value > ", &value) != OK)
+            break;
+        regnos[0] = riscv_regno(num);
+        rc = riscv_reg_write_batch(&dm, regnos, &value, 1);
+        break;
+
+    case 'g':
+        // a single batch of abstract commands
+        for (uint32_t i = 0; i < 32; i++)
+            regnos[i] = RISCV_REG_GPR(i);
+        rc = riscv_reg_read_batch(&dm, regnos, values, 32);
+        if (rc != OK)
+            break;
+        for (uint32_t i = 0; i < 32; i++)
+        {
+            Serial.print(i % 4 ? "  x" : "\nx"); Serial.print(i, DEC);
+            Serial.print(": 0x"); Serial.print(values[i], HEX);
+        }
+        Serial.println();
+        break;
+
+    case 'e':
+        if (parse_number(NULL, 32, "\nInsert instruction > ", &value) != OK)
+            break;
+        rc = riscv_progbuf_exec(&dm, &value, 1);
+        break;
+
+    case 'm':
+        if (parse_number(NULL, 32, "\nInsert addr > ", &addr) != OK)
+            break;
+        rc = riscv_sb_read_block(&dm, addr, &value, 1);
+        if (rc != OK)
+            break;
+        Serial.print("\n0x"); Serial.print(addr, HEX);
+        Serial.print(": 0x"); Serial.println(value, HEX);
+        break;
+
+    case 'd':
+        // stream a memory range to the host tool, which writes it to an image file
+        if (parse_number(NULL, 32, "\nInsert start addr > ", &addr) != OK)
+            break;
+        if (parse_number(NULL, 32, "\nInsert amount of words to dump > ", &num) != OK)
+            break;
+        rc = riscv_sb_dump(&dm, addr, num);
+        break;
+
+    case 'z':
+        // quit RISC-V commands menu
+        Serial.print("\nGoing back to main menu...");
+        break;
+
+    default:
+        break;
+    }
+
+    if (rc != OK)
+    {
+        Serial.print("\nDebug access failed: "); Serial.println(rc, DEC);
+    }
+}
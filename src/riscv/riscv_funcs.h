@@ -0,0 +1,10 @@
+#ifndef __RISCV_FUNCS_H__
+#define __RISCV_FUNCS_H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+
+void riscv_main(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out);
+
+#endif
@@ -0,0 +1,32 @@
+/* --------------------------------------------------------------------------------------- */
+/* -------------------- Device profile of RISC-V JTAG debug transports --------------------*/
+/* --------------------------------------------------------------------------------------- */
+#include <stdint.h>
+
+#include "riscv_dtm.h"
+#include "riscv_funcs.h"
+#include "../profile/profile.h"
+
+static constexpr profile_part_t riscv_parts[] = {
+    { "SiFive E31", 0x20000913 },
+};
+
+static constexpr profile_instr_t riscv_instrs[] = {
+    { "IDCODE", RISCV_DTM_IDCODE, 32, 0 },
+    { "DTMCS",  RISCV_DTM_DTMCS,  32, 0 },
+    { "DMI",    RISCV_DTM_DMI,    0,  0 },
+    { "BYPASS", RISCV_DTM_BYPASS, 1,  0 },
+};
+
+// SiFive cores, of any part and version, with a 0.13 DTM
+extern constexpr profile_t riscv_profile = {
+    "RISC-V DTM",
+    5,
+    0x00000fff,
+    0x00000913,
+    riscv_parts,
+    sizeof(riscv_parts) / sizeof(riscv_parts[0]),
+    riscv_instrs,
+    sizeof(riscv_instrs) / sizeof(riscv_instrs[0]),
+    riscv_main,
+};
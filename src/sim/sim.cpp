@@ -0,0 +1,97 @@
+#include <Arduino.h>
+
+#include "sim.h"
+#include "../../include/main.h"
+
+static const sim_target_t* sim_target = nullptr;
+static uint8_t sim_tck = 0;
+static uint8_t sim_tms = 1;
+static uint8_t sim_tdi = 1;
+static uint8_t sim_trst = 1;
+static bool sim_swdio_in = false;   // the driver released SWDIO (TMS)
+static uint32_t sim_tcks = 0;
+
+void sim_attach(const sim_target_t* target)
+{
+    sim_target = target;
+    sim_tcks = 0;
+
+    if (sim_target && sim_target->reset)
+        sim_target->reset();
+}
+
+const sim_target_t* sim_attached() { return sim_target; }
+
+void sim_pin_write(uint8_t pin, uint8_t val)
+{
+    val = val ? 1 : 0;
+
+    switch (pin)
+    {
+    case TCK:
+        if (val == sim_tck)
+            break;
+        sim_tck = val;
+
+        // a target in reset ignores TCK
+        if (!sim_target || !sim_trst)
+            break;
+
+        if (val)
+        {
+            sim_tcks++;
+            // a released SWDIO is pulled up
+            sim_target->rise(sim_swdio_in ? 1 : sim_tms, sim_tdi);
+        }
+        else if (sim_target->fall)
+        {
+            sim_target->fall();
+        }
+        break;
+
+    case TMS:
+        // the escapes of cJTAG
+        if (val != sim_tms && sim_tck && !sim_swdio_in && sim_target && sim_trst && sim_target->tms_edge)
+            sim_target->tms_edge();
+        sim_tms = val;
+        break;
+
+    case TDI:
+        sim_tdi = val;
+        break;
+
+    case TRST:
+        if (sim_trst && !val && sim_target && sim_target->reset)
+            sim_target->reset();
+        sim_trst = val;
+        break;
+
+    default:
+        break;
+    }
+}
+
+uint8_t sim_pin_read(uint8_t pin)
+{
+    // TDO and SWDIO are pulled up when nothing drives them
+    if (!sim_target)
+        return 1;
+
+    if (pin == TDO)
+        return sim_target->tdo();
+
+    if (pin == SWDIO && sim_swdio_in && sim_target->swdio)
+        return sim_target->swdio();
+
+    return 1;
+}
+
+void sim_pin_mode(uint8_t pin, uint8_t mode)
+{
+    if (pin == SWDIO)
+        sim_swdio_in = (mode != OUTPUT);
+}
+
+uint32_t sim_tck_count() { return sim_tcks; }
+
+void sim_tck_clear() { sim_tcks = 0; }
@@ -0,0 +1,67 @@
+/** @file sim.h
+ *
+ * @brief Pin level backend of the driver for simulated targets.
+ * With JTAG_SIM set (see main.h), PIN_WRITE and PIN_READ end up here instead
+ * of the Arduino pins, and the edges of TCK are passed to the attached target.
+ * TCK cycles are counted, to measure the cost of driver operations.
+ *
+ * SWD runs on the same pins (SWCLK is TCK, SWDIO is TMS). While the driver
+ * has SWDIO as an input, the target sees the line pulled up, and the driver
+ * reads the level the target drives. cJTAG turns TMSC (TMS) around the same
+ * way, and its escapes are the TMS edges while TCK is high.
+ */
+#ifndef __SIM__H__
+#define __SIM__H__
+
+#include <stdint.h>
+
+/**
+ * A simulated target, sees the pins the way a real one does.
+ */
+typedef struct
+{
+    const char* name;
+    void (*reset)();                           // TRST asserted, or the target was attached
+    void (*rise)(uint8_t tms, uint8_t tdi);    // rising edge of TCK, TMS and TDI are sampled
+    void (*fall)();                            // falling edge of TCK, TDO is updated
+    uint8_t (*tdo)();                          // current TDO level
+    uint8_t (*swdio)();                        // SWDIO level driven by the target, nullptr for JTAG only
+    void (*tms_edge)();                        // TMS driven to a new level while TCK is high, nullptr if ignored
+} sim_target_t;
+
+/**
+ * @brief Connect a simulated target to the pins, and reset it.
+ */
+void sim_attach(const sim_target_t* target);
+
+/**
+ * @brief The target attached with sim_attach(), or nullptr.
+ */
+const sim_target_t* sim_attached();
+
+/**
+ * @brief Drive a JTAG pin (TCK, TMS, TDI or TRST) of the simulated target.
+ */
+void sim_pin_write(uint8_t pin, uint8_t val);
+
+/**
+ * @brief Read a JTAG pin (TDO), or SWDIO, of the simulated target.
+ */
+uint8_t sim_pin_read(uint8_t pin);
+
+/**
+ * @brief Set the direction of a pin, only SWDIO (TMS) changes between output and input.
+ */
+void sim_pin_mode(uint8_t pin, uint8_t mode);
+
+/**
+ * @brief Number of TCK cycles since the target was attached or the counter was cleared.
+ */
+uint32_t sim_tck_count();
+
+/**
+ * @brief Restart the TCK counter.
+ */
+void sim_tck_clear();
+
+#endif
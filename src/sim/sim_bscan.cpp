@@ -0,0 +1,198 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "sim.h"
+#include "sim_tap.h"
+#include "sim_bscan.h"
+#include "../jtag_drv/jtag_drv.h"
+
+static sim_tap_t tap;
+static sim_bscan_stats_t stats;
+static const bscan_model_t* model = nullptr;
+
+static uint8_t bsr[BSCAN_MAX_LEN];      // shift register, a byte a cell
+static uint8_t latch[BSCAN_MAX_LEN];    // update latches
+static uint8_t board[BSCAN_MAX_LEN];    // level of the board, by input cell
+static int16_t driver[BSCAN_MAX_LEN];   // output cell of the same pin, by input cell
+static int16_t wired[BSCAN_MAX_LEN];    // output cell wired to the pin, by input cell
+static bool extest = false;
+
+static bool sim_bscan_port(uint16_t cell, const char* port)
+{
+    return model->cells[cell].port != nullptr && strcmp(model->cells[cell].port, port) == 0;
+}
+
+static bool sim_bscan_is_output(uint16_t cell)
+{
+    uint8_t function = model->cells[cell].function;
+
+    return function == BSCAN_OUTPUT2 || function == BSCAN_OUTPUT3 || function == BSCAN_BIDIR;
+}
+
+static bool sim_bscan_is_input(uint16_t cell)
+{
+    uint8_t function = model->cells[cell].function;
+
+    return function == BSCAN_INPUT || function == BSCAN_CLOCK || function == BSCAN_OBSERVE_ONLY || function == BSCAN_BIDIR;
+}
+
+/**
+ * @brief Output cell of a pin, or -1.
+ */
+static int16_t sim_bscan_output(const char* port)
+{
+    for (uint16_t i = 0; i < model->length; i++)
+    {
+        if (sim_bscan_is_output(i) && sim_bscan_port(i, port))
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Level an output cell drives, or SIM_BSCAN_Z.
+ */
+static uint8_t sim_bscan_drives(int16_t cell)
+{
+    int16_t control;
+
+    if (cell < 0 || !extest)
+        return SIM_BSCAN_Z;
+
+    control = model->cells[cell].control;
+    if (control >= 0 && latch[control] == model->cells[cell].disable)
+        return SIM_BSCAN_Z;
+
+    return latch[cell];
+}
+
+static uint8_t sim_bscan_pin(uint16_t cell)
+{
+    uint8_t level = sim_bscan_drives(driver[cell]);
+
+    if (level == SIM_BSCAN_Z)
+        level = sim_bscan_drives(wired[cell]);
+    if (level == SIM_BSCAN_Z)
+        level = board[cell];
+
+    return level;
+}
+
+static bool sim_bscan_bsr(uint32_t ir)
+{
+    return ir == model->extest || ir == model->sample;
+}
+
+static void sim_bscan_capture_dr(sim_tap_t* tap)
+{
+    if (tap->ir == SIM_BSCAN_IDCODE_IR)
+    {
+        tap->dr = model->idcode;
+        tap->dr_len = 32;
+        return;
+    }
+
+    if (!sim_bscan_bsr(tap->ir))
+        return;
+
+    for (uint16_t i = 0; i < model->length; i++)
+        bsr[i] = sim_bscan_is_input(i) ? sim_bscan_pin(i) : latch[i];
+    stats.captures++;
+}
+
+static void sim_bscan_update_dr(sim_tap_t* tap)
+{
+    if (!sim_bscan_bsr(tap->ir))
+        return;
+
+    memcpy(latch, bsr, model->length);
+    if (tap->ir == model->extest)
+        stats.updates++;
+}
+
+static void sim_bscan_update_ir(sim_tap_t* tap)
+{
+    extest = tap->ir == model->extest;
+}
+
+static void sim_bscan_reset()
+{
+    sim_tap_reset(&tap);
+}
+
+static void sim_bscan_rise(uint8_t tms, uint8_t tdi)
+{
+    // the BSR is longer than the register of the TAP
+    if (tap.state == SHIFT_DR && sim_bscan_bsr(tap.ir))
+    {
+        memmove(bsr, bsr + 1, model->length - 1);
+        bsr[model->length - 1] = tdi;
+    }
+
+    sim_tap_rise(&tap, tms, tdi);
+}
+
+static void sim_bscan_fall()
+{
+    sim_tap_fall(&tap);
+    if (tap.state == SHIFT_DR && sim_bscan_bsr(tap.ir))
+        tap.tdo = bsr[0];
+}
+
+static uint8_t sim_bscan_tdo() { return tap.tdo; }
+
+static const sim_target_t sim_bscan = {
+    "BSCAN", sim_bscan_reset, sim_bscan_rise, sim_bscan_fall, sim_bscan_tdo, nullptr, nullptr
+};
+
+void sim_bscan_attach(const bscan_model_t* m)
+{
+    model = m;
+
+    memset(&tap, 0, sizeof(tap));
+    tap.ir_len = model->ir_len;
+    tap.ir_reset = SIM_BSCAN_IDCODE_IR;
+    tap.capture_dr = sim_bscan_capture_dr;
+    tap.update_dr = sim_bscan_update_dr;
+    tap.update_ir = sim_bscan_update_ir;
+
+    memset(&stats, 0, sizeof(stats));
+    memset(bsr, 0, sizeof(bsr));
+    memset(latch, 0, sizeof(latch));
+    memset(board, 1, sizeof(board));
+
+    for (uint16_t i = 0; i < model->length; i++)
+    {
+        driver[i] = -1;
+        wired[i] = -1;
+        if (sim_bscan_is_input(i) && model->cells[i].port != nullptr)
+            driver[i] = sim_bscan_output(model->cells[i].port);
+    }
+
+    sim_attach(&sim_bscan);
+}
+
+void sim_bscan_drive(const char* port, uint8_t level)
+{
+    for (uint16_t i = 0; i < model->length; i++)
+    {
+        if (sim_bscan_is_input(i) && sim_bscan_port(i, port))
+            board[i] = level ? 1 : 0;
+    }
+}
+
+void sim_bscan_wire(const char* from, const char* to)
+{
+    int16_t output = sim_bscan_output(from);
+
+    for (uint16_t i = 0; i < model->length; i++)
+    {
+        if (sim_bscan_is_input(i) && sim_bscan_port(i, to))
+            wired[i] = output;
+    }
+}
+
+uint8_t sim_bscan_level(const char* port) { return sim_bscan_drives(sim_bscan_output(port)); }
+
+const sim_bscan_stats_t* sim_bscan_stats() { return &stats; }
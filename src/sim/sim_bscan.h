@@ -0,0 +1,59 @@
+/** @file sim_bscan.h
+ *
+ * @brief Simulated device with a boundary register, behind the pins of sim.h,
+ * built from the same model the boundary scan engine (bscan.h) takes: IDCODE,
+ * SAMPLE/PRELOAD, EXTEST and BYPASS, and the pins of the cell map on a board.
+ *
+ * In EXTEST an output drives its pin while its control cell enables it,
+ * with the value of its update latch. Pins that are not driven by the device
+ * take the level the board puts on them (1 by default, a pull up), or the
+ * level of the output wired to them with sim_bscan_wire(). Input cells
+ * capture their pins, the other cells capture their update latches.
+ */
+#ifndef __SIM_BSCAN__H__
+#define __SIM_BSCAN__H__
+
+#include <stdint.h>
+
+#include "../bscan/bscan.h"
+
+#define SIM_BSCAN_IDCODE_IR 0x2
+
+/**
+ * Level of a pin that nothing drives.
+ */
+#define SIM_BSCAN_Z 2
+
+typedef struct
+{
+    uint32_t captures;  // Capture-DR of the BSR
+    uint32_t updates;   // Update-DR of the BSR in EXTEST
+} sim_bscan_stats_t;
+
+/**
+ * @brief Attach a simulated device to the pins. The opcodes of the model are
+ * taken as they are, IDCODE is SIM_BSCAN_IDCODE_IR and BYPASS all ones.
+ */
+void sim_bscan_attach(const bscan_model_t* model);
+
+/**
+ * @brief Put a level on a pin from the board.
+ */
+void sim_bscan_drive(const char* port, uint8_t level);
+
+/**
+ * @brief Wire the output of a pin to the input of another one.
+ */
+void sim_bscan_wire(const char* from, const char* to);
+
+/**
+ * @brief Level the device drives on a pin, or SIM_BSCAN_Z.
+ */
+uint8_t sim_bscan_level(const char* port);
+
+/**
+ * @brief Counters of the BSR scans since the device was attached.
+ */
+const sim_bscan_stats_t* sim_bscan_stats();
+
+#endif
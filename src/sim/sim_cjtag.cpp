@@ -0,0 +1,152 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "sim.h"
+#include "sim_cjtag.h"
+#include "../cjtag/cjtag.h"
+
+enum { CJTAG_OFFLINE, CJTAG_ACTIVATING, CJTAG_OSCAN1 };
+
+static const sim_target_t* target = nullptr;   // the four wire target behind the adapter
+static sim_cjtag_stats_t stats;
+
+static uint8_t mode = CJTAG_OFFLINE;
+static uint8_t edges = 0;           // TMSC edges while TCKC is high
+static bool pending = false;        // a rising edge waits for the falling one
+static uint8_t sample = 1;          // TMSC at that rising edge
+
+static uint32_t packets = 0;        // activation packets, LSB first
+static uint8_t packet_bits = 0;
+
+static uint8_t slot = 0;            // OScan1 slot of the next TCKC cycle
+static uint8_t tdi = 1;
+static uint8_t tms = 1;
+static bool driving = false;        // the adapter drives TDO on TMSC
+static uint8_t tdo = 1;
+
+static void sim_cjtag_escape()
+{
+    stats.escapes++;
+
+    if (edges >= 8)
+    {
+        // reset escape: the TAP behind goes to Test-Logic-Reset
+        mode = CJTAG_OFFLINE;
+        if (target->reset)
+            target->reset();
+    }
+    else if (edges >= 6)
+    {
+        mode = CJTAG_ACTIVATING;
+        packets = 0;
+        packet_bits = 0;
+    }
+    else if (edges >= 4)
+    {
+        mode = CJTAG_OFFLINE;
+    }
+}
+
+static void sim_cjtag_reset()
+{
+    mode = CJTAG_OFFLINE;
+    edges = 0;
+    pending = false;
+    driving = false;
+    if (target->reset)
+        target->reset();
+}
+
+static void sim_cjtag_rise(uint8_t tmsc, uint8_t)
+{
+    pending = true;
+    sample = tmsc;
+    edges = 0;
+}
+
+static void sim_cjtag_tms_edge() { edges++; }
+
+static void sim_cjtag_fall()
+{
+    driving = false;
+
+    if (edges)
+    {
+        sim_cjtag_escape();
+        edges = 0;
+        pending = false;
+        return;
+    }
+
+    if (!pending)
+        return;
+    pending = false;
+
+    switch (mode)
+    {
+    case CJTAG_ACTIVATING:
+        packets |= (uint32_t)sample << packet_bits;
+        if (++packet_bits < 12)
+            break;
+
+        if (packets == (CJTAG_OAC | (CJTAG_EC << 4) | (CJTAG_CP << 8)))
+        {
+            mode = CJTAG_OSCAN1;
+            slot = 0;
+            stats.activations++;
+        }
+        else
+        {
+            mode = CJTAG_OFFLINE;
+        }
+        break;
+
+    case CJTAG_OSCAN1:
+        if (slot == 0)
+        {
+            tdi = !sample;
+        }
+        else if (slot == 1)
+        {
+            tms = sample;
+        }
+        else
+        {
+            // the TDO slot is over, the TAP behind gets its TCK
+            target->rise(tms, tdi);
+            if (target->fall)
+                target->fall();
+            stats.cycles++;
+        }
+        slot = (slot + 1) % 3;
+
+        // TDO is driven during the low half of its slot
+        if (slot == 2)
+        {
+            driving = true;
+            tdo = target->tdo();
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+// TDI and TDO of the adapter are not wired
+static uint8_t sim_cjtag_tdo() { return 1; }
+
+static uint8_t sim_cjtag_tmsc() { return driving ? tdo : 1; }
+
+static const sim_target_t sim_cjtag = {
+    "cJTAG adapter", sim_cjtag_reset, sim_cjtag_rise, sim_cjtag_fall, sim_cjtag_tdo, sim_cjtag_tmsc, sim_cjtag_tms_edge
+};
+
+void sim_cjtag_attach()
+{
+    target = sim_attached();
+    memset(&stats, 0, sizeof(stats));
+    sim_attach(&sim_cjtag);
+}
+
+const sim_cjtag_stats_t* sim_cjtag_stats() { return &stats; }
@@ -0,0 +1,39 @@
+/** @file sim_cjtag.h
+ *
+ * @brief Simulated IEEE 1149.7 adapter (TAP.7 controller, T4 to T0) in front
+ * of a four wire target of the simulation: the driver sees the two wires
+ * TCKC (TCK) and TMSC (TMS), and the target behind gets a TCK for every
+ * OScan1 cycle, with the TMS and TDI of its slots.
+ *
+ * The adapter starts offline and leaves TMSC alone. A reset escape resets
+ * the TAP behind it and takes it offline, a selection escape followed by the
+ * activation packets of cjtag.h puts it online in OScan1, and a deselection
+ * escape takes it offline again. Packets that do not match keep it offline.
+ *
+ * A TCKC rising edge takes effect on the next falling edge, unless TMSC
+ * toggled meanwhile, which makes the high period an escape instead.
+ */
+#ifndef __SIM_CJTAG__H__
+#define __SIM_CJTAG__H__
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t escapes;       // escapes of any kind
+    uint32_t activations;   // times the adapter went online
+    uint32_t cycles;        // OScan1 cycles, TCKs of the target behind
+} sim_cjtag_stats_t;
+
+/**
+ * @brief Put the adapter in front of the target attached with sim_attach(),
+ * offline.
+ */
+void sim_cjtag_attach();
+
+/**
+ * @brief Counters of the adapter since it was attached.
+ */
+const sim_cjtag_stats_t* sim_cjtag_stats();
+
+#endif
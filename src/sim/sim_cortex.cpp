@@ -0,0 +1,729 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "sim.h"
+#include "sim_tap.h"
+#include "sim_cortex.h"
+#include "../arm/adiv5.h"
+#include "../arm/cortex_m.h"
+#include "../arm/arm_loader.h"
+#include "../arm/arm_dcc.h"
+#include "../swd/swd.h"
+
+static sim_tap_t tap;
+static sim_cortex_stats_t stats;
+
+static uint32_t mem_base = 0;
+static uint32_t* mem = nullptr;
+static uint32_t mem_words = 0;
+
+static uint32_t ctrl_stat = 0;
+static uint32_t dp_select = 0;
+static uint32_t result = 0;         // shifted out by the next DPACC / APACC scan
+static uint32_t csw = 0;
+static uint32_t tar = 0;
+
+static uint32_t sram_base = 0;
+static uint32_t* sram = nullptr;
+static uint32_t sram_words = 0;
+
+// core
+static bool halted = false;
+static uint32_t dhcsr = 0;          // control bits of the last DHCSR write
+static uint32_t dcrdr = 0;
+static uint32_t regs[CORTEX_M_XPSR + 1];
+
+// loader model
+static uint32_t loader_entry = 0xffffffff;
+static bool loader_running = false;
+static uint32_t loader_ctrl = 0;
+static uint32_t loader_buf = 0;     // buffer the loader takes next
+static bool loader_busy = false;    // programming the buffer, until loader_since + loader_us
+static uint32_t loader_since = 0;
+static uint32_t loader_us = 0;
+
+// DCC writer
+static const uint32_t* dcc_words = nullptr;
+static uint32_t dcc_left = 0;       // bytes
+static uint32_t dcc_byte = 0;       // byte of the current word
+
+static uint32_t wait_every = 0;
+static uint32_t ap_accesses = 0;
+static bool wait_next = false;      // the next scan is answered by WAIT
+static bool dropped = false;        // the scan being shifted was answered by WAIT
+
+// SWJ-DP port selection, the selection sequence follows at least 50 ones
+static bool swd_mode = false;
+static uint32_t sel_ones = 0;       // consecutive SWCLK cycles with TMS / SWDIO high
+static uint32_t sel_seq = 0;
+static uint8_t sel_bits = 0;        // bits of the selection sequence received, 0 if none
+
+typedef enum
+{
+    SWD_IDLE, SWD_REQUEST, SWD_TRN_ACK, SWD_ACK_DATA, SWD_TRN_HOST, SWD_WRITE_DATA
+} swd_state_t;
+
+// SWD-DP
+static swd_state_t swd_state = SWD_IDLE;
+static bool swd_need_idle = false;  // after a line reset, a request needs an idle cycle first
+static uint32_t swd_bits = 0;
+static uint32_t swd_req = 0;
+static uint64_t swd_in = 0;         // write data and parity
+static uint64_t swd_tx = 0;         // ACK, read data and parity, LSB first
+static uint8_t swd_tx_bits = 0;
+static uint8_t swd_out = 1;         // SWDIO driven by the target
+static bool swd_write = false;      // an accepted write waits for its data phase
+
+/**
+ * @brief A word of the memory or of the SRAM, or nullptr outside of them.
+ */
+static uint32_t* sim_cortex_mem(uint32_t addr)
+{
+    if (addr & 3)
+        return nullptr;
+    if (addr >= mem_base && (addr - mem_base) / 4 < mem_words)
+        return &mem[(addr - mem_base) / 4];
+    if (sram != nullptr && addr >= sram_base && (addr - sram_base) / 4 < sram_words)
+        return &sram[(addr - sram_base) / 4];
+
+    return nullptr;
+}
+
+/**
+ * @brief A word of the memory, or nullptr (and STICKYERR) outside of it.
+ */
+static uint32_t* sim_cortex_word(uint32_t addr)
+{
+    uint32_t* word = sim_cortex_mem(addr);
+
+    if (word == nullptr)
+    {
+        ctrl_stat |= DP_STICKYERR;
+        stats.faults++;
+    }
+
+    return word;
+}
+
+static void sim_cortex_halt()
+{
+    halted = true;
+    loader_running = false;
+}
+
+/**
+ * @brief Run the loader model: take the next buffer, and program it.
+ */
+static void sim_cortex_loader_step()
+{
+    uint32_t* count;
+    uint32_t* dest;
+    uint32_t* status;
+    uint32_t* word;
+    uint32_t first;
+
+    if (!loader_running)
+        return;
+
+    count = sim_cortex_mem(loader_ctrl + 4 * (2 * loader_buf + 1));
+    dest = sim_cortex_mem(loader_ctrl + 4 * (2 * loader_buf));
+    status = sim_cortex_mem(loader_ctrl + 16);
+    if (count == nullptr || dest == nullptr || status == nullptr)
+    {
+        sim_cortex_halt();
+        return;
+    }
+
+    if (loader_busy)
+    {
+        if (micros() - loader_since < loader_us)
+            return;
+        loader_busy = false;
+        *count = 0;
+        loader_buf ^= 1;
+        return;
+    }
+
+    if (*count == 0)
+        return;
+
+    // BKPT at the end
+    if (*count == ARM_LOADER_DONE)
+    {
+        sim_cortex_halt();
+        return;
+    }
+
+    // only the flash (the memory of sim_cortex_attach) is programmed
+    first = (*dest - mem_base) / 4;
+    if (*count > ARM_LOADER_BUF_WORDS || (*dest & 3) || *dest < mem_base || first + *count > mem_words)
+    {
+        *status = 1;
+        sim_cortex_halt();
+        return;
+    }
+
+    for (uint32_t i = 0; i < *count; i++)
+    {
+        word = sim_cortex_mem(loader_ctrl + 4 * (ARM_LOADER_CTRL_WORDS + loader_buf * ARM_LOADER_BUF_WORDS + i));
+        if (word == nullptr)
+        {
+            *status = 2;
+            sim_cortex_halt();
+            return;
+        }
+
+        // programming can only clear bits
+        mem[first + i] &= *word;
+        stats.programs++;
+    }
+
+    loader_busy = true;
+    loader_since = micros();
+    loader_us = *count * SIM_CORTEX_PROGRAM_US;
+}
+
+/**
+ * @brief Run the DCC writer of the target: the next byte, once DCRDR is free.
+ */
+static void sim_cortex_dcc_step()
+{
+    if (halted || dcc_left == 0 || (dcrdr & ARM_DCC_BUSY))
+        return;
+
+    dcrdr = (((*dcc_words >> (8 * dcc_byte)) & 0xff) << ARM_DCC_DATA_SHIFT) | ARM_DCC_BUSY;
+    stats.dcc_bytes++;
+    dcc_left--;
+    if (++dcc_byte == 4)
+    {
+        dcc_byte = 0;
+        dcc_words++;
+    }
+}
+
+/**
+ * @brief Debug registers of the core, in the System Control Space.
+ * @return false if the address is not one of them.
+ */
+static bool sim_cortex_scs(bool read, uint32_t addr, uint32_t data)
+{
+    uint8_t reg;
+
+    switch (addr)
+    {
+    case CORTEX_M_DHCSR:
+        if (read)
+        {
+            result = dhcsr | CORTEX_M_S_REGRDY | (halted ? CORTEX_M_S_HALT : 0);
+            break;
+        }
+        if ((data & 0xffff0000) != CORTEX_M_DBGKEY)
+            break;
+
+        dhcsr = data & 0xffff;
+        if ((dhcsr & CORTEX_M_C_DEBUGEN) && (dhcsr & CORTEX_M_C_HALT))
+        {
+            sim_cortex_halt();
+        }
+        else if (halted && (dhcsr & CORTEX_M_C_STEP))
+        {
+            // every instruction is a 16 bit one that does nothing
+            regs[CORTEX_M_PC] += 2;
+        }
+        else if (halted)
+        {
+            halted = false;
+            stats.resumes++;
+            if (dhcsr & CORTEX_M_C_MASKINTS)
+                stats.masked++;
+            loader_running = (regs[CORTEX_M_PC] & ~1UL) == (loader_entry & ~1UL);
+            loader_ctrl = regs[CORTEX_M_R0];
+            loader_buf = 0;
+            loader_busy = false;
+        }
+        break;
+
+    case CORTEX_M_DCRSR:
+        reg = data & 0x7f;
+        if (read || !halted || reg > CORTEX_M_XPSR)
+            break;
+        if (data & CORTEX_M_DCRSR_WRITE)
+            regs[reg] = dcrdr;
+        else
+            dcrdr = regs[reg];
+        break;
+
+    case CORTEX_M_DCRDR:
+        if (read)
+            result = dcrdr;
+        else
+            dcrdr = data;
+        break;
+
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+static void sim_cortex_dp(bool read, uint8_t reg, uint32_t data)
+{
+    switch (reg)
+    {
+    case SWD_DP_ABORT:
+        // DPIDR and ABORT of the SWD-DP, reserved on the JTAG-DP
+        if (!swd_mode)
+            break;
+        if (read)
+        {
+            result = SIM_CORTEX_DPIDR;
+            break;
+        }
+        if (data & SWD_ABORT_STKERRCLR)
+            ctrl_stat &= ~DP_STICKYERR;
+        if (data & SWD_ABORT_STKCMPCLR)
+            ctrl_stat &= ~DP_STICKYCMP;
+        if (data & SWD_ABORT_ORUNERRCLR)
+            ctrl_stat &= ~DP_STICKYORUN;
+        if (data & SWD_ABORT_WDERRCLR)
+            ctrl_stat &= ~DP_WDATAERR;
+        break;
+
+    case DP_CTRL_STAT:
+        if (read)
+        {
+            result = ctrl_stat;
+            break;
+        }
+        // the SWD-DP only clears them through ABORT
+        if (!swd_mode)
+            ctrl_stat &= ~(data & (DP_STICKYERR | DP_STICKYCMP | DP_STICKYORUN));
+        ctrl_stat = (ctrl_stat & ~(DP_CSYSPWRUPREQ | DP_CDBGPWRUPREQ | DP_CSYSPWRUPACK | DP_CDBGPWRUPACK)) |
+                    (data & (DP_CSYSPWRUPREQ | DP_CDBGPWRUPREQ));
+        // the power domains acknowledge right away
+        if (data & DP_CSYSPWRUPREQ)
+            ctrl_stat |= DP_CSYSPWRUPACK;
+        if (data & DP_CDBGPWRUPREQ)
+            ctrl_stat |= DP_CDBGPWRUPACK;
+        break;
+
+    case DP_SELECT:
+        if (read)
+            result = dp_select;
+        else
+            dp_select = data;
+        break;
+
+    case DP_RDBUFF:
+        // the result of the last access, again
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_cortex_ap(bool read, uint8_t reg, uint32_t data)
+{
+    uint32_t* word;
+
+    reg |= dp_select & 0xf0;
+    result = 0;
+
+    if (read)
+        stats.ap_reads++;
+    else
+        stats.ap_writes++;
+
+    if (wait_every && ++ap_accesses % wait_every == 0)
+        wait_next = true;
+
+    if (!(ctrl_stat & DP_CDBGPWRUPACK) || (dp_select >> 24) != 0)
+    {
+        ctrl_stat |= DP_STICKYERR;
+        stats.faults++;
+        return;
+    }
+
+    switch (reg)
+    {
+    case AP_CSW:
+        if (read)
+            result = csw | 0x40;    // DeviceEn
+        else
+            csw = data & ~(uint32_t)0xc0;
+        break;
+
+    case AP_TAR:
+        if (read)
+            result = tar;
+        else
+            tar = data;
+        break;
+
+    case AP_DRW:
+        word = sim_cortex_scs(read, tar, data) ? nullptr : sim_cortex_word(tar);
+        if (word != nullptr)
+        {
+            if (read)
+                result = *word;
+            else
+                *word = data;
+        }
+        // the increment wraps within the 1KB block
+        if ((csw & AP_CSW_ADDRINC_MASK) == AP_CSW_ADDRINC_SINGLE)
+            tar = (tar & ~(uint32_t)(ADIV5_TAR_BLOCK - 1)) | ((tar + 4) & (ADIV5_TAR_BLOCK - 1));
+        break;
+
+    case AP_IDR:
+        if (read)
+            result = SIM_CORTEX_AP_IDR;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_cortex_capture_dr(sim_tap_t* tap)
+{
+    switch (tap->ir)
+    {
+    case JTAG_DP_IDCODE:
+        tap->dr = SIM_CORTEX_IDCODE;
+        tap->dr_len = 32;
+        break;
+
+    case JTAG_DP_DPACC:
+    case JTAG_DP_APACC:
+        dropped = wait_next;
+        wait_next = false;
+        if (dropped)
+            stats.waits++;
+        tap->dr = ((uint64_t)result << 3) | (dropped ? ADIV5_ACK_WAIT : ADIV5_ACK_OK);
+        tap->dr_len = ADIV5_SCAN_LEN;
+        break;
+
+    case JTAG_DP_ABORT:
+        tap->dr_len = ADIV5_SCAN_LEN;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_cortex_update_dr(sim_tap_t* tap)
+{
+    bool read = tap->dr & 1;
+    uint8_t reg = ((tap->dr >> 1) & 3) << 2;
+    uint32_t data = tap->dr >> 3;
+
+    if (tap->ir != JTAG_DP_DPACC && tap->ir != JTAG_DP_APACC)
+        return;
+
+    stats.scans++;
+    if (dropped)
+        return;
+
+    if (tap->ir == JTAG_DP_DPACC)
+        sim_cortex_dp(read, reg, data);
+    else
+        sim_cortex_ap(read, reg, data);
+}
+
+static uint8_t sim_cortex_parity(uint32_t value)
+{
+    uint8_t parity = 0;
+
+    for (; value; value >>= 1)
+        parity ^= value & 1;
+
+    return parity;
+}
+
+/**
+ * @brief A complete SWD request: answer it, and run a read right away.
+ */
+static void sim_cortex_swd_request()
+{
+    bool ap = (swd_req >> 1) & 1;
+    bool read = (swd_req >> 2) & 1;
+    uint8_t reg = ((swd_req >> 3) & 3) << 2;
+    uint32_t ack = SWD_ACK_OK;
+    uint32_t saved;
+
+    // start, parity, stop and park, or no answer at all
+    if ((swd_req & 1) == 0 || ((swd_req >> 5) & 1) != sim_cortex_parity((swd_req >> 1) & 0xf) ||
+        ((swd_req >> 6) & 1) != 0 || ((swd_req >> 7) & 1) != 1)
+    {
+        swd_state = SWD_IDLE;
+        return;
+    }
+
+    stats.scans++;
+    swd_state = SWD_TRN_ACK;
+    swd_write = false;
+
+    if (wait_next)
+    {
+        wait_next = false;
+        stats.waits++;
+        ack = SWD_ACK_WAIT;
+    }
+    else if ((ctrl_stat & (DP_STICKYERR | DP_STICKYCMP | DP_STICKYORUN | DP_WDATAERR)) &&
+             (ap || (read && reg != SWD_DP_DPIDR && reg != DP_CTRL_STAT) || (!read && reg != SWD_DP_ABORT)))
+    {
+        // only DPIDR, CTRL/STAT and ABORT are accessible until the flags are cleared
+        ack = SWD_ACK_FAULT;
+    }
+
+    swd_tx = ack;
+    swd_tx_bits = 3;
+
+    if (ack != SWD_ACK_OK)
+        return;
+
+    if (!read)
+    {
+        swd_write = true;
+        return;
+    }
+
+    if (ap)
+    {
+        // posted: the result of the previous AP read, the new one stays for RDBUFF
+        saved = result;
+        sim_cortex_ap(true, reg, 0);
+    }
+    else
+    {
+        // not posted, and RDBUFF keeps the last AP read
+        saved = result;
+        sim_cortex_dp(true, reg, 0);
+        if (reg != DP_RDBUFF)
+        {
+            uint32_t value = result;
+            result = saved;
+            saved = value;
+        }
+    }
+
+    swd_tx |= ((uint64_t)saved << 3) | ((uint64_t)sim_cortex_parity(saved) << 35);
+    swd_tx_bits = 36;
+}
+
+/**
+ * @brief The write data phase is complete.
+ */
+static void sim_cortex_swd_write()
+{
+    bool ap = (swd_req >> 1) & 1;
+    uint8_t reg = ((swd_req >> 3) & 3) << 2;
+    uint32_t data = swd_in;
+    uint32_t saved = result;
+
+    if (((swd_in >> 32) & 1) != sim_cortex_parity(data))
+    {
+        ctrl_stat |= DP_WDATAERR;
+        return;
+    }
+
+    if (ap)
+        sim_cortex_ap(false, reg, data);
+    else
+        sim_cortex_dp(false, reg, data);
+
+    // a write leaves the last AP read in RDBUFF
+    result = saved;
+}
+
+static void sim_cortex_swd_rise(uint8_t swdio)
+{
+    // line reset
+    if (sel_ones >= 50)
+    {
+        swd_state = SWD_IDLE;
+        swd_tx_bits = 0;
+        swd_need_idle = true;
+        return;
+    }
+
+    switch (swd_state)
+    {
+    case SWD_IDLE:
+        if (!swdio)
+            swd_need_idle = false;
+        else if (!swd_need_idle)
+        {
+            swd_req = 1;
+            swd_bits = 1;
+            swd_state = SWD_REQUEST;
+        }
+        break;
+
+    case SWD_REQUEST:
+        swd_req |= (uint32_t)swdio << swd_bits;
+        if (++swd_bits == 8)
+            sim_cortex_swd_request();
+        break;
+
+    case SWD_TRN_ACK:
+        // the target drives SWDIO from the next cycle
+        swd_state = SWD_ACK_DATA;
+        break;
+
+    case SWD_ACK_DATA:
+        swd_tx >>= 1;
+        if (--swd_tx_bits == 0)
+            swd_state = SWD_TRN_HOST;
+        break;
+
+    case SWD_TRN_HOST:
+        swd_state = swd_write ? SWD_WRITE_DATA : SWD_IDLE;
+        swd_bits = 0;
+        swd_in = 0;
+        break;
+
+    case SWD_WRITE_DATA:
+        swd_in |= (uint64_t)swdio << swd_bits;
+        if (++swd_bits == 33)
+        {
+            sim_cortex_swd_write();
+            swd_state = SWD_IDLE;
+        }
+        break;
+    }
+}
+
+/**
+ * @brief Follow the selection sequences of the SWJ-DP.
+ * @return true if the port was switched by this cycle.
+ */
+static bool sim_cortex_select(uint8_t tms)
+{
+    bool switched = false;
+
+    if (sel_bits > 0)
+    {
+        sel_seq |= (uint32_t)tms << sel_bits;
+        if (++sel_bits == 16)
+        {
+            sel_bits = 0;
+            if (!swd_mode && sel_seq == SWD_JTAG_TO_SWD)
+            {
+                swd_mode = true;
+                swd_state = SWD_IDLE;
+                swd_tx_bits = 0;
+                switched = true;
+            }
+            else if (swd_mode && sel_seq == SWD_SWD_TO_JTAG)
+            {
+                swd_mode = false;
+                sim_tap_reset(&tap);
+                switched = true;
+            }
+        }
+    }
+    else if (!tms && sel_ones >= 50)
+    {
+        sel_seq = 0;
+        sel_bits = 1;
+    }
+
+    sel_ones = tms ? sel_ones + 1 : 0;
+
+    return switched;
+}
+
+static void sim_cortex_reset()
+{
+    sim_tap_reset(&tap);
+    swd_mode = false;
+    sel_ones = 0;
+    sel_bits = 0;
+}
+
+static void sim_cortex_rise(uint8_t tms, uint8_t tdi)
+{
+    sim_cortex_loader_step();
+    sim_cortex_dcc_step();
+
+    if (sim_cortex_select(tms))
+        return;
+
+    if (swd_mode)
+        sim_cortex_swd_rise(tms);
+    else
+        sim_tap_rise(&tap, tms, tdi);
+}
+
+static void sim_cortex_fall()
+{
+    if (swd_mode)
+        swd_out = swd_state == SWD_ACK_DATA && swd_tx_bits > 0 ? swd_tx & 1 : 1;
+    else
+        sim_tap_fall(&tap);
+}
+
+static uint8_t sim_cortex_tdo() { return tap.tdo; }
+
+static uint8_t sim_cortex_swdio() { return swd_out; }
+
+static const sim_target_t sim_cortex = {
+    "Cortex-M", sim_cortex_reset, sim_cortex_rise, sim_cortex_fall, sim_cortex_tdo, sim_cortex_swdio, nullptr
+};
+
+void sim_cortex_attach(uint32_t base, uint32_t* memory, uint32_t words)
+{
+    memset(&tap, 0, sizeof(tap));
+    tap.ir_len = SIM_CORTEX_IR_LEN;
+    tap.ir_reset = JTAG_DP_IDCODE;
+    tap.capture_dr = sim_cortex_capture_dr;
+    tap.update_dr = sim_cortex_update_dr;
+
+    memset(&stats, 0, sizeof(stats));
+    mem_base = base;
+    mem = memory;
+    mem_words = words;
+    ctrl_stat = 0;
+    dp_select = 0;
+    result = 0;
+    csw = 0x23000000;
+    tar = 0;
+    ap_accesses = 0;
+    wait_next = false;
+    dropped = false;
+
+    sram = nullptr;
+    sram_words = 0;
+    halted = false;
+    dhcsr = 0;
+    dcrdr = 0;
+    memset(regs, 0, sizeof(regs));
+    loader_running = false;
+    dcc_left = 0;
+
+    sim_attach(&sim_cortex);
+}
+
+void sim_cortex_set_sram(uint32_t base, uint32_t* memory, uint32_t words)
+{
+    sram_base = base;
+    sram = memory;
+    sram_words = words;
+}
+
+void sim_cortex_set_loader(uint32_t entry) { loader_entry = entry; }
+
+void sim_cortex_set_dcc(const uint32_t* words, uint32_t count)
+{
+    dcc_words = words;
+    dcc_left = count * 4;
+    dcc_byte = 0;
+}
+
+void sim_cortex_set_wait(uint32_t every) { wait_every = every; }
+
+const sim_cortex_stats_t* sim_cortex_stats() { return &stats; }
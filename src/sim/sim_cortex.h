@@ -0,0 +1,89 @@
+/** @file sim_cortex.h
+ *
+ * @brief Simulated Cortex-M debug port, behind the pins of sim.h: an SWJ-DP,
+ * a JTAG-DP (IDCODE, BYPASS, DPACC, APACC, ABORT) that the JTAG-to-SWD
+ * sequence switches to an SWD-DP, with a single MEM-AP (AHB-AP) in front of
+ * a caller supplied memory.
+ *
+ * The DP answers the way ADIv5 describes it: an access returns the result of
+ * the previous one, RDBUFF returns the last result again, and TAR is
+ * incremented within its 1KB block after every DRW access. AP accesses need
+ * the debug power up, and accesses outside of the memory set STICKYERR.
+ * WAIT can be injected to check that the driver repeats the dropped scans.
+ * Over SWD, the request parity is checked, DP reads are not posted, and
+ * while a sticky flag is set every access but DPIDR, CTRL/STAT and ABORT is
+ * answered by FAULT. A line reset is followed, and SWD-to-JTAG switches back.
+ *
+ * The core is modelled by its debug registers (DHCSR, DCRSR, DCRDR): it can
+ * be halted, its registers written, stepped over 16 bit instructions that do
+ * nothing, and resumed. It runs no code, except for a flash loader
+ * (arm_loader.h) resumed at the entry set by
+ * sim_cortex_set_loader(), which is run as a model: it programs the buffers
+ * of its control block into the memory of sim_cortex_attach(), taking the
+ * program time of the real flash, and halts when it is done.
+ * While running, the core can write words to the DCC (arm_dcc.h), a byte
+ * at a time as libdcc does.
+ */
+#ifndef __SIM_CORTEX__H__
+#define __SIM_CORTEX__H__
+
+#include <stdint.h>
+
+#define SIM_CORTEX_IDCODE 0x4ba00477
+#define SIM_CORTEX_IR_LEN 4
+#define SIM_CORTEX_DPIDR  0x2ba01477    // SW-DP of Cortex-M3/M4
+#define SIM_CORTEX_AP_IDR 0x24770011    // AHB-AP of Cortex-M3/M4
+
+/**
+ * Flash program time of a 32 bit word, in microseconds.
+ */
+#define SIM_CORTEX_PROGRAM_US 16
+
+typedef struct
+{
+    uint32_t scans;         // DPACC and APACC scans, or SWD transfers
+    uint32_t ap_reads;      // APACC reads
+    uint32_t ap_writes;     // APACC writes
+    uint32_t waits;         // scans answered by WAIT
+    uint32_t faults;        // accesses that set STICKYERR
+    uint32_t programs;      // words programmed by the loader
+    uint32_t dcc_bytes;     // bytes written to the DCC by the core
+    uint32_t resumes;       // halted core resumed
+    uint32_t masked;        // resumed with the interrupts masked (C_MASKINTS)
+} sim_cortex_stats_t;
+
+/**
+ * @brief Attach a simulated Cortex-M to the pins.
+ * @param base Address of the first word of the memory.
+ * @param mem Memory content, modified by the writes.
+ * @param words Number of 32 bit words in the memory.
+ */
+void sim_cortex_attach(uint32_t base, uint32_t* mem, uint32_t words);
+
+/**
+ * @brief Add the SRAM of the target, where the loader and its buffers go.
+ */
+void sim_cortex_set_sram(uint32_t base, uint32_t* sram, uint32_t words);
+
+/**
+ * @brief Run the loader model when the core is resumed at the given entry address.
+ */
+void sim_cortex_set_loader(uint32_t entry);
+
+/**
+ * @brief Let the running core write words to the DCC, the next byte as soon
+ * as the driver took the previous one.
+ */
+void sim_cortex_set_dcc(const uint32_t* words, uint32_t count);
+
+/**
+ * @brief Answer WAIT to the scan that follows every n-th AP access, 0 never.
+ */
+void sim_cortex_set_wait(uint32_t every);
+
+/**
+ * @brief Counters of the DAP accesses since the target was attached.
+ */
+const sim_cortex_stats_t* sim_cortex_stats();
+
+#endif
@@ -0,0 +1,253 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "sim.h"
+#include "sim_tap.h"
+#include "sim_max10.h"
+#include "sim_sld.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../max10/max10_ir.h"
+#include "../max10/max10_funcs.h"
+
+static sim_tap_t tap;
+static sim_max10_stats_t stats;
+
+static uint32_t* flash = nullptr;
+static uint32_t flash_words = 0;
+static uint32_t usercode = 0xffffffff;
+
+static bool isc = false;            // between ISC_ENABLE and ISC_DISABLE
+static uint32_t addr = 0;           // word index of the next ISC access
+
+static bool erasing = false;
+static uint32_t erase_first = 0;
+static uint32_t erase_words = 0;
+static uint32_t erase_us = 0;
+static uint32_t busy_since = 0;
+static uint32_t busy_us = 0;        // the flash takes no command until busy_us passed
+
+/**
+ * @brief Complete a pending erase, if its time has come.
+ * @return true if the flash is still busy.
+ */
+static bool sim_max10_busy()
+{
+    uint32_t now = micros();
+
+    if (erasing && now - busy_since >= erase_us)
+    {
+        for (uint32_t i = erase_first; i < erase_first + erase_words && i < flash_words; i++)
+            flash[i] = 0xffffffff;
+        erasing = false;
+    }
+
+    return now - busy_since < busy_us;
+}
+
+static void sim_max10_erase(uint32_t first, uint32_t words, uint32_t us)
+{
+    if (sim_max10_busy())
+    {
+        stats.violations++;
+        return;
+    }
+
+    erasing = true;
+    erase_first = first;
+    erase_words = words;
+    erase_us = us;
+    busy_since = micros();
+    busy_us = us;
+    stats.erases++;
+}
+
+static void sim_max10_capture_dr(sim_tap_t* tap)
+{
+    if (sim_sld_scan(tap->ir))
+    {
+        sim_sld_capture(tap->ir);
+        return;
+    }
+
+    switch (tap->ir)
+    {
+    case IDCODE:
+        tap->dr = SIM_MAX10_IDCODE;
+        tap->dr_len = 32;
+        break;
+
+    case USERCODE:
+        tap->dr = usercode;
+        tap->dr_len = 32;
+        break;
+
+    case ISC_ADDRESS_SHIFT:
+        tap->dr = (uint64_t)addr * 4;
+        tap->dr_len = 23;
+        break;
+
+    case ISC_READ:
+        tap->dr_len = 32;
+        if (!isc)
+            break;
+
+        // the device does not define a read while the flash is busy, it is
+        // counted, and gets the content before the erase or the program
+        if (sim_max10_busy())
+            stats.violations++;
+        tap->dr = addr < flash_words ? flash[addr] : 0xffffffff;
+
+        addr++;
+        stats.reads++;
+        break;
+
+    case ISC_PROGRAM:
+        tap->dr_len = 32;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_max10_update_dr(sim_tap_t* tap)
+{
+    if (sim_sld_scan(tap->ir))
+    {
+        sim_sld_update(tap->ir);
+        return;
+    }
+
+    switch (tap->ir)
+    {
+    case ISC_ADDRESS_SHIFT:
+        addr = (tap->dr & 0x7fffff) / 4;
+        break;
+
+    case ISC_PROGRAM:
+        if (!isc)
+            break;
+
+        if (sim_max10_busy())
+        {
+            // the word is lost, and the address does not move
+            stats.violations++;
+            break;
+        }
+
+        // programming can only clear bits
+        if (addr < flash_words)
+            flash[addr] &= (uint32_t)tap->dr;
+        addr++;
+        busy_since = micros();
+        busy_us = SIM_MAX10_PROGRAM_US;
+        stats.programs++;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_max10_update_ir(sim_tap_t* tap)
+{
+    uint32_t first, words;
+
+    // TEST_LOGIC_RESET clears the VIR of the SLD hub
+    if (tap->state == TEST_LOGIC_RESET)
+        sim_sld_reset();
+
+    switch (tap->ir)
+    {
+    case ISC_ENABLE:
+        isc = true;
+        break;
+
+    case ISC_DISABLE:
+        // leaving ISC mode cuts a running erase short, the flash is left as it was
+        if (erasing && sim_max10_busy())
+        {
+            stats.violations++;
+            erasing = false;
+            busy_us = 0;
+        }
+        isc = false;
+        break;
+
+    case DSM_CLEAR:
+        if (isc)
+            sim_max10_erase(0, flash_words, SIM_MAX10_ERASE_US);
+        break;
+
+    case ISC_ERASE:
+        if (!isc)
+            break;
+
+        // the sector that holds the shifted address
+        for (uint32_t i = 0; i < MAX10_SECTORS; i++)
+        {
+            first = max10_sectors[i].start / 4;
+            words = max10_sectors[i].words;
+            if (addr >= first && addr < first + words)
+            {
+                sim_max10_erase(first, words, SIM_MAX10_SECTOR_ERASE_US);
+                break;
+            }
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_max10_reset()
+{
+    isc = false;
+    addr = 0;
+    sim_tap_reset(&tap);
+}
+
+static void sim_max10_rise(uint8_t tms, uint8_t tdi)
+{
+    // the registers of the SLD hub are longer than the register of the TAP
+    if (tap.state == SHIFT_DR && sim_sld_scan(tap.ir))
+        sim_sld_shift(tdi);
+
+    sim_tap_rise(&tap, tms, tdi);
+}
+
+static void sim_max10_fall()
+{
+    sim_tap_fall(&tap);
+    if (tap.state == SHIFT_DR && sim_sld_scan(tap.ir))
+        tap.tdo = sim_sld_tdo();
+}
+
+static uint8_t sim_max10_tdo() { return tap.tdo; }
+
+static const sim_target_t sim_max10 = {
+    "MAX10", sim_max10_reset, sim_max10_rise, sim_max10_fall, sim_max10_tdo, nullptr, nullptr
+};
+
+void sim_max10_attach(uint32_t* image, uint32_t words)
+{
+    memset(&tap, 0, sizeof(tap));
+    tap.ir_len = SIM_MAX10_IR_LEN;
+    tap.ir_reset = IDCODE;
+    tap.capture_dr = sim_max10_capture_dr;
+    tap.update_dr = sim_max10_update_dr;
+    tap.update_ir = sim_max10_update_ir;
+
+    memset(&stats, 0, sizeof(stats));
+    flash = image;
+    flash_words = words;
+    erasing = false;
+    busy_us = 0;
+
+    sim_attach(&sim_max10);
+}
+
+void sim_max10_set_usercode(uint32_t code) { usercode = code; }
+
+const sim_max10_stats_t* sim_max10_stats() { return &stats; }
@@ -0,0 +1,56 @@
+/** @file sim_max10.h
+ *
+ * @brief Simulated MAX10 FPGA (10M08), behind the pins of sim.h.
+ * Implements the instructions of max10_ir.h that the driver uses:
+ * IDCODE, USERCODE, BYPASS, ISC_ENABLE / ISC_DISABLE, ISC_ADDRESS_SHIFT (23 bits),
+ * ISC_READ with address auto increment, ISC_PROGRAM, ISC_ERASE of the sector
+ * at the shifted address and DSM_CLEAR of the whole flash.
+ *
+ * The UFM / CFM content is a caller supplied image of 32 bit words, indexed
+ * by (ISC address / 4). Words past the image read as erased.
+ * Erase and program take the time of the real device (micros()). Reading the
+ * flash while it is busy returns its old content, ISC_DISABLE during an
+ * erase aborts it, and a word programmed too early is dropped: all of them
+ * are counted as timing violations.
+ */
+#ifndef __SIM_MAX10__H__
+#define __SIM_MAX10__H__
+
+#include <stdint.h>
+
+#define SIM_MAX10_IDCODE   0x031820dd
+#define SIM_MAX10_IR_LEN   10
+
+/**
+ * Erase and program times, in microseconds.
+ */
+#define SIM_MAX10_ERASE_US        350000    // DSM_CLEAR, as in the ISC flow of the BSDL
+#define SIM_MAX10_SECTOR_ERASE_US 200000    // ISC_ERASE
+#define SIM_MAX10_PROGRAM_US      305       // ISC_PROGRAM of a single word
+
+typedef struct
+{
+    uint32_t reads;         // words read with ISC_READ
+    uint32_t programs;      // words programmed with ISC_PROGRAM
+    uint32_t erases;        // erases started, device and sector
+    uint32_t violations;    // program or erase while the flash was busy
+} sim_max10_stats_t;
+
+/**
+ * @brief Attach a simulated MAX10 to the pins.
+ * @param image Flash content, modified by program and erase.
+ * @param words Number of 32 bit words in the image.
+ */
+void sim_max10_attach(uint32_t* image, uint32_t words);
+
+/**
+ * @brief Set the 32 bit user code of the design.
+ */
+void sim_max10_set_usercode(uint32_t usercode);
+
+/**
+ * @brief Counters of the flash accesses since the device was attached.
+ */
+const sim_max10_stats_t* sim_max10_stats();
+
+#endif
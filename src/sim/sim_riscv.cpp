@@ -0,0 +1,470 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "sim.h"
+#include "sim_tap.h"
+#include "sim_riscv.h"
+#include "../riscv/riscv_dtm.h"
+#include "../riscv/riscv_dm.h"
+
+#define SIM_RISCV_PROGBUF_SIZE 4
+#define SIM_RISCV_DATACOUNT    1
+
+// cmderr values
+#define CMDERR_BUSY          1
+#define CMDERR_NOT_SUPPORTED 2
+#define CMDERR_EXCEPTION     3
+#define CMDERR_HALT_RESUME   4
+
+// sberror: bad address
+#define SBERROR_ADDRESS 2
+
+static sim_tap_t tap;
+static sim_riscv_stats_t stats;
+
+static uint32_t tcks = 0;           // rising edges since attached
+static uint32_t dmi_latency = 8;
+static uint32_t cmd_latency = 0;
+static uint32_t sb_latency = 0;
+static uint8_t idle_hint = 1;
+
+// DTM
+static uint8_t dmistat = 0;         // sticky busy or failed, until dmireset
+static uint32_t dmi_done = 0;       // TCK count the running DMI access completes at
+static uint32_t dmi_data = 0;
+static uint8_t dmi_addr = 0;
+
+// DM and hart
+static bool dmactive = false;
+static bool halted = false;
+static bool resumeack = false;
+static uint32_t gprs[32];
+static uint32_t dpc = 0;
+static uint32_t data0 = 0;
+static uint32_t progbuf[SIM_RISCV_PROGBUF_SIZE];
+static uint8_t cmderr = 0;
+static uint32_t cmd_done = 0;
+
+// system bus
+static uint32_t* mem = nullptr;
+static uint32_t mem_base = 0;
+static uint32_t mem_words = 0;
+static uint32_t sbcs = 0;           // the writable fields and the errors
+static uint32_t sbaddress = 0;
+static uint32_t sbdata = 0;
+static uint32_t sb_done = 0;
+
+/**
+ * @brief The word of the memory at an address, or nullptr if there is none.
+ */
+static uint32_t* sim_riscv_word(uint32_t addr)
+{
+    if ((addr & 3) || addr < mem_base || (addr - mem_base) / 4 >= mem_words)
+        return nullptr;
+
+    return &mem[(addr - mem_base) / 4];
+}
+
+/**
+ * @brief Run the program buffer on the hart until ebreak.
+ * @return 0, or the cmderr of an exception.
+ */
+static uint8_t sim_riscv_exec()
+{
+    uint32_t insn, rd, rs1, rs2;
+    int32_t imm;
+    uint32_t* word;
+
+    for (uint32_t pc = 0; pc < SIM_RISCV_PROGBUF_SIZE; pc++)
+    {
+        insn = progbuf[pc];
+        rd = (insn >> 7) & 0x1f;
+        rs1 = (insn >> 15) & 0x1f;
+        rs2 = (insn >> 20) & 0x1f;
+
+        if (insn == RISCV_EBREAK)
+            return 0;
+
+        switch (insn & 0x707f)
+        {
+        case 0x0013:    // addi
+            imm = (int32_t)insn >> 20;
+            if (rd)
+                gprs[rd] = gprs[rs1] + imm;
+            break;
+
+        case 0x2003:    // lw
+            imm = (int32_t)insn >> 20;
+            word = sim_riscv_word(gprs[rs1] + imm);
+            if (word == nullptr)
+                return CMDERR_EXCEPTION;
+            if (rd)
+                gprs[rd] = *word;
+            break;
+
+        case 0x2023:    // sw
+            imm = (((int32_t)insn >> 25) << 5) | rd;
+            word = sim_riscv_word(gprs[rs1] + imm);
+            if (word == nullptr)
+                return CMDERR_EXCEPTION;
+            *word = gprs[rs2];
+            break;
+
+        default:
+            return CMDERR_EXCEPTION;
+        }
+    }
+
+    // no ebreak at the end of the program buffer
+    return CMDERR_EXCEPTION;
+}
+
+/**
+ * @brief Run an access register command.
+ * @return 0, or the cmderr it fails with.
+ */
+static uint8_t sim_riscv_command(uint32_t command)
+{
+    uint32_t regno = command & 0xffff;
+    uint32_t* reg = nullptr;
+
+    stats.commands++;
+
+    if ((command >> 24) != 0 || (command & (7UL << 20)) != RISCV_CMD_AARSIZE_32)
+        return CMDERR_NOT_SUPPORTED;
+    if (!halted)
+        return CMDERR_HALT_RESUME;
+
+    if (command & RISCV_CMD_TRANSFER)
+    {
+        if (regno >= RISCV_REG_GPR(0) && regno <= RISCV_REG_GPR(31))
+            reg = &gprs[regno - RISCV_REG_GPR(0)];
+        else if (regno == RISCV_CSR_DPC)
+            reg = &dpc;
+        else
+            return CMDERR_EXCEPTION;
+
+        if (!(command & RISCV_CMD_WRITE))
+            data0 = *reg;
+        else if (reg != &gprs[0])
+            *reg = data0;
+    }
+
+    return command & RISCV_CMD_POSTEXEC ? sim_riscv_exec() : 0;
+}
+
+/**
+ * @brief true while an abstract command runs. An access to its registers
+ * meanwhile sets cmderr busy, and is ignored.
+ */
+static bool sim_riscv_cmd_busy()
+{
+    if ((int32_t)(tcks - cmd_done) >= 0)
+        return false;
+
+    if (cmderr == 0)
+        cmderr = CMDERR_BUSY;
+
+    return true;
+}
+
+/**
+ * @brief Start a system bus access at sbaddress, the address increments after it.
+ * @param write Writes sbdata, else reads into it.
+ */
+static void sim_riscv_sb_access(bool write)
+{
+    uint32_t* word = sim_riscv_word(sbaddress);
+
+    if (word == nullptr)
+    {
+        sbcs |= (uint32_t)SBERROR_ADDRESS << 12;
+        return;
+    }
+
+    if (write)
+    {
+        *word = sbdata;
+        stats.sb_writes++;
+    }
+    else
+    {
+        sbdata = *word;
+        stats.sb_reads++;
+    }
+
+    if (sbcs & RISCV_SBCS_AUTOINCREMENT)
+        sbaddress += 4;
+    sb_done = tcks + sb_latency;
+}
+
+/**
+ * @brief true if no system bus access can start: one still runs, which sets
+ * sbbusyerror, or an error is pending.
+ */
+static bool sim_riscv_sb_blocked()
+{
+    if ((int32_t)(tcks - sb_done) < 0)
+        sbcs |= RISCV_SBCS_BUSYERROR;
+
+    return (sbcs & RISCV_SBCS_BUSYERROR) || RISCV_SBCS_ERROR(sbcs);
+}
+
+static uint32_t sim_riscv_dm_read(uint8_t addr)
+{
+    uint32_t value = 0;
+
+    if (!dmactive && addr != RISCV_DM_DMCONTROL)
+        return 0;
+
+    switch (addr)
+    {
+    case RISCV_DM_DMCONTROL:
+        return dmactive ? RISCV_DMCONTROL_DMACTIVE : 0;
+
+    case RISCV_DM_DMSTATUS:
+        // version 0.13, authenticated, no implicit ebreak
+        value = RISCV_DM_VERSION_013 | (1UL << 7);
+        value |= halted ? RISCV_DMSTATUS_ALLHALTED | RISCV_DMSTATUS_ANYHALTED
+                        : RISCV_DMSTATUS_ALLRUNNING | (1UL << 10);
+        if (resumeack)
+            value |= RISCV_DMSTATUS_ALLRESUMEACK | (1UL << 16);
+        return value;
+
+    case RISCV_DM_ABSTRACTCS:
+        value = SIM_RISCV_DATACOUNT | ((uint32_t)cmderr << 8) | ((uint32_t)SIM_RISCV_PROGBUF_SIZE << 24);
+        if ((int32_t)(tcks - cmd_done) < 0)
+            value |= RISCV_ABSTRACTCS_BUSY;
+        return value;
+
+    case RISCV_DM_DATA0:
+        return sim_riscv_cmd_busy() ? 0 : data0;
+
+    case RISCV_DM_SBCS:
+        // version 1, 32 address bits, 32 bit accesses
+        value = (1UL << 29) | (32UL << 5) | RISCV_SBCS_ACCESS32 | sbcs;
+        if ((int32_t)(tcks - sb_done) < 0)
+            value |= RISCV_SBCS_BUSY;
+        return value;
+
+    case RISCV_DM_SBADDRESS0:
+        return sbaddress;
+
+    case RISCV_DM_SBDATA0:
+        if (sim_riscv_sb_blocked())
+            return 0;
+        value = sbdata;
+        if (sbcs & RISCV_SBCS_READONDATA)
+            sim_riscv_sb_access(false);
+        return value;
+
+    default:
+        if (addr >= RISCV_DM_PROGBUF0 && addr < RISCV_DM_PROGBUF0 + SIM_RISCV_PROGBUF_SIZE)
+            return progbuf[addr - RISCV_DM_PROGBUF0];
+        return 0;
+    }
+}
+
+static void sim_riscv_dm_write(uint8_t addr, uint32_t value)
+{
+    uint8_t err;
+
+    if (!dmactive && addr != RISCV_DM_DMCONTROL)
+        return;
+
+    switch (addr)
+    {
+    case RISCV_DM_DMCONTROL:
+        dmactive = value & RISCV_DMCONTROL_DMACTIVE;
+        if (!dmactive)
+        {
+            cmderr = 0;
+            sbcs = 0;
+            break;
+        }
+        if (value & RISCV_DMCONTROL_HALTREQ)
+        {
+            resumeack = false;
+            halted = true;
+        }
+        else if (value & RISCV_DMCONTROL_RESUMEREQ)
+        {
+            resumeack = true;
+            halted = false;
+        }
+        break;
+
+    case RISCV_DM_ABSTRACTCS:
+        if (!sim_riscv_cmd_busy())
+            cmderr &= ~(uint8_t)(RISCV_ABSTRACTCS_CMDERR(value));
+        break;
+
+    case RISCV_DM_COMMAND:
+        if (sim_riscv_cmd_busy() || cmderr != 0)
+            break;
+        err = sim_riscv_command(value);
+        cmderr = err;
+        cmd_done = tcks + cmd_latency;
+        break;
+
+    case RISCV_DM_DATA0:
+        if (!sim_riscv_cmd_busy())
+            data0 = value;
+        break;
+
+    case RISCV_DM_SBCS:
+        sbcs &= ~(value & (RISCV_SBCS_BUSYERROR | RISCV_SBCS_ERROR_CLEAR));
+        sbcs = (sbcs & (RISCV_SBCS_BUSYERROR | RISCV_SBCS_ERROR_CLEAR)) |
+               (value & (RISCV_SBCS_READONADDR | (7UL << 17) | RISCV_SBCS_AUTOINCREMENT | RISCV_SBCS_READONDATA));
+        break;
+
+    case RISCV_DM_SBADDRESS0:
+        if (sim_riscv_sb_blocked())
+            break;
+        sbaddress = value;
+        if (sbcs & RISCV_SBCS_READONADDR)
+            sim_riscv_sb_access(false);
+        break;
+
+    case RISCV_DM_SBDATA0:
+        if (sim_riscv_sb_blocked())
+            break;
+        sbdata = value;
+        sim_riscv_sb_access(true);
+        break;
+
+    default:
+        if (addr >= RISCV_DM_PROGBUF0 && addr < RISCV_DM_PROGBUF0 + SIM_RISCV_PROGBUF_SIZE &&
+            !sim_riscv_cmd_busy())
+            progbuf[addr - RISCV_DM_PROGBUF0] = value;
+        break;
+    }
+}
+
+static void sim_riscv_capture_dr(sim_tap_t* tap)
+{
+    switch (tap->ir)
+    {
+    case RISCV_DTM_IDCODE:
+        tap->dr = SIM_RISCV_IDCODE;
+        tap->dr_len = 32;
+        break;
+
+    case RISCV_DTM_DTMCS:
+        tap->dr = RISCV_DTMCS_VERSION_013 | (SIM_RISCV_ABITS << 4) | ((uint32_t)dmistat << 10) |
+                  ((uint32_t)idle_hint << 12);
+        tap->dr_len = 32;
+        break;
+
+    case RISCV_DTM_DMI:
+        // captured before the access completed: busy, until dmireset
+        if (dmistat == 0 && (int32_t)(tcks - dmi_done) < 0)
+            dmistat = RISCV_DMI_BUSY;
+        if (dmistat == RISCV_DMI_BUSY)
+            stats.busy++;
+
+        tap->dr = dmistat | ((uint64_t)dmi_data << 2) | ((uint64_t)dmi_addr << 34);
+        tap->dr_len = SIM_RISCV_ABITS + 34;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_riscv_update_dr(sim_tap_t* tap)
+{
+    uint8_t op = tap->dr & 3;
+
+    switch (tap->ir)
+    {
+    case RISCV_DTM_DTMCS:
+        if (tap->dr & (RISCV_DTMCS_DMIRESET | RISCV_DTMCS_DMIHARDRESET))
+            dmistat = 0;
+        if (tap->dr & RISCV_DTMCS_DMIHARDRESET)
+            dmi_done = tcks;
+        break;
+
+    case RISCV_DTM_DMI:
+        // the scan started while busy, or while an access still runs, is dropped
+        if (dmistat != 0 || op == RISCV_DMI_NOP)
+            break;
+        if ((int32_t)(tcks - dmi_done) < 0)
+        {
+            dmistat = RISCV_DMI_BUSY;
+            break;
+        }
+
+        dmi_addr = (tap->dr >> 34) & ((1 << SIM_RISCV_ABITS) - 1);
+        if (op == RISCV_DMI_READ)
+            dmi_data = sim_riscv_dm_read(dmi_addr);
+        else if (op == RISCV_DMI_WRITE)
+            sim_riscv_dm_write(dmi_addr, (uint32_t)(tap->dr >> 2));
+        else
+            dmistat = RISCV_DMI_FAILED;
+
+        dmi_done = tcks + dmi_latency;
+        stats.dmi_accesses++;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_riscv_reset()
+{
+    dmistat = 0;
+    dmi_done = tcks;
+    sim_tap_reset(&tap);
+}
+
+static void sim_riscv_rise(uint8_t tms, uint8_t tdi)
+{
+    tcks++;
+    sim_tap_rise(&tap, tms, tdi);
+}
+
+static void sim_riscv_fall() { sim_tap_fall(&tap); }
+
+static uint8_t sim_riscv_tdo() { return tap.tdo; }
+
+static const sim_target_t sim_riscv = {
+    "RISC-V", sim_riscv_reset, sim_riscv_rise, sim_riscv_fall, sim_riscv_tdo, nullptr, nullptr
+};
+
+void sim_riscv_attach(uint32_t base, uint32_t* memory, uint32_t words)
+{
+    memset(&tap, 0, sizeof(tap));
+    tap.ir_len = SIM_RISCV_IR_LEN;
+    tap.ir_reset = RISCV_DTM_IDCODE;
+    tap.capture_dr = sim_riscv_capture_dr;
+    tap.update_dr = sim_riscv_update_dr;
+
+    memset(&stats, 0, sizeof(stats));
+    memset(gprs, 0, sizeof(gprs));
+    memset(progbuf, 0, sizeof(progbuf));
+    mem = memory;
+    mem_base = base;
+    mem_words = words;
+    dmactive = false;
+    halted = false;
+    resumeack = false;
+    cmderr = 0;
+    cmd_done = tcks;
+    sbcs = 0;
+    sb_done = tcks;
+
+    sim_attach(&sim_riscv);
+}
+
+void sim_riscv_set_latency(uint32_t dmi, uint32_t command, uint32_t sb)
+{
+    dmi_latency = dmi;
+    cmd_latency = command;
+    sb_latency = sb;
+}
+
+void sim_riscv_set_idle_hint(uint8_t idle) { idle_hint = idle; }
+
+const sim_riscv_stats_t* sim_riscv_stats() { return &stats; }
@@ -0,0 +1,58 @@
+/** @file sim_riscv.h
+ *
+ * @brief Simulated RISC-V hart, behind the pins of sim.h: a 0.13 JTAG DTM
+ * (IDCODE, DTMCS, DMI, BYPASS) in front of a debug module with a single
+ * hart, abstract register access, a four word program buffer and 32 bit
+ * system bus access to a caller supplied memory.
+ *
+ * A DMI access takes a number of TCK cycles. A scan that captures the DMI
+ * before the access completed, or starts an access meanwhile, gets busy and
+ * the DMI ignores the scans until dmireset. The abstract commands and the
+ * system bus accesses can take time as well, and accesses that come too
+ * early set cmderr busy or sbbusyerror.
+ *
+ * The program buffer runs lw, sw and addi, anything else is an exception.
+ */
+#ifndef __SIM_RISCV__H__
+#define __SIM_RISCV__H__
+
+#include <stdint.h>
+
+#define SIM_RISCV_IDCODE 0x20000913
+#define SIM_RISCV_IR_LEN 5
+#define SIM_RISCV_ABITS  7
+
+typedef struct
+{
+    uint32_t dmi_accesses;  // DMI reads and writes started
+    uint32_t busy;          // scans answered by busy
+    uint32_t commands;      // abstract commands run
+    uint32_t sb_reads;      // system bus reads
+    uint32_t sb_writes;     // system bus writes
+} sim_riscv_stats_t;
+
+/**
+ * @brief Attach a simulated RISC-V hart to the pins.
+ * @param base Address of the first word of the memory on the system bus.
+ * @param mem Memory content, modified by the writes.
+ * @param words Number of 32 bit words in the memory.
+ */
+void sim_riscv_attach(uint32_t base, uint32_t* mem, uint32_t words);
+
+/**
+ * @brief TCK cycles taken by a DMI access, by an abstract command and by a
+ * system bus access, from the end of the scan that starts it.
+ */
+void sim_riscv_set_latency(uint32_t dmi, uint32_t command, uint32_t sb);
+
+/**
+ * @brief Idle cycles hinted in DTMCS.
+ */
+void sim_riscv_set_idle_hint(uint8_t idle);
+
+/**
+ * @brief Counters of the DMI accesses since the target was attached.
+ */
+const sim_riscv_stats_t* sim_riscv_stats();
+
+#endif
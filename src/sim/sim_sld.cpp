@@ -0,0 +1,162 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "sim_sld.h"
+#include "../max10/max10_ir.h"
+
+// address bits of the hub and its nodes
+#define SIM_SLD_ADDR_LEN 2
+#define SIM_SLD_VIR_LEN  (SIM_SLD_INSTR_LEN + SIM_SLD_ADDR_LEN)
+
+static const uint8_t node_instr_len[SIM_SLD_NODES] = { SIM_SLD_INSTR_LEN, 3 };
+
+static sim_sld_stats_t stats;
+static bool present = false;
+
+static uint32_t vir = 0;            // loaded VIR, address and instruction
+static uint32_t vir_shift = 0;      // VIR shift register
+static uint32_t info_nibble = 0;    // next nibble of the infos
+
+// VDR scan: captured bits shifted out, and the bits shifted in
+static uint8_t vdr_out[SIM_SLD_MAX_BITS];
+static uint8_t vdr_in[SIM_SLD_MAX_BITS];
+static uint32_t vdr_len = 0;        // bits captured
+static uint32_t vdr_pos = 0;        // bits shifted
+
+static uint32_t vjtag_data[SIM_SLD_NODES];
+static uint32_t vjtag_counter = 0;
+
+static uint32_t sim_sld_info(uint32_t word)
+{
+    if (word == 0)
+        return (1UL << 27) | ((uint32_t)SIM_SLD_NODES << 19) | ((uint32_t)SIM_SLD_MFG << 8) | SIM_SLD_INSTR_LEN;
+    if (word <= SIM_SLD_NODES)
+        return (1UL << 27) | ((uint32_t)SIM_SLD_NODE_VJTAG << 19) | ((uint32_t)SIM_SLD_MFG << 8) | (word - 1);
+    return 0;
+}
+
+static void sim_sld_load(uint32_t value, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++)
+        vdr_out[i] = (value >> i) & 1;
+    vdr_len = len;
+}
+
+/**
+ * @brief The last bits shifted into a register of len bits, as a shift
+ * register keeps them. Bits that were not shifted keep the capture.
+ */
+static uint32_t sim_sld_shifted(uint32_t len)
+{
+    uint32_t value = 0;
+    uint32_t bit;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        if (vdr_pos >= len)
+            bit = vdr_in[vdr_pos - len + i];
+        else
+            bit = i + vdr_pos >= len ? vdr_in[i + vdr_pos - len] : vdr_out[i + vdr_pos];
+        value |= bit << i;
+    }
+
+    return value;
+}
+
+bool sim_sld_scan(uint32_t ir)
+{
+    return present && (ir == USER0 || ir == USER1);
+}
+
+void sim_sld_capture(uint32_t ir)
+{
+    uint32_t address = vir >> SIM_SLD_INSTR_LEN;
+    uint32_t node, instr;
+
+    vdr_pos = 0;
+    vdr_len = 0;
+
+    if (ir == USER1)
+    {
+        sim_sld_load(vir, SIM_SLD_VIR_LEN);
+        vir_shift = vir;
+        return;
+    }
+
+    // the hub info and the node infos, a nibble a scan
+    if (address == 0)
+    {
+        sim_sld_load((sim_sld_info(info_nibble / 8) >> (4 * (info_nibble % 8))) & 0xf, 4);
+        info_nibble++;
+        stats.info_reads++;
+        return;
+    }
+
+    node = address - 1;
+    if (node >= SIM_SLD_NODES)
+        return;
+
+    // a node decodes the bits of its own instruction width
+    instr = vir & ((1UL << node_instr_len[node]) - 1);
+    stats.vdr_scans++;
+    if (instr == SIM_SLD_VJTAG_DATA)
+        sim_sld_load(vjtag_data[node], 32);
+    else if (instr == SIM_SLD_VJTAG_COUNTER)
+        sim_sld_load(vjtag_counter++, 32);
+}
+
+void sim_sld_shift(uint8_t tdi)
+{
+    vir_shift = (vir_shift >> 1) | ((uint32_t)tdi << (SIM_SLD_VIR_LEN - 1));
+    if (vdr_pos < SIM_SLD_MAX_BITS)
+        vdr_in[vdr_pos] = tdi;
+    vdr_pos++;
+}
+
+uint8_t sim_sld_tdo()
+{
+    return vdr_pos < vdr_len ? vdr_out[vdr_pos] : 0;
+}
+
+void sim_sld_update(uint32_t ir)
+{
+    uint32_t address = vir >> SIM_SLD_INSTR_LEN;
+    uint32_t node;
+
+    if (ir == USER1)
+    {
+        vir = vir_shift & ((1UL << SIM_SLD_VIR_LEN) - 1);
+        address = vir >> SIM_SLD_INSTR_LEN;
+        if (address == 0)
+            info_nibble = 0;
+        else
+            stats.vir_updates++;
+        return;
+    }
+
+    node = address - 1;
+    if (address == 0 || node >= SIM_SLD_NODES || vdr_pos > SIM_SLD_MAX_BITS)
+        return;
+
+    if ((vir & ((1UL << node_instr_len[node]) - 1)) == SIM_SLD_VJTAG_DATA)
+        vjtag_data[node] = sim_sld_shifted(32);
+}
+
+void sim_sld_reset()
+{
+    vir = 0;
+    info_nibble = 0;
+}
+
+void sim_sld_attach()
+{
+    memset(&stats, 0, sizeof(stats));
+    memset(vjtag_data, 0, sizeof(vjtag_data));
+    vjtag_counter = 0;
+    present = true;
+    sim_sld_reset();
+}
+
+uint32_t sim_sld_vjtag_data(uint8_t instance) { return instance < SIM_SLD_NODES ? vjtag_data[instance] : 0; }
+
+const sim_sld_stats_t* sim_sld_stats() { return &stats; }
@@ -0,0 +1,72 @@
+/** @file sim_sld.h
+ *
+ * @brief Simulated SLD hub of a MAX10 design, reached through USER1 (VIR)
+ * and USER0 (VDR) of the simulated MAX10 (sim_max10.h).
+ *
+ * The hub has two Virtual JTAG instances with different instruction widths,
+ * so the VIR is m + n bits: m = SIM_SLD_INSTR_LEN, the widest node
+ * instruction, and n = 2 address bits for the hub and its nodes. A VIR of
+ * address 0 selects the hub info, read as 4 bit VDR scans, a nibble each,
+ * the hub info first and then the node infos. The VIR is reset in
+ * TEST_LOGIC_RESET.
+ *
+ * Registers of a Virtual JTAG node:
+ *  - SIM_SLD_VJTAG_DATA: 32 bits, read and written.
+ *  - SIM_SLD_VJTAG_COUNTER: 32 bits, counts its captures.
+ */
+#ifndef __SIM_SLD__H__
+#define __SIM_SLD__H__
+
+#include <stdint.h>
+
+#define SIM_SLD_MFG          0x06e
+#define SIM_SLD_NODE_VJTAG   8
+
+/**
+ * Node instruction width of the hub (m), the widest node instruction.
+ */
+#define SIM_SLD_INSTR_LEN    5
+#define SIM_SLD_NODES        2
+
+#define SIM_SLD_VJTAG_DATA    1
+#define SIM_SLD_VJTAG_COUNTER 2
+
+/**
+ * Longest VDR scan the hub keeps, in bits.
+ */
+#define SIM_SLD_MAX_BITS 1024
+
+typedef struct
+{
+    uint32_t vir_updates;   // VIR scans that loaded a node instruction
+    uint32_t vdr_scans;     // VDR scans of a node register
+    uint32_t info_reads;    // nibbles of the hub and node infos read
+} sim_sld_stats_t;
+
+/**
+ * @brief Add the hub to the design of the simulated MAX10, after sim_max10_attach().
+ */
+void sim_sld_attach();
+
+/**
+ * @brief Data register of a Virtual JTAG instance.
+ */
+uint32_t sim_sld_vjtag_data(uint8_t instance);
+
+/**
+ * @brief Counters of the hub accesses since it was attached.
+ */
+const sim_sld_stats_t* sim_sld_stats();
+
+/**
+ * @brief The hub side of the MAX10 TAP, called by sim_max10 for USER0 and USER1.
+ * @return sim_sld_scan(): true if the instruction is a hub scan and the hub is there.
+ */
+bool sim_sld_scan(uint32_t ir);
+void sim_sld_capture(uint32_t ir);
+void sim_sld_shift(uint8_t tdi);
+uint8_t sim_sld_tdo();
+void sim_sld_update(uint32_t ir);
+void sim_sld_reset();
+
+#endif
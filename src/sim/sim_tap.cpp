@@ -0,0 +1,99 @@
+#include "sim_tap.h"
+#include "../jtag_drv/jtag_drv.h"
+
+// next state for TMS = 0 and TMS = 1, in the order of tap_state
+static const uint8_t sim_tap_next[16][2] = {
+    { RUN_TEST_IDLE, TEST_LOGIC_RESET },    // TEST_LOGIC_RESET
+    { RUN_TEST_IDLE, SELECT_DR },           // RUN_TEST_IDLE
+    { CAPTURE_DR, SELECT_IR },              // SELECT_DR
+    { SHIFT_DR, EXIT1_DR },                 // CAPTURE_DR
+    { SHIFT_DR, EXIT1_DR },                 // SHIFT_DR
+    { PAUSE_DR, UPDATE_DR },                // EXIT1_DR
+    { PAUSE_DR, EXIT2_DR },                 // PAUSE_DR
+    { SHIFT_DR, UPDATE_DR },                // EXIT2_DR
+    { RUN_TEST_IDLE, SELECT_DR },           // UPDATE_DR
+    { CAPTURE_IR, TEST_LOGIC_RESET },       // SELECT_IR
+    { SHIFT_IR, EXIT1_IR },                 // CAPTURE_IR
+    { SHIFT_IR, EXIT1_IR },                 // SHIFT_IR
+    { PAUSE_IR, UPDATE_IR },                // EXIT1_IR
+    { PAUSE_IR, EXIT2_IR },                 // PAUSE_IR
+    { SHIFT_IR, UPDATE_IR },                // EXIT2_IR
+    { RUN_TEST_IDLE, SELECT_DR },           // UPDATE_IR
+};
+
+void sim_tap_reset(sim_tap_t* tap)
+{
+    tap->state = TEST_LOGIC_RESET;
+    tap->ir = tap->ir_reset;
+    tap->tdo = 1;
+    if (tap->update_ir)
+        tap->update_ir(tap);
+}
+
+void sim_tap_rise(sim_tap_t* tap, uint8_t tms, uint8_t tdi)
+{
+    uint8_t prev = tap->state;
+
+    switch (tap->state)
+    {
+    case SHIFT_DR:
+        tap->dr = (tap->dr >> 1) | ((uint64_t)tdi << (tap->dr_len - 1));
+        break;
+
+    case SHIFT_IR:
+        tap->ir_shift = (tap->ir_shift >> 1) | ((uint32_t)tdi << (tap->ir_len - 1));
+        break;
+
+    case RUN_TEST_IDLE:
+        if (tap->idle)
+            tap->idle(tap);
+        break;
+
+    default:
+        break;
+    }
+
+    tap->state = sim_tap_next[tap->state][tms ? 1 : 0];
+
+    switch (tap->state)
+    {
+    case TEST_LOGIC_RESET:
+        if (prev != TEST_LOGIC_RESET)
+            sim_tap_reset(tap);
+        break;
+
+    case CAPTURE_DR:
+        // bypass unless the model has a register for the instruction
+        tap->dr = 0;
+        tap->dr_len = 1;
+        tap->capture_dr(tap);
+        break;
+
+    case CAPTURE_IR:
+        // IEEE 1149.1 requires 01 in the LSBs
+        tap->ir_shift = 1;
+        break;
+
+    case UPDATE_DR:
+        if (tap->update_dr)
+            tap->update_dr(tap);
+        break;
+
+    case UPDATE_IR:
+        tap->ir = tap->ir_shift;
+        if (tap->update_ir)
+            tap->update_ir(tap);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void sim_tap_fall(sim_tap_t* tap)
+{
+    if (tap->state == SHIFT_DR)
+        tap->tdo = tap->dr & 1;
+    else if (tap->state == SHIFT_IR)
+        tap->tdo = tap->ir_shift & 1;
+}
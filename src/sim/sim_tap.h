@@ -0,0 +1,51 @@
+/** @file sim_tap.h
+ *
+ * @brief IEEE 1149.1 TAP controller of a simulated target. The target model
+ * provides the data registers through callbacks, the TAP does the state
+ * machine, the shifting and the instruction register.
+ */
+#ifndef __SIM_TAP__H__
+#define __SIM_TAP__H__
+
+#include <stdint.h>
+
+typedef struct sim_tap sim_tap_t;
+
+struct sim_tap
+{
+    uint8_t state;          // tap_state of jtag_drv.h
+    uint8_t ir_len;
+    uint32_t ir;            // instruction in effect
+    uint32_t ir_reset;      // instruction loaded in TEST_LOGIC_RESET (IDCODE or BYPASS)
+    uint32_t ir_shift;
+    uint64_t dr;            // data register being shifted, up to 64 bits
+    uint8_t dr_len;
+    uint8_t tdo;
+    void* ctx;              // the target model
+
+    // CAPTURE_DR: set dr and dr_len for the instruction in ir
+    void (*capture_dr)(sim_tap_t* tap);
+    // UPDATE_DR: dr holds the shifted in value, if not nullptr
+    void (*update_dr)(sim_tap_t* tap);
+    // UPDATE_IR: ir holds the new instruction, if not nullptr
+    void (*update_ir)(sim_tap_t* tap);
+    // rising edge of TCK in RUN_TEST_IDLE, if not nullptr
+    void (*idle)(sim_tap_t* tap);
+};
+
+/**
+ * @brief Put the TAP in TEST_LOGIC_RESET and load its reset instruction.
+ */
+void sim_tap_reset(sim_tap_t* tap);
+
+/**
+ * @brief Rising edge of TCK: shift, and move to the next state.
+ */
+void sim_tap_rise(sim_tap_t* tap, uint8_t tms, uint8_t tdi);
+
+/**
+ * @brief Falling edge of TCK: present the next bit on TDO.
+ */
+void sim_tap_fall(sim_tap_t* tap);
+
+#endif
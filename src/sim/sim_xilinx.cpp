@@ -0,0 +1,273 @@
+#include <Arduino.h>
+#include <string.h>
+
+#include "sim.h"
+#include "sim_tap.h"
+#include "sim_xilinx.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../xilinx/xc7_ir.h"
+
+static sim_tap_t tap;
+static sim_xc7_stats_t stats;
+
+static uint32_t usercode = 0xffffffff;
+
+static bool initializing = false;   // housecleaning after JPROGRAM
+static uint32_t init_since = 0;
+
+static bool synced = false;
+static uint32_t word = 0;           // bits of CFG_IN, MSB first
+static uint8_t bits = 0;
+static uint8_t reg = 0;             // register of the last type 1 packet
+static bool writing = false;
+static uint32_t words_left = 0;     // data words of the current packet
+
+static uint32_t crc = 0;
+static bool error = false;          // CRC or IDCODE mismatch, the startup is blocked
+static bool started = false;        // START command
+static uint32_t startup_tcks = 0;
+static bool done = false;
+
+uint32_t sim_xc7_crc(uint32_t crc, uint8_t reg, uint32_t data)
+{
+    uint64_t val = ((uint64_t)(reg & 0x1f) << 32) | data;
+
+    for (uint8_t i = 0; i < 37; i++)
+    {
+        if ((crc ^ (uint32_t)(val >> i)) & 1)
+            crc = (crc >> 1) ^ 0x82f63b78;
+        else
+            crc >>= 1;
+    }
+
+    return crc;
+}
+
+static bool sim_xc7_init_complete()
+{
+    if (initializing && micros() - init_since >= SIM_XC7_INIT_US)
+        initializing = false;
+
+    return !initializing;
+}
+
+static void sim_xc7_write_reg(uint8_t reg, uint32_t data)
+{
+    if (reg == SIM_XC7_REG_CRC)
+    {
+        stats.crc_checks++;
+        if (data != crc)
+        {
+            stats.crc_errors++;
+            error = true;
+        }
+        crc = 0;
+        return;
+    }
+
+    crc = sim_xc7_crc(crc, reg, data);
+
+    switch (reg)
+    {
+    case SIM_XC7_REG_FDRI:
+        stats.fdri_words++;
+        break;
+
+    case SIM_XC7_REG_IDCODE:
+        if ((data & 0x0fffffff) != (SIM_XC7_IDCODE & 0x0fffffff))
+            error = true;
+        break;
+
+    case SIM_XC7_REG_CMD:
+        switch (data & 0x1f)
+        {
+        case SIM_XC7_CMD_RCRC:
+            crc = 0;
+            break;
+
+        case SIM_XC7_CMD_START:
+            started = true;
+            break;
+
+        case SIM_XC7_CMD_DESYNC:
+            synced = false;
+            break;
+
+        default:
+            break;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_xc7_word(uint32_t w)
+{
+    stats.words++;
+
+    if (words_left > 0)
+    {
+        words_left--;
+        if (writing)
+            sim_xc7_write_reg(reg, w);
+        return;
+    }
+
+    switch (w >> 29)
+    {
+    case 1:
+        // type 1: op [28:27], register [17:13], words [10:0]
+        writing = ((w >> 27) & 3) == 2;
+        reg = (w >> 13) & 0x1f;
+        words_left = w & 0x7ff;
+        break;
+
+    case 2:
+        // type 2: the register of the type 1 packet before it, words [26:0]
+        writing = ((w >> 27) & 3) == 2;
+        words_left = w & 0x7ffffff;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_xc7_cfg_in(uint8_t tdi)
+{
+    // the device does not take a bitstream before the housecleaning is over
+    if (!sim_xc7_init_complete())
+        return;
+
+    word = (word << 1) | tdi;
+
+    if (!synced)
+    {
+        // the sync word aligns the words
+        if (word == SIM_XC7_SYNC)
+        {
+            synced = true;
+            bits = 0;
+            words_left = 0;
+        }
+        return;
+    }
+
+    if (++bits == 32)
+    {
+        sim_xc7_word(word);
+        bits = 0;
+    }
+}
+
+static void sim_xc7_capture_dr(sim_tap_t* tap)
+{
+    switch (tap->ir)
+    {
+    case XC7_IDCODE:
+        tap->dr = SIM_XC7_IDCODE;
+        tap->dr_len = 32;
+        break;
+
+    case XC7_USERCODE:
+        tap->dr = usercode;
+        tap->dr_len = 32;
+        break;
+
+    case XC7_CFG_IN:
+        tap->dr_len = 32;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_xc7_update_ir(sim_tap_t* tap)
+{
+    switch (tap->ir)
+    {
+    case XC7_JPROGRAM:
+        // clear the configuration
+        initializing = true;
+        init_since = micros();
+        synced = false;
+        word = 0;
+        words_left = 0;
+        crc = 0;
+        error = false;
+        started = false;
+        done = false;
+        break;
+
+    case XC7_JSTART:
+        startup_tcks = 0;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void sim_xc7_idle(sim_tap_t* tap)
+{
+    if (tap->ir != XC7_JSTART || !started || error || done)
+        return;
+
+    if (++startup_tcks >= SIM_XC7_STARTUP_TCKS)
+    {
+        done = true;
+        stats.startups++;
+    }
+}
+
+static void sim_xc7_reset() { sim_tap_reset(&tap); }
+
+static void sim_xc7_rise(uint8_t tms, uint8_t tdi)
+{
+    if (tap.state == SHIFT_DR && tap.ir == XC7_CFG_IN)
+        sim_xc7_cfg_in(tdi);
+
+    sim_tap_rise(&tap, tms, tdi);
+
+    // the status bits are captured above the 01 of IEEE 1149.1
+    if (tap.state == CAPTURE_IR)
+    {
+        tap.ir_shift = 1;
+        if (sim_xc7_init_complete())
+            tap.ir_shift |= XC7_IR_INIT_COMPLETE;
+        if (done)
+            tap.ir_shift |= XC7_IR_DONE | XC7_IR_ISC_DONE;
+    }
+}
+
+static void sim_xc7_fall() { sim_tap_fall(&tap); }
+
+static uint8_t sim_xc7_tdo() { return tap.tdo; }
+
+static const sim_target_t sim_xc7 = {
+    "XC7A35T", sim_xc7_reset, sim_xc7_rise, sim_xc7_fall, sim_xc7_tdo, nullptr, nullptr
+};
+
+void sim_xc7_attach()
+{
+    memset(&tap, 0, sizeof(tap));
+    tap.ir_len = SIM_XC7_IR_LEN;
+    tap.ir_reset = XC7_IDCODE;
+    tap.capture_dr = sim_xc7_capture_dr;
+    tap.update_ir = sim_xc7_update_ir;
+    tap.idle = sim_xc7_idle;
+
+    memset(&stats, 0, sizeof(stats));
+    initializing = false;
+    synced = false;
+    started = false;
+    error = false;
+    done = false;
+
+    sim_attach(&sim_xc7);
+}
+
+const sim_xc7_stats_t* sim_xc7_stats() { return &stats; }
@@ -0,0 +1,72 @@
+/** @file sim_xilinx.h
+ *
+ * @brief Simulated Xilinx 7-series FPGA (XC7A35T), behind the pins of sim.h:
+ * the configuration TAP of xc7_ir.h with IDCODE, USERCODE, BYPASS, ISC_NOOP,
+ * JPROGRAM, JSTART and CFG_IN, and the status bits captured in the IR.
+ *
+ * JPROGRAM clears the configuration, and INIT_COMPLETE is captured once the
+ * housecleaning time passed (micros()). The bits shifted through CFG_IN are
+ * taken MSB first into 32 bit words: the words before the sync word
+ * 0xAA995566 are ignored, then type 1 and type 2 packets write the
+ * configuration registers. Every register write updates the CRC of UG470,
+ * a write of the CRC register checks it, and a write of IDCODE checks the
+ * part. DONE goes high after the START command and SIM_XC7_STARTUP_TCKS
+ * cycles in Run-Test/Idle with JSTART, unless a check failed.
+ */
+#ifndef __SIM_XILINX__H__
+#define __SIM_XILINX__H__
+
+#include <stdint.h>
+
+#define SIM_XC7_IDCODE  0x0362d093
+#define SIM_XC7_IR_LEN  6
+
+#define SIM_XC7_INIT_US        1000    // housecleaning after JPROGRAM
+#define SIM_XC7_STARTUP_TCKS   64      // startup sequence after JSTART
+
+/**
+ * Configuration packets and registers (UG470, configuration packets).
+ */
+#define SIM_XC7_SYNC        0xaa995566
+#define SIM_XC7_NOOP        0x20000000
+#define SIM_XC7_TYPE1_WRITE(reg, words) (0x30000000 | ((uint32_t)(reg) << 13) | (words))
+#define SIM_XC7_TYPE2_WRITE(words)      (0x50000000 | (words))
+
+#define SIM_XC7_REG_CRC     0x00
+#define SIM_XC7_REG_FAR     0x01
+#define SIM_XC7_REG_FDRI    0x02
+#define SIM_XC7_REG_CMD     0x04
+#define SIM_XC7_REG_IDCODE  0x0c
+
+#define SIM_XC7_CMD_WCFG    0x01
+#define SIM_XC7_CMD_START   0x05
+#define SIM_XC7_CMD_RCRC    0x07
+#define SIM_XC7_CMD_DESYNC  0x0d
+
+typedef struct
+{
+    uint32_t words;         // words shifted through CFG_IN after the sync word
+    uint32_t fdri_words;    // words written to FDRI, the frame data
+    uint32_t crc_checks;    // writes of the CRC register
+    uint32_t crc_errors;    // of them, the ones that did not match
+    uint32_t startups;      // times DONE went high
+} sim_xc7_stats_t;
+
+/**
+ * @brief Attach a simulated 7-series FPGA to the pins, unconfigured.
+ */
+void sim_xc7_attach();
+
+/**
+ * @brief Update the configuration CRC with a register write, the way the
+ * device does: the 5 bit register address above the 32 data bits, shifted
+ * LSB first through a CRC-32C. Starts from 0, and after RCRC.
+ */
+uint32_t sim_xc7_crc(uint32_t crc, uint8_t reg, uint32_t data);
+
+/**
+ * @brief Counters of the configuration since the device was attached.
+ */
+const sim_xc7_stats_t* sim_xc7_stats();
+
+#endif
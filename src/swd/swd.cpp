@@ -0,0 +1,168 @@
+#include <Arduino.h>
+
+#include "swd.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../../include/main.h"
+
+/**
+ * @brief Drive the n LSBs of bits on SWDIO, a SWCLK cycle each.
+ */
+static void swd_write_bits(uint32_t bits, uint8_t n)
+{
+    for (uint8_t i = 0; i < n; i++)
+    {
+        PIN_WRITE(SWDIO, bits & 1);
+        PIN_WRITE(SWCLK, 0); HC;
+        PIN_WRITE(SWCLK, 1); HC;
+        bits >>= 1;
+    }
+}
+
+/**
+ * @brief Read n bits the target drives on SWDIO, first bit in the LSB.
+ */
+static uint32_t swd_read_bits(uint8_t n)
+{
+    uint32_t bits = 0;
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        PIN_WRITE(SWCLK, 0); HC;
+        bits |= (uint32_t)PIN_READ(SWDIO) << i;
+        PIN_WRITE(SWCLK, 1); HC;
+    }
+
+    return bits;
+}
+
+/**
+ * @brief Turnaround cycle: SWDIO is handed over to the target, or taken back from it.
+ */
+static void swd_turnaround(bool to_target)
+{
+    if (to_target)
+        PIN_MODE(SWDIO, INPUT_PULLUP);
+
+    PIN_WRITE(SWCLK, 0); HC;
+    PIN_WRITE(SWCLK, 1); HC;
+
+    if (!to_target)
+        PIN_MODE(SWDIO, OUTPUT);
+}
+
+static uint8_t swd_parity(uint32_t value)
+{
+    value ^= value >> 16;
+    value ^= value >> 8;
+    value ^= value >> 4;
+    value ^= value >> 2;
+    value ^= value >> 1;
+
+    return value & 1;
+}
+
+void swd_init(swd_t* swd, uint32_t retries, uint8_t idle)
+{
+    swd->retries = retries;
+    swd->idle = idle;
+    swd->dpidr = 0;
+    swd->waits = 0;
+    swd->faults = 0;
+}
+
+void swd_line_reset()
+{
+    PIN_MODE(SWDIO, OUTPUT);
+    for (uint8_t i = 0; i < SWD_LINE_RESET_CYCLES; i++)
+        swd_write_bits(1, 1);
+    swd_write_bits(0, 2);
+}
+
+status_t swd_connect(swd_t* swd)
+{
+    status_t rc;
+
+    // the selection sequence is only recognized after at least 50 ones
+    PIN_MODE(SWDIO, OUTPUT);
+    for (uint8_t i = 0; i < SWD_LINE_RESET_CYCLES; i++)
+        swd_write_bits(1, 1);
+    swd_write_bits(SWD_JTAG_TO_SWD, 16);
+    swd_line_reset();
+
+    rc = swd_transfer(swd, false, true, SWD_DP_DPIDR, 0, &swd->dpidr);
+    if (rc != OK)
+    {
+        Serial.print("\nNo SWD-DP answers: "); Serial.println(rc, DEC);
+        return -ERR_TAP_DEVICE_UNAVAILABLE;
+    }
+
+    return swd_transfer(swd, false, false, SWD_DP_ABORT, SWD_ABORT_CLEAR_ALL, nullptr);
+}
+
+void swd_disconnect()
+{
+    PIN_MODE(SWDIO, OUTPUT);
+    for (uint8_t i = 0; i < SWD_LINE_RESET_CYCLES; i++)
+        swd_write_bits(1, 1);
+    swd_write_bits(SWD_SWD_TO_JTAG, 16);
+
+    // TMS high from here on resets the TAP
+    reset_tap();
+}
+
+status_t swd_transfer(swd_t* swd, bool ap, bool read, uint8_t reg, uint32_t in, uint32_t* out)
+{
+    uint32_t request, ack, data, parity;
+    uint8_t header = (ap ? 1 : 0) | (read ? 2 : 0) | (reg & 0xc);
+
+    // start, APnDP, RnW, A[3:2], parity, stop, park
+    request = 1 | (header << 1) | (swd_parity(header) << 5) | (1 << 7);
+
+    for (uint32_t retry = 0; retry <= swd->retries; retry++)
+    {
+        swd_write_bits(request, 8);
+        swd_turnaround(true);
+        ack = swd_read_bits(3);
+
+        if (ack == SWD_ACK_OK && read)
+        {
+            data = swd_read_bits(32);
+            parity = swd_read_bits(1);
+            swd_turnaround(false);
+            swd_write_bits(0, swd->idle);
+
+            if (parity != swd_parity(data))
+                return -ERR_BAD_CHECKSUM;
+            if (out != nullptr)
+                *out = data;
+            return OK;
+        }
+
+        swd_turnaround(false);
+
+        if (ack == SWD_ACK_OK)
+        {
+            swd_write_bits(in, 32);
+            swd_write_bits(swd_parity(in), 1);
+            swd_write_bits(0, swd->idle);
+            return OK;
+        }
+
+        if (ack == SWD_ACK_FAULT)
+        {
+            // a sticky flag is set, every access but DPIDR, CTRL/STAT and ABORT faults until it is cleared
+            swd->faults++;
+            swd_transfer(swd, false, false, SWD_DP_ABORT, SWD_ABORT_CLEAR_ALL, nullptr);
+            return -ERR_BUS_FAULT;
+        }
+
+        // no DP in front of the driver, or it lost the framing
+        if (ack != SWD_ACK_WAIT)
+            return -ERR_TAP_DEVICE_UNAVAILABLE;
+
+        // the transfer was dropped, repeat it
+        swd->waits++;
+    }
+
+    return -ERR_TIMEOUT;
+}
@@ -0,0 +1,111 @@
+/** @file swd.h
+ *
+ * @brief ARM Serial Wire Debug on the JTAG pins (SWCLK on TCK, SWDIO on TMS,
+ * see main.h), a transport of the ADIv5 DAP layer (adiv5.h) next to the JTAG-DP.
+ *
+ * A transfer, driven bits LSB first, SWDIO sampled by the target on the
+ * rising edge of SWCLK, and by the driver while SWCLK is low:
+ *
+ *   request (8 bits, driver): start 1, APnDP, RnW, A[2], A[3], parity, stop 0, park 1
+ *   turnaround, ACK (3 bits, target): OK 0b001, WAIT 0b010, FAULT 0b100
+ *   read:  data (32 bits) and parity from the target, turnaround
+ *   write: turnaround, data (32 bits) and parity from the driver
+ *
+ * WAIT and FAULT end the transfer after the ACK. A WAIT transfer is repeated
+ * up to the configured number of retries, a FAULT clears the sticky flags of
+ * the DP through ABORT. AP reads are posted as over the JTAG-DP: a read
+ * returns the result of the previous AP read, RDBUFF the last one.
+ *
+ * Bits are shifted from and to packed 32 bit words, not the one byte per
+ * bit registers of the JTAG driver, and back to back transfers need no idle
+ * cycles in between: a word of a block access is 46 SWCLK cycles.
+ */
+#ifndef __SWD__H__
+#define __SWD__H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+
+#define SWD_ACK_OK    0x1
+#define SWD_ACK_WAIT  0x2
+#define SWD_ACK_FAULT 0x4
+
+/**
+ * DP registers that differ from the JTAG-DP: ABORT is written at A[3:2] = 0,
+ * where reads return DPIDR.
+ */
+#define SWD_DP_ABORT 0x0
+#define SWD_DP_DPIDR 0x0
+
+/**
+ * ABORT bits, the sticky flags of CTRL/STAT are only cleared through them.
+ */
+#define SWD_ABORT_DAPABORT  (1UL << 0)
+#define SWD_ABORT_STKCMPCLR (1UL << 1)
+#define SWD_ABORT_STKERRCLR (1UL << 2)
+#define SWD_ABORT_WDERRCLR  (1UL << 3)
+#define SWD_ABORT_ORUNERRCLR (1UL << 4)
+#define SWD_ABORT_CLEAR_ALL (SWD_ABORT_STKCMPCLR | SWD_ABORT_STKERRCLR | SWD_ABORT_WDERRCLR | SWD_ABORT_ORUNERRCLR)
+
+/**
+ * Selection sequences of an SWJ-DP, sent after a line reset, LSB first.
+ */
+#define SWD_JTAG_TO_SWD 0xe79e
+#define SWD_SWD_TO_JTAG 0xe73c
+
+/**
+ * SWCLK cycles with SWDIO high of a line reset (at least 50).
+ */
+#define SWD_LINE_RESET_CYCLES 56
+
+/**
+ * Default number of repeats of a transfer answered by WAIT.
+ */
+#define SWD_WAIT_RETRIES 100
+
+typedef struct
+{
+    uint32_t retries;       // repeats of a transfer answered by WAIT
+    uint8_t idle;           // idle cycles after every transfer
+    uint32_t dpidr;         // read by swd_connect()
+    uint32_t waits;         // WAIT acknowledges since swd_init()
+    uint32_t faults;        // FAULT acknowledges since swd_init()
+} swd_t;
+
+/**
+ * @brief Set up an SWD port.
+ * @param retries Repeats of a transfer answered by WAIT, e.g. SWD_WAIT_RETRIES.
+ * @param idle Idle cycles after every transfer, 0 for back to back transfers.
+ */
+void swd_init(swd_t* swd, uint32_t retries, uint8_t idle);
+
+/**
+ * @brief Line reset: SWD_LINE_RESET_CYCLES cycles with SWDIO high, then two idle cycles.
+ */
+void swd_line_reset();
+
+/**
+ * @brief Switch an SWJ-DP from JTAG to SWD, reset the line and read DPIDR,
+ * which takes the DP out of its reset state. The sticky flags are cleared.
+ * @return OK, or -ERR_TAP_DEVICE_UNAVAILABLE if no DP answers.
+ */
+status_t swd_connect(swd_t* swd);
+
+/**
+ * @brief Switch an SWJ-DP back to JTAG, and reset its TAP. SWDIO is left an
+ * output, as TMS.
+ */
+void swd_disconnect();
+
+/**
+ * @brief A single DP or AP register transfer, repeated while the DP answers WAIT.
+ * @param ap true for an AP register of the selected AP, false for a DP register.
+ * @param reg Register address, only A[3:2] are sent.
+ * @param out Read data, not used by writes. AP reads are posted (see above).
+ * @return OK, -ERR_TIMEOUT if the DP kept answering WAIT, -ERR_BUS_FAULT on FAULT,
+ * -ERR_BAD_CHECKSUM on a read parity error, -ERR_TAP_DEVICE_UNAVAILABLE if no valid ACK.
+ */
+status_t swd_transfer(swd_t* swd, bool ap, bool read, uint8_t reg, uint32_t in, uint32_t* out);
+
+#endif
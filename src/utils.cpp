@@ -35,6 +35,136 @@ void send_data_to_host(uint8_t* buf, uint16_t chunk_size)
     Serial.flush();
 }
 
+void send_frame_to_host(const uint8_t* payload, uint16_t len)
+{
+    uint32_t crc = crc32_update(0, payload, len);
+    uint8_t header[2] = { (uint8_t)len, (uint8_t)(len >> 8) };
+    uint8_t trailer[4] = { (uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24) };
+
+    Serial.write(header, sizeof(header));
+    if (len > 0)
+        Serial.write(payload, len);
+    Serial.write(trailer, sizeof(trailer));
+}
+
+void words_to_le_bytes(const uint32_t* words, uint8_t* bytes, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        bytes[4 * i] = words[i];
+        bytes[4 * i + 1] = words[i] >> 8;
+        bytes[4 * i + 2] = words[i] >> 16;
+        bytes[4 * i + 3] = words[i] >> 24;
+    }
+}
+
+void send_words_frame_to_host(const uint32_t* words, uint16_t count)
+{
+    uint8_t bytes[64];
+    uint16_t len = count * 4;
+    uint8_t header[2] = { (uint8_t)len, (uint8_t)(len >> 8) };
+    uint8_t trailer[4];
+    uint32_t crc = 0;
+    uint16_t n;
+
+    // packed and sent a few words at a time, the CRC-32 follows the payload
+    Serial.write(header, sizeof(header));
+    while (count > 0)
+    {
+        n = min(count, (uint16_t)(sizeof(bytes) / 4));
+        words_to_le_bytes(words, bytes, n);
+        crc = crc32_update(crc, bytes, n * 4);
+        Serial.write(bytes, n * 4);
+        words += n;
+        count -= n;
+    }
+
+    trailer[0] = crc;
+    trailer[1] = crc >> 8;
+    trailer[2] = crc >> 16;
+    trailer[3] = crc >> 24;
+    Serial.write(trailer, sizeof(trailer));
+}
+
+void send_dump_header_to_host(uint32_t addr, uint32_t words, uint16_t frame_words)
+{
+    Serial.print("\n@dump 0x"); Serial.print(addr, HEX);
+    Serial.print(" "); Serial.print(words, DEC);
+    Serial.print(" "); Serial.println(frame_words, DEC);
+}
+
+void send_dump_end_to_host(uint32_t addr, status_t rc)
+{
+    send_frame_to_host(nullptr, 0);
+    Serial.flush();
+
+    if (rc != OK)
+    {
+        Serial.print("\nMemory access failed at 0x"); Serial.println(addr, HEX);
+    }
+}
+
+void frame_rx_begin(frame_rx_t* rx, uint8_t* buf, uint16_t size)
+{
+    rx->buf = buf;
+    rx->size = size;
+    rx->len = 0;
+    rx->received = 0;
+    rx->crc = 0;
+    rx->complete = false;
+}
+
+status_t frame_rx_poll(frame_rx_t* rx)
+{
+    uint32_t pos;
+    uint8_t c;
+
+    while (!rx->complete && Serial.available() > 0)
+    {
+        c = Serial.read();
+        pos = rx->received++;
+
+        // length, payload and CRC-32 fields
+        if (pos < 2) {
+            rx->len |= (uint16_t)c << (8 * pos);
+            if (pos == 1 && rx->len > rx->size)
+                return -ERR_OUT_OF_BOUNDS;
+        }
+        else if (pos < 2 + (uint32_t)rx->len) {
+            rx->buf[pos - 2] = c;
+        }
+        else {
+            rx->crc |= (uint32_t)c << (8 * (pos - 2 - rx->len));
+            if (rx->received == 2 + (uint32_t)rx->len + 4)
+            {
+                if (rx->crc != crc32_update(0, rx->buf, rx->len))
+                    return -ERR_BAD_CHECKSUM;
+                rx->complete = true;
+            }
+        }
+    }
+
+    return OK;
+}
+
+status_t frame_rx_wait(frame_rx_t* rx, uint32_t timeout_ms)
+{
+    uint32_t begin = millis();
+    status_t rc = OK;
+
+    while (!rx->complete)
+    {
+        rc = frame_rx_poll(rx);
+        if (rc != OK)
+            return rc;
+
+        if (millis() - begin > timeout_ms)
+            return -ERR_TIMEOUT;
+    }
+
+    return OK;
+}
+
 char serial_event(char character)
 {
   char inChar = '\0';
@@ -123,7 +253,8 @@ status_t parse_number(uint8_t* dest, uint32_t size, const char* message, uint32_
     status_t rc = OK;
     char prefix = '0';
 
-    if ((dest == nullptr) || (size == 0) || (message == nullptr) || (out == nullptr))
+    // dest is optional, when nullptr only the uint32 value is returned
+    if ((size == 0) || (message == nullptr) || (out == nullptr))
     {
         Serial.println("\nparse_number bad function parameter");
         rc = -ERR_BAD_PARAMETER;
@@ -154,14 +285,16 @@ status_t parse_number(uint8_t* dest, uint32_t size, const char* message, uint32_
                 goto exit;
         }
 
-        // Prepare the character array (the buffer)
-        char tmp[digits.length() + 1];  // with 1 extra char for '/0'
-        // convert String to char array
-        digits.toCharArray(tmp, digits.length() + 1);
-        // add null terminator
-        tmp[digits.length()] = '\0';
-        // convert to unsigned int
-        *out = strtoul(tmp, NULL, 16);
+        {
+            // Prepare the character array (the buffer)
+            char tmp[digits.length() + 1];  // with 1 extra char for '/0'
+            // convert String to char array
+            digits.toCharArray(tmp, digits.length() + 1);
+            // add null terminator
+            tmp[digits.length()] = '\0';
+            // convert to unsigned int
+            *out = strtoul(tmp, NULL, 16);
+        }
         break;
 
     // user sent binary format
@@ -188,7 +321,8 @@ status_t parse_number(uint8_t* dest, uint32_t size, const char* message, uint32_
             digits.toCharArray(tmp, digits.length() + 1);
             tmp[digits.length()] = '\0';
             *out = strtoul(tmp, NULL, 10);
-            rc = int_to_bin_array(dest, *out, size);
+            if (dest != nullptr)
+                rc = int_to_bin_array(dest, *out, size);
             break;
         }
 
@@ -521,3 +655,26 @@ void print_array(uint8_t* arr, uint32_t len)
 
     Serial.flush();
 }
+
+// CRC-32 remainders of a single nibble, reflected polynomial 0xEDB88320.
+// a 16 entries table is a good trade between flash size and speed
+static const uint32_t crc32_nibble[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+    0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+    0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+uint32_t crc32_update(uint32_t crc, const uint8_t* data, uint32_t len)
+{
+    crc = ~crc;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0f];
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0f];
+    }
+
+    return ~crc;
+}
@@ -0,0 +1,154 @@
+#include <Arduino.h>
+
+#include "xc7_cfg.h"
+#include "xc7_ir.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+static void xc7_load_ir(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint32_t instr)
+{
+    int_to_bin_array(ir_in, instr, ir_len);
+    insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+}
+
+status_t xc7_status(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint32_t* status)
+{
+    // a dropped scan would return the bits captured by an earlier one
+    ir_shadow_invalidate();
+    xc7_load_ir(ir_len, ir_in, ir_out, XC7_ISC_NOOP);
+
+    return bin_array_to_uint32(ir_out, ir_len, status);
+}
+
+/**
+ * @brief Poll the IR capture until one of the status bits is set.
+ */
+static status_t xc7_wait_status(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint32_t bit, uint32_t timeout_ms)
+{
+    uint32_t start = millis();
+    uint32_t status = 0;
+    status_t rc;
+
+    while (true)
+    {
+        rc = xc7_status(ir_len, ir_in, ir_out, &status);
+        if (rc != OK)
+            return rc;
+        if (status & bit)
+            return OK;
+        if (millis() - start > timeout_ms)
+            return -ERR_TIMEOUT;
+    }
+}
+
+/**
+ * @brief Shift a chunk of the bitstream, in pieces, and feed the next
+ * chunk from the serial RX buffer in between.
+ */
+static status_t xc7_shift_chunk(const uint8_t* chunk, uint32_t len, frame_rx_t* next)
+{
+    uint32_t bytes;
+    status_t rc = OK;
+
+    for (uint32_t i = 0; i < len && rc == OK; i += bytes)
+    {
+        bytes = len - i < XC7_CFG_POLL_BYTES ? len - i : XC7_CFG_POLL_BYTES;
+        dr_stream_shift(&chunk[i], bytes, true);
+        rc = frame_rx_poll(next);
+    }
+
+    return rc;
+}
+
+status_t xc7_configure(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out)
+{
+    uint8_t chunks[2][XC7_CFG_CHUNK_WORDS * 4];
+    frame_rx_t rx[2];
+    uint32_t cur = 0;
+    uint32_t sent = 0;
+    uint32_t crc = 0;
+    uint32_t status = 0;
+    status_t rc = OK;
+
+    Serial.print("\n@program 0x0 0 "); Serial.println(XC7_CFG_CHUNK_WORDS, DEC);
+    Serial.flush();
+
+    // clear the configuration memory, INIT_COMPLETE is set after the housecleaning
+    xc7_load_ir(ir_len, ir_in, ir_out, XC7_JPROGRAM);
+    rc = xc7_wait_status(ir_len, ir_in, ir_out, XC7_IR_INIT_COMPLETE, XC7_INIT_TIMEOUT_MS);
+    if (rc != OK)
+    {
+        Serial.write('X');
+        Serial.println("\nINIT_COMPLETE did not go high after JPROGRAM");
+        return rc;
+    }
+
+    xc7_load_ir(ir_len, ir_in, ir_out, XC7_CFG_IN);
+    dr_stream_begin();
+
+    clear_serial_rx_buf();
+    frame_rx_begin(&rx[cur], chunks[cur], sizeof(chunks[cur]));
+    Serial.write('R');
+
+    while (true)
+    {
+        rc = frame_rx_wait(&rx[cur], XC7_CFG_TIMEOUT_MS);
+        if (rc != OK)
+            break;
+
+        // an empty frame ends the bitstream
+        if (rx[cur].len == 0)
+            break;
+        if (rx[cur].len % 4 != 0)
+        {
+            rc = -ERR_BAD_PARAMETER;
+            break;
+        }
+
+        crc = crc32_update(crc, chunks[cur], rx[cur].len);
+
+        // ask for the next chunk, it arrives while this one is shifted
+        frame_rx_begin(&rx[cur ^ 1], chunks[cur ^ 1], sizeof(chunks[cur ^ 1]));
+        Serial.write('R');
+
+        rc = xc7_shift_chunk(chunks[cur], rx[cur].len, &rx[cur ^ 1]);
+        if (rc != OK)
+            break;
+
+        sent += rx[cur].len / 4;
+        cur ^= 1;
+    }
+
+    // a scan that never shifted a bit cannot be ended from Shift-DR by dr_stream_end
+    if (sent == 0 && rc == OK)
+        rc = -ERR_BAD_PARAMETER;
+
+    if (rc != OK)
+    {
+        Serial.write('X');
+        reset_tap();
+        Serial.print("\nConfiguration failed after "); Serial.print(sent, DEC);
+        Serial.print(" words, error: "); Serial.println(rc, DEC);
+        return rc;
+    }
+
+    dr_stream_end(RUN_TEST_IDLE);
+
+    xc7_load_ir(ir_len, ir_in, ir_out, XC7_JSTART);
+    for (uint32_t i = 0; i < XC7_STARTUP_CYCLES; i++)
+        advance_tap_state(RUN_TEST_IDLE);
+
+    rc = xc7_wait_status(ir_len, ir_in, ir_out, XC7_IR_DONE, XC7_INIT_TIMEOUT_MS);
+    xc7_status(ir_len, ir_in, ir_out, &status);
+
+    Serial.print("\nShifted "); Serial.print(sent, DEC);
+    Serial.print(" words, CRC32: 0x"); Serial.print(crc, HEX);
+    Serial.print(", IR status: 0x"); Serial.println(status, HEX);
+    if (rc != OK)
+        Serial.println("DONE did not go high, check the bitstream");
+    else
+        Serial.println("DONE");
+
+    return rc;
+}
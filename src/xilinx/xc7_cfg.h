@@ -0,0 +1,66 @@
+/** @file xc7_cfg.h
+ *
+ * @brief JTAG configuration of Xilinx 7-series FPGAs (UG470): the device is
+ * cleared with JPROGRAM, and once INIT_COMPLETE is captured in the IR the
+ * bitstream is shifted through CFG_IN as a single DR scan, which the host
+ * streams in chunks. The scan waits in Pause-DR between the chunks, so its
+ * length is not limited by the memory of the driver. JSTART and the startup
+ * clocks in Run-Test/Idle then bring the design up, and DONE is polled in the IR.
+ */
+#ifndef __XC7_CFG__H__
+#define __XC7_CFG__H__
+
+#include <stdint.h>
+
+#include "../../include/status.h"
+
+/**
+ * Number of 32 bit words in every chunk of a bitstream from the host.
+ * Two chunks are buffered, one is shifted while the next one arrives.
+ */
+#define XC7_CFG_CHUNK_WORDS 256
+
+/**
+ * Bytes shifted between two polls of the serial RX buffer, so it does not
+ * overflow while a chunk is shifted.
+ */
+#define XC7_CFG_POLL_BYTES 32
+
+/**
+ * Time to wait for a chunk of the bitstream from the host.
+ */
+#define XC7_CFG_TIMEOUT_MS 2000
+
+/**
+ * Time for the housecleaning of JPROGRAM, until INIT_COMPLETE.
+ */
+#define XC7_INIT_TIMEOUT_MS 100
+
+/**
+ * TCK cycles in Run-Test/Idle after JSTART, for the startup sequence
+ * (UG470 asks for at least 2000 with the JTAG startup clock).
+ */
+#define XC7_STARTUP_CYCLES 2000
+
+/**
+ * @brief Read the status bits the device captures in the IR (XC7_IR_*),
+ * with an IR scan of ISC_NOOP that is never dropped by the IR shadow cache.
+ */
+status_t xc7_status(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint32_t* status);
+
+/**
+ * @brief Configure the device with a bitstream streamed from the host.
+ * The bitstream is sent once as a text line
+ *
+ *   "@program 0x0 0 <words per chunk>"
+ *
+ * (0 words: the length is not known in advance), and then the host sends the
+ * next chunk of the bitstream as a frame (see send_frame_to_host) for every
+ * 'R' byte it gets, and an empty frame after the last one. The bits of every
+ * byte are shifted MSB first, as the bytes of a .bit / .bin file are ordered.
+ * An 'X' byte tells the host to stop.
+ * @return OK if DONE went high, -ERR_TIMEOUT if INIT_COMPLETE or DONE did not.
+ */
+status_t xc7_configure(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out);
+
+#endif
@@ -0,0 +1,80 @@
+/* --------------------------------------------------------------------------------------- */
+/* -------------------- Commands of Xilinx 7-series FPGAs ---------------------------------*/
+/* --------------------------------------------------------------------------------------- */
+#include <stdint.h>
+
+#include "xc7_funcs.h"
+#include "xc7_cfg.h"
+#include "xc7_ir.h"
+#include "../jtag_drv/jtag_drv.h"
+#include "../../include/main.h"
+#include "../../include/utils.h"
+
+/**
+ * @brief Print the Xilinx 7-series menu.
+ */
+static void xc7_print_menu()
+{
+    Serial.flush();
+    Serial.print("\n\nXilinx 7-series Menu:\n");
+    Serial.print("s - Read configuration status (IR capture)\n");
+    Serial.print("u - Read USERCODE\n");
+    Serial.print("p - Configure with a bitstream from host (binary)\n");
+    Serial.print("z - Exit\n");
+    Serial.flush();
+}
+
+/**
+ * @brief Prompts the user to choose what to execute
+ * from the available menu of Xilinx 7-series commands.
+ */
+void xc7_main(const uint8_t ir_len, uint8_t* ir_in, uint8_t* ir_out, uint8_t* dr_in, uint8_t* dr_out)
+{
+    uint32_t value = 0;
+    status_t rc = OK;
+
+    xc7_print_menu();
+    char command = get_character("\nxc7 > ");
+
+    switch (command)
+    {
+    case 's':
+        rc = xc7_status(ir_len, ir_in, ir_out, &value);
+        if (rc != OK)
+            break;
+        Serial.print("\nIR status: 0x"); Serial.print(value, HEX);
+        Serial.print(", INIT_COMPLETE: "); Serial.print(value & XC7_IR_INIT_COMPLETE ? 1 : 0, DEC);
+        Serial.print(", DONE: "); Serial.println(value & XC7_IR_DONE ? 1 : 0, DEC);
+        break;
+
+    case 'u':
+        int_to_bin_array(ir_in, XC7_USERCODE, ir_len);
+        insert_ir(ir_in, ir_out, ir_len, RUN_TEST_IDLE);
+        clear_reg(dr_in, 32);
+        insert_dr(dr_in, dr_out, 32, RUN_TEST_IDLE);
+        rc = bin_array_to_uint32(dr_out, 32, &value);
+        if (rc != OK)
+            break;
+        Serial.print("\nUSERCODE: 0x"); Serial.println(value, HEX);
+        break;
+
+    case 'p':
+        // the bitstream is streamed by the host tool, see program.py
+        reset_tap();
+        rc = xc7_configure(ir_len, ir_in, ir_out);
+        break;
+
+    case 'z':
+        // quit Xilinx commands menu
+        Serial.print("\nGoing back to main menu...");
+        break;
+
+    default:
+        break;
+    }
+
+    if (rc != OK)
+    {
+        Serial.print("\nConfiguration access failed: "); Serial.println(rc, DEC);
+    }
+}
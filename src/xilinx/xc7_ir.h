@@ -0,0 +1,32 @@
+/** @file xc7_ir.h
+ *
+ * @brief IR instructions of the configuration TAP of Xilinx 7-series FPGAs
+ * (UG470, JTAG configuration), and the status bits captured in the IR.
+ */
+#ifndef __XC7_IR__H__
+#define __XC7_IR__H__
+
+#define XC7_IR_LEN      6
+
+#define XC7_USER1       0x02
+#define XC7_USER2       0x03
+#define XC7_CFG_OUT     0x04
+#define XC7_CFG_IN      0x05
+#define XC7_USERCODE    0x08
+#define XC7_IDCODE      0x09
+#define XC7_JPROGRAM    0x0b
+#define XC7_JSTART      0x0c
+#define XC7_JSHUTDOWN   0x0d
+#define XC7_ISC_NOOP    0x14
+#define XC7_BYPASS      0x3f
+
+/**
+ * Bits captured in the IR (Capture-IR), shifted out by every IR scan.
+ * The two LSBs are the 01 of IEEE 1149.1.
+ */
+#define XC7_IR_ISC_DONE       (1 << 2)
+#define XC7_IR_ISC_ENABLED    (1 << 3)
+#define XC7_IR_INIT_COMPLETE  (1 << 4)
+#define XC7_IR_DONE           (1 << 5)
+
+#endif
@@ -0,0 +1,46 @@
+/* --------------------------------------------------------------------------------------- */
+/* -------------------- Device profile of the Xilinx 7-series FPGA family -----------------*/
+/* --------------------------------------------------------------------------------------- */
+#include <stdint.h>
+
+#include "xc7_ir.h"
+#include "xc7_funcs.h"
+#include "../profile/profile.h"
+
+static constexpr profile_part_t xc7_parts[] = {
+    { "XC7A35T",  0x0362d093 },
+    { "XC7A50T",  0x0362c093 },
+    { "XC7A100T", 0x03631093 },
+    { "XC7A200T", 0x03636093 },
+    { "XC7K325T", 0x03651093 },
+    { "XC7Z010",  0x03722093 },
+    { "XC7Z020",  0x03727093 },
+};
+
+// DR lengths of the configuration registers depend on the part or the design
+static constexpr profile_instr_t xc7_instrs[] = {
+    { "USER1",     XC7_USER1,     0,  0 },
+    { "USER2",     XC7_USER2,     0,  0 },
+    { "CFG_OUT",   XC7_CFG_OUT,   0,  0 },
+    { "CFG_IN",    XC7_CFG_IN,    0,  0 },
+    { "USERCODE",  XC7_USERCODE,  32, 0 },
+    { "IDCODE",    XC7_IDCODE,    32, 0 },
+    { "JPROGRAM",  XC7_JPROGRAM,  1,  0 },
+    { "JSTART",    XC7_JSTART,    1,  0 },
+    { "JSHUTDOWN", XC7_JSHUTDOWN, 1,  0 },
+    { "ISC_NOOP",  XC7_ISC_NOOP,  1,  0 },
+    { "BYPASS",    XC7_BYPASS,    1,  0 },
+};
+
+// Xilinx parts of the 7-series (family bits 0x1b), of any version
+extern constexpr profile_t xc7_profile = {
+    "Xilinx 7-series",
+    XC7_IR_LEN,
+    0x0fe00fff,
+    0x03600093,
+    xc7_parts,
+    sizeof(xc7_parts) / sizeof(xc7_parts[0]),
+    xc7_instrs,
+    sizeof(xc7_instrs) / sizeof(xc7_instrs[0]),
+    xc7_main,
+};